@@ -117,6 +117,7 @@ MSystem *BigIron;
 char persistDir[256];
 char printDir[256];	
 char printApp[256];	
+char punchApp[256];
 
 u32 traceMaskx = 0;
 
@@ -155,6 +156,14 @@ double cycleTime;
 
 int main(int argc, char **argv)
 {
+	/*
+	**  Merge a disk overlay into its base container instead of running.
+	*/
+	if (argc > 2 && strcmp(argv[1], "-merge") == 0)
+	{
+		return(dd8xxMergeOverlay(argv[2], argc > 3 ? argv[3] : nullptr) ? 0 : 1);
+	}
+
 #if defined(_WIN32)
 	WSADATA wsaData;
 
@@ -203,6 +212,11 @@ int main(int argc, char **argv)
 
 	BigIron->CreateMainFrames();
 
+	/*
+	**  Start feeding decks from the card hot folder.
+	*/
+	deckWatch();
+
 	/*
 	**  Setup debug support.
 	*/
@@ -220,14 +234,10 @@ int main(int argc, char **argv)
 	CreateThreads();
 
 
-	while (BigIron->emulationActive)
-	{
-#if defined(_WIN32)
-		Sleep(1000);
-#else
-		Sleep(1);
-#endif
-	}
+	/*
+	**  Nothing for the main thread to do until shutdown.
+	*/
+	BigIron->WaitForStop();
 
 #if CcDebug == 1
 	/*
@@ -268,7 +278,26 @@ int main(int argc, char **argv)
 
 void CreateThreads()
 {
-	deadStart(0);
+	for (u8 k = 0; k < BigIron->initMainFrames; k++)
+	{
+		deadStart(k);
+	}
+
+	/*
+	**  Optionally replace the deadstarted state by a saved snapshot.
+	*/
+	if (*BigIron->resumeFile != '\0')
+	{
+		snapshotRestore(BigIron->resumeFile);
+	}
+
+	/*
+	**  Shared ECS is initialised, let other processes attach.
+	*/
+	memStoreShareReady();
+
+	snapshotInit();
+
 	CreateCPUThread(BigIron->chasis[0]->Acpu[0]);
 #if MaxCpus == 2
 	if ( BigIron->initCpus > 1)
@@ -279,7 +308,6 @@ void CreateThreads()
 #if MaxMainFrames > 1
 	if (BigIron->initMainFrames > 1)
 	{
-		deadStart(1);
 		CreateCPUThreadX(BigIron->chasis[1]->Acpu[0]);
 #if MaxCpus == 2
 		if (BigIron->initCpus > 1)
@@ -293,7 +321,6 @@ void CreateThreads()
 #if MaxMainFrames > 2
 	if (BigIron->initMainFrames > 2)
 	{
-		deadStart(2);
 		CreateCPUThreadY(BigIron->chasis[2]->Acpu[0]);
 #if MaxCpus == 2
 		if (BigIron->initCpus > 1)
@@ -308,7 +335,6 @@ void CreateThreads()
 #if MaxMainFrames > 3
 	if (BigIron->initMainFrames > 3)
 	{
-		deadStart(3);
 		CreateCPUThreadZ(BigIron->chasis[3]->Acpu[0]);
 #if MaxCpus == 2
 		if (BigIron->initCpus > 1)
@@ -699,7 +725,9 @@ void CreateCPUThread1Z(MCpu *cpu)
 void CPUThread(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
 	ncpu->mfr->cycles = 0;
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
@@ -748,9 +776,29 @@ void CPUThread(LPVOID pCpu)
 			RELEASE1(&BigIron->SysPpMutex);
 		}
 #endif
+		/*
+		**  Checkpoint cut, outside SysPpMutex so the other mainframes
+		**  can reach theirs, the end of a disk conversion and the stop
+		**  while another mainframe saves a snapshot.
+		*/
+		if (ncpu->mfr->checkpointCut)
+		{
+			memStoreCut(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->diskConvert)
+		{
+			dd8xxConvertFinish(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->snapshotHold)
+		{
+			snapshotHold(ncpu->mfr->mainFrameID);
+		}
+
 		// step CPU
 #if MaxCpus == 2
-		if (BigIron->initCpus > 1)	// tell cpu 1 thread it can run now too
+		if (BigIron->initCpus > 1 && !ncpu->mfr->Acpu[1]->cpu.cpuStopped)	// tell cpu 1 thread it can run now too
 			WakeConditionVariable(&ncpu->mfr->CpuRun);
 #endif
 		for (int i = 0; i < BigIron->cpuRatio; i++)
@@ -797,9 +845,16 @@ void CPUThread(LPVOID pCpu)
 void CPUThread1(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
+		/*
+		**  Block while the CPU is stopped, an exchange jump wakes us.
+		*/
+		ncpu->mfr->CpuPark(ncpu->cpu.CpuID);
+
 		// step CPU
 		// wait for cpu 0 thread to tell us to run
 #if MaxCpus == 2
@@ -840,7 +895,9 @@ void CPUThread1(LPVOID pCpu)
 void CPUThreadX(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
 	ncpu->mfr->cycles = 0;
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
@@ -893,9 +950,29 @@ void CPUThreadX(LPVOID pCpu)
 		}
 #endif
 
+		/*
+		**  Checkpoint cut, outside SysPpMutex so the other mainframes
+		**  can reach theirs, the end of a disk conversion and the stop
+		**  while another mainframe saves a snapshot.
+		*/
+		if (ncpu->mfr->checkpointCut)
+		{
+			memStoreCut(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->diskConvert)
+		{
+			dd8xxConvertFinish(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->snapshotHold)
+		{
+			snapshotHold(ncpu->mfr->mainFrameID);
+		}
+
 		// step CPU
 #if MaxCpus == 2
-		if (BigIron->initCpus > 1)	// tell cpu 1 thread it can run now too
+		if (BigIron->initCpus > 1 && !ncpu->mfr->Acpu[1]->cpu.cpuStopped)	// tell cpu 1 thread it can run now too
 			WakeConditionVariable(&ncpu->mfr->CpuRun);
 #endif
 		for (int i = 0; i < BigIron->cpuRatio; i++)
@@ -944,9 +1021,16 @@ void CPUThreadX(LPVOID pCpu)
 void CPUThread1X(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
+		/*
+		**  Block while the CPU is stopped, an exchange jump wakes us.
+		*/
+		ncpu->mfr->CpuPark(ncpu->cpu.CpuID);
+
 		//if (opActive)
 		//{
 		//	opRequest();
@@ -992,7 +1076,9 @@ void CPUThread1X(LPVOID pCpu)
 void CPUThreadY(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
 	ncpu->mfr->cycles = 0;
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
@@ -1045,9 +1131,29 @@ void CPUThreadY(LPVOID pCpu)
 		}
 #endif
 
+		/*
+		**  Checkpoint cut, outside SysPpMutex so the other mainframes
+		**  can reach theirs, the end of a disk conversion and the stop
+		**  while another mainframe saves a snapshot.
+		*/
+		if (ncpu->mfr->checkpointCut)
+		{
+			memStoreCut(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->diskConvert)
+		{
+			dd8xxConvertFinish(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->snapshotHold)
+		{
+			snapshotHold(ncpu->mfr->mainFrameID);
+		}
+
 		// step CPU
 #if MaxCpus == 2
-		if (BigIron->initCpus > 1)	// tell cpu 1 thread it can run now too
+		if (BigIron->initCpus > 1 && !ncpu->mfr->Acpu[1]->cpu.cpuStopped)	// tell cpu 1 thread it can run now too
 			WakeConditionVariable(&ncpu->mfr->CpuRun);
 #endif
 		for (int i = 0; i < BigIron->cpuRatio; i++)
@@ -1096,9 +1202,16 @@ void CPUThreadY(LPVOID pCpu)
 void CPUThread1Y(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
+		/*
+		**  Block while the CPU is stopped, an exchange jump wakes us.
+		*/
+		ncpu->mfr->CpuPark(ncpu->cpu.CpuID);
+
 		//if (opActive)
 		//{
 		//	opRequest();
@@ -1143,7 +1256,9 @@ void CPUThread1Y(LPVOID pCpu)
 void CPUThreadZ(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
 	ncpu->mfr->cycles = 0;
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
@@ -1196,9 +1311,29 @@ void CPUThreadZ(LPVOID pCpu)
 		}
 #endif
 
+		/*
+		**  Checkpoint cut, outside SysPpMutex so the other mainframes
+		**  can reach theirs, the end of a disk conversion and the stop
+		**  while another mainframe saves a snapshot.
+		*/
+		if (ncpu->mfr->checkpointCut)
+		{
+			memStoreCut(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->diskConvert)
+		{
+			dd8xxConvertFinish(ncpu->mfr->mainFrameID);
+		}
+
+		if (ncpu->mfr->snapshotHold)
+		{
+			snapshotHold(ncpu->mfr->mainFrameID);
+		}
+
 		// step CPU
 #if MaxCpus == 2
-		if (BigIron->initCpus > 1)	// tell cpu 1 thread it can run now too
+		if (BigIron->initCpus > 1 && !ncpu->mfr->Acpu[1]->cpu.cpuStopped)	// tell cpu 1 thread it can run now too
 			WakeConditionVariable(&ncpu->mfr->CpuRun);
 #endif
 		for (int i = 0; i < BigIron->cpuRatio; i++)
@@ -1247,9 +1382,16 @@ void CPUThreadZ(LPVOID pCpu)
 void CPUThread1Z(LPVOID pCpu)
 {
 	MCpu *ncpu = static_cast<MCpu*>(pCpu);
+	memStoreBindThread(ncpu->mfr->mainFrameID);
+	ncpu->mfr->threadStats[ncpu->cpu.CpuID].startUs = rtcHostMicroseconds();
 
 	while (BigIron->emulationActive)
 	{
+		/*
+		**  Block while the CPU is stopped, an exchange jump wakes us.
+		*/
+		ncpu->mfr->CpuPark(ncpu->cpu.CpuID);
+
 		//if (opActive)
 		//{
 		//	opRequest();
@@ -1276,6 +1418,48 @@ void CPUThread1Z(LPVOID pCpu)
 #endif
 
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Show how much host time each emulation thread spent
+**                  running versus parked with nothing to do.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void threadShowStats()
+{
+	u64 now = rtcHostMicroseconds();
+
+	printf("\n    Thread                 Busy (s)    Parked (s)     Parks   Busy %%\n");
+
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		MMainFrame *mfr = BigIron->chasis[k];
+
+		for (int i = 0; i < BigIron->initCpus; i++)
+		{
+			ThreadStats *ts = &mfr->threadStats[i];
+			if (ts->startUs == 0)
+			{
+				continue;
+			}
+
+			u64 total = now - ts->startUs;
+			u64 busy = total > ts->parkedUs ? total - ts->parkedUs : 0;
+
+			printf("    MF%d %-18s %10.1f    %10.1f  %8lu   %5.1f\n",
+				k,
+				i == 0 ? "CPU 0 + PPs" : "CPU 1",
+				static_cast<double>(static_cast<i64>(busy)) / 1000000.0,
+				static_cast<double>(static_cast<i64>(ts->parkedUs)) / 1000000.0,
+				static_cast<unsigned long>(ts->parks),
+				total == 0 ? 0.0 : 100.0 * static_cast<double>(static_cast<i64>(busy)) / static_cast<double>(static_cast<i64>(total)));
+		}
+	}
+}
+
+
 
 /*
 **--------------------------------------------------------------------------
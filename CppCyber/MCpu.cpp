@@ -105,6 +105,8 @@ void MCpu::Init(char *model, MMainFrame *mainfr)
 	cpuMaxMemory = mfr->cpuMaxMemory;
 	extMem = BigIron->extMem;
 	extMaxMemory = BigIron->extMaxMemory;
+	cmDirty = mfr->cmStore.dirty;
+	extDirty = BigIron->ecsStore.dirty;
 	mainFrameID = mfr->mainFrameID;
 
 
@@ -132,24 +134,9 @@ void MCpu::Init(char *model, MMainFrame *mainfr)
 void MCpu::Terminate() const
 {
 	/*
-	**  Optionally save CM.
+	**  Optionally save CM and free it.
 	*/
-
-	if (mfr->cmHandle != nullptr)
-	{
-		fseek(mfr->cmHandle, 0, SEEK_SET);
-		if (fwrite(cpMem, sizeof(CpWord), cpuMaxMemory, mfr->cmHandle) != cpuMaxMemory)
-		{
-			fprintf(stderr, "Error writing CM backing file\n");
-		}
-
-		fclose(mfr->cmHandle);
-	}
-
-	/*
-	**  Free allocated memory.
-	*/
-	free(cpMem);
+	memStoreClose(&mfr->cmStore);
 }
 
 
@@ -215,12 +202,14 @@ void MCpu::PpWriteMem(u32 address, CpWord data) const
 		if (address < cpuMaxMemory)
 		{
 			cpMem[address] = data & Mask60;
+			MarkDirty(cmDirty, address);
 		}
 	}
 	else
 	{
 		address %= cpuMaxMemory;
 		cpMem[address] = data & Mask60;
+		MarkDirty(cmDirty, address);
 	}
 }
 
@@ -261,7 +250,7 @@ bool MCpu::ExchangeJump(u32 addr, int monitorx, char *xjSource)
 		traceCpuPrint(this, stuff);
 		//  abort and dump
 		opActive = false;
-		BigIron->emulationActive = false;
+		BigIron->StopEmulation();
 #endif
 	}
 #if MaxCpus ==2
@@ -410,6 +399,8 @@ bool MCpu::ExchangeJump(u32 addr, int monitorx, char *xjSource)
 	**  Save old context.
 	*/
 	mem = cpMem + addr;
+	MarkDirty(cmDirty, addr);
+	MarkDirty(cmDirty, addr + 017);
 
 	*mem++ = (static_cast<CpWord>(tmp.regP & Mask18) << 36) | (static_cast<CpWord>(tmp.regA[0] & Mask18) << 18);
 	*mem++ = (static_cast<CpWord>(tmp.regRaCm & Mask24) << 36) | (static_cast<CpWord>(tmp.regA[1] & Mask18) << 18) | static_cast<CpWord>(tmp.regB[1] & Mask18);
@@ -490,6 +481,14 @@ bool MCpu::ExchangeJump(u32 addr, int monitorx, char *xjSource)
 		cpu.cpuStopped = true;
 	}
 
+	/*
+	**  Restart the CPU's thread if it is parked.
+	*/
+	if (!cpu.cpuStopped)
+	{
+		mfr->CpuWake(cpu.CpuID);
+	}
+
 
 //////////////////////////////
 
@@ -612,6 +611,36 @@ bool MCpu::Step()
 	return false;
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Write or read the CPU state for a snapshot, including
+**                  the partly executed instruction word.
+**
+**  Parameters:     Name        Description.
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void MCpu::Snapshot(FILE *fcb, bool restore)
+{
+	SnapshotVar(fcb, cpu, restore);
+	SnapshotVar(fcb, opOffset, restore);
+	SnapshotVar(fcb, opWord, restore);
+	SnapshotVar(fcb, opFm, restore);
+	SnapshotVar(fcb, opI, restore);
+	SnapshotVar(fcb, opJ, restore);
+	SnapshotVar(fcb, opK, restore);
+	SnapshotVar(fcb, opLength, restore);
+	SnapshotVar(fcb, opAddress, restore);
+	SnapshotVar(fcb, oldRegP, restore);
+	SnapshotVar(fcb, acc60, restore);
+	SnapshotVar(fcb, acc18, restore);
+	SnapshotVar(fcb, acc21, restore);
+	SnapshotVar(fcb, acc24, restore);
+	SnapshotVar(fcb, floatException, restore);
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Perform ECS flag register operation.
 **
@@ -625,6 +654,12 @@ bool MCpu::EcsFlagRegister(u32 ecsAddress)
 {
 	u32 flagFunction = (ecsAddress >> 21) & Mask3;
 	u32 flagWord = ecsAddress & Mask18;
+
+	if (BigIron->ecsStore.share != nullptr)
+	{
+		return(EcsSharedFlagRegister(BigIron->ecsStore.share, flagFunction, flagWord));
+	}
+
 #if MaxMainFrames > 1 || MaxCpus > 1
 	if (flagFunction != 6)
 	{
@@ -705,6 +740,86 @@ bool MCpu::EcsFlagRegister(u32 ecsAddress)
 	return(true);
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform ECS flag register operation on the register
+**                  shared with other emulator processes. Every function
+**                  is a single atomic operation on the shared word, so
+**                  no lock is needed.
+**
+**  Parameters:     Name        Description.
+**                  share       shared ECS segment header
+**                  flagFunction flag register function
+**                  flagWord    flag bits
+**
+**  Returns:        true if accepted, false otherwise.
+**
+**------------------------------------------------------------------------*/
+bool MCpu::EcsSharedFlagRegister(EcsShare *share, u32 flagFunction, u32 flagWord)
+{
+	i32 flags = static_cast<i32>(flagWord);
+	i32 old;
+
+	switch (flagFunction)
+	{
+	case 4:
+		/*
+		**  Ready/Select.
+		*/
+		do
+		{
+			old = share->flagRegister;
+			if ((old & flags) != 0)
+			{
+				return(false);
+			}
+#if defined(_WIN32)
+		} while (InterlockedCompareExchange(reinterpret_cast<volatile LONG *>(&share->flagRegister), old | flags, old) != old);
+#else
+		} while (__sync_val_compare_and_swap(&share->flagRegister, old, old | flags) != old);
+#endif
+		break;
+
+	case 5:
+		/*
+		**  Selective set.
+		*/
+#if defined(_WIN32)
+		InterlockedOr(reinterpret_cast<volatile LONG *>(&share->flagRegister), flags);
+#else
+		__sync_fetch_and_or(&share->flagRegister, flags);
+#endif
+		break;
+
+	case 6:
+		/*
+		**  Status.
+		*/
+		if ((share->flagRegister & flags) != 0)
+		{
+			return(false);
+		}
+
+		break;
+
+	case 7:
+		/*
+		**  Selective clear.
+		*/
+#if defined(_WIN32)
+		InterlockedAnd(reinterpret_cast<volatile LONG *>(&share->flagRegister), ~flags & Mask18);
+#else
+		__sync_fetch_and_and(&share->flagRegister, ~flags & Mask18);
+#endif
+		break;
+
+	default:
+		OpIllegal("EcsFlagRegister");
+		break;
+	}
+
+	return(true);
+}
+
 
 /*
 **--------------------------------------------------------------------------
@@ -728,6 +843,7 @@ void MCpu::OpIllegal(char * from)
 	if (cpu.regRaCm < cpuMaxMemory)
 	{
 		cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+		MarkDirty(cmDirty, cpu.regRaCm);
 	}
 
 	cpu.regP = 0;
@@ -776,6 +892,7 @@ bool MCpu::CheckOpAddress(u32 address, u32 *location)
 			if ((cpu.exitMode & EmAddressOutOfRange) != 0)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 		}
 
@@ -971,6 +1088,7 @@ bool MCpu::ReadMem(u32 address, CpWord *data)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1049,6 +1167,7 @@ bool MCpu::WriteMem(u32 address, CpWord *data)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1089,6 +1208,7 @@ bool MCpu::WriteMem(u32 address, CpWord *data)
 	**  Store the data.
 	*/
 	cpMem[location] = *data & Mask60;
+	MarkDirty(cmDirty, location);
 
 	return(false);
 }
@@ -1261,6 +1381,7 @@ void MCpu::UemWord(bool writeToUem)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1289,8 +1410,8 @@ void MCpu::UemWord(bool writeToUem)
 	{
 		if (uemAddress < cpuMaxMemory && (uemAddress & (3 << 21)) == 0)
 		{
-			// ReSharper disable once CppAssignedValueIsNeverUsed
-			cpMem[uemAddress++] = cpu.regX[opJ] & Mask60;
+			cpMem[uemAddress] = cpu.regX[opJ] & Mask60;
+			MarkDirty(cmDirty, uemAddress);
 		}
 	}
 	else
@@ -1348,6 +1469,7 @@ void MCpu::EcsWord(bool writeToEcs)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1376,8 +1498,8 @@ void MCpu::EcsWord(bool writeToEcs)
 	{
 		if (ecsAddress < extMaxMemory)
 		{
-			// ReSharper disable once CppAssignedValueIsNeverUsed
-			extMem[ecsAddress++] = cpu.regX[opJ] & Mask60;
+			extMem[ecsAddress] = cpu.regX[opJ] & Mask60;
+			MarkDirty(extDirty, ecsAddress);
 		}
 	}
 	else
@@ -1461,6 +1583,7 @@ void MCpu::UemTransfer(bool writeToUem)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1506,7 +1629,9 @@ void MCpu::UemTransfer(bool writeToUem)
 				return;
 			}
 
-			cpMem[uemAddress++] = cpMem[cmAddress] & Mask60;
+			cpMem[uemAddress] = cpMem[cmAddress] & Mask60;
+			MarkDirty(cmDirty, uemAddress);
+			uemAddress += 1;
 
 			/*
 			**  Increment CM address.
@@ -1531,11 +1656,13 @@ void MCpu::UemTransfer(bool writeToUem)
 				>>>>>>>>>>>> Maybe the manual is wrong about bits 21/22 and it should be bit 24 instead? <<<<<<<<<<<<<<<<
 				*/
 				cpMem[cmAddress] = 0;
+				MarkDirty(cmDirty, cmAddress);
 				takeErrorExit = true;
 			}
 			else
 			{
 				cpMem[cmAddress] = cpMem[uemAddress++] & Mask60;
+				MarkDirty(cmDirty, cmAddress);
 			}
 
 			/*
@@ -1649,6 +1776,7 @@ void MCpu::EcsTransfer(bool writeToEcs)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1693,7 +1821,9 @@ void MCpu::EcsTransfer(bool writeToEcs)
 				return;
 			}
 
-			extMem[ecsAddress++] = cpMem[cmAddress] & Mask60;
+			extMem[ecsAddress] = cpMem[cmAddress] & Mask60;
+			MarkDirty(extDirty, ecsAddress);
+			ecsAddress += 1;
 
 			/*
 			**  Increment CM address.
@@ -1714,11 +1844,13 @@ void MCpu::EcsTransfer(bool writeToEcs)
 				**  Zero CM, but take error exit to lower 30 bits once zeroing is finished.
 				*/
 				cpMem[cmAddress] = 0;
+				MarkDirty(cmDirty, cmAddress);
 				takeErrorExit = true;
 			}
 			else
 			{
 				cpMem[cmAddress] = extMem[ecsAddress++] & Mask60;
+				MarkDirty(cmDirty, cmAddress);
 			}
 
 			/*
@@ -1773,6 +1905,7 @@ bool MCpu::CmuGetByte(u32 address, u32 pos, u8 *byte)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1837,6 +1970,7 @@ bool MCpu::CmuPutByte(u32 address, u32 pos, u8 byte)
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -1878,6 +2012,7 @@ bool MCpu::CmuPutByte(u32 address, u32 pos, u8 byte)
 	**  Store the word.
 	*/
 	cpMem[location] = data & Mask60;
+	MarkDirty(cmDirty, location);
 
 	return(false);
 }
@@ -1933,6 +2068,7 @@ void MCpu::CmuMoveIndirect()
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -2041,6 +2177,7 @@ void MCpu::CmuMoveDirect()
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -2154,6 +2291,7 @@ void MCpu::CmuCompareCollated()
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -2297,6 +2435,7 @@ void MCpu::CmuCompareUncollated()
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
@@ -2432,6 +2571,7 @@ void MCpu::FloatExceptionHandler()
 			if (cpu.regRaCm < cpuMaxMemory)
 			{
 				cpMem[cpu.regRaCm] = (static_cast<CpWord>(cpu.exitCondition) << 48) | (static_cast<CpWord>(cpu.regP + 1) << 30);
+				MarkDirty(cmDirty, cpu.regRaCm);
 			}
 
 			cpu.regP = 0;
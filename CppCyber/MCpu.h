@@ -58,6 +58,7 @@ public:
 	bool ExchangeJump(u32 addr, int monitorx, char *xjSource);
 	bool Step();
 	bool EcsFlagRegister(u32 ecsAddress);
+	void Snapshot(FILE *fcb, bool restore);
 
 	/*
 	**  ----------------
@@ -75,6 +76,8 @@ public:
 	CpWord *extMem;
 	u32 cpuMaxMemory;
 	u32 extMaxMemory;
+	u8 *cmDirty;		// page dirty maps, null unless checkpointing
+	u8 *extDirty;
 
 private:
 	/*
@@ -83,6 +86,7 @@ private:
 	**  ---------------------------
 	*/
 	void OpIllegal(char *from);
+	bool EcsSharedFlagRegister(EcsShare *share, u32 flagFunction, u32 flagWord);
 	bool CheckOpAddress(u32 address, u32 *location);
 	void FetchOpWord(u32 address, CpWord *data);
 	void VoidIwStack(u32 branchAddr);
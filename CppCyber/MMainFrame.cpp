@@ -54,55 +54,18 @@ void MMainFrame::Init(u8 id, long memory)
 	INIT_COND_VAR(&XJDone);
 #endif
 
-	// allocate CM here
-
-	cpMem = static_cast<CpWord*>(calloc(memory, sizeof(CpWord)));
-	if (cpMem == nullptr)
-	{
-		fprintf(stderr, "Failed to allocate CPU memory\n");
-		exit(1);
-	}
+	memset(threadStats, 0, sizeof(threadStats));
 
+	/*
+	**  Allocate CM, optionally restoring it from the persist directory.
+	*/
+	char storeName[16];
+	sprintf(storeName, "cmStore%d", mainFrameID);
+	checkpointCut = false;
+	diskConvert = false;
+	cpMem = memStoreOpen(&cmStore, storeName, memory, mainFrameID, true);
 	cpuMaxMemory = memory;
 
-	if (*persistDir != '\0')
-	{
-		char fileName[256];
-
-		/*
-		**  Try to open existing CM file.
-		*/
-		char mfnum[10];
-		sprintf(mfnum, "%d", mainFrameID);
-		strcpy(fileName, persistDir);
-		strcat(fileName, "/cmStore");
-		strcat(fileName, mfnum);
-		cmHandle = fopen(fileName, "r+b");
-		if (cmHandle != nullptr)
-		{
-			/*
-			**  Read CM contents.
-			*/
-			if (fread(cpMem, sizeof(CpWord), cpuMaxMemory, cmHandle) != cpuMaxMemory)
-			{
-				printf("Unexpected length of CM backing file, clearing CM\n");
-				memset(cpMem, 0, cpuMaxMemory);
-			}
-		}
-		else
-		{
-			/*
-			**  Create a new file.
-			*/
-			cmHandle = fopen(fileName, "w+b");
-			if (cmHandle == nullptr)
-			{
-				fprintf(stderr, "Failed to create CM backing file\n");
-				exit(1);
-			}
-		}
-	}
-
 	u8 ppuCount = static_cast<u8>(BigIron->pps);
 
 	for (u8 pp = 0; pp < ppuCount; pp++)
@@ -181,6 +144,68 @@ void MMainFrame::Init(u8 id, long memory)
 
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Block the calling CPU thread while its CPU is stopped.
+**                  A stopped CPU can only be restarted by an exchange
+**                  jump, which calls CpuWake, so there is nothing to do
+**                  until then. CPU 0 shares its thread with the PPs and
+**                  never parks.
+**
+**  Parameters:     Name        Description.
+**                  cpuId       CPU number
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void MMainFrame::CpuPark(u8 cpuId)
+{
+#if MaxCpus == 2
+	MCpu *cpu = Acpu[cpuId];
+
+	if (cpuId == 0 || !cpu->cpu.cpuStopped)
+	{
+		return;
+	}
+
+	u64 start = rtcHostMicroseconds();
+
+	RESERVE1(&DummyMutex);
+	while (cpu->cpu.cpuStopped && BigIron->emulationActive)
+	{
+		SleepConditionVariableCS(&CpuRun, &DummyMutex, INFINITE);
+	}
+	RELEASE1(&DummyMutex);
+
+	threadStats[cpuId].parkedUs += rtcHostMicroseconds() - start;
+	threadStats[cpuId].parks += 1;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Wake a CPU thread parked in CpuPark. Taking the mutex
+**                  orders the wakeup after the caller's change of
+**                  cpuStopped, so a thread about to park cannot miss it.
+**
+**  Parameters:     Name        Description.
+**                  cpuId       CPU number
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void MMainFrame::CpuWake(u8 cpuId)
+{
+#if MaxCpus == 2
+	if (cpuId == 0 || BigIron->initCpus < 2)
+	{
+		return;
+	}
+
+	RESERVE1(&DummyMutex);
+	WakeConditionVariable(&CpuRun);
+	RELEASE1(&DummyMutex);
+#endif
+}
+
 /*---------------------------  End Of File  ------------------------------*/
 
 
@@ -42,6 +42,9 @@ public:
 
 	void Init(u8 id, long memory);
 
+	void CpuPark(u8 cpuId);
+	void CpuWake(u8 cpuId);
+
 	CpWord *cpMem;
 	u32 cpuMaxMemory;
 	int monitorCpu = -1;
@@ -161,8 +164,7 @@ public:
 
 	///
 
-	NpuBuffer *bufPool = nullptr;
-	int bufCount = 0;
+	NpuPool bufPools[NpuBufClasses];
 
 	NpuBuffer *bipUplineBuffer = nullptr;
 	NpuQueue *bipUplineQueue;
@@ -193,7 +195,14 @@ public:
 	NpuConnType connTypes[MaxConnTypes];
 	int numConnTypes = 0;
 
-	int pollIndex = 0;
+	int netPollFd = -1;
+#if defined(_WIN32)
+	HANDLE netEvent = nullptr;
+#endif
+	Tcb *volatile netSignalQ = nullptr;
+	Tcb *netReadyHead = nullptr;
+	Tcb *netReadyTail = nullptr;
+	NpuLinger *netLinger = nullptr;
 
 	///
 
@@ -206,6 +215,8 @@ public:
 
 	int cpuCnt = 0;		// count of active cpus
 
+	ThreadStats threadStats[MaxCpus];	// indexed by CPU, thread 0 also runs the PPs
+
 	ChSlot *channel;
 	u8 channelCount;
 
@@ -219,7 +230,10 @@ public:
 	CONDITION_VARIABLE CpuRun;
 #endif
 
-	FILE *cmHandle;
+	MemStore cmStore;
+	volatile bool checkpointCut;	// checkpoint thread wants a cut at the next barrel boundary
+	volatile bool diskConvert;		// a disk conversion waits to be finished at the next barrel boundary
+	volatile bool snapshotHold;		// a snapshot is being saved, stop at the next barrel boundary
 
 	u8 mainFrameID;
 	
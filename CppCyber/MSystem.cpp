@@ -59,6 +59,9 @@ static u32 featuresCyber865 =
 MSystem::MSystem()
 {
 	emulationActive = true;
+
+	InitializeCriticalSection(&StopMutex);
+	InitializeConditionVariable(&StopCond);
 }
 
 
@@ -79,14 +82,7 @@ void MSystem::CreateMainFrames()
 	INIT_MUTEX(&SysPpMutex, 0x0400);
 #endif
 
-	for (u8 i = 0; i < initMainFrames; i++)
-	{
-		chasis[i] = new MMainFrame();
-		chasis[i]->Init(i, memory);
-	}
-
-
-	// allocate ecs/ems here
+	// allocate ecs/ems here, before the CPUs pick up its address
 	switch (ecsBanks != 0 ? ECS : ESM)
 	{
 	case ECS:
@@ -99,55 +95,17 @@ void MSystem::CreateMainFrames()
 	}
 
 	/*
-	**  Allocate configured ECS memory.
+	**  Allocate configured ECS memory, optionally restoring it from the
+	**  persist directory.
 	*/
-	// ReSharper disable once CppDeclaratorMightNotBeInitialized
-	extMem = static_cast<CpWord*>(calloc((ecsBanks + esmBanks) * extBanksSize, sizeof(CpWord)));
-	if (extMem == nullptr)
-	{
-		fprintf(stderr, "Failed to allocate ECS memory\n");
-		exit(1);
-	}
-
 	// ReSharper disable once CppDeclaratorMightNotBeInitialized
 	extMaxMemory = (ecsBanks + esmBanks) * extBanksSize;
+	extMem = memStoreOpen(&ecsStore, "ecsStore", extMaxMemory, 0, false);
 
-	/*
-	**  Optionally read in persistent CM and ECS contents.
-	*/
-	if (*persistDir != '\0')
+	for (u8 i = 0; i < initMainFrames; i++)
 	{
-		char fileName[256];
-
-		/*
-		**  Try to open existing ECS file.
-		*/
-		strcpy(fileName, persistDir);
-		strcat(fileName, "/ecsStore");
-		ecsHandle = fopen(fileName, "r+b");
-		if (ecsHandle != nullptr)
-		{
-			/*
-			**  Read ECS contents.
-			*/
-			if (fread(extMem, sizeof(CpWord), extMaxMemory, ecsHandle) != extMaxMemory)
-			{
-				printf("Unexpected length of ECS backing file, clearing ECS\n");
-				memset(extMem, 0, extMaxMemory);
-			}
-		}
-		else
-		{
-			/*
-			**  Create a new file.
-			*/
-			ecsHandle = fopen(fileName, "w+b");
-			if (ecsHandle == nullptr)
-			{
-				fprintf(stderr, "Failed to create ECS backing file\n");
-				exit(1);
-			}
-		}
+		chasis[i] = new MMainFrame();
+		chasis[i]->Init(i, memory);
 	}
 }
 
@@ -393,6 +351,79 @@ void MSystem::InitCyber(char *config)
 		}
 	}
 
+	/*
+	**  Choose how CM and ECS are kept in the persist directory: mapped
+	**  (default) or read at startup and written at shutdown.
+	*/
+	long persistMap;
+	long persistSync;
+	long checkpoint;
+	(void)initGetInteger("persistMap", 1, &persistMap);
+	(void)initGetInteger("persistSync", 0, &persistSync);
+	if (persistSync < 0)
+	{
+		fprintf(stderr, "Entry 'persistSync' invalid in section [cyber] in %s - must be 0 or more seconds\n", startupFile);
+		exit(1);
+	}
+
+	/*
+	**  Optionally checkpoint CM and ECS into the persist directory.
+	*/
+	(void)initGetInteger("checkpoint", 0, &checkpoint);
+	if (checkpoint < 0)
+	{
+		fprintf(stderr, "Entry 'checkpoint' invalid in section [cyber] in %s - must be 0 or more seconds\n", startupFile);
+		exit(1);
+	}
+
+	if (checkpoint != 0 && *persistDir == '\0')
+	{
+		fprintf(stderr, "Entry 'checkpoint' in section [cyber] in %s requires 'persistDir'\n", startupFile);
+		exit(1);
+	}
+
+	/*
+	**  Optionally start from the last complete checkpoint rather than
+	**  from the backing files.
+	*/
+	long restoreCheckpoint;
+	(void)initGetInteger("restoreCheckpoint", 0, &restoreCheckpoint);
+	if (restoreCheckpoint != 0 && checkpoint == 0)
+	{
+		fprintf(stderr, "Entry 'restoreCheckpoint' in section [cyber] in %s requires 'checkpoint'\n", startupFile);
+		exit(1);
+	}
+
+	/*
+	**  Optionally allocate CM and ECS on huge pages and place each
+	**  mainframe's CM on its own NUMA node.
+	*/
+	long hugePages;
+	long numa;
+	(void)initGetInteger("hugePages", 0, &hugePages);
+	(void)initGetInteger("numa", 0, &numa);
+	if (hugePages != 0 && hugePages != 2 && hugePages != 1024)
+	{
+		fprintf(stderr, "Entry 'hugePages' invalid in section [cyber] in %s - must be 0, 2 or 1024 (MB)\n", startupFile);
+		exit(1);
+	}
+
+	/*
+	**  Optionally share ECS and its flag register with other emulator
+	**  processes, each running its own mainframe.
+	*/
+	char ecsShare[40];
+	(void)initGetString("ecsShare", "", ecsShare, sizeof(ecsShare));
+
+	/*
+	**  Make sure the vector pack and unpack kernels match the scalar
+	**  loops on this host.
+	*/
+	(void)bitpackCheck(false);
+
+	memStoreInit(persistMap != 0, static_cast<u32>(persistSync), static_cast<u32>(checkpoint), restoreCheckpoint != 0,
+		static_cast<u32>(hugePages), numa != 0, ecsShare);
+
 	/*
 	**  Determine where to print files
 	**  and check if directory exists.
@@ -426,6 +457,90 @@ void MSystem::InitCyber(char *config)
 		}
 	}
 
+	if (initGetString("punchApp", "", punchApp, 256))
+	{
+		struct stat s;
+		if (stat(punchApp, &s) != 0)
+		{
+			fprintf(stderr, "Entry 'punchApp' in section [cyber] in %s\n", startupFile);
+			fprintf(stderr, "specifies non-existing file '%s'.\n", punchApp);
+			exit(1);
+		}
+	}
+
+	/*
+	**  Optionally resume from a snapshot instead of deadstarting.
+	*/
+	if (initGetString("resume", "", resumeFile, 256))
+	{
+		struct stat s;
+		if (stat(resumeFile, &s) != 0)
+		{
+			fprintf(stderr, "Entry 'resume' in section [cyber] in %s\n", startupFile);
+			fprintf(stderr, "specifies non-existing file '%s'.\n", resumeFile);
+			exit(1);
+		}
+	}
+
+	/*
+	**  Optionally map 844/885 disk containers instead of reading and
+	**  writing them, and choose when written sectors go to disk.
+	*/
+	long diskMap;
+	long diskSync;
+	(void)initGetInteger("diskMap", 0, &diskMap);
+	(void)initGetInteger("diskSync", 0, &diskSync);
+	if (diskSync < 0 || diskSync > 2)
+	{
+		fprintf(stderr, "Entry 'diskSync' invalid in section [cyber] in %s - must be 0, 1 or 2\n", startupFile);
+		exit(1);
+	}
+
+	/*
+	**  Optionally cache sectors of disks which are not mapped.
+	*/
+	long diskCache;
+	long diskReadAhead;
+	(void)initGetInteger("diskCache", 0, &diskCache);
+	(void)initGetInteger("diskReadAhead", 8, &diskReadAhead);
+	if (diskCache < 0 || diskReadAhead < 0 || diskReadAhead > 64)
+	{
+		fprintf(stderr, "Entry 'diskCache' or 'diskReadAhead' invalid in section [cyber] in %s\n", startupFile);
+		exit(1);
+	}
+
+	dd8xxInitOptions(diskMap != 0, static_cast<u8>(diskSync), static_cast<u32>(diskCache), static_cast<u32>(diskReadAhead));
+
+	/*
+	**  Optionally mount tapes by VSN from a tape library directory, when
+	**  the console shows the tapeRequest text followed by a VSN. The
+	**  tape gets a write ring only if the tapeRingRequest text follows
+	**  the VSN on the same line.
+	*/
+	char tapeLibrary[256];
+	char tapeRequest[32];
+	char tapeRingRequest[32];
+	(void)initGetString("tapeRequest", "VSN=", tapeRequest, sizeof(tapeRequest));
+	(void)initGetString("tapeRingRequest", "", tapeRingRequest, sizeof(tapeRingRequest));
+	if (initGetString("tapeLibrary", "", tapeLibrary, sizeof(tapeLibrary)))
+	{
+		struct stat s;
+		if (stat(tapeLibrary, &s) != 0 || (s.st_mode & S_IFDIR) == 0)
+		{
+			fprintf(stderr, "Entry 'tapeLibrary' in section [cyber] in %s\n", startupFile);
+			fprintf(stderr, "specifies non-existing directory '%s'.\n", tapeLibrary);
+			exit(1);
+		}
+
+		vtlInit(tapeLibrary, tapeRequest, tapeRingRequest);
+	}
+
+	char cardHotFolder[256];
+	if (initGetString("cardHotFolder", "", cardHotFolder, sizeof(cardHotFolder)))
+	{
+		deckHotFolder(cardHotFolder);
+	}
+
 	(void)initGetInteger("autoRemovePaper", 0, &autoRemovePaper);
 
 	initMainFrames = MaxMainFrames;
@@ -875,37 +990,68 @@ void MSystem::InitEquipment(u8 mfrId)
 	}
 }
 
-void MSystem::Terminate() const
+/*--------------------------------------------------------------------------
+**  Purpose:        End emulation and wake every thread blocked waiting
+**                  for work so it can notice.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void MSystem::StopEmulation()
 {
+	EnterCriticalSection(&StopMutex);
+	emulationActive = false;
+	WakeAllConditionVariable(&StopCond);
+	LeaveCriticalSection(&StopMutex);
+
 	for (int k = 0; k < initMainFrames; k++)
 	{
-		chasis[k]->Acpu[0]->Terminate();  // first cpu will do the job for both in a  dual cpu config
+		for (u8 i = 0; i < initCpus; i++)
+		{
+			chasis[k]->CpuWake(i);
+		}
 	}
+}
 
-	/*
-	**  Optionally save ECS.
-	*/
-	if (ecsHandle != nullptr)
+/*--------------------------------------------------------------------------
+**  Purpose:        Block the main thread until emulation ends.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void MSystem::WaitForStop()
+{
+	EnterCriticalSection(&StopMutex);
+	while (emulationActive)
 	{
-		fseek(ecsHandle, 0, SEEK_SET);
-		if (fwrite(extMem, sizeof(CpWord), extMaxMemory, ecsHandle) != extMaxMemory)
-		{
-			fprintf(stderr, "Error writing ECS backing file\n");
-		}
+		SleepConditionVariableCS(&StopCond, &StopMutex, INFINITE);
+	}
+	LeaveCriticalSection(&StopMutex);
+}
 
-		fclose(ecsHandle);
+void MSystem::Terminate()
+{
+	for (int k = 0; k < initMainFrames; k++)
+	{
+		chasis[k]->Acpu[0]->Terminate();  // first cpu will do the job for both in a  dual cpu config
 	}
 
 	/*
-	**  Free allocated memory.
+	**  Optionally save ECS and free it.
 	*/
-	free(extMem);
+	memStoreClose(&ecsStore);
 
 	for (u8 k = 0; k < initMainFrames; k++)
 	{
 		Mpp::Terminate(k);
 		channelTerminate(k);
 	}
+
+	vtlTerminate();
 }
 
 
@@ -31,7 +31,9 @@ public:
 	MSystem();
 	~MSystem();
 
-	void Terminate() const;
+	void Terminate();
+	void StopEmulation();
+	void WaitForStop();
 
 	void InitStartup(char *config);
 	void FinishInitFile() const;
@@ -42,7 +44,7 @@ public:
 	void InitEquipment(u8 mfrId);
 	static u32 ConvertEndian(u32 value);
 
-	bool emulationActive;
+	volatile bool emulationActive;
 	bool bigEndian;
 
 	u16 mux6676TelnetPortx;
@@ -58,6 +60,9 @@ public:
 	CRITICAL_SECTION ECSFlagMutex;
 	CRITICAL_SECTION TraceMutex;
 #endif
+	CRITICAL_SECTION StopMutex;
+	CONDITION_VARIABLE StopCond;
+
 	long cpuRatio;
 
 	ModelType modelType;
@@ -76,7 +81,9 @@ public:
 
 	//u32 ecsFlagRegister;
 
-	FILE *ecsHandle;
+	MemStore ecsStore;
+
+	char resumeFile[256];
 
 	MMainFrame *chasis[MaxMainFrames];
 
@@ -161,6 +161,26 @@ void  Mpp::StepAll(u8 mfrID)
 	}
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Write or read the PP state for a snapshot.
+**
+**  Parameters:     Name        Description.
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void Mpp::Snapshot(FILE *fcb, bool restore)
+{
+	SnapshotVar(fcb, ppu, restore);
+	SnapshotVar(fcb, opF, restore);
+	SnapshotVar(fcb, opD, restore);
+	SnapshotVar(fcb, location, restore);
+	SnapshotVar(fcb, acc18, restore);
+	SnapshotVar(fcb, noHang, restore);
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Execute one instruction in an active PPU.
 **
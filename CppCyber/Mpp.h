@@ -39,6 +39,7 @@ public:
 
 	static void Terminate(u8 mfrID);
 	static void StepAll(u8 mfrID);
+	void Snapshot(FILE *fcb, bool restore);
 
 	PpSlot ppu;
 
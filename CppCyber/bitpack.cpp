@@ -0,0 +1,777 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: bitpack.cpp
+**
+**  Description:
+**      Pack and unpack 12 bit PP words to and from the byte layouts used
+**      by disk and tape containers: two PP words in three bytes (packed
+**      disk containers, TAP records) and one PP word in two 6 bit bytes
+**      (7 track TAP records, 6 bit conversion tables).
+**
+**      Coded tape records are translated through a character conversion
+**      table on the way, one record at a time.
+**
+**      The 12 bit layout uses SSSE3 byte shuffles when the host CPU has
+**      them, the 6 bit layout uses SSE2. Both fall back to the plain
+**      loops on other hosts and for the tail of a buffer. Only the low
+**      12 (or 6) bits of each input item are used, and every output word
+**      is masked, so callers see the same results on every path. The 64
+**      entry tables used on output are looked up with SSSE3 shuffles,
+**      one per 16 entries. The 256 entry tables used on input would take
+**      16 shuffles per vector, more than the plain loop, so coded input
+**      is always translated by the loop.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BitpackSse2
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(_WIN32)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define CheckWords              1024
+#define CheckRounds             256
+#define BenchGroups             161     /* one disk sector */
+#define BenchRounds             20000
+#define BenchRecord             4096    /* coded tape record, bytes */
+#define BenchRecords            2000
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if defined(BitpackSse2) && !defined(_WIN32)
+#define TargetSsse3 __attribute__((target("ssse3")))
+#else
+#define TargetSsse3
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct checkOut
+{
+	PpWord      w8To12[CheckWords];
+	u8          b12To8[CheckWords * 2];
+	PpWord      w6To12[CheckWords];
+	u8          b12To6[CheckWords * 2];
+	PpWord      w8To12Bytes[CheckWords + 2];
+	PpWord      w6To12Bytes[CheckWords + 1];
+	PpWord      wConv8To12[CheckWords + 1];
+	u8          bConv12To8[CheckWords * 2];
+	bool        illegal;
+} CheckOut;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void bitpackCheckRun(u8 *in, PpWord *wIn, u32 groups, u8 *table8, u8 *table6, CheckOut *out);
+static u32 bitpackRandom(u32 *seed);
+#if defined(BitpackSse2)
+static bool bitpackHasSsse3();
+static u32 bitpack8To12Ssse3(u8 *ip, PpWord *op, u32 groups);
+static u32 bitpack12To8Ssse3(PpWord *ip, u8 *op, u32 groups);
+static __m128i bitpackLookup(__m128i x, u8 *table, int rows);
+static u32 bitpackConvert12To8Ssse3(PpWord *ip, u8 *op, u32 words, u8 *table);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+#if defined(BitpackSse2)
+static bool useSsse3 = bitpackHasSsse3();
+static bool useSse2 = true;
+#endif
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack groups of three bytes into pairs of PP words.
+**
+**  Parameters:     Name        Description.
+**                  ip          input bytes (3 * groups)
+**                  op          output PP words (2 * groups)
+**                  groups      number of 3 byte groups
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpack8To12(u8 *ip, PpWord *op, u32 groups)
+{
+	u32 done = 0;
+
+#if defined(BitpackSse2)
+	if (useSsse3)
+	{
+		done = bitpack8To12Ssse3(ip, op, groups);
+		ip += done * 3;
+		op += done * 2;
+	}
+#endif
+
+	for (; done < groups; done++)
+	{
+		u16 c1 = ip[0];
+		u16 c2 = ip[1];
+		u16 c3 = ip[2];
+
+		*op++ = ((c1 << 4) | (c2 >> 4)) & Mask12;
+		*op++ = ((c2 << 8) | (c3 >> 0)) & Mask12;
+		ip += 3;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack pairs of PP words into groups of three bytes.
+**
+**  Parameters:     Name        Description.
+**                  ip          input PP words (2 * groups)
+**                  op          output bytes (3 * groups)
+**                  groups      number of PP word pairs
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpack12To8(PpWord *ip, u8 *op, u32 groups)
+{
+	u32 done = 0;
+
+#if defined(BitpackSse2)
+	if (useSsse3)
+	{
+		done = bitpack12To8Ssse3(ip, op, groups);
+		ip += done * 2;
+		op += done * 3;
+	}
+#endif
+
+	for (; done < groups; done++)
+	{
+		*op++ = ((ip[0] >> 4) & 0xFF);
+		*op++ = ((ip[0] << 4) & 0xF0) | ((ip[1] >> 8) & 0x0F);
+		*op++ = ((ip[1] >> 0) & 0xFF);
+		ip += 2;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack pairs of 6 bit bytes into PP words.
+**
+**  Parameters:     Name        Description.
+**                  ip          input bytes (2 * words)
+**                  op          output PP words
+**                  words       number of PP words
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpack6To12(u8 *ip, PpWord *op, u32 words)
+{
+	u32 done = 0;
+
+#if defined(BitpackSse2)
+	const __m128i mask6 = _mm_set1_epi16(Mask6);
+
+	for (; useSse2 && done + 8 <= words; done += 8)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i *>(ip));
+		__m128i hi = _mm_slli_epi16(_mm_and_si128(x, mask6), 6);
+		__m128i lo = _mm_and_si128(_mm_srli_epi16(x, 8), mask6);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(op), _mm_or_si128(hi, lo));
+		ip += 16;
+		op += 8;
+	}
+#endif
+
+	for (; done < words; done++)
+	{
+		*op++ = (static_cast<PpWord>(ip[0] & Mask6) << 6) | (static_cast<PpWord>(ip[1] & Mask6) << 0);
+		ip += 2;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack PP words into pairs of 6 bit bytes.
+**
+**  Parameters:     Name        Description.
+**                  ip          input PP words
+**                  op          output bytes (2 * words)
+**                  words       number of PP words
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpack12To6(PpWord *ip, u8 *op, u32 words)
+{
+	u32 done = 0;
+
+#if defined(BitpackSse2)
+	const __m128i mask6 = _mm_set1_epi16(Mask6);
+
+	for (; useSse2 && done + 8 <= words; done += 8)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i *>(ip));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(x, 6), mask6);
+		__m128i lo = _mm_slli_epi16(_mm_and_si128(x, mask6), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(op), _mm_or_si128(hi, lo));
+		ip += 8;
+		op += 16;
+	}
+#endif
+
+	for (; done < words; done++)
+	{
+		*op++ = ((*ip >> 6) & Mask6);
+		*op++ = ((*ip >> 0) & Mask6);
+		ip += 1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack a byte string of any length into PP words,
+**                  reading only the given bytes. A partial last group is
+**                  completed with fill bytes.
+**
+**  Parameters:     Name        Description.
+**                  ip          input bytes
+**                  op          output PP words (2 * ((bytes + 2) / 3))
+**                  bytes       number of input bytes
+**                  fill        value of the missing bytes
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpack8To12Bytes(u8 *ip, PpWord *op, u32 bytes, u8 fill)
+{
+	u32 groups = bytes / 3;
+	u32 rest = bytes - groups * 3;
+
+	bitpack8To12(ip, op, groups);
+
+	if (rest != 0)
+	{
+		u8 tail[3] = { fill, fill, fill };
+		memcpy(tail, ip + groups * 3, rest);
+		bitpack8To12(tail, op + groups * 2, 1);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack a string of 6 bit bytes of any length into PP
+**                  words, reading only the given bytes. An odd last byte
+**                  becomes the upper half of the last word.
+**
+**  Parameters:     Name        Description.
+**                  ip          input bytes
+**                  op          output PP words ((bytes + 1) / 2)
+**                  bytes       number of input bytes
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpack6To12Bytes(u8 *ip, PpWord *op, u32 bytes)
+{
+	u32 words = bytes / 2;
+
+	bitpack6To12(ip, op, words);
+
+	if ((bytes & 1) != 0)
+	{
+		op[words] = static_cast<PpWord>(ip[bytes - 1] & Mask6) << 6;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Translate a coded record through a conversion table
+**                  and pack the 6 bit characters into PP words. An odd
+**                  last character becomes the upper half of the last
+**                  word. There is no vector kernel, a shuffle lookup of
+**                  a 256 entry table is slower than this loop.
+**
+**  Parameters:     Name        Description.
+**                  ip          input bytes
+**                  op          output PP words ((bytes + 1) / 2)
+**                  bytes       number of input bytes
+**                  table       256 entry conversion table
+**
+**  Returns:        true if any translated character has the illegal
+**                  character bit (0100) set.
+**
+**------------------------------------------------------------------------*/
+bool bitpackConvert8To12(u8 *ip, PpWord *op, u32 bytes, u8 *table)
+{
+	u32 words = bytes / 2;
+	u8 seen = 0;
+
+	for (u32 done = 0; done < words; done++)
+	{
+		u8 c1 = table[ip[0]];
+		u8 c2 = table[ip[1]];
+
+		seen |= c1 | c2;
+		*op++ = (static_cast<PpWord>(c1 & Mask6) << 6) | (static_cast<PpWord>(c2 & Mask6) << 0);
+		ip += 2;
+	}
+
+	if ((bytes & 1) != 0)
+	{
+		u8 c1 = table[ip[0]];
+
+		seen |= c1;
+		*op = static_cast<PpWord>(c1 & Mask6) << 6;
+	}
+
+	return((seen & (1 << 6)) != 0);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack PP words into pairs of 6 bit characters and
+**                  translate them through a conversion table.
+**
+**  Parameters:     Name        Description.
+**                  ip          input PP words
+**                  op          output bytes (2 * words)
+**                  words       number of PP words
+**                  table       conversion table, indexed by 6 bit code
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void bitpackConvert12To8(PpWord *ip, u8 *op, u32 words, u8 *table)
+{
+	u32 done = 0;
+
+#if defined(BitpackSse2)
+	if (useSsse3)
+	{
+		done = bitpackConvert12To8Ssse3(ip, op, words, table);
+		ip += done;
+		op += done * 2;
+	}
+#endif
+
+	for (; done < words; done++)
+	{
+		*op++ = table[(*ip >> 6) & Mask6];
+		*op++ = table[(*ip >> 0) & Mask6];
+		ip += 1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check the vector kernels against the scalar loops on
+**                  random buffers of random length. On a mismatch the
+**                  vector kernels are switched off for the rest of the
+**                  run. Optionally time a disk sector round trip on
+**                  both paths.
+**
+**  Parameters:     Name        Description.
+**                  report      print the result and the timing
+**
+**  Returns:        true if both paths agree.
+**
+**------------------------------------------------------------------------*/
+bool bitpackCheck(bool report)
+{
+#if defined(BitpackSse2)
+	static u8 in[CheckWords * 2];
+	static PpWord wIn[CheckWords];
+	static CheckOut ref;
+	static CheckOut vec;
+	u8 table8[256];
+	u8 table6[64];
+	u32 seed = 012345;
+	bool ssse3 = useSsse3;
+	bool ok = true;
+
+	for (int round = 0; ok && round < CheckRounds; round++)
+	{
+		for (u32 i = 0; i < sizeof(in); i++)
+		{
+			in[i] = static_cast<u8>(bitpackRandom(&seed));
+		}
+
+		/*
+		**  Only the low 12 bits of a PP word are defined, but feed
+		**  all 16 so both paths are known to ignore the rest alike.
+		*/
+		for (u32 i = 0; i < CheckWords; i++)
+		{
+			wIn[i] = static_cast<PpWord>(bitpackRandom(&seed));
+		}
+
+		for (u32 i = 0; i < sizeof(table8); i++)
+		{
+			table8[i] = static_cast<u8>(bitpackRandom(&seed));
+		}
+
+		for (u32 i = 0; i < sizeof(table6); i++)
+		{
+			table6[i] = static_cast<u8>(bitpackRandom(&seed));
+		}
+
+		u32 groups = bitpackRandom(&seed) % (CheckWords / 2 + 1);
+
+		memset(&ref, 0, sizeof(ref));
+		memset(&vec, 0, sizeof(vec));
+
+		useSsse3 = false;
+		useSse2 = false;
+		bitpackCheckRun(in, wIn, groups, table8, table6, &ref);
+
+		useSsse3 = ssse3;
+		useSse2 = true;
+		bitpackCheckRun(in, wIn, groups, table8, table6, &vec);
+
+		ok = memcmp(&ref, &vec, sizeof(ref)) == 0;
+	}
+
+	if (!ok)
+	{
+		useSsse3 = false;
+		useSse2 = false;
+		fprintf(stderr, "bitpack: vector kernels disagree with the scalar loops, using the scalar loops\n");
+		return(false);
+	}
+
+	if (!report)
+	{
+		return(true);
+	}
+
+	/*
+	**  Time a packed disk sector round trip and the translation of a
+	**  coded tape record in both directions on both paths.
+	*/
+	static u8 record[BenchRecord];
+	static PpWord recordWords[BenchRecord / 2];
+	double us[3][2];
+
+	for (u32 i = 0; i < sizeof(record); i++)
+	{
+		record[i] = static_cast<u8>(bitpackRandom(&seed));
+	}
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		useSsse3 = pass == 0 ? false : ssse3;
+		useSse2 = pass != 0;
+
+		u64 start = rtcHostMicroseconds();
+		for (int i = 0; i < BenchRounds; i++)
+		{
+			bitpack8To12(in, ref.w8To12, BenchGroups);
+			bitpack12To8(ref.w8To12, in, BenchGroups);
+		}
+
+		us[0][pass] = static_cast<double>(static_cast<i64>(rtcHostMicroseconds() - start)) / BenchRounds;
+
+		start = rtcHostMicroseconds();
+		for (int i = 0; i < BenchRecords; i++)
+		{
+			bitpackConvert8To12(record, recordWords, BenchRecord, table8);
+		}
+
+		us[1][pass] = static_cast<double>(static_cast<i64>(rtcHostMicroseconds() - start)) / BenchRecords;
+
+		start = rtcHostMicroseconds();
+		for (int i = 0; i < BenchRecords; i++)
+		{
+			bitpackConvert12To8(recordWords, record, BenchRecord / 2, table6);
+		}
+
+		us[2][pass] = static_cast<double>(static_cast<i64>(rtcHostMicroseconds() - start)) / BenchRecords;
+	}
+
+	useSsse3 = ssse3;
+	useSse2 = true;
+
+	printf("bitpack: vector kernels agree with the scalar loops, SSSE3 %s\n", ssse3 ? "used" : "not available");
+	printf("bitpack: sector round trip %.0f ns scalar, %.0f ns vector\n", us[0][0] * 1000.0, us[0][1] * 1000.0);
+	printf("bitpack: coded %d byte record read %.0f ns scalar, %.0f ns vector\n", BenchRecord, us[1][0] * 1000.0, us[1][1] * 1000.0);
+	printf("bitpack: coded %d byte record write %.0f ns scalar, %.0f ns vector\n", BenchRecord, us[2][0] * 1000.0, us[2][1] * 1000.0);
+
+	return(true);
+#else
+	if (report)
+	{
+		printf("bitpack: no vector kernels on this host\n");
+	}
+
+	return(true);
+#endif
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Run every public kernel once for the self-check.
+**                  The 6 bit and byte string kernels get lengths that
+**                  are not multiples of the vector width.
+**
+**  Parameters:     Name        Description.
+**                  in          random bytes (CheckWords * 2)
+**                  wIn         random PP words (CheckWords)
+**                  groups      number of 12 bit groups, up to CheckWords / 2
+**                  table8      256 entry conversion table
+**                  table6      64 entry conversion table
+**                  out         results
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void bitpackCheckRun(u8 *in, PpWord *wIn, u32 groups, u8 *table8, u8 *table6, CheckOut *out)
+{
+	u32 bytes8 = groups * 3 - groups % 3;
+	u32 bytes6 = groups * 4 - (groups & 1);
+
+	bitpack8To12(in, out->w8To12, groups);
+	bitpack12To8(wIn, out->b12To8, groups);
+	bitpack6To12(in, out->w6To12, groups * 2);
+	bitpack12To6(wIn, out->b12To6, groups * 2);
+	bitpack8To12Bytes(in, out->w8To12Bytes, bytes8, 0xFF);
+	bitpack6To12Bytes(in, out->w6To12Bytes, bytes6);
+	out->illegal = bitpackConvert8To12(in, out->wConv8To12, bytes6, table8);
+	bitpackConvert12To8(wIn, out->bConv12To8, groups * 2 - (groups & 1), table6);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Simple pseudo random generator for the self-check.
+**
+**  Parameters:     Name        Description.
+**                  seed        generator state
+**
+**  Returns:        Next value, 16 bits.
+**
+**------------------------------------------------------------------------*/
+static u32 bitpackRandom(u32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return((*seed >> 8) & 0xFFFF);
+}
+
+#if defined(BitpackSse2)
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check whether the host CPU supports SSSE3.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if it does.
+**
+**------------------------------------------------------------------------*/
+static bool bitpackHasSsse3()
+{
+#if defined(_WIN32)
+	int info[4];
+	__cpuid(info, 1);
+	return((info[2] & (1 << 9)) != 0);
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+	{
+		return(false);
+	}
+
+	return((ecx & (1 << 9)) != 0);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack 3 byte groups into PP word pairs, four groups
+**                  per step. Each step loads 16 bytes but consumes 12, so
+**                  the last few groups are left to the caller's loop.
+**
+**                  The shuffle builds one big endian 16 bit lane per PP
+**                  word: b0:b1 for the first word of a group and b1:b2
+**                  for the second. The first is shifted right by 4, the
+**                  second masked to 12 bits.
+**
+**  Parameters:     Name        Description.
+**                  ip          input bytes
+**                  op          output PP words
+**                  groups      number of 3 byte groups
+**
+**  Returns:        Number of groups done.
+**
+**------------------------------------------------------------------------*/
+TargetSsse3 static u32 bitpack8To12Ssse3(u8 *ip, PpWord *op, u32 groups)
+{
+	const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	const __m128i even = _mm_set1_epi32(0x0000FFFF);
+	const __m128i odd = _mm_set1_epi32(0x0FFF0000);
+	u32 done = 0;
+
+	for (; done + 6 <= groups; done += 4)
+	{
+		__m128i x = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i *>(ip)), shuffle);
+		__m128i first = _mm_and_si128(_mm_srli_epi16(x, 4), even);
+		__m128i second = _mm_and_si128(x, odd);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(op), _mm_or_si128(first, second));
+		ip += 12;
+		op += 8;
+	}
+
+	return(done);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack PP word pairs into 3 byte groups, four pairs per
+**                  step. Each pair becomes a 24 bit value in a 32 bit
+**                  lane, whose three low bytes are then shuffled into
+**                  big endian order and stored as 12 bytes.
+**
+**  Parameters:     Name        Description.
+**                  ip          input PP words
+**                  op          output bytes
+**                  groups      number of PP word pairs
+**
+**  Returns:        Number of pairs done.
+**
+**------------------------------------------------------------------------*/
+TargetSsse3 static u32 bitpack12To8Ssse3(PpWord *ip, u8 *op, u32 groups)
+{
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m128i mask12 = _mm_set1_epi32(Mask12);
+	u32 done = 0;
+
+	for (; done + 4 <= groups; done += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i *>(ip));
+		__m128i first = _mm_slli_epi32(_mm_and_si128(x, mask12), 12);
+		__m128i second = _mm_and_si128(_mm_srli_epi32(x, 16), mask12);
+		x = _mm_shuffle_epi8(_mm_or_si128(first, second), shuffle);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(op), x);
+		u32 tail = static_cast<u32>(_mm_cvtsi128_si32(_mm_srli_si128(x, 8)));
+		memcpy(op + 8, &tail, sizeof(tail));
+		ip += 8;
+		op += 12;
+	}
+
+	return(done);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Look up 16 bytes in a table. Row k of the table holds
+**                  the entries 16 * k to 16 * k + 15; each row is
+**                  shuffled by the low nibbles and kept where the high
+**                  nibble is k.
+**
+**  Parameters:     Name        Description.
+**                  x           bytes to look up, all below 16 * rows
+**                  table       table
+**                  rows        number of 16 entry rows
+**
+**  Returns:        The table entries.
+**
+**------------------------------------------------------------------------*/
+TargetSsse3 static __m128i bitpackLookup(__m128i x, u8 *table, int rows)
+{
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	__m128i lo = _mm_and_si128(x, nibble);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+	__m128i result = _mm_setzero_si128();
+
+	for (int k = 0; k < rows; k++)
+	{
+		__m128i row = _mm_loadu_si128(reinterpret_cast<__m128i *>(table + 16 * k));
+		__m128i select = _mm_cmpeq_epi8(hi, _mm_set1_epi8(static_cast<char>(k)));
+		result = _mm_or_si128(result, _mm_and_si128(_mm_shuffle_epi8(row, lo), select));
+	}
+
+	return(result);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack 8 PP words into 16 characters per step and
+**                  translate them. 6 bit codes only need the first four
+**                  rows of the table.
+**
+**  Parameters:     Name        Description.
+**                  ip          input PP words
+**                  op          output bytes
+**                  words       number of PP words
+**                  table       conversion table, indexed by 6 bit code
+**
+**  Returns:        Number of words done.
+**
+**------------------------------------------------------------------------*/
+TargetSsse3 static u32 bitpackConvert12To8Ssse3(PpWord *ip, u8 *op, u32 words, u8 *table)
+{
+	const __m128i mask6 = _mm_set1_epi16(Mask6);
+	u32 done = 0;
+
+	for (; done + 8 <= words; done += 8)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i *>(ip));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(x, 6), mask6);
+		__m128i lo = _mm_slli_epi16(_mm_and_si128(x, mask6), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(op), bitpackLookup(_mm_or_si128(hi, lo), table, 4));
+		ip += 8;
+		op += 16;
+	}
+
+	return(done);
+}
+
+#endif
+
+/*---------------------------  End Of File  ------------------------------*/
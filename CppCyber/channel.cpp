@@ -129,6 +129,16 @@ void channelTerminate(u8 mfrID)
 {
 	DevSlot *dp;
 
+	/*
+	**  Write out buffered tape records before any unit file is closed.
+	*/
+	tapTerminate();
+
+	/*
+	**  Write out spooled print data and close the print files.
+	*/
+	spoolTerminate();
+
 	/*
 	**  Give some devices a chance to cleanup and free allocated memory of all
 	**  devices hanging of this channel.
@@ -152,6 +162,11 @@ void channelTerminate(u8 mfrID)
 				mt679Terminate(dp);
 			}
 
+			if (dp->devType == DtDd8xx)
+			{
+				dd8xxTerminate(dp);
+			}
+
 			/*
 			**  Free all unit contexts and close all open files.
 			*/
@@ -573,4 +588,123 @@ void channelStep(u8 mfrID)
 	}
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Write or read the state of all channels of a mainframe
+**                  and of the devices attached to them.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe ID
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        false if the snapshot does not match the configuration.
+**
+**------------------------------------------------------------------------*/
+bool channelSnapshot(u8 mfrID, FILE *fcb, bool restore)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrID];
+
+	for (u8 chNo = 0; chNo < mfr->channelCount; chNo++)
+	{
+		ChSlot *cc = mfr->channel + chNo;
+		DevSlot *dp;
+		int count = 0;
+		int ioIndex = -1;
+
+		/*
+		**  Devices are identified by their position in the channel's list,
+		**  which only depends on the equipment configuration.
+		*/
+		for (dp = cc->firstDevice; dp != nullptr; dp = dp->next)
+		{
+			if (dp == cc->ioDevice)
+			{
+				ioIndex = count;
+			}
+
+			count += 1;
+		}
+
+		int savedCount = count;
+		SnapshotVar(fcb, savedCount, restore);
+		if (savedCount != count)
+		{
+			return(false);
+		}
+
+		SnapshotVar(fcb, ioIndex, restore);
+		SnapshotVar(fcb, cc->data, restore);
+		SnapshotVar(fcb, cc->status, restore);
+		SnapshotVar(fcb, cc->active, restore);
+		SnapshotVar(fcb, cc->full, restore);
+		SnapshotVar(fcb, cc->discAfterInput, restore);
+		SnapshotVar(fcb, cc->flag, restore);
+		SnapshotVar(fcb, cc->inputPending, restore);
+		SnapshotVar(fcb, cc->delayStatus, restore);
+		SnapshotVar(fcb, cc->delayDisconnect, restore);
+
+		count = 0;
+		if (restore)
+		{
+			cc->ioDevice = nullptr;
+		}
+
+		for (dp = cc->firstDevice; dp != nullptr; dp = dp->next)
+		{
+			u8 devType = dp->devType;
+			u8 eqNo = dp->eqNo;
+
+			SnapshotVar(fcb, devType, restore);
+			SnapshotVar(fcb, eqNo, restore);
+			if (devType != dp->devType || eqNo != dp->eqNo)
+			{
+				return(false);
+			}
+
+			if (restore && count == ioIndex)
+			{
+				cc->ioDevice = dp;
+			}
+
+			count += 1;
+
+			SnapshotVar(fcb, dp->status, restore);
+			SnapshotVar(fcb, dp->fcode, restore);
+			SnapshotVar(fcb, dp->recordLength, restore);
+			SnapshotVar(fcb, dp->selectedUnit, restore);
+
+			/*
+			**  Device specific state. This may mount or unmount unit files.
+			*/
+			if (dp->snapshot != nullptr)
+			{
+				dp->snapshot(dp, fcb, restore);
+			}
+
+			/*
+			**  Position of every open unit file. TAP containers first put
+			**  their buffered records and position in the file.
+			*/
+			for (u8 unitNo = 0; unitNo < MaxUnits2; unitNo++)
+			{
+				if (!restore && dp->fcb[unitNo] != nullptr)
+				{
+					tapSnapshot(dp->fcb[unitNo], false);
+				}
+
+				i64 position = dp->fcb[unitNo] != nullptr ? TapTell(dp->fcb[unitNo]) : -1;
+
+				SnapshotVar(fcb, position, restore);
+				if (restore && position >= 0 && dp->fcb[unitNo] != nullptr)
+				{
+					TapSeek(dp->fcb[unitNo], position);
+					tapSnapshot(dp->fcb[unitNo], true);
+				}
+			}
+		}
+	}
+
+	return(true);
+}
+
 /*---------------------------  End Of File  ------------------------------*/
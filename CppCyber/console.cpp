@@ -823,11 +823,15 @@ static void consoleIo(u8 mfrId)
 					*/
 					windowSetX(static_cast<u16>((mfr->activeChannel->data & Mask9) + currentOffset));
 				}
+
+				vtlWatch(mfrId, '\n');
 			}
 			else
 			{
 				windowQueue(consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
 				windowQueue(consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
 			}
 
 			/*
@@ -981,11 +985,15 @@ static void consoleIo1(u8 mfrId)
 					*/
 					windowSetX1(static_cast<u16>((mfr->activeChannel->data & Mask9) + currentOffset1));
 				}
+
+				vtlWatch(mfrId, '\n');
 			}
 			else
 			{
 				windowQueue1(consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
 				windowQueue1(consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
 			}
 
 			/*
@@ -1140,11 +1148,15 @@ static void consoleIo2(u8 mfrId)
 					*/
 					windowSetX2(static_cast<u16>((mfr->activeChannel->data & Mask9) + currentOffset2));
 				}
+
+				vtlWatch(mfrId, '\n');
 			}
 			else
 			{
 				windowQueue2(consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
 				windowQueue2(consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
 			}
 
 			/*
@@ -1299,11 +1311,15 @@ static void consoleIo3(u8 mfrId)
 					*/
 					windowSetX3(static_cast<u16>((mfr->activeChannel->data & Mask9) + currentOffset3));
 				}
+
+				vtlWatch(mfrId, '\n');
 			}
 			else
 			{
 				windowQueue3(consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
 				windowQueue3(consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
+				vtlWatch(mfrId, consoleToAscii[(mfr->activeChannel->data >> 0) & Mask6]);
 			}
 
 			/*
@@ -149,6 +149,18 @@
 
 #define MaxIwStack              12
 
+/*
+**  CM/ECS pages tracked for incremental checkpoints.
+*/
+#define MemPageShift            9
+#define MemPageWords            (1 << MemPageShift)
+#define MarkDirty(map, addr)    do { if ((map) != nullptr) (map)[(addr) >> MemPageShift] = 1; } while (0)
+
+/*
+**  Emulator processes which may share one ECS.
+*/
+#define MaxEcsSharers           16
+
 #define FontLarge               32
 #define FontMedium              16
 #define FontSmall               8
@@ -252,12 +264,31 @@
 #define MaskActive              0x4000 
 #define MaskFull                0x2000
 
+/*
+**  TAP container read results other than a record length.
+*/
+#define TapMark                 0
+#define TapEof                  (-1)
+#define TapBot                  (-2)
+#define TapError                (-3)
+
 /*
 **  ----------------------
 **  Public Macro Functions
 **  ----------------------
 */
 #define LogErrorLocation        __FILE__, __LINE__
+
+/*
+**  Position a TAP container or other unit file at a 64 bit byte offset.
+*/
+#if defined(_WIN32)
+#define TapSeek(fcb, pos) _fseeki64((fcb), (pos), SEEK_SET)
+#define TapTell(fcb) _ftelli64(fcb)
+#else
+#define TapSeek(fcb, pos) fseeko((fcb), (pos), SEEK_SET)
+#define TapTell(fcb) ftello(fcb)
+#endif
 #if defined (__GNUC__) || defined(__SunOS)
 #define stricmp strcasecmp
 #endif
@@ -104,6 +104,8 @@ typedef struct
 	char    convtable[4096];
 	u32     getcardcycle;
 	char    card[322];
+	Spool   *spool;
+	bool    punched;
 } CpContext;
 
 
@@ -199,8 +201,8 @@ void cp3446Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	**  Open the device file.
 	*/
 	sprintf(fname, "CP3446_C%02o_E%o", channelNo, eqNo);
-	up->fcb[0] = fopen(fname, "w");
-	if (up->fcb[0] == nullptr)
+	cc->spool = spoolOpen(fname, "w");
+	if (cc->spool == nullptr)
 	{
 		fprintf(stderr, "Failed to open %s\n", fname);
 		exit(1);
@@ -253,7 +255,6 @@ void cp3446RemoveCards(char *params)
 	int equipmentNo;
 	int mfrID;
 	time_t currentTime;
-	char fname[80];
 	char fnameNew[80];
 
 	/*
@@ -293,18 +294,13 @@ void cp3446RemoveCards(char *params)
 	}
 
 	/*
-	**  Close the old device file.
+	**  Punch the card in progress and have the spooler rename the device
+	**  file to the format "CP3446_yyyymmdd_hhmmss" once the queued cards
+	**  are written. The rename replaces the file in one step, so the
+	**  completed deck never appears partly written.
 	*/
 	CpContext *cc = static_cast<CpContext *>(dp->context[0]);
 	cp3446FlushCard(dp, cc);
-	fflush(dp->fcb[0]);
-	fclose(dp->fcb[0]);
-	dp->fcb[0] = nullptr;
-
-	/*
-	**  Rename the device file to the format "CP3446_yyyymmdd_hhmmss".
-	*/
-	sprintf(fname, "CP3446_C%02o_E%o", channelNo, equipmentNo);
 
 	time(&currentTime);
 	struct tm t = *localtime(&currentTime);
@@ -316,25 +312,10 @@ void cp3446RemoveCards(char *params)
 		t.tm_min,
 		t.tm_sec);
 
-	if (rename(fname, fnameNew) != 0)
-	{
-		printf("Could not rename %s to %s - %s\n", fname, fnameNew, strerror(errno));
-		return;
-	}
-
 	/*
-	**  Open the device file.
+	**  The punchApp post-processor, if any, runs on the completed deck.
 	*/
-	dp->fcb[0] = fopen(fname, "w");
-
-	/*
-	**  Check if the open succeeded.
-	*/
-	if (dp->fcb[0] == nullptr)
-	{
-		printf("Failed to open %s\n", fname);
-		return;
-	}
+	spoolComplete(cc->spool, fnameNew, punchApp[0] != 0 ? punchApp : nullptr);
 
 	printf("Punch cards removed from 3446 card puncher\n");
 }
@@ -408,6 +389,14 @@ static FcStatus cp3446Func(PpWord funcCode, u8 mfrId)
 	case FcCp3446Clear:
 		cc->intmask = 0;
 		cc->binary = false;
+
+		// The punch goes idle at the end of a deck, so flush the punch file
+		if (cc->punched)
+		{
+			spoolFlush(cc->spool);
+			cc->punched = false;
+		}
+
 		st = FcProcessed;
 		break;
 
@@ -628,7 +617,7 @@ static void cp3446Disconnect(u8 mfrId)
 	{
 		cc->status |= StCp3446EoiInt;
 		dcc6681Interrupt((cc->status & cc->intmask) != 0, mfrId);
-		if (mfr->active3000Device->fcb[0] != nullptr && cc->col != 0)
+		if (cc->col != 0)
 		{
 			cp3446FlushCard(mfr->active3000Device, cc);
 		}
@@ -659,7 +648,7 @@ static void cp3446FlushCard(DevSlot *up, CpContext *cc)
 
 	if (cc->binary && cc->rawcard)
 	{
-		fputs("~raw", up->fcb[0]);
+		spoolWrite(cc->spool, "~raw", 4);
 		lc = cc->col;
 		cc->card[lc++] = '\n';
 	}
@@ -675,9 +664,10 @@ static void cp3446FlushCard(DevSlot *up, CpContext *cc)
 	/*
 	**  Write the card and reset for next card.
 	*/
-	fwrite(cc->card, 1, lc, up->fcb[0]);
+	spoolWrite(cc->spool, cc->card, lc);
 	cc->col = 0;
 	cc->lastnbcol = -1;
+	cc->punched = true;
 }
 
 /*--------------------------------------------------------------------------
@@ -84,6 +84,13 @@
 #define StCr3447CompareErr       02000
 #define StCr3447NonIntStatus     02177
 
+/*
+**  Deck card flags.
+*/
+#define CrCardRaw                0001
+#define CrCardBinary             0002   // 7/9 punch in column 1
+#define CrCardFile               0004   // 7/8 punch in column 1
+
 /*
 **  -----------------------
 **  Private Macro Functions
@@ -106,6 +113,8 @@ typedef struct
 	const u16 *table;
 	u32     getcardcycle;
 	PpWord  card[80];
+	DeckTray *tray;
+	bool    loaded;
 } CrContext;
 
 
@@ -119,6 +128,8 @@ static void cr3447Io(u8 mfrId);
 static void cr3447Activate(u8 mfrId);
 static void cr3447Disconnect(u8 mfrId);
 static void cr3447NextCard(DevSlot *up, CrContext *cc);
+static void cr3447ParseCard(void *param, char *buffer, DeckCard *dc);
+static void cr3447Feed(DevSlot *up, CrContext *cc);
 static char *cr3447Func2String(PpWord funcCode);
 
 /*
@@ -190,6 +201,7 @@ void cr3447Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	}
 
 	up->context[0] = static_cast<void *>(cc);
+	cc->tray = deckTrayOpen(cr3447ParseCard, 326, nullptr);
 
 	/*
 	**  Setup character set translation table.
@@ -215,9 +227,11 @@ void cr3447Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Load cards on 3447 card reader.
+**  Purpose:        Load cards on 3447 card reader. The deck is queued
+**                  behind any decks still in the input tray.
 **
 **  Parameters:     Name        Description.
+**                  params      "mainframe,channel,equipment,file"
 **
 **  Returns:        Nothing.
 **
@@ -227,24 +241,28 @@ void cr3447LoadCards(char *params)
 	int channelNo;
 	int equipmentNo;
 	int mfrID;
-	static char str[200];
+	char str[_MAX_PATH + 1];
 
 	/*
 	**  Operator wants to load new card stack.
 	*/
-	int numParam = sscanf(params, "%o,%o,%o,%s", &mfrID, &channelNo, &equipmentNo, str);
-
-	MMainFrame *mfr = BigIron->chasis[mfrID];
+	int numParam = sscanf(params, "%o,%o,%o,%256s", &mfrID, &channelNo, &equipmentNo, str);
 
 	/*
 	**  Check parameters.
 	*/
-	if (numParam != 3)
+	if (numParam != 4)
 	{
 		printf("Not enough or invalid parameters\n");
 		return;
 	}
 
+	if (mfrID < 0 || mfrID >= BigIron->initMainFrames)
+	{
+		printf("Invalid mainframe no\n");
+		return;
+	}
+
 	if (channelNo < 0 || channelNo >= MaxChannels)
 	{
 		printf("Invalid channel no\n");
@@ -263,48 +281,47 @@ void cr3447LoadCards(char *params)
 		return;
 	}
 
+	(void)cr3447LoadDeck(static_cast<u8>(mfrID), static_cast<u8>(channelNo), static_cast<u8>(equipmentNo), str);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue a deck file on a CR3447 card reader.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe
+**                  channelNo   channel
+**                  equipmentNo equipment
+**                  fileName    deck file
+**
+**  Returns:        false if there is no CR3447 on that channel.
+**
+**------------------------------------------------------------------------*/
+bool cr3447LoadDeck(u8 mfrID, u8 channelNo, u8 equipmentNo, char *fileName)
+{
 	/*
 	**  Locate the device control block.
 	*/
-	DevSlot *dp = dcc6681FindDevice(static_cast<u8>(mfrID), static_cast<u8>(channelNo), static_cast<u8>(equipmentNo), DtCr3447);
+	DevSlot *dp = dcc6681FindDevice(mfrID, channelNo, equipmentNo, DtCr3447);
 	if (dp == nullptr)
 	{
-		return;
+		return(false);
 	}
 
 	CrContext *cc = static_cast<CrContext *>(dp->context[0]);
 
 	/*
-	**  Ensure the tray is empty.
+	**  The deck is read in the background and fed to the reader at
+	**  its next function or I/O once the decks ahead have been read.
 	*/
-	if (dp->fcb[0] != nullptr)
+	if (!deckQueue(cc->tray, fileName))
 	{
-		printf("Input tray full\n");
-		return;
+		printf("Failed to open %s\n", fileName);
+		return(true);
 	}
 
-	dp->fcb[0] = nullptr;
-	cc->status = StCr3447Eof;
-
-	FILE *fcb = fopen(str, "r");
+	printf("CR3447 loaded with %s\n", fileName);
 
-	/*
-	**  Check if the open succeeded.
-	*/
-	if (fcb == nullptr)
-	{
-		printf("Failed to open %s\n", str);
-		return;
-	}
-
-	dp->fcb[0] = fcb;
-	cc->status = StCr3447Ready;
-	cr3447NextCard(dp, cc);
-
-	mfr->activeDevice = channelFindDevice(static_cast<u8>(channelNo), DtDcc6681, mfrID);
-	dcc6681Interrupt((cc->status & cc->intmask) != 0, mfrID);
-
-	printf("CR3447 loaded with %s", str);
+	return(true);
 }
 
 /*
@@ -341,6 +358,8 @@ static FcStatus cr3447Func(PpWord funcCode, u8 mfrId)
 
 	CrContext *cc = static_cast<CrContext *>(mfr->active3000Device->context[0]);
 
+	cr3447Feed(mfr->active3000Device, cc);
+
 	switch (funcCode)
 	{
 	default:                    // all unrecognized codes are NOPs
@@ -439,6 +458,8 @@ static void cr3447Io(u8 mfrId)
 
 	CrContext *cc = static_cast<CrContext *>(mfr->active3000Device->context[0]);
 
+	cr3447Feed(mfr->active3000Device, cc);
+
 	switch (mfr->active3000Device->fcode)
 	{
 	default:
@@ -470,7 +491,7 @@ static void cr3447Io(u8 mfrId)
 			break;
 		}
 
-		if (mfr->active3000Device->fcb[0] == nullptr)
+		if (!cc->loaded)
 		{
 			cc->status = StCr3447Eof;
 			break;
@@ -572,7 +593,7 @@ static void cr3447Disconnect(u8 mfrId)
 	{
 		cc->status |= StCr3447EoiInt;
 		dcc6681Interrupt((cc->status & cc->intmask) != 0, mfrId);
-		if (mfr->active3000Device->fcb[0] != nullptr && cc->col != 0)
+		if (cc->loaded && cc->col != 0)
 		{
 			cr3447NextCard(mfr->active3000Device, cc);
 		}
@@ -589,10 +610,6 @@ static void cr3447Disconnect(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void cr3447NextCard(DevSlot *up, CrContext *cc)
 {
-	static char buffer[326];
-	char c;
-	int i;
-
 	/*
 	**  Initialise read.
 	*/
@@ -601,10 +618,10 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 	cc->rawcard = false;
 
 	/*
-	**  Read the next card.
+	**  Take the next card from the deck.
 	*/
-	char *cp = fgets(buffer, sizeof(buffer), up->fcb[0]);
-	if (cp == nullptr)
+	DeckCard *dc = deckNextCard(cc->tray);
+	if (dc == nullptr)
 	{
 		/*
 		**  If the last card wasn't a 6/7/8/9 card, fake one.
@@ -618,12 +635,45 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 			return;
 		}
 
-		fclose(up->fcb[0]);
-		up->fcb[0] = nullptr;
+		cc->loaded = false;
 		cc->status = StCr3447Eof;
 		return;
 	}
 
+	cc->rawcard = (dc->flags & CrCardRaw) != 0;
+	if (dc->flags & CrCardBinary)
+	{
+		cc->status |= StCr3447Binary;
+	}
+	else if ((dc->flags & CrCardFile) != 0 && !cc->binary)
+	{
+		cc->status |= StCr3447File;
+	}
+
+	memcpy(cc->card, dc->card, sizeof(cc->card));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert a line of a deck file into a card. Called by
+**                  the deck loader thread.
+**
+**  Parameters:     Name        Description.
+**                  param       unused
+**                  buffer      line as read by fgets
+**                  dc          card
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cr3447ParseCard(void *param, char *buffer, DeckCard *dc)
+{
+	char *cp;
+	int i;
+
+	(void)param;
+
+	dc->flags = 0;
+
 	/*
 	**  Deal with special first-column codes.
 	*/
@@ -632,10 +682,9 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 		/*
 		**  EOI = 6/7/8/9 card.
 		*/
-		cc->rawcard = true;
-		cc->status |= StCr3447Binary;
-		memset(cc->card, 0, sizeof(cc->card));
-		cc->card[0] = 00017;
+		dc->flags = CrCardRaw | CrCardBinary;
+		memset(dc->card, 0, sizeof(dc->card));
+		dc->card[0] = 00017;
 		return;
 	}
 
@@ -646,10 +695,9 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 			/*
 			**  EOI = 6/7/8/9 card.
 			*/
-			cc->rawcard = true;
-			cc->status |= StCr3447Binary;
-			memset(cc->card, 0, sizeof(cc->card));
-			cc->card[0] = 00017;
+			dc->flags = CrCardRaw | CrCardBinary;
+			memset(dc->card, 0, sizeof(dc->card));
+			dc->card[0] = 00017;
 			return;
 		}
 
@@ -658,10 +706,9 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 			/*
 			**  EOF = 6/7/9 card.
 			*/
-			cc->rawcard = true;
-			cc->status |= StCr3447Binary;
-			memset(cc->card, 0, sizeof(cc->card));
-			cc->card[0] = 00015;
+			dc->flags = CrCardRaw | CrCardBinary;
+			memset(dc->card, 0, sizeof(dc->card));
+			dc->card[0] = 00015;
 			return;
 		}
 
@@ -670,10 +717,9 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 			/*
 			**  EOR = 7/8/9 card.
 			*/
-			cc->rawcard = true;
-			cc->status |= StCr3447Binary;
-			memset(cc->card, 0, sizeof(cc->card));
-			cc->card[0] = 00007;
+			dc->flags = CrCardRaw | CrCardBinary;
+			memset(dc->card, 0, sizeof(dc->card));
+			dc->card[0] = 00007;
 			return;
 		}
 
@@ -682,30 +728,26 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 			/*
 			**  Raw binary card.
 			*/
-			cc->rawcard = true;
+			dc->flags = CrCardRaw;
 			PpWord col1 = buffer[4] & Mask5;
 			if (col1 == 00005)
 			{
-				cc->status |= StCr3447Binary;
+				dc->flags |= CrCardBinary;
 			}
-			else if (col1 == 00006 && !cc->binary)
+			else if (col1 == 00006)
 			{
-				cc->status |= StCr3447File;
+				dc->flags |= CrCardFile;
 			}
 		}
 	}
 
-	if (!cc->rawcard)
+	if ((dc->flags & CrCardRaw) == 0)
 	{
 		/*
-		**  Skip over any characters past column 80 (if line is longer).
+		**  Characters past column 80 (if line is longer) are ignored.
 		*/
 		if ((cp = strchr(buffer, '\n')) == nullptr)
 		{
-			do
-			{
-				c = fgetc(up->fcb[0]);
-			} while (c != '\n' && c != EOF);
 			cp = buffer + 80;
 		}
 
@@ -722,20 +764,16 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 		*/
 		for (i = 0; i < 80; i++)
 		{
-			cc->card[i] = buffer[i];
+			dc->card[i] = static_cast<u8>(buffer[i]);
 		}
 	}
 	else
 	{
 		/*
-		**  Skip over any characters past column 324 (if line is longer).
+		**  Characters past column 324 (if line is longer) are ignored.
 		*/
 		if ((cp = strchr(buffer, '\n')) == nullptr)
 		{
-			do
-			{
-				c = fgetc(up->fcb[0]);
-			} while (c != '\n' && c != EOF);
 			cp = buffer + 324;
 		}
 
@@ -767,13 +805,36 @@ static void cr3447NextCard(DevSlot *up, CrContext *cc)
 				}
 			}
 
-			cc->card[i] = value;
+			dc->card[i] = value;
 
 			cp += 4;
 		}
 	}
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Start reading the next deck once the previous one has
+**                  been read and the next one is loaded.
+**
+**  Parameters:     Name        Description.
+**                  up          device
+**                  cc          card reader context
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cr3447Feed(DevSlot *up, CrContext *cc)
+{
+	if (cc->loaded || !deckFeed(cc->tray))
+	{
+		return;
+	}
+
+	cc->loaded = true;
+	cc->status = StCr3447Ready;
+	cr3447NextCard(up, cc);
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Convert function code to string.
 **
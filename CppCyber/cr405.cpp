@@ -71,6 +71,8 @@ typedef struct cr405Context
 	u32     getCardCycle;
 	int     col;
 	PpWord  card[80];
+	DeckTray *tray;
+	bool    loaded;
 } Cr405Context;
 
 /*
@@ -83,6 +85,8 @@ static void cr405Io(u8 mfrId);
 static void cr405Activate(u8 mfrId);
 static void cr405Disconnect(u8 mfrId);
 static void cr405NextCard(DevSlot *dp);
+static void cr405ParseCard(void *param, char *buffer, DeckCard *dc);
+static void cr405Feed(DevSlot *dp);
 
 /*
 **  ----------------
@@ -175,6 +179,7 @@ void cr405Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	}
 
 	cc->col = 80;
+	cc->tray = deckTrayOpen(cr405ParseCard, 322, cc);
 
 	/*
 	**  Print a friendly message.
@@ -183,9 +188,11 @@ void cr405Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Load cards on 3447 card reader.
+**  Purpose:        Load cards on 405 card reader. The deck is queued
+**                  behind any decks still in the input tray.
 **
 **  Parameters:     Name        Description.
+**                  params      "mainframe,channel,equipment,file"
 **
 **  Returns:        Nothing.
 **
@@ -195,22 +202,28 @@ void cr405LoadCards(char *params)
 	int channelNo;
 	int equipmentNo;
 	int mfrID;
-	static char str[200];
+	char str[_MAX_PATH + 1];
 
 	/*
 	**  Operator wants to load new card stack.
 	*/
-	int numParam = sscanf(params, "%o,%o,%o,%s", &mfrID, &channelNo, &equipmentNo, str);
+	int numParam = sscanf(params, "%o,%o,%o,%256s", &mfrID, &channelNo, &equipmentNo, str);
 
 	/*
 	**  Check parameters.
 	*/
-	if (numParam != 3)
+	if (numParam != 4)
 	{
 		printf("Not enough or invalid parameters\n");
 		return;
 	}
 
+	if (mfrID < 0 || mfrID >= BigIron->initMainFrames)
+	{
+		printf("Invalid mainframe no\n");
+		return;
+	}
+
 	if (channelNo < 0 || channelNo >= MaxChannels)
 	{
 		printf("Invalid channel no\n");
@@ -229,40 +242,47 @@ void cr405LoadCards(char *params)
 		return;
 	}
 
+	(void)cr405LoadDeck(static_cast<u8>(mfrID), static_cast<u8>(channelNo), static_cast<u8>(equipmentNo), str);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue a deck file on a CR405 card reader.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe
+**                  channelNo   channel
+**                  equipmentNo equipment
+**                  fileName    deck file
+**
+**  Returns:        false if there is no CR405 on that channel.
+**
+**------------------------------------------------------------------------*/
+bool cr405LoadDeck(u8 mfrID, u8 channelNo, u8 equipmentNo, char *fileName)
+{
 	/*
 	**  Locate the device control block.
 	*/
-	DevSlot *dp = channelFindDevice(static_cast<u8>(channelNo), DtCr405, mfrID);
+	DevSlot *dp = channelFindDevice(channelNo, DtCr405, mfrID);
 	if (dp == nullptr)
 	{
-		return;
+		return(false);
 	}
 
-	//Cr405Context *cc = (Cr405Context *)(dp->context[0]);
+	Cr405Context *cc = static_cast<Cr405Context *>(dp->context[0]);
 
 	/*
-	**  Ensure the tray is empty.
+	**  The deck is read in the background and fed to the reader at
+	**  its next function or I/O once the decks ahead have been read.
 	*/
-	if (dp->fcb[0] != nullptr)
+	if (!deckQueue(cc->tray, fileName))
 	{
-		printf("Input tray full\n");
-		return;
+		printf("Failed to open %s\n", fileName);
+		return(true);
 	}
 
-	dp->fcb[0] = fopen(str, "r");
+	printf("CR405 loaded with %s\n", fileName);
 
-	/*
-	**  Check if the open succeeded.
-	*/
-	if (dp->fcb[0] == nullptr)
-	{
-		printf("Failed to open %s\n", str);
-		return;
-	}
-
-	cr405NextCard(dp);
-
-	printf("CR405 loaded with %s", str);
+	return(true);
 }
 
 /*--------------------------------------------------------------------------
@@ -277,6 +297,9 @@ void cr405LoadCards(char *params)
 static FcStatus cr405Func(PpWord funcCode, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	cr405Feed(mfr->activeDevice);
+
 	switch (funcCode)
 	{
 	default:
@@ -310,6 +333,8 @@ static void cr405Io(u8 mfrId)
 
 	Cr405Context *cc = static_cast<Cr405Context*>(mfr->activeDevice->context[0]);
 
+	cr405Feed(mfr->activeDevice);
+
 	switch (mfr->activeDevice->fcode)
 	{
 	default:
@@ -318,7 +343,7 @@ static void cr405Io(u8 mfrId)
 		break;
 
 	case FcCr405StatusReq:
-		if (mfr->activeDevice->fcb[0] == nullptr && cc->col >= 80)
+		if (!cc->loaded && cc->col >= 80)
 		{
 			mfr->activeChannel->data = StCr405NotReady;
 		}
@@ -390,11 +415,8 @@ static void cr405Disconnect(u8 mfrId)
 static void cr405NextCard(DevSlot *dp)
 {
 	Cr405Context *cc = static_cast<Cr405Context*>(dp->context[0]);
-	static char buffer[322];
-	char c;
-	int i;
 
-	if (dp->fcb[0] == nullptr)
+	if (!cc->loaded)
 	{
 		return;
 	}
@@ -404,13 +426,12 @@ static void cr405NextCard(DevSlot *dp)
 	*/
 	cc->getCardCycle = dp->mfr->cycles;
 	cc->col = 0;
-	bool binaryCard = false;
 
 	/*
-	**  Read the next card.
+	**  Take the next card from the deck.
 	*/
-	char *cp = fgets(buffer, sizeof(buffer), dp->fcb[0]);
-	if (cp == nullptr)
+	DeckCard *dc = deckNextCard(cc->tray);
+	if (dc == nullptr)
 	{
 		/*
 		**  If the last card wasn't a 6/7/8/9 card, fake one.
@@ -425,11 +446,34 @@ static void cr405NextCard(DevSlot *dp)
 			cc->col = 80;
 		}
 
-		fclose(dp->fcb[0]);
-		dp->fcb[0] = nullptr;
+		cc->loaded = false;
 		return;
 	}
 
+	memcpy(cc->card, dc->card, sizeof(cc->card));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert a line of a deck file into a card. Called by
+**                  the deck loader thread.
+**
+**  Parameters:     Name        Description.
+**                  param       card reader context
+**                  buffer      line as read by fgets
+**                  dc          card
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cr405ParseCard(void *param, char *buffer, DeckCard *dc)
+{
+	Cr405Context *cc = static_cast<Cr405Context*>(param);
+	char *cp;
+	int i;
+
+	dc->flags = 0;
+	bool binaryCard = false;
+
 	/*
 	**  Deal with special first-column codes.
 	*/
@@ -440,8 +484,8 @@ static void cr405NextCard(DevSlot *dp)
 			/*
 			**  EOI = 6/7/8/9 card.
 			*/
-			memset(cc->card, 0, sizeof(cc->card));
-			cc->card[0] = 00017;
+			memset(dc->card, 0, sizeof(dc->card));
+			dc->card[0] = 00017;
 			return;
 		}
 
@@ -450,8 +494,8 @@ static void cr405NextCard(DevSlot *dp)
 			/*
 			**  EOF = 6/7/9 card.
 			*/
-			memset(cc->card, 0, sizeof(cc->card));
-			cc->card[0] = 00015;
+			memset(dc->card, 0, sizeof(dc->card));
+			dc->card[0] = 00015;
 			return;
 		}
 
@@ -460,8 +504,8 @@ static void cr405NextCard(DevSlot *dp)
 			/*
 			**  EOR = 7/8/9 card.
 			*/
-			memset(cc->card, 0, sizeof(cc->card));
-			cc->card[0] = 00007;
+			memset(dc->card, 0, sizeof(dc->card));
+			dc->card[0] = 00007;
 			return;
 		}
 
@@ -471,7 +515,7 @@ static void cr405NextCard(DevSlot *dp)
 			**  Binary = 7/9 card.
 			*/
 			binaryCard = true;
-			cc->card[0] = 00005;
+			dc->card[0] = 00005;
 		}
 	}
 
@@ -481,14 +525,10 @@ static void cr405NextCard(DevSlot *dp)
 	if (!binaryCard)
 	{
 		/*
-		**  Skip over any characters past column 80 (if line is longer).
+		**  Characters past column 80 (if line is longer) are ignored.
 		*/
 		if ((cp = strchr(buffer, '\n')) == nullptr)
 		{
-			do
-			{
-				c = fgetc(dp->fcb[0]);
-			} while (c != '\n' && c != EOF);
 			cp = buffer + 80;
 		}
 
@@ -505,20 +545,16 @@ static void cr405NextCard(DevSlot *dp)
 		*/
 		for (i = 0; i < 80; i++)
 		{
-			cc->card[i] = cc->table[buffer[i]];
+			dc->card[i] = cc->table[static_cast<u8>(buffer[i])];
 		}
 	}
 	else
 	{
 		/*
-		**  Skip over any characters past column 320 (if line is longer).
+		**  Characters past column 320 (if line is longer) are ignored.
 		*/
 		if ((cp = strchr(buffer, '\n')) == nullptr)
 		{
-			do
-			{
-				c = fgetc(dp->fcb[0]);
-			} while (c != '\n' && c != EOF);
 			cp = buffer + 320;
 		}
 
@@ -550,11 +586,34 @@ static void cr405NextCard(DevSlot *dp)
 				}
 			}
 
-			cc->card[i] = value;
+			dc->card[i] = value;
 
 			cp += 4;
 		}
 	}
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Start reading the next deck once the previous one has
+**                  been read and the next one is loaded.
+**
+**  Parameters:     Name        Description.
+**                  dp          device
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cr405Feed(DevSlot *dp)
+{
+	Cr405Context *cc = static_cast<Cr405Context*>(dp->context[0]);
+
+	if (cc->loaded || cc->col < 80 || !deckFeed(cc->tray))
+	{
+		return;
+	}
+
+	cc->loaded = true;
+	cr405NextCard(dp);
+}
+
 /*---------------------------  End Of File  ------------------------------*/
@@ -35,6 +35,15 @@
 */
 
 #include "stdafx.h"
+#include <math.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #define DEBUG 0
 /*
 **  -----------------
@@ -156,6 +165,16 @@
 #define DsTrack885              1
 #define DsSector885             30
 
+/*
+**  Drive timing used by the latency model, in microseconds. Both
+**  drives turn at 3600 rpm.
+*/
+#define RevolutionUs            16667
+#define SeekMin844Us            8000
+#define SeekMax844Us            55000
+#define SeekMin885Us            5000
+#define SeekMax885Us            45000
+
 /*
 **  Disk drive types.
 */
@@ -168,6 +187,34 @@
 #define CtUndefined             0
 #define CtClassic               1
 #define CtPacked                2
+#define CtSparse                3
+
+/*
+**  Sector cache: time the cache thread lets writes collect once a drive
+**  has dirty sectors, and the end of a slot chain.
+*/
+#define CacheFlushMs            100
+#define CacheNoSlot             0xFFFFFFFF
+
+/*
+**  Copy-on-write overlay file.
+*/
+#define OverlayMagic            "CYBOVL"
+#define OverlayVersion          1
+#define OverlayAlign            4096
+
+/*
+**  Sparse container file.
+*/
+#define SparseMagic             "CYBSPS"
+#define SparseVersion           1
+#define SparseSectorSize        512
+#define SparseAlign             4096
+
+/*
+**  Seek distance histogram: 0, 1, 2-3, 4-7 ... 512 and more cylinders.
+*/
+#define DiskSeekBuckets         11
 
 /*
 **  -----------------------
@@ -175,6 +222,15 @@
 **  -----------------------
 */
 
+/*
+**  Position a container at a 64 bit byte offset.
+*/
+#if defined(_WIN32)
+#define DiskSeek(fcb, pos) _fseeki64((fcb), (pos), SEEK_SET)
+#else
+#define DiskSeek(fcb, pos) fseeko((fcb), (pos), SEEK_SET)
+#endif
+
 /*
 **  -----------------------------------------
 **  Private Typedef and Structure Definitions
@@ -187,6 +243,126 @@ typedef struct diskSize
 	i32         maxSectors;
 } DiskSize;
 
+typedef struct diskCacheSlot
+{
+	i64         position;           /* container byte offset of sector */
+	u32         hashNext;           /* next slot in hash chain or free list */
+	u32         lruNewer;           /* LRU list of clean slots */
+	u32         lruOlder;
+	bool        valid;
+	bool        dirty;
+} DiskCacheSlot;
+
+/*
+**  Write-back cache of container sectors. The emulation thread only
+**  touches the container on a miss; the cache thread writes dirty
+**  sectors. fileLock serialises container I/O and is always taken
+**  before cacheLock.
+**
+**  Sectors are found through a hash table of slot chains keyed by
+**  sector number. Clean slots are kept on an LRU list, so the victim
+**  of a miss is its oldest entry; dirty slots leave the list until
+**  they are written.
+*/
+typedef struct diskCache
+{
+	DiskCacheSlot *slot;
+	u32         *bucket;            /* first slot of each hash chain */
+	u8          *data;              /* slots * sectorSize bytes */
+	FILE        *fcb;               /* container */
+	u8          *ioBuf;             /* read-ahead and flush staging */
+	i64         *ioPos;             /* positions of staged flush sectors */
+	u32         slots;
+	u32         sectorSize;
+	u32         hashMask;
+	u32         free;               /* unused slots */
+	u32         lruNew;             /* most recently used clean slot */
+	u32         lruOld;             /* least recently used clean slot */
+	u32         dirtyCount;
+	u32         dirtyMax;
+	CRITICAL_SECTION cacheLock;
+	CRITICAL_SECTION fileLock;
+
+	u32         hits;
+	u32         misses;
+	u32         readAhead;
+	u32         written;
+	u32         stalls;
+} DiskCache;
+
+/*
+**  Copy-on-write overlay of a shared base container. The overlay file
+**  holds a header, a bitmap with one bit per sector and, from
+**  dataOffset on, each written sector at its container position. Only
+**  written sectors occupy space where the host supports sparse files.
+*/
+typedef struct
+{
+	char        magic[8];           /* OverlayMagic */
+	u32         version;            /* OverlayVersion */
+	u32         sectorSize;         /* container sector size */
+	u32         sectors;            /* sectors in the container */
+	u32         dataOffset;         /* overlay file offset of sector 0 */
+	char        base[256];          /* base container */
+} OverlayHeader;
+
+typedef struct diskOverlay
+{
+	FILE        *baseFcb;           /* base container, read only */
+	u8          *baseMap;           /* mapping of the base or nullptr */
+	u64         baseBytes;          /* bytes mapped */
+	u8          *bitmap;            /* sectors held in the overlay */
+	u32         bitmapBytes;
+	u32         dataOffset;
+	u32         written;            /* sectors held in the overlay */
+#if defined(_WIN32)
+	HANDLE      baseMapHandle;
+#endif
+} DiskOverlay;
+
+/*
+**  Sparse container. The file holds a header, an index with the 64 bit
+**  file offset of every sector, and the sectors which are not all zero
+**  in packed format, each in a slot of its own. A zero index entry is
+**  a sector of zeros.
+*/
+typedef struct
+{
+	char        magic[8];           /* SparseMagic */
+	u32         version;            /* SparseVersion */
+	u32         sectorSize;         /* bytes per slot */
+	u32         sectors;            /* sectors in the container */
+	u32         reserved;
+	u64         dataOffset;         /* file offset of the first slot */
+} SparseHeader;
+
+typedef struct diskSparse
+{
+	u64         *index;             /* slot offset per sector, 0 if zero */
+	u64         *free;              /* slots given up by zeroed sectors */
+	u32         freeCount;
+	u32         freeMax;
+	u32         sectors;
+	u32         stored;             /* sectors held in slots */
+	u64         dataEnd;            /* file offset of the next new slot */
+} DiskSparse;
+
+/*
+**  I/O statistics of a drive. Only the PP thread driving the drive
+**  updates them.
+*/
+typedef struct diskStats
+{
+	u64         reads;              /* read functions */
+	u64         writes;             /* write functions */
+	u64         seeks;              /* completed seeks */
+	u64         sectorsRead;
+	u64         sectorsWritten;
+	u64         ioUs;               /* host time moving sectors */
+	u64         seekDistance[DiskSeekBuckets];
+	i32         lastCylinder;
+} DiskStats;
+
 typedef struct diskParam
 {
 	PpWord(*read)(struct diskParam *, FILE *fcb);
@@ -203,8 +379,54 @@ typedef struct diskParam
 	u8          diskType;
 	PpWord      buffer[SectorSize];
 	PpWord      *bufPtr;
+	PpWord      *bufEnd;
+	i64         position;
+	u8          *map;
+	u64         mapBytes;
+	DiskCache   *cache;
+	DiskOverlay *overlay;
+	DiskSparse  *sparse;
+	u8          *convDirty;         /* sectors written during a conversion */
+	u32         convSectors;
+	char        fileName[80];
+	DiskStats   stats;
+	u32         seekMinUs;          /* latency model, 0 if instant */
+	u32         seekMaxUs;
+	u32         sectorUs;
+	u64         busyUntil;          /* latencyClock when the drive is free */
+	u64         latencyClock;       /* rtcClock widened so it does not wrap */
+	u32         latencyRtc;         /* rtcClock when latencyClock was advanced */
+	struct diskParam *nextDisk;
+	u8          channelNo;
+	u8          mfrID;
+#if defined(_WIN32)
+	HANDLE      fileHandle;
+	HANDLE      mapHandle;
+#endif
 } DiskParam;
 
+/*
+**  Conversion of a drive's container to sparse format.
+*/
+typedef struct convertJob
+{
+	DevSlot     *ds;
+	DiskParam   *dp;
+	DiskParam   conv;               /* sparse container being built */
+	FILE        *rfcb;              /* old container, read by the thread */
+	FILE        *nfcb;              /* new container */
+	u8          *dirty;             /* sectors written during the copy */
+	u32         sectors;
+	u32         unitNo;
+	u8          mfrID;
+	bool        classic;            /* layout of the old container */
+	i32         sectorSize;         /* sector size of the old container */
+	volatile bool ok;               /* bulk copy succeeded */
+	u64         start;
+	char        newName[_MAX_PATH + 1];
+	char        bakName[_MAX_PATH + 1];
+} ConvertJob;
+
 /*
 **  ---------------------------
 **  Private Function Prototypes
@@ -215,8 +437,10 @@ static FcStatus dd8xxFunc(PpWord funcCode, u8 mfrId);
 static void dd8xxIo(u8 mfrId);
 static void dd8xxActivate(u8 mfrId);
 static void dd8xxDisconnect(u8 mfrId);
-static i32 dd8xxSeek(DiskParam *dp, u8 mfrId);
-static i32 dd8xxSeekNextSector(DiskParam *dp,u8 mfrId);
+static void dd8xxSnapshot(DevSlot *ds, FILE *fcb, bool restore);
+static i64 dd8xxSeek(DiskParam *dp, u8 mfrId);
+static i64 dd8xxSeekNextSector(DiskParam *dp, u8 mfrId);
+static void dd8xxPosition(DiskParam *dp, FILE *fcb, i64 pos);
 //static void dd8xxDump(PpWord data);
 //static void dd8xxFlush(void);
 static PpWord dd8xxReadClassic(DiskParam *dp, FILE *fcb);
@@ -226,6 +450,48 @@ static void dd8xxWritePacked(DiskParam *dp, FILE *fcb, PpWord data);
 static void dd8xxSectorRead(DiskParam *dp, FILE *fcb, PpWord *sector);
 static void dd8xxSectorWrite(DiskParam *dp, FILE *fcb, PpWord *sector);
 static void dd844SetClearFlaw(DiskParam *dp, PpWord flawState, u8 mfrId);
+static bool dd8xxMap(DiskParam *dp, FILE *fcb);
+static void dd8xxMapWritten(DiskParam *dp, u8 *sector);
+static void dd8xxCacheCreate(DiskParam *dp, FILE *fcb);
+static void dd8xxCacheRead(DiskParam *dp, FILE *fcb, u8 *sector);
+static void dd8xxCacheWrite(DiskParam *dp, FILE *fcb, u8 *sector);
+static void dd8xxCacheFlush(DiskParam *dp, FILE *fcb);
+static DiskCacheSlot *dd8xxCacheFind(DiskCache *cp, i64 position);
+static DiskCacheSlot *dd8xxCacheVictim(DiskCache *cp);
+static void dd8xxCacheInsert(DiskCache *cp, DiskCacheSlot *sp, i64 position);
+static void dd8xxCacheLink(DiskCache *cp, DiskCacheSlot *sp);
+static void dd8xxCacheUnlink(DiskCache *cp, DiskCacheSlot *sp);
+static void dd8xxCreateThread();
+static FILE *dd8xxOverlayOpen(DiskParam *dp, char *fname, char *baseName);
+static void dd8xxOverlayRead(DiskParam *dp, FILE *fcb, u8 *sector);
+static void dd8xxOverlayWrite(DiskParam *dp, FILE *fcb, u8 *sector);
+static void dd8xxOverlayClose(DiskParam *dp);
+static bool dd8xxOverlayHeader(FILE *fcb, OverlayHeader *header);
+static bool dd8xxSparseOpen(DiskParam *dp, FILE *fcb, bool create);
+static void dd8xxSparseRead(DiskParam *dp, FILE *fcb, u8 *sector);
+static bool dd8xxSparseWrite(DiskParam *dp, FILE *fcb, u8 *sector);
+static void dd8xxSparseRelease(DiskSparse *sp, u64 offset);
+static void dd8xxSparseClose(DiskParam *dp);
+static int dd8xxSparseCompare(const void *a, const void *b);
+static void dd8xxRelease(DevSlot *ds, int unitNo);
+static void dd8xxUnlink(DiskParam *dp);
+static bool dd8xxConvertSector(ConvertJob *job, FILE *from, u32 sector);
+static void dd8xxConvertCreateThread(ConvertJob *job);
+#if defined(_WIN32)
+static void dd8xxConvertThread(void *param);
+#else
+static void *dd8xxConvertThread(void *param);
+#endif
+static void dd8xxStatsSeek(DiskParam *dp);
+static u64 dd8xxLatencyNow(DiskParam *dp);
+static bool dd8xxBusy(DiskParam *dp);
+static void dd8xxLatencySeek(DiskParam *dp, i32 distance);
+static void dd8xxLatencySector(DiskParam *dp);
+#if defined(_WIN32)
+static void dd8xxThread(void *param);
+#else
+static void *dd8xxThread(void *param);
+#endif
 static char *dd8xxFunc2String(PpWord funcCode);
 
 /*
@@ -240,7 +506,18 @@ static char *dd8xxFunc2String(PpWord funcCode);
 **  -----------------
 */
 static int diskCount = 0;
+static bool diskMap = false;
+static u8 diskSync = 0;
+static u32 cacheSectors = 0;
+static u32 cacheReadAhead = 0;
+static DiskParam *firstDisk = nullptr;
+static DiskParam *lastDisk = nullptr;
+static CRITICAL_SECTION diskListMutex;
+static CRITICAL_SECTION diskFlushMutex;
+static CONDITION_VARIABLE diskFlushWork;
+static bool diskFlushPending = false;
 static PpWord mySector[SectorSize];
+static ConvertJob *convertJob = nullptr;
 
 static DiskSize sizeDd844_2 = { MaxCylinders844_2, MaxTracks844, MaxSectors844 };
 static DiskSize sizeDd844_4 = { MaxCylinders844_4, MaxTracks844, MaxSectors844 };
@@ -351,1448 +628,3899 @@ void dd885Init_1(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	dd8xxInit(mfrID, eqNo, unitNo, channelNo, deviceName, &sizeDd885_1, DiskType885);
 }
 
-/*
-**--------------------------------------------------------------------------
+/*--------------------------------------------------------------------------
+**  Purpose:        Set up disk container options. Must be called before
+**                  the first disk is initialised.
 **
-**  Private Functions
+**  Parameters:     Name        Description.
+**                  map         true to map containers into memory
+**                  sync        0 to flush mapped containers at shutdown,
+**                              1 to start writing each sector to disk when
+**                              it is complete, 2 to also wait for it
+**                  cache       sectors cached per unmapped drive, 0 for none
+**                  readAhead   sectors read ahead on a cache miss
 **
-**--------------------------------------------------------------------------
-*/
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void dd8xxInitOptions(bool map, u8 sync, u32 cache, u32 readAhead)
+{
+	diskMap = map;
+	diskSync = sync;
+	cacheSectors = cache;
+	cacheReadAhead = readAhead;
+
+	InitializeCriticalSection(&diskListMutex);
+	InitializeCriticalSection(&diskFlushMutex);
+	InitializeConditionVariable(&diskFlushWork);
+
+	if (cacheSectors != 0)
+	{
+		dd8xxCreateThread();
+	}
+}
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Initialise specified disk drive.
+**  Purpose:        Show disk cache statistics.
 **
 **  Parameters:     Name        Description.
-**                  eqNo        equipment number
-**                  unitNo      unit number
-**                  channelNo   channel number the device is attached to
-**                  deviceName  optional device file name
-**                  size        pointer to disk size structure
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxInit(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName, DiskSize *size, u8 diskType)
+void dd8xxShowStats()
 {
-	char fname[80];
-	time_t mTime;
-	u8 containerType;
-	char *opt = nullptr;
-
-	(void)eqNo;
-
-	MMainFrame *mfr = BigIron->chasis[mfrID];
+	if (cacheSectors == 0)
+	{
+		return;
+	}
 
+	printf("\n    Disk cache (%lu sectors per drive, read ahead %lu):\n",
+		static_cast<unsigned long>(cacheSectors), static_cast<unsigned long>(cacheReadAhead));
 
-#if DEBUG
-	if (dd8xxLog == NULL)
+	EnterCriticalSection(&diskListMutex);
+	for (DiskParam *dp = firstDisk; dp != nullptr; dp = dp->nextDisk)
 	{
-		dd8xxLog = fopen("dd8xxlog.txt", "wt");
-		if (dd8xxLog == NULL)
+		DiskCache *cp = dp->cache;
+		if (cp == nullptr)
 		{
-			fprintf(stderr, "dd8xxlog.txt - aborting\n");
-			exit(1);
+			continue;
 		}
+
+		printf("        MF%d CH%02o U%o: %lu hits, %lu misses, %lu read ahead, %lu written, %lu dirty, %lu stalls\n",
+			dp->mfrID, dp->channelNo, dp->unitNo,
+			static_cast<unsigned long>(cp->hits), static_cast<unsigned long>(cp->misses),
+			static_cast<unsigned long>(cp->readAhead), static_cast<unsigned long>(cp->written),
+			static_cast<unsigned long>(cp->dirtyCount), static_cast<unsigned long>(cp->stalls));
 	}
-#endif
+	LeaveCriticalSection(&diskListMutex);
+}
 
-	/*
-	**  Setup channel functions.
-	*/
-	DevSlot *ds = channelAttach(channelNo, eqNo, DtDd8xx, mfrID);
-	mfr->activeDevice = ds;
-	ds->activate = dd8xxActivate;
-	ds->disconnect = dd8xxDisconnect;
-	ds->func = dd8xxFunc;
-	ds->io = dd8xxIo;
+/*--------------------------------------------------------------------------
+**  Purpose:        Show I/O statistics of all 844/885 drives: functions
+**                  issued, sectors moved, host time, cache hits and the
+**                  distribution of seek distances, followed by the
+**                  sectors moved per channel.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void dd8xxShowDiskStatus()
+{
+	u64 channelSectors[MaxMainFrames][MaxChannels] = { 0 };
 
-	/*
-	**  Save disk parameters.
-	*/
-	ds->selectedUnit = -1;
-	DiskParam *dp = static_cast<DiskParam *>(calloc(1, sizeof(DiskParam)));
-	if (dp == nullptr)
+	printf("\n    Disk I/O (seek distance in cylinders: 0 1 2 4 8 16 32 64 128 256 512+):\n");
+
+	EnterCriticalSection(&diskListMutex);
+	for (DiskParam *dp = firstDisk; dp != nullptr; dp = dp->nextDisk)
 	{
-		fprintf(stderr, "Failed to allocate dd8xx context block\n");
-		exit(1);
+		DiskStats *st = &dp->stats;
+
+		printf("        MF%d CH%02o U%o DD%s %s\n", dp->mfrID, dp->channelNo, dp->unitNo,
+			dp->diskType == DiskType885 ? "885" : "844", dp->fileName);
+		printf("            %lu reads, %lu writes, %lu seeks, %lu sectors read, %lu written, %.3f s host I/O",
+			static_cast<unsigned long>(st->reads), static_cast<unsigned long>(st->writes),
+			static_cast<unsigned long>(st->seeks), static_cast<unsigned long>(st->sectorsRead),
+			static_cast<unsigned long>(st->sectorsWritten), static_cast<double>(st->ioUs) / 1000000.0);
+		if (dp->cache != nullptr)
+		{
+			printf(", %lu cache hits", static_cast<unsigned long>(dp->cache->hits));
+		}
+
+		printf("\n            seeks");
+		for (int i = 0; i < DiskSeekBuckets; i++)
+		{
+			printf(" %lu", static_cast<unsigned long>(st->seekDistance[i]));
+		}
+
+		printf("\n");
+
+		channelSectors[dp->mfrID][dp->channelNo] += st->sectorsRead + st->sectorsWritten;
 	}
+	LeaveCriticalSection(&diskListMutex);
 
-	dp->size = *size;
-	dp->diskNo = diskCount++;
-	dp->diskType = diskType;
-	dp->unitNo = unitNo;
+	for (int mfrID = 0; mfrID < MaxMainFrames; mfrID++)
+	{
+		for (int ch = 0; ch < MaxChannels; ch++)
+		{
+			if (channelSectors[mfrID][ch] != 0)
+			{
+				printf("        MF%d CH%02o: %lu sectors\n", mfrID, ch, static_cast<unsigned long>(channelSectors[mfrID][ch]));
+			}
+		}
+	}
+}
 
-	/*
-	**  Determine if any options have been specified.
-	*/
-	if (deviceName != nullptr)
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the I/O statistics of all 844/885 drives to a
+**                  file as comma separated values, one line per drive
+**                  after a line of column names.
+**
+**  Parameters:     Name        Description.
+**                  fileName    file to write
+**
+**  Returns:        true if successful.
+**
+**------------------------------------------------------------------------*/
+bool dd8xxDumpDiskStats(char *fileName)
+{
+	FILE *fcb = fopen(fileName, "w");
+	if (fcb == nullptr)
 	{
-		opt = strchr(deviceName, ',');
+		return(false);
 	}
 
-	if (opt != nullptr)
+	fprintf(fcb, "mainframe,channel,unit,type,file,reads,writes,seeks,sectorsRead,sectorsWritten,ioUs,cacheHits");
+	for (int i = 0; i < DiskSeekBuckets; i++)
 	{
-		/*
-		**  Process options.
-		*/
-		*opt++ = '\0';
+		fprintf(fcb, ",seek%d", i == 0 ? 0 : 1 << (i - 1));
+	}
 
-		if (strcmp(opt, "old") == 0
-			|| strcmp(opt, "classic") == 0)
-		{
-			containerType = CtClassic;
-		}
-		else if (strcmp(opt, "new") == 0
-			|| strcmp(opt, "packed") == 0)
+	fprintf(fcb, "\n");
+
+	EnterCriticalSection(&diskListMutex);
+	for (DiskParam *dp = firstDisk; dp != nullptr; dp = dp->nextDisk)
+	{
+		DiskStats *st = &dp->stats;
+
+		fprintf(fcb, "%d,%o,%o,%s,%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu", dp->mfrID, dp->channelNo, dp->unitNo,
+			dp->diskType == DiskType885 ? "885" : "844", dp->fileName,
+			static_cast<unsigned long long>(st->reads), static_cast<unsigned long long>(st->writes),
+			static_cast<unsigned long long>(st->seeks), static_cast<unsigned long long>(st->sectorsRead),
+			static_cast<unsigned long long>(st->sectorsWritten), static_cast<unsigned long long>(st->ioUs),
+			static_cast<unsigned long long>(dp->cache != nullptr ? dp->cache->hits : 0));
+		for (int i = 0; i < DiskSeekBuckets; i++)
 		{
-			containerType = CtPacked;
+			fprintf(fcb, ",%llu", static_cast<unsigned long long>(st->seekDistance[i]));
 		}
-		else
+
+		fprintf(fcb, "\n");
+	}
+	LeaveCriticalSection(&diskListMutex);
+
+	return(fclose(fcb) == 0);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write every dirty sector of every cached drive to its
+**                  container. Called with the PpuMutex of every mainframe
+**                  held, so no sector is dirtied meanwhile and the
+**                  containers match the machine state being saved.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void dd8xxFlushCaches()
+{
+	EnterCriticalSection(&diskListMutex);
+	for (DiskParam *dp = firstDisk; dp != nullptr; dp = dp->nextDisk)
+	{
+		while (dp->cache != nullptr && dp->cache->dirtyCount != 0)
 		{
-			fprintf(stderr, "Unrecognized option name %s\n", opt);
-			exit(1);
+			dd8xxCacheFlush(dp, dp->cache->fcb);
 		}
 	}
-	else
+	LeaveCriticalSection(&diskListMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Flush and release the caches, overlays, sparse indexes
+**                  and mappings of a disk controller's containers. The
+**                  channel closes the files afterwards.
+**
+**  Parameters:     Name        Description.
+**                  ds          device slot
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void dd8xxTerminate(DevSlot *ds)
+{
+	for (int unitNo = 0; unitNo < MaxUnits2; unitNo++)
 	{
-		/*
-		**  No options specified - use default values.
-		*/
-		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-		switch (diskType)
+		if (ds->context[unitNo] != nullptr)
 		{
-		case DiskType885:
-			containerType = CtPacked;
-			break;
-
-		case DiskType844:
-			containerType = CtClassic;
-			break;
+			dd8xxRelease(ds, unitNo);
+			dd8xxUnlink(static_cast<DiskParam *>(ds->context[unitNo]));
 		}
 	}
 
 	/*
-	**  Setup environment for disk container type.
+	**  Let the cache thread see that emulation has stopped.
 	*/
-	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-	// ReSharper disable once CppDeclaratorMightNotBeInitialized
-	switch (containerType)
+	EnterCriticalSection(&diskFlushMutex);
+	diskFlushPending = true;
+	LeaveCriticalSection(&diskFlushMutex);
+	WakeAllConditionVariable(&diskFlushWork);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Merge a copy-on-write overlay into its base container
+**                  and delete the overlay. Run offline (CppCyber -merge)
+**                  while no emulator uses the base: every other overlay
+**                  on the same base sees the merged sectors afterwards.
+**
+**  Parameters:     Name        Description.
+**                  overlayName overlay file
+**                  baseName    base container, nullptr for the one
+**                              recorded in the overlay
+**
+**  Returns:        true if the overlay was merged.
+**
+**------------------------------------------------------------------------*/
+bool dd8xxMergeOverlay(char *overlayName, char *baseName)
+{
+	OverlayHeader header;
+	u32 merged = 0;
+	bool ok = true;
+
+	FILE *ofcb = fopen(overlayName, "rb");
+	if (ofcb == nullptr || !dd8xxOverlayHeader(ofcb, &header))
 	{
-	case CtClassic:
-		dp->read = dd8xxReadClassic;
-		dp->write = dd8xxWriteClassic;
-		dp->sectorSize = SectorSize * 2;
-		break;
+		fprintf(stderr, "%s is not a disk overlay\n", overlayName);
+		return(false);
+	}
 
-	case CtPacked:
-		dp->read = dd8xxReadPacked;
-		dp->write = dd8xxWritePacked;
-		dp->sectorSize = 512;
-		break;
+	if (baseName == nullptr)
+	{
+		baseName = header.base;
 	}
 
-	/*
-	**  Initialize detailed status.
-	*/
-	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-	switch (diskType)
+	FILE *bfcb = fopen(baseName, "r+b");
+	if (bfcb == nullptr)
 	{
-	case DiskType885:
-		dp->detailedStatus[0] = 0;             // strobe offset & address error status
-		dp->detailedStatus[1] = 0340;             // checkword error status & sector count
-		dp->detailedStatus[2] = 0;             // command code & error bits
-		dp->detailedStatus[3] = 07440 + unitNo;    // dsu number
-		dp->detailedStatus[4] = 0;             // address 1 of failing sector
-		dp->detailedStatus[5] = 0;             // address 2 of failing sector
-		dp->detailedStatus[6] = 010;             // non recoverable error status
-		dp->detailedStatus[7] = 037;             // 11 bit correction factor
-		dp->detailedStatus[8] = 01640;             // DSU status
-		dp->detailedStatus[9] = 07201;             // DSU fault status
-		dp->detailedStatus[10] = 0;             // DSU interlock status
-		dp->detailedStatus[11] = 0;             // bit address of correctable read error
-		dp->detailedStatus[12] = 02000;             // PP address of correctable read error
-		dp->detailedStatus[13] = 0;             // first word of correction vector
-		dp->detailedStatus[14] = 0;             // second word of correction vector
-		dp->detailedStatus[15] = 0;             // DSC operating status word
-		dp->detailedStatus[16] = 0;             // coupler buffer status
-		dp->detailedStatus[17] = 0400;             // access A is connected & last command
-		dp->detailedStatus[18] = 0;             // last command 2 and 3
-		dp->detailedStatus[19] = 0;             // last command 4
-		break;
+		fprintf(stderr, "Failed to open base container %s\n", baseName);
+		fclose(ofcb);
+		return(false);
+	}
 
-	case DiskType844:
-		dp->detailedStatus[0] = 0;             // strobe offset & address error status
-		dp->detailedStatus[1] = 0;             // checkword error status & sector count
-		dp->detailedStatus[2] = 0;             // command code & error bits
-		dp->detailedStatus[3] = 04440 + unitNo;    // dsu number
-		dp->detailedStatus[4] = 0;             // address 1 of failing sector
-		dp->detailedStatus[5] = 0;             // address 2 of failing sector
-		dp->detailedStatus[6] = 010;             // non recoverable error status
-		dp->detailedStatus[7] = 0;             // 11 bit correction factor
-		dp->detailedStatus[8] = 00740;             // DSU status
-		dp->detailedStatus[9] = 04001;             // DSU fault status
-		dp->detailedStatus[10] = 07520;             // DSU interlock status
-		dp->detailedStatus[11] = 0;             // bit address of correctable read error
-		dp->detailedStatus[12] = 0;             // PP address of correctable read error
-		dp->detailedStatus[13] = 0;             // first word of correction vector
-		dp->detailedStatus[14] = 0;             // second word of correction vector
-		dp->detailedStatus[15] = 00020;             // DSC operating status word
-		dp->detailedStatus[16] = 0;             // coupler buffer status
-		dp->detailedStatus[17] = 0400;             // access A is connected & last command
-		dp->detailedStatus[18] = 0;             // last command 2 and 3
-		dp->detailedStatus[19] = 0;             // last command 4
-		break;
+	u32 bitmapBytes = (header.sectors + 7) / 8;
+	u8 *bitmap = static_cast<u8 *>(malloc(bitmapBytes));
+	u8 *sector = static_cast<u8 *>(malloc(header.sectorSize));
+	if (bitmap == nullptr || sector == nullptr || fread(bitmap, 1, bitmapBytes, ofcb) != bitmapBytes)
+	{
+		fprintf(stderr, "Failed to read overlay %s\n", overlayName);
+		ok = false;
 	}
 
-	/*
-	**  Link device parameters.
-	*/
-	ds->context[unitNo] = dp;
-
-	/*
-	**  Open or create disk image.
-	*/
-	if (deviceName == nullptr)
+	for (u32 i = 0; ok && i < header.sectors; i++)
 	{
-		/*
-		**  Construct a name.
-		*/
-		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-		switch (diskType)
+		if ((bitmap[i >> 3] & (1 << (i & 7))) == 0)
 		{
-		case DiskType844:
-			sprintf(fname, "DD844_C%02ou%1o", channelNo, unitNo);
-			break;
-
-		case DiskType885:
-			sprintf(fname, "DD885_C%02ou%1o", channelNo, unitNo);
-			break;
+			continue;
 		}
-	}
-	else
-	{
-		strcpy(fname, deviceName);
-	}
 
-	/*
-	**  Try to open existing disk image.
-	*/
-	FILE *fcb = fopen(fname, "r+b");
-	if (fcb == nullptr)
-	{
-		/*
-		**  Disk does not yet exist - manufacture one.
-		*/
-		fcb = fopen(fname, "w+b");
-		if (fcb == nullptr)
+		i64 position = static_cast<i64>(i) * header.sectorSize;
+		if (DiskSeek(ofcb, header.dataOffset + position) != 0
+			|| fread(sector, 1, header.sectorSize, ofcb) != header.sectorSize)
 		{
-			fprintf(stderr, "Failed to open %s\n", fname);
-			exit(1);
+			fprintf(stderr, "Failed to read overlay %s\n", overlayName);
+			ok = false;
 		}
-
-		/*
-		**  Write last disk sector to reserve the space.
-		*/
-		memset(mySector, 0, SectorSize * 2);
-		dp->cylinder = size->maxCylinders - 1;
-		dp->track = size->maxTracks - 1;
-		dp->sector = size->maxSectors - 1;
-		fseek(fcb, dd8xxSeek(dp, mfrID), SEEK_SET);
-		dd8xxSectorWrite(dp, fcb, mySector);
-
-		/*
-		**  Position to cylinder with the disk's factory and utility
-		**  data areas.
-		*/
-		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-		switch (diskType)
+		else if (DiskSeek(bfcb, position) != 0
+			|| fwrite(sector, 1, header.sectorSize, bfcb) != header.sectorSize)
 		{
-		case DiskType885:
-			dp->cylinder = size->maxCylinders - 2;
-			break;
-
-		case DiskType844:
-			dp->cylinder = size->maxCylinders - 1;
-			break;
+			fprintf(stderr, "Failed to write base container %s\n", baseName);
+			ok = false;
 		}
-
-		/*
-		**  Zero entire cylinder containing factory and utility data areas.
-		*/
-		memset(mySector, 0, SectorSize * 2);
-		for (dp->track = 0; dp->track < size->maxTracks; dp->track++)
+		else
 		{
-			for (dp->sector = 0; dp->sector < size->maxSectors; dp->sector++)
-			{
-				fseek(fcb, dd8xxSeek(dp, mfrID), SEEK_SET);
-				dd8xxSectorWrite(dp, fcb, mySector);
-			}
+			merged += 1;
 		}
+	}
 
-		/*
-		**  Write serial number and date of manufacture.
-		*/
-		mySector[0] = (channelNo & 070) << (8 - 3);
-		mySector[0] |= (channelNo & 007) << (4 - 0);
-		mySector[0] |= (unitNo & 070) >> (3 - 0);
-		mySector[1] = (unitNo & 007) << (8 - 0);
-		mySector[1] |= (diskType & 070) << (4 - 3);
-		mySector[1] |= (diskType & 007) << (0 - 0);
-
-		time(&mTime);
-		struct tm *lTime = localtime(&mTime);
-		u8 yy = lTime->tm_year % 100;
-		u8 mm = lTime->tm_mon + 1;
-		u8 dd = lTime->tm_mday;
+	if (fclose(bfcb) != 0)
+	{
+		fprintf(stderr, "Failed to write base container %s\n", baseName);
+		ok = false;
+	}
 
-		mySector[2] = (dd / 10) << 8 | (dd % 10) << 4 | mm / 10;
-		mySector[3] = (mm % 10) << 8 | (yy / 10) << 4 | yy % 10;
+	fclose(ofcb);
+	free(bitmap);
+	free(sector);
 
-		dp->track = 0;
-		dp->sector = 0;
-		fseek(fcb, dd8xxSeek(dp, mfrID), SEEK_SET);
-		dd8xxSectorWrite(dp, fcb, mySector);
+	if (!ok)
+	{
+		return(false);
 	}
 
-	ds->fcb[unitNo] = fcb;
-
-	/*
-	**  Reset disk seek position.
-	*/
-	dp->cylinder = 0;
-	dp->track = 0;
-	dp->sector = 0;
-	dp->interlace = 1;
-	fseek(fcb, dd8xxSeek(dp, mfrID), SEEK_SET);
+	printf("Merged %lu sectors of %s into %s\n", static_cast<unsigned long>(merged), overlayName, baseName);
+	remove(overlayName);
 
-	/*
-	**  Print a friendly message.
-	*/
-	printf("Disk with %d cylinders initialised on channel %o unit %o, mainframe %o\n",
-		dp->size.maxCylinders, channelNo, unitNo, mfrID);
+	return(true);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Execute function code on 8xx disk drive.
+**  Purpose:        Convert the container of a drive to a sparse
+**                  container while the system runs. A thread copies the
+**                  container while the drive stays in use; sectors the
+**                  PPs write meanwhile are recorded and copied again by
+**                  dd8xxConvertFinish on the drive's emulation thread,
+**                  which then swaps the files. The old container is kept
+**                  as <name>.bak.
 **
 **  Parameters:     Name        Description.
-**                  funcCode    function code
+**                  params      mainframe, channel and unit number
 **
-**  Returns:        FcStatus
+**  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static FcStatus dd8xxFunc(PpWord funcCode, u8 mfrId)
+void dd8xxConvertDisk(char *params)
 {
-	FILE *fcb;
-	DiskParam *dp;
+	u32 mfrID;
+	u32 channelNo;
+	u32 unitNo;
 
-	MMainFrame *mfr = BigIron->chasis[mfrId];
+	if (sscanf(params, "%o,%o,%o", &mfrID, &channelNo, &unitNo) != 3)
+	{
+		printf("Not enough or invalid parameters\n");
+		return;
+	}
 
-	i8 unitNo = mfr->activeDevice->selectedUnit;
-	if (unitNo != -1)
+	if (mfrID >= static_cast<u32>(BigIron->initMainFrames)
+		|| channelNo >= BigIron->chasis[mfrID]->channelCount
+		|| unitNo >= MaxUnits2)
 	{
-		dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
-		fcb = mfr->activeDevice->fcb[unitNo];
+		printf("Invalid mainframe, channel or unit no\n");
+		return;
 	}
-	else
+
+	if (convertJob != nullptr)
 	{
-		dp = nullptr;
-		fcb = nullptr;
+		printf("Conversion of %s is still running\n", convertJob->dp->fileName);
+		return;
 	}
 
-	/*
-	**  Deal with deadstart function.
-	*/
-	if ((funcCode & 0700) == Fc8xxDeadstart)
+	DevSlot *ds = channelFindDevice(static_cast<u8>(channelNo), DtDd8xx, static_cast<u8>(mfrID));
+	DiskParam *dp = ds == nullptr ? nullptr : static_cast<DiskParam *>(ds->context[unitNo]);
+	if (dp == nullptr || ds->fcb[unitNo] == nullptr)
 	{
-		funcCode = Fc8xxDeadstart;
-		mfr->activeDevice->selectedUnit = funcCode & 07;
-		unitNo = mfr->activeDevice->selectedUnit;
-		fcb = mfr->activeDevice->fcb[unitNo];
-		dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
+		printf("No disk on mainframe %o channel %o unit %o\n", mfrID, channelNo, unitNo);
+		return;
 	}
 
-#if DEBUG
-	dd8xxLogFlush();
-	if (dp != NULL)
+	if (dp->sparse != nullptr || dp->overlay != nullptr)
 	{
-		fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o DSK:%d f:%04o T:%-25s   c:%3d t:%2d s:%2d  >   ",
-			traceSequenceNo,
-			activePpu->id,
-			activeDevice->channel->id,
-			dp->diskNo,
-			funcCode,
-			dd8xxFunc2String(funcCode),
-			dp->cylinder,
-			dp->track,
-			dp->sector);
+		printf("%s is already sparse or is an overlay\n", dp->fileName);
+		return;
 	}
-	else
+
+	ConvertJob *job = static_cast<ConvertJob *>(calloc(1, sizeof(ConvertJob)));
+	if (job == nullptr)
 	{
-		fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o DSK:? f:%04o T:%-25s  >   ",
-			traceSequenceNo,
-			activePpu->id,
-			activeDevice->channel->id,
-			funcCode,
-			dd8xxFunc2String(funcCode));
+		printf("Failed to allocate memory for conversion of %s\n", dp->fileName);
+		return;
 	}
 
-	fflush(dd8xxLog);
-#endif
+	int newLen = snprintf(job->newName, sizeof(job->newName), "%s.new", dp->fileName);
+	int bakLen = snprintf(job->bakName, sizeof(job->bakName), "%s.bak", dp->fileName);
+	if (newLen < 0 || newLen >= static_cast<int>(sizeof(job->newName))
+		|| bakLen < 0 || bakLen >= static_cast<int>(sizeof(job->bakName)))
+	{
+		printf("Container name %s is too long\n", dp->fileName);
+		free(job);
+		return;
+	}
 
-	/*
-	**  Catch functions which try to operate on not selected drives.
-	*/
-	if (unitNo == -1)
+	job->nfcb = fopen(job->newName, "w+b");
+	if (job->nfcb == nullptr)
 	{
-		switch (funcCode)
-		{
-		case Fc8xxConnect:
-		case Fc8xxSeekFull:
-		case Fc8xxSeekHalf:
-		case Fc8xxOpComplete:
-		case Fc8xxDropSeeks:
-		case Fc8xxGeneralStatus:
-		case Fc8xxStartMemLoad:
-		case Fc8xxDriveRelease:
-		case Fc8xxManipulateProcessor:
-		case Fc8xxDisableReserve:
-		case Fc8xxClearCoupler:
-			/*
-			**  These functions are OK - do nothing.
-			*/
-			break;
+		printf("Failed to create %s\n", job->newName);
+		free(job);
+		return;
+	}
 
-		default:
-			/*
-			**  All remaining functions are declined if no drive is selected.
-			*/
-#if DEBUG
-			fprintf(dd8xxLog, " No drive selected, function declined ");
-#endif
-			return(FcDeclined);
-		}
+	job->rfcb = fopen(dp->fileName, "rb");
+	if (job->rfcb == nullptr)
+	{
+		fclose(job->nfcb);
+		remove(job->newName);
+		printf("Failed to open %s\n", dp->fileName);
+		free(job);
+		return;
+	}
+
+	job->ds = ds;
+	job->dp = dp;
+	job->unitNo = unitNo;
+	job->mfrID = static_cast<u8>(mfrID);
+	job->classic = dp->read == dd8xxReadClassic;
+	job->sectorSize = dp->sectorSize;
+	job->start = rtcHostMicroseconds();
+
+	job->conv = *dp;
+	job->conv.map = nullptr;
+	job->conv.cache = nullptr;
+	job->conv.bufPtr = nullptr;
+	dd8xxSparseOpen(&job->conv, job->nfcb, true);
+
+	job->sectors = job->conv.sparse->sectors;
+	job->dirty = static_cast<u8 *>(calloc((job->sectors + 7) / 8, 1));
+	if (job->dirty == nullptr)
+	{
+		dd8xxSparseClose(&job->conv);
+		fclose(job->nfcb);
+		fclose(job->rfcb);
+		remove(job->newName);
+		printf("Failed to allocate memory for conversion of %s\n", dp->fileName);
+		free(job);
+		return;
 	}
 
 	/*
-	**  Process function request.
+	**  Write back the cache so the container on disk is current, then
+	**  have the drive record every sector written from here on.
 	*/
-	switch (funcCode)
+	MMainFrame *mfr = BigIron->chasis[mfrID];
+	RESERVE(&mfr->PpuMutex);
+	if (dp->cache != nullptr)
 	{
-	default:
-#if DEBUG
-		fprintf(dd8xxLog, " !!!!!FUNC not implemented & declined!!!!!! ");
-#endif
-		return(FcDeclined);
-
-	case Fc8xxClearCoupler:
-		return(FcProcessed);
+		dd8xxCacheFlush(dp, ds->fcb[unitNo]);
+	}
 
-	case Fc8xxConnect:
-		/*
-		**  Expect drive number.
-		*/
-		mfr->activeDevice->recordLength = 1;
-		break;
+	fflush(ds->fcb[unitNo]);
+	dp->convSectors = job->sectors;
+	dp->convDirty = job->dirty;
+	RELEASE(&mfr->PpuMutex);
 
-	case Fc8xxSeekFull:
-	case Fc8xxSeekHalf:
-		/*
-		**  Expect drive number, cylinder, track and sector.
-		*/
-		mfr->activeDevice->recordLength = 4;
-		break;
+	convertJob = job;
+	dd8xxConvertCreateThread(job);
 
-	case Fc8xxRead:
-	case Fc8xxReadFlawedSector:
-	case Fc8xxGapRead:
-		mfr->activeDevice->recordLength = SectorSize;
-		break;
+	printf("Converting %s to sparse\n", dp->fileName);
+}
 
-	case Fc8xxWrite:
-	case Fc8xxWriteFlawedSector:
-	case Fc8xxWriteLastSector:
-	case Fc8xxWriteVerify:
-		mfr->activeDevice->recordLength = SectorSize;
-		break;
-
-	case Fc8xxReadCheckword:
-		mfr->activeDevice->recordLength = 2;
-		break;
-
-	case Fc8xxOpComplete:
-		return(FcProcessed);
-
-	case Fc8xxDropSeeks:
-		return(FcProcessed);
+/*--------------------------------------------------------------------------
+**  Purpose:        Finish a conversion once its thread has copied the
+**                  container. Called by the CPU 0 thread of the drive's
+**                  mainframe between PP barrel passes, so the drive is
+**                  idle: copy the sectors written during the bulk copy
+**                  again and swap the files.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe ID
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void dd8xxConvertFinish(u8 mfrID)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrID];
+	ConvertJob *job = convertJob;
 
-	case Fc8xxGeneralStatus:
-		mfr->activeDevice->recordLength = 1;
-		break;
+	mfr->diskConvert = false;
+	if (job == nullptr || job->mfrID != mfrID)
+	{
+		return;
+	}
 
-	case Fc8xxDetailedStatus:
-	case Fc8xxDetailedStatus2:
-		dp->detailedStatus[2] = (funcCode << 4) & 07760;
+	DevSlot *ds = job->ds;
+	DiskParam *dp = job->dp;
+	u32 unitNo = job->unitNo;
+	bool ok = job->ok;
 
-		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-		switch (dp->diskType)
-		{
-		case DiskType885:
-			dp->detailedStatus[4] = (dp->cylinder >> 4) & 077;
-			dp->detailedStatus[5] = ((dp->cylinder << 8) | dp->track) & 07777;
-			dp->detailedStatus[6] = ((dp->sector << 4) | 010) & 07777;
-			if ((dp->track & 1) != 0)
-			{
-				dp->detailedStatus[9] |= 2;  /* odd track */
-			}
-			else
-			{
-				dp->detailedStatus[9] &= ~2;
-			}
+	RESERVE(&mfr->PpuMutex);
 
-			break;
+	/*
+	**  Keep a sector being transferred, it may live in the old mapping.
+	*/
+	if (dp->bufPtr != nullptr && dp->bufEnd - SectorSize != dp->buffer)
+	{
+		PpWord *old = dp->bufEnd - SectorSize;
+		memcpy(dp->buffer, old, SectorSize * sizeof(PpWord));
+		dp->bufPtr = dp->buffer + (dp->bufPtr - old);
+		dp->bufEnd = dp->buffer + SectorSize;
+	}
 
-		case DiskType844:
-			dp->detailedStatus[4] = ((dp->cylinder & 0777) << 3) | ((dp->track >> 2) & 07);
-			dp->detailedStatus[5] = ((dp->track & 03) << 10) | ((dp->sector & 017) << 5) | ((dp->cylinder >> 9) & 01);
-			dp->detailedStatus[6] = ((dp->sector << 4) | 010) & 07777;
-			break;
-		}
+	/*
+	**  From here on the old container is read with plain file I/O.
+	**  Copy again what was written during the bulk copy.
+	*/
+	dd8xxRelease(ds, unitNo);
+	FILE *fcb = ds->fcb[unitNo];
+	fflush(fcb);
 
-		if (funcCode == Fc8xxDetailedStatus)
-		{
-			mfr->activeDevice->recordLength = 12;
-		}
-		else
+	u32 recopied = 0;
+	for (u32 i = 0; ok && i < job->sectors; i++)
+	{
+		if ((job->dirty[i >> 3] & (1 << (i & 7))) != 0)
 		{
-			mfr->activeDevice->recordLength = 20;
+			ok = dd8xxConvertSector(job, fcb, i);
+			recopied += 1;
 		}
-		break;
+	}
 
-	case Fc8xxStartMemLoad:
-		break;
+	dp->convDirty = nullptr;
+	dp->convSectors = 0;
 
-	case Fc8xxReadUtilityMap:
-	case Fc8xxReadFactoryData:
-		mfr->activeDevice->recordLength = SectorSize;
-		break;
+	u32 stored = job->conv.sparse->stored;
+	dd8xxSparseClose(&job->conv);
 
-	case Fc8xxDriveRelease:
-		return(FcProcessed);
+	if (fclose(job->nfcb) != 0)
+	{
+		ok = false;
+	}
 
-	case Fc8xxDeadstart:
-		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
-		switch (dp->diskType)
+	/*
+	**  Swap the files. If that fails the drive stays on its old
+	**  container, accessed by plain file I/O.
+	*/
+	bool swapped = false;
+	if (ok)
+	{
+		fclose(fcb);
+		remove(job->bakName);
+		if (rename(dp->fileName, job->bakName) == 0)
 		{
-		case DiskType844:
-			if (dp->size.maxCylinders == MaxCylinders844_2)
+			swapped = rename(job->newName, dp->fileName) == 0;
+			if (!swapped)
 			{
-				dp->cylinder = DsCylinder844_2;
-			}
-			else
-			{
-				dp->cylinder = DsCylinder844_4;
+				rename(job->bakName, dp->fileName);
 			}
-
-			dp->track = DsTrack844;
-			dp->sector = DsSector844;
-			break;
-
-		case DiskType885:
-			dp->cylinder = DsCylinder885;
-			dp->track = DsTrack885;
-			dp->sector = DsSector885;
-			break;
 		}
 
-		fseek(fcb, dd8xxSeek(dp, mfrId), SEEK_SET);
-		mfr->activeDevice->recordLength = SectorSize;
-		break;
+		fcb = fopen(dp->fileName, "r+b");
+		ds->fcb[unitNo] = fcb;
+	}
 
-	case Fc8xxSetClearFlaw:
-		if (dp->diskType != DiskType844)
-		{
-			return(FcDeclined);
-		}
+	if (!ok || !swapped)
+	{
+		remove(job->newName);
+		printf("Failed to convert %s\n", dp->fileName);
+	}
 
-		mfr->activeDevice->recordLength = 1;
-		break;
+	if (fcb != nullptr && swapped)
+	{
+		i64 sector = dp->position / dp->sectorSize;
+		dd8xxSparseOpen(dp, fcb, false);
+		dp->position = sector * dp->sectorSize;
+	}
 
-	case Fc8xxFormatPack:
-		if (dp->size.maxTracks == MaxTracks844)
-		{
-			mfr->activeDevice->recordLength = 7;
-		}
-		else
-		{
-			mfr->activeDevice->recordLength = 18;
-		}
-		break;
+	/*
+	**  A drive left on plain file I/O carries on at its current sector.
+	**  The recopy moved the file, and a cached drive never positioned it.
+	*/
+	if (fcb != nullptr && !swapped)
+	{
+		DiskSeek(fcb, dp->position);
+	}
 
-	case Fc8xxManipulateProcessor:
-		mfr->activeDevice->recordLength = 5;
-		break;
+	RELEASE(&mfr->PpuMutex);
 
-	case Fc8xxIoLength:
-	case Fc8xxDisableReserve:
-	case Fc8xxContinue:
-	case Fc8xxOnSectorStatus:
-	case Fc8xxReturnCylAddr:
-	case Fc8xxGapWrite:
-	case Fc8xxGapWriteVerify:
-	case Fc8xxGapReadCheckword:
-#if DEBUG
-		fprintf(dd8xxLog, " !!!!!FUNC not implemented but accepted!!!!!! ");
-#endif
-		logError(LogErrorLocation, "ch %o, function %04o not implemented\n", mfr->activeChannel->id, funcCode);
-		break;
+	if (fcb == nullptr)
+	{
+		printf("Failed to reopen %s, drive is unavailable\n", dp->fileName);
+	}
+	else if (swapped)
+	{
+		printf("Converted %s to sparse in %.3f s, %lu of %lu sectors stored, %lu copied again, old container in %s\n",
+			dp->fileName, static_cast<double>(static_cast<i64>(rtcHostMicroseconds() - job->start)) / 1000000.0,
+			static_cast<unsigned long>(stored), static_cast<unsigned long>(job->sectors),
+			static_cast<unsigned long>(recopied), job->bakName);
 	}
 
-	mfr->activeDevice->fcode = funcCode;
-
-#if DEBUG
-	fflush(dd8xxLog);
-#endif
-	return(FcAccepted);
+	free(job->dirty);
+	free(job);
+	convertJob = nullptr;
 }
 
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform I/O on 8xx disk drive.
+**  Purpose:        Initialise specified disk drive.
 **
 **  Parameters:     Name        Description.
+**                  eqNo        equipment number
+**                  unitNo      unit number
+**                  channelNo   channel number the device is attached to
+**                  deviceName  optional device file name
+**                  size        pointer to disk size structure
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxIo(u8 mfrId)
+static void dd8xxInit(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName, DiskSize *size, u8 diskType)
 {
-	FILE *fcb;
-	DiskParam *dp;
-	i32 pos;
+	char fname[80];
+	time_t mTime;
+	u8 containerType;
+	char *opt = nullptr;
+	char *baseName = nullptr;
+	double latency = 0.0;
 
-	MMainFrame *mfr = BigIron->chasis[mfrId];
+	(void)eqNo;
 
-	i8 unitNo = mfr->activeDevice->selectedUnit;
-	if (unitNo != -1)
+	MMainFrame *mfr = BigIron->chasis[mfrID];
+
+
+#if DEBUG
+	if (dd8xxLog == NULL)
 	{
-		dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
-		fcb = mfr->activeDevice->fcb[unitNo];
+		dd8xxLog = fopen("dd8xxlog.txt", "wt");
+		if (dd8xxLog == NULL)
+		{
+			fprintf(stderr, "dd8xxlog.txt - aborting\n");
+			exit(1);
+		}
 	}
-	else
+#endif
+
+	/*
+	**  Setup channel functions.
+	*/
+	DevSlot *ds = channelAttach(channelNo, eqNo, DtDd8xx, mfrID);
+	mfr->activeDevice = ds;
+	ds->activate = dd8xxActivate;
+	ds->disconnect = dd8xxDisconnect;
+	ds->snapshot = dd8xxSnapshot;
+	ds->func = dd8xxFunc;
+	ds->io = dd8xxIo;
+
+	/*
+	**  Save disk parameters.
+	*/
+	ds->selectedUnit = -1;
+	DiskParam *dp = static_cast<DiskParam *>(calloc(1, sizeof(DiskParam)));
+	if (dp == nullptr)
 	{
-		dp = nullptr;
-		fcb = nullptr;
+		fprintf(stderr, "Failed to allocate dd8xx context block\n");
+		exit(1);
 	}
 
-	switch (mfr->activeDevice->fcode)
+	dp->size = *size;
+	dp->diskNo = diskCount++;
+	dp->diskType = diskType;
+	dp->unitNo = unitNo;
+	dp->channelNo = channelNo;
+	dp->mfrID = mfrID;
+	dp->bufEnd = dp->buffer + SectorSize;
+
+	/*
+	**  Determine if any options have been specified.
+	*/
+	if (deviceName != nullptr)
 	{
-	case Fc8xxConnect:
-		if (mfr->activeChannel->full)
+		opt = strchr(deviceName, ',');
+	}
+
+	/*
+	**  Default values for options not specified.
+	*/
+	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+	switch (diskType)
+	{
+	case DiskType885:
+		containerType = CtPacked;
+		break;
+
+	case DiskType844:
+		containerType = CtClassic;
+		break;
+	}
+
+	if (opt != nullptr)
+	{
+		/*
+		**  Process options.
+		*/
+		*opt++ = '\0';
+
+		while (opt != nullptr)
 		{
-			unitNo = mfr->activeChannel->data & 07;
-			if (unitNo != mfr->activeDevice->selectedUnit)
+			char *next = strchr(opt, ',');
+			if (next != nullptr)
 			{
-				if (mfr->activeDevice->fcb[unitNo] != nullptr)
-				{
-					mfr->activeDevice->selectedUnit = unitNo;
-					dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
-					dp->detailedStatus[12] &= ~01000;
-				}
-				else
+				*next++ = '\0';
+			}
+
+			if (strcmp(opt, "old") == 0
+				|| strcmp(opt, "classic") == 0)
+			{
+				containerType = CtClassic;
+			}
+			else if (strcmp(opt, "new") == 0
+				|| strcmp(opt, "packed") == 0)
+			{
+				containerType = CtPacked;
+			}
+			else if (strcmp(opt, "sparse") == 0)
+			{
+				containerType = CtSparse;
+			}
+			else if (strncmp(opt, "base=", 5) == 0 && opt[5] != '\0')
+			{
+				/*
+				**  The device file is a copy-on-write overlay of this
+				**  shared base container.
+				*/
+				baseName = opt + 5;
+			}
+			else if (strcmp(opt, "latency=instant") == 0)
+			{
+				latency = 0.0;
+			}
+			else if (strcmp(opt, "latency=realistic") == 0)
+			{
+				latency = 1.0;
+			}
+			else if (strncmp(opt, "latency=", 8) == 0)
+			{
+				/*
+				**  Realistic timing scaled by a factor.
+				*/
+				char *end;
+				latency = strtod(opt + 8, &end);
+				if (end == opt + 8 || *end != '\0' || latency < 0.0)
 				{
-					mfr->activeDevice->selectedUnit = -1;
-					logError(LogErrorLocation, "channel %02o - invalid connect: %4.4o", mfr->activeChannel->id, static_cast<u32>(mfr->activeDevice->fcode));
+					fprintf(stderr, "Invalid latency factor %s\n", opt + 8);
+					exit(1);
 				}
 			}
 			else
 			{
-				dp->detailedStatus[12] |= 01000;
+				fprintf(stderr, "Unrecognized option name %s\n", opt);
+				exit(1);
 			}
 
-			mfr->activeChannel->full = false;
+			opt = next;
+		}
+	}
+
+	/*
+	**  Setup the latency model. A drive without one completes seeks
+	**  and transfers at once.
+	*/
+	if (latency > 0.0)
+	{
+		dp->seekMinUs = static_cast<u32>((diskType == DiskType885 ? SeekMin885Us : SeekMin844Us) * latency);
+		dp->seekMaxUs = static_cast<u32>((diskType == DiskType885 ? SeekMax885Us : SeekMax844Us) * latency);
+		dp->sectorUs = static_cast<u32>(RevolutionUs / size->maxSectors * latency);
+		if (dp->sectorUs == 0)
+		{
+			dp->sectorUs = 1;
 		}
+	}
+
+	/*
+	**  Setup environment for disk container type.
+	*/
+	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+	// ReSharper disable once CppDeclaratorMightNotBeInitialized
+	switch (containerType)
+	{
+	case CtClassic:
+		dp->read = dd8xxReadClassic;
+		dp->write = dd8xxWriteClassic;
+		dp->sectorSize = SectorSize * 2;
 		break;
 
-	case Fc8xxSeekFull:
-	case Fc8xxSeekHalf:
-		if (mfr->activeChannel->full)
+	case CtPacked:
+	case CtSparse:
+		dp->read = dd8xxReadPacked;
+		dp->write = dd8xxWritePacked;
+		dp->sectorSize = 512;
+		break;
+	}
+
+	/*
+	**  Initialize detailed status.
+	*/
+	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+	switch (diskType)
+	{
+	case DiskType885:
+		dp->detailedStatus[0] = 0;             // strobe offset & address error status
+		dp->detailedStatus[1] = 0340;             // checkword error status & sector count
+		dp->detailedStatus[2] = 0;             // command code & error bits
+		dp->detailedStatus[3] = 07440 + unitNo;    // dsu number
+		dp->detailedStatus[4] = 0;             // address 1 of failing sector
+		dp->detailedStatus[5] = 0;             // address 2 of failing sector
+		dp->detailedStatus[6] = 010;             // non recoverable error status
+		dp->detailedStatus[7] = 037;             // 11 bit correction factor
+		dp->detailedStatus[8] = 01640;             // DSU status
+		dp->detailedStatus[9] = 07201;             // DSU fault status
+		dp->detailedStatus[10] = 0;             // DSU interlock status
+		dp->detailedStatus[11] = 0;             // bit address of correctable read error
+		dp->detailedStatus[12] = 02000;             // PP address of correctable read error
+		dp->detailedStatus[13] = 0;             // first word of correction vector
+		dp->detailedStatus[14] = 0;             // second word of correction vector
+		dp->detailedStatus[15] = 0;             // DSC operating status word
+		dp->detailedStatus[16] = 0;             // coupler buffer status
+		dp->detailedStatus[17] = 0400;             // access A is connected & last command
+		dp->detailedStatus[18] = 0;             // last command 2 and 3
+		dp->detailedStatus[19] = 0;             // last command 4
+		break;
+
+	case DiskType844:
+		dp->detailedStatus[0] = 0;             // strobe offset & address error status
+		dp->detailedStatus[1] = 0;             // checkword error status & sector count
+		dp->detailedStatus[2] = 0;             // command code & error bits
+		dp->detailedStatus[3] = 04440 + unitNo;    // dsu number
+		dp->detailedStatus[4] = 0;             // address 1 of failing sector
+		dp->detailedStatus[5] = 0;             // address 2 of failing sector
+		dp->detailedStatus[6] = 010;             // non recoverable error status
+		dp->detailedStatus[7] = 0;             // 11 bit correction factor
+		dp->detailedStatus[8] = 00740;             // DSU status
+		dp->detailedStatus[9] = 04001;             // DSU fault status
+		dp->detailedStatus[10] = 07520;             // DSU interlock status
+		dp->detailedStatus[11] = 0;             // bit address of correctable read error
+		dp->detailedStatus[12] = 0;             // PP address of correctable read error
+		dp->detailedStatus[13] = 0;             // first word of correction vector
+		dp->detailedStatus[14] = 0;             // second word of correction vector
+		dp->detailedStatus[15] = 00020;             // DSC operating status word
+		dp->detailedStatus[16] = 0;             // coupler buffer status
+		dp->detailedStatus[17] = 0400;             // access A is connected & last command
+		dp->detailedStatus[18] = 0;             // last command 2 and 3
+		dp->detailedStatus[19] = 0;             // last command 4
+		break;
+	}
+
+	/*
+	**  Link device parameters.
+	*/
+	ds->context[unitNo] = dp;
+
+	/*
+	**  Open or create disk image.
+	*/
+	if (deviceName == nullptr)
+	{
+		/*
+		**  Construct a name.
+		*/
+		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+		switch (diskType)
 		{
-			switch (mfr->activeDevice->recordLength--)
+		case DiskType844:
+			sprintf(fname, "DD844_C%02ou%1o", channelNo, unitNo);
+			break;
+
+		case DiskType885:
+			sprintf(fname, "DD885_C%02ou%1o", channelNo, unitNo);
+			break;
+		}
+	}
+	else
+	{
+		strcpy(fname, deviceName);
+	}
+
+	strcpy(dp->fileName, fname);
+
+	/*
+	**  Try to open existing disk image. An overlay is created on its
+	**  base if necessary.
+	*/
+	FILE *fcb = baseName != nullptr ? dd8xxOverlayOpen(dp, fname, baseName) : fopen(fname, "r+b");
+	if (fcb == nullptr)
+	{
+		/*
+		**  Disk does not yet exist - manufacture one.
+		*/
+		fcb = fopen(fname, "w+b");
+		if (fcb == nullptr)
+		{
+			fprintf(stderr, "Failed to open %s\n", fname);
+			exit(1);
+		}
+
+		/*
+		**  A new sparse container needs its index before the first write.
+		*/
+		if (containerType == CtSparse)
+		{
+			dd8xxSparseOpen(dp, fcb, true);
+		}
+
+		/*
+		**  Write last disk sector to reserve the space.
+		*/
+		memset(mySector, 0, SectorSize * 2);
+		dp->cylinder = size->maxCylinders - 1;
+		dp->track = size->maxTracks - 1;
+		dp->sector = size->maxSectors - 1;
+		DiskSeek(fcb, dd8xxSeek(dp, mfrID));
+		dd8xxSectorWrite(dp, fcb, mySector);
+
+		/*
+		**  Position to cylinder with the disk's factory and utility
+		**  data areas.
+		*/
+		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+		switch (diskType)
+		{
+		case DiskType885:
+			dp->cylinder = size->maxCylinders - 2;
+			break;
+
+		case DiskType844:
+			dp->cylinder = size->maxCylinders - 1;
+			break;
+		}
+
+		/*
+		**  Zero entire cylinder containing factory and utility data areas.
+		*/
+		memset(mySector, 0, SectorSize * 2);
+		for (dp->track = 0; dp->track < size->maxTracks; dp->track++)
+		{
+			for (dp->sector = 0; dp->sector < size->maxSectors; dp->sector++)
 			{
-			case 4:
-				unitNo = mfr->activeChannel->data & 07;
-				if (unitNo != mfr->activeDevice->selectedUnit)
-				{
-					if (mfr->activeDevice->fcb[unitNo] != nullptr)
-					{
-						mfr->activeDevice->selectedUnit = unitNo;
-						dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
-						dp->detailedStatus[12] &= ~01000;
+				DiskSeek(fcb, dd8xxSeek(dp, mfrID));
+				dd8xxSectorWrite(dp, fcb, mySector);
+			}
+		}
+
+		/*
+		**  Write serial number and date of manufacture.
+		*/
+		mySector[0] = (channelNo & 070) << (8 - 3);
+		mySector[0] |= (channelNo & 007) << (4 - 0);
+		mySector[0] |= (unitNo & 070) >> (3 - 0);
+		mySector[1] = (unitNo & 007) << (8 - 0);
+		mySector[1] |= (diskType & 070) << (4 - 3);
+		mySector[1] |= (diskType & 007) << (0 - 0);
+
+		time(&mTime);
+		struct tm *lTime = localtime(&mTime);
+		u8 yy = lTime->tm_year % 100;
+		u8 mm = lTime->tm_mon + 1;
+		u8 dd = lTime->tm_mday;
+
+		mySector[2] = (dd / 10) << 8 | (dd % 10) << 4 | mm / 10;
+		mySector[3] = (mm % 10) << 8 | (yy / 10) << 4 | yy % 10;
+
+		dp->track = 0;
+		dp->sector = 0;
+		DiskSeek(fcb, dd8xxSeek(dp, mfrID));
+		dd8xxSectorWrite(dp, fcb, mySector);
+	}
+
+	/*
+	**  A sparse container is recognised by its header, whatever the
+	**  options say.
+	*/
+	else if (baseName == nullptr && !dd8xxSparseOpen(dp, fcb, false) && containerType == CtSparse)
+	{
+		fprintf(stderr, "%s is not a sparse container\n", fname);
+		exit(1);
+	}
+
+	ds->fcb[unitNo] = fcb;
+
+	/*
+	**  Optionally access the container through a mapping from now on.
+	*/
+	if (diskMap && dp->overlay == nullptr && dp->sparse == nullptr && !dd8xxMap(dp, fcb))
+	{
+		printf("Can't map %s, using file I/O\n", fname);
+	}
+
+	/*
+	**  Containers accessed by file I/O may be cached.
+	*/
+	if (dp->map == nullptr && dp->overlay == nullptr && dp->sparse == nullptr && cacheSectors != 0)
+	{
+		dd8xxCacheCreate(dp, fcb);
+	}
+
+	/*
+	**  Every drive is listed for the statistics, the cached ones also
+	**  for the cache thread.
+	*/
+	EnterCriticalSection(&diskListMutex);
+	if (firstDisk == nullptr)
+	{
+		firstDisk = dp;
+	}
+	else
+	{
+		lastDisk->nextDisk = dp;
+	}
+
+	lastDisk = dp;
+	LeaveCriticalSection(&diskListMutex);
+
+	/*
+	**  Reset disk seek position.
+	*/
+	dp->cylinder = 0;
+	dp->track = 0;
+	dp->sector = 0;
+	dp->interlace = 1;
+	dd8xxPosition(dp, fcb, dd8xxSeek(dp, mfrID));
+
+	/*
+	**  Print a friendly message.
+	*/
+	printf("Disk with %d cylinders initialised on channel %o unit %o, mainframe %o%s\n",
+		dp->size.maxCylinders, channelNo, unitNo, mfrID,
+		dp->map != nullptr ? " (mapped)" : dp->overlay != nullptr ? " (overlay)" : dp->sparse != nullptr ? " (sparse)" : "");
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Execute function code on 8xx disk drive.
+**
+**  Parameters:     Name        Description.
+**                  funcCode    function code
+**
+**  Returns:        FcStatus
+**
+**------------------------------------------------------------------------*/
+static FcStatus dd8xxFunc(PpWord funcCode, u8 mfrId)
+{
+	FILE *fcb;
+	DiskParam *dp;
+
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	i8 unitNo = mfr->activeDevice->selectedUnit;
+	if (unitNo != -1)
+	{
+		dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
+		fcb = mfr->activeDevice->fcb[unitNo];
+	}
+	else
+	{
+		dp = nullptr;
+		fcb = nullptr;
+	}
+
+	/*
+	**  Deal with deadstart function.
+	*/
+	if ((funcCode & 0700) == Fc8xxDeadstart)
+	{
+		funcCode = Fc8xxDeadstart;
+		mfr->activeDevice->selectedUnit = funcCode & 07;
+		unitNo = mfr->activeDevice->selectedUnit;
+		fcb = mfr->activeDevice->fcb[unitNo];
+		dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
+	}
+
+#if DEBUG
+	dd8xxLogFlush();
+	if (dp != NULL)
+	{
+		fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o DSK:%d f:%04o T:%-25s   c:%3d t:%2d s:%2d  >   ",
+			traceSequenceNo,
+			activePpu->id,
+			activeDevice->channel->id,
+			dp->diskNo,
+			funcCode,
+			dd8xxFunc2String(funcCode),
+			dp->cylinder,
+			dp->track,
+			dp->sector);
+	}
+	else
+	{
+		fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o DSK:? f:%04o T:%-25s  >   ",
+			traceSequenceNo,
+			activePpu->id,
+			activeDevice->channel->id,
+			funcCode,
+			dd8xxFunc2String(funcCode));
+	}
+
+	fflush(dd8xxLog);
+#endif
+
+	/*
+	**  Catch functions which try to operate on not selected drives.
+	*/
+	if (unitNo == -1)
+	{
+		switch (funcCode)
+		{
+		case Fc8xxConnect:
+		case Fc8xxSeekFull:
+		case Fc8xxSeekHalf:
+		case Fc8xxOpComplete:
+		case Fc8xxDropSeeks:
+		case Fc8xxGeneralStatus:
+		case Fc8xxStartMemLoad:
+		case Fc8xxDriveRelease:
+		case Fc8xxManipulateProcessor:
+		case Fc8xxDisableReserve:
+		case Fc8xxClearCoupler:
+			/*
+			**  These functions are OK - do nothing.
+			*/
+			break;
+
+		default:
+			/*
+			**  All remaining functions are declined if no drive is selected.
+			*/
+#if DEBUG
+			fprintf(dd8xxLog, " No drive selected, function declined ");
+#endif
+			return(FcDeclined);
+		}
+	}
+
+	/*
+	**  Process function request.
+	*/
+	switch (funcCode)
+	{
+	default:
+#if DEBUG
+		fprintf(dd8xxLog, " !!!!!FUNC not implemented & declined!!!!!! ");
+#endif
+		return(FcDeclined);
+
+	case Fc8xxClearCoupler:
+		return(FcProcessed);
+
+	case Fc8xxConnect:
+		/*
+		**  Expect drive number.
+		*/
+		mfr->activeDevice->recordLength = 1;
+		break;
+
+	case Fc8xxSeekFull:
+	case Fc8xxSeekHalf:
+		/*
+		**  Expect drive number, cylinder, track and sector.
+		*/
+		mfr->activeDevice->recordLength = 4;
+		break;
+
+	case Fc8xxRead:
+	case Fc8xxReadFlawedSector:
+	case Fc8xxGapRead:
+		mfr->activeDevice->recordLength = SectorSize;
+		dp->stats.reads += 1;
+		dd8xxLatencySector(dp);
+		break;
+
+	case Fc8xxWrite:
+	case Fc8xxWriteFlawedSector:
+	case Fc8xxWriteLastSector:
+	case Fc8xxWriteVerify:
+		mfr->activeDevice->recordLength = SectorSize;
+		dp->stats.writes += 1;
+		dd8xxLatencySector(dp);
+		break;
+
+	case Fc8xxReadCheckword:
+		mfr->activeDevice->recordLength = 2;
+		break;
+
+	case Fc8xxOpComplete:
+		return(FcProcessed);
+
+	case Fc8xxDropSeeks:
+		return(FcProcessed);
+
+	case Fc8xxGeneralStatus:
+		mfr->activeDevice->recordLength = 1;
+		break;
+
+	case Fc8xxDetailedStatus:
+	case Fc8xxDetailedStatus2:
+		dp->detailedStatus[2] = (funcCode << 4) & 07760;
+
+		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+		switch (dp->diskType)
+		{
+		case DiskType885:
+			dp->detailedStatus[4] = (dp->cylinder >> 4) & 077;
+			dp->detailedStatus[5] = ((dp->cylinder << 8) | dp->track) & 07777;
+			dp->detailedStatus[6] = ((dp->sector << 4) | 010) & 07777;
+			if ((dp->track & 1) != 0)
+			{
+				dp->detailedStatus[9] |= 2;  /* odd track */
+			}
+			else
+			{
+				dp->detailedStatus[9] &= ~2;
+			}
+
+			break;
+
+		case DiskType844:
+			dp->detailedStatus[4] = ((dp->cylinder & 0777) << 3) | ((dp->track >> 2) & 07);
+			dp->detailedStatus[5] = ((dp->track & 03) << 10) | ((dp->sector & 017) << 5) | ((dp->cylinder >> 9) & 01);
+			dp->detailedStatus[6] = ((dp->sector << 4) | 010) & 07777;
+			break;
+		}
+
+		if (funcCode == Fc8xxDetailedStatus)
+		{
+			mfr->activeDevice->recordLength = 12;
+		}
+		else
+		{
+			mfr->activeDevice->recordLength = 20;
+		}
+		break;
+
+	case Fc8xxStartMemLoad:
+		break;
+
+	case Fc8xxReadUtilityMap:
+	case Fc8xxReadFactoryData:
+		mfr->activeDevice->recordLength = SectorSize;
+		break;
+
+	case Fc8xxDriveRelease:
+		return(FcProcessed);
+
+	case Fc8xxDeadstart:
+		// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
+		switch (dp->diskType)
+		{
+		case DiskType844:
+			if (dp->size.maxCylinders == MaxCylinders844_2)
+			{
+				dp->cylinder = DsCylinder844_2;
+			}
+			else
+			{
+				dp->cylinder = DsCylinder844_4;
+			}
+
+			dp->track = DsTrack844;
+			dp->sector = DsSector844;
+			break;
+
+		case DiskType885:
+			dp->cylinder = DsCylinder885;
+			dp->track = DsTrack885;
+			dp->sector = DsSector885;
+			break;
+		}
+
+		dd8xxPosition(dp, fcb, dd8xxSeek(dp, mfrId));
+		mfr->activeDevice->recordLength = SectorSize;
+		break;
+
+	case Fc8xxSetClearFlaw:
+		if (dp->diskType != DiskType844)
+		{
+			return(FcDeclined);
+		}
+
+		mfr->activeDevice->recordLength = 1;
+		break;
+
+	case Fc8xxFormatPack:
+		if (dp->size.maxTracks == MaxTracks844)
+		{
+			mfr->activeDevice->recordLength = 7;
+		}
+		else
+		{
+			mfr->activeDevice->recordLength = 18;
+		}
+		break;
+
+	case Fc8xxManipulateProcessor:
+		mfr->activeDevice->recordLength = 5;
+		break;
+
+	case Fc8xxIoLength:
+	case Fc8xxDisableReserve:
+	case Fc8xxContinue:
+	case Fc8xxOnSectorStatus:
+	case Fc8xxReturnCylAddr:
+	case Fc8xxGapWrite:
+	case Fc8xxGapWriteVerify:
+	case Fc8xxGapReadCheckword:
+#if DEBUG
+		fprintf(dd8xxLog, " !!!!!FUNC not implemented but accepted!!!!!! ");
+#endif
+		logError(LogErrorLocation, "ch %o, function %04o not implemented\n", mfr->activeChannel->id, funcCode);
+		break;
+	}
+
+	mfr->activeDevice->fcode = funcCode;
+
+#if DEBUG
+	fflush(dd8xxLog);
+#endif
+	return(FcAccepted);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform I/O on 8xx disk drive.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxIo(u8 mfrId)
+{
+	FILE *fcb;
+	DiskParam *dp;
+	i64 pos;
+
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	i8 unitNo = mfr->activeDevice->selectedUnit;
+	if (unitNo != -1)
+	{
+		dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
+		fcb = mfr->activeDevice->fcb[unitNo];
+	}
+	else
+	{
+		dp = nullptr;
+		fcb = nullptr;
+	}
+
+	switch (mfr->activeDevice->fcode)
+	{
+	case Fc8xxConnect:
+		if (mfr->activeChannel->full)
+		{
+			unitNo = mfr->activeChannel->data & 07;
+			if (unitNo != mfr->activeDevice->selectedUnit)
+			{
+				if (mfr->activeDevice->fcb[unitNo] != nullptr)
+				{
+					mfr->activeDevice->selectedUnit = unitNo;
+					dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
+					dp->detailedStatus[12] &= ~01000;
+				}
+				else
+				{
+					mfr->activeDevice->selectedUnit = -1;
+					logError(LogErrorLocation, "channel %02o - invalid connect: %4.4o", mfr->activeChannel->id, static_cast<u32>(mfr->activeDevice->fcode));
+				}
+			}
+			else
+			{
+				dp->detailedStatus[12] |= 01000;
+			}
+
+			mfr->activeChannel->full = false;
+		}
+		break;
+
+	case Fc8xxSeekFull:
+	case Fc8xxSeekHalf:
+		if (mfr->activeChannel->full)
+		{
+			switch (mfr->activeDevice->recordLength--)
+			{
+			case 4:
+				unitNo = mfr->activeChannel->data & 07;
+				if (unitNo != mfr->activeDevice->selectedUnit)
+				{
+					if (mfr->activeDevice->fcb[unitNo] != nullptr)
+					{
+						mfr->activeDevice->selectedUnit = unitNo;
+						dp = static_cast<DiskParam *>(mfr->activeDevice->context[unitNo]);
+						dp->detailedStatus[12] &= ~01000;
+
+					}
+					else
+					{
+						logError(LogErrorLocation, "channel %02o - invalid select: %4.4o", mfr->activeChannel->id, static_cast<u32>(mfr->activeDevice->fcode));
+						mfr->activeDevice->selectedUnit = -1;
+					}
+				}
+				else
+				{
+					dp->detailedStatus[12] |= 01000;
+				}
+				break;
+
+			case 3:
+				if (dp != nullptr)
+				{
+					dp->cylinder = mfr->activeChannel->data;
+				}
+				break;
+
+			case 2:
+				if (dp != nullptr)
+				{
+					dp->track = mfr->activeChannel->data;
+				}
+				break;
+
+			case 1:
+				if (dp != nullptr)
+				{
+					if (mfr->activeDevice->fcode == Fc8xxSeekFull)
+					{
+						dp->interlace = 1;
+					}
+					else
+					{
+						dp->interlace = 2;
+					}
+
+					dp->sector = mfr->activeChannel->data;
+					pos = dd8xxSeek(dp, mfrId);
+					if (pos >= 0 && fcb != nullptr)
+					{
+						dd8xxPosition(dp, fcb, pos);
+						dd8xxLatencySeek(dp, abs(dp->cylinder - dp->stats.lastCylinder));
+						dd8xxStatsSeek(dp);
+					}
+				}
+				else
+				{
+					mfr->activeDevice->status = 05020;
+				}
+				break;
+
+			default:
+				mfr->activeDevice->recordLength = 0;
+				break;
+			}
+
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+
+			mfr->activeChannel->full = false;
+		}
+		break;
+
+	case Fc8xxDeadstart:
+		if (!mfr->activeChannel->full)
+		{
+			if (mfr->activeDevice->recordLength == SectorSize)
+			{
+				/*
+				**  The first word in the sector contains the data length.
+				*/
+				mfr->activeDevice->recordLength = dp->read(dp, fcb);
+				if (mfr->activeDevice->recordLength > SectorSize)
+				{
+					mfr->activeDevice->recordLength = SectorSize;
+				}
+
+				mfr->activeChannel->data = mfr->activeDevice->recordLength;
+			}
+			else
+			{
+				mfr->activeChannel->data = dp->read(dp, fcb);
+			}
+
+			mfr->activeChannel->full = true;
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+				pos = dd8xxSeekNextSector(dp, mfrId);
+				if (pos >= 0)
+				{
+					dd8xxPosition(dp, fcb, pos);
+				}
+			}
+		}
+		break;
+
+	case Fc8xxRead:
+	case Fc8xxReadFlawedSector:
+	case Fc8xxGapRead:
+		/*
+		**  The latency model holds data back until the sector has
+		**  passed under the heads.
+		*/
+		if (!mfr->activeChannel->full && !dd8xxBusy(dp))
+		{
+			mfr->activeChannel->data = dp->read(dp, fcb);
+			mfr->activeChannel->full = true;
+#if DEBUG
+			dd8xxLogByte(activeChannel->data);
+#endif
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+				pos = dd8xxSeekNextSector(dp, mfrId);
+				if (mfr->activeDevice->fcode == Fc8xxGapRead && pos >= 0)
+				{
+					pos = dd8xxSeekNextSector(dp, mfrId);
+				}
+				if (pos >= 0)
+				{
+					dd8xxPosition(dp, fcb, pos);
+				}
+			}
+		}
+		break;
+
+	case Fc8xxWrite:
+	case Fc8xxWriteFlawedSector:
+	case Fc8xxWriteLastSector:
+	case Fc8xxWriteVerify:
+		if (mfr->activeChannel->full && !dd8xxBusy(dp))
+		{
+			dp->write(dp, fcb, mfr->activeChannel->data);
+			mfr->activeChannel->full = false;
+
+#if DEBUG
+			dd8xxLogByte(activeChannel->data);
+#endif
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				pos = dd8xxSeekNextSector(dp, mfrId);
+				if (pos >= 0)
+				{
+					dd8xxPosition(dp, fcb, pos);
+				}
+			}
+		}
+		break;
+
+	case Fc8xxGeneralStatus:
+		if (!mfr->activeChannel->full)
+		{
+			mfr->activeChannel->data = mfr->activeDevice->status;
+			if (dp != nullptr && dd8xxBusy(dp))
+			{
+				mfr->activeChannel->data |= St8xxBusy;
+			}
+
+			mfr->activeChannel->full = true;
+
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+			}
+		}
+		break;
+
+	case Fc8xxReadCheckword:
+		if (!mfr->activeChannel->full)
+		{
+			mfr->activeChannel->data = 0;
+			mfr->activeChannel->full = true;
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+			}
+		}
+		break;
+	case Fc8xxDetailedStatus:
+		if (!mfr->activeChannel->full)
+		{
+			mfr->activeChannel->data = dp->detailedStatus[12 - mfr->activeDevice->recordLength];
+			mfr->activeChannel->full = true;
+
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+			}
+		}
+		break;
+
+	case Fc8xxDetailedStatus2:
+		if (!mfr->activeChannel->full)
+		{
+			mfr->activeChannel->data = dp->detailedStatus[20 - mfr->activeDevice->recordLength];
+			mfr->activeChannel->full = true;
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+			}
+		}
+		break;
+
+	case Fc8xxReadFactoryData:
+	case Fc8xxReadUtilityMap:
+		if (!mfr->activeChannel->full)
+		{
+			mfr->activeChannel->data = dp->read(dp, fcb);
+			mfr->activeChannel->full = true;
+
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+
+			if (--mfr->activeDevice->recordLength == 0)
+			{
+				mfr->activeChannel->discAfterInput = true;
+			}
+		}
+		break;
+
+	case Fc8xxSetClearFlaw:
+		if (mfr->activeChannel->full)
+		{
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+			dd844SetClearFlaw(dp, mfr->activeChannel->data, mfrId);
+			mfr->activeChannel->full = false;
+		}
+		break;
+
+	case Fc8xxStartMemLoad:
+		if (mfr->activeChannel->full)
+		{
+			mfr->activeChannel->full = false;
+#if DEBUG
+			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#endif
+		}
+		break;
+
+	case Fc8xxFormatPack:
+	case Fc8xxManipulateProcessor:
+	case Fc8xxIoLength:
+	case Fc8xxOpComplete:
+	case Fc8xxDisableReserve:
+	case Fc8xxContinue:
+	case Fc8xxDropSeeks:
+	case Fc8xxOnSectorStatus:
+	case Fc8xxDriveRelease:
+	case Fc8xxReturnCylAddr:
+	case Fc8xxGapWrite:
+	case Fc8xxGapWriteVerify:
+	case Fc8xxGapReadCheckword:
+	default:
+		mfr->activeChannel->full = false;
+		break;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Handle channel activation.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxActivate(u8 mfrId)
+{
+#if DEBUG
+	fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o Activate",
+		traceSequenceNo,
+		activePpu->id,
+		activeDevice->channel->id);
+
+	fflush(dd8xxLog);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Handle disconnecting of channel.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxDisconnect(u8 mfrId)
+{
+	/*
+	**  Abort pending device disconnects - the PP is doing the disconnect.
+	*/
+
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+	mfr->activeChannel->discAfterInput = false;
+
+#if DEBUG
+	fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o Disconnect",
+		traceSequenceNo,
+		activePpu->id,
+		activeDevice->channel->id);
+
+	fflush(dd8xxLog);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Save or restore the disk position and sector buffer
+**                  of every unit on a controller.
+**
+**  Parameters:     Name        Description.
+**                  ds          device slot
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxSnapshot(DevSlot *ds, FILE *fcb, bool restore)
+{
+	for (int unitNo = 0; unitNo < MaxUnits2; unitNo++)
+	{
+		DiskParam *dp = static_cast<DiskParam *>(ds->context[unitNo]);
+		if (dp == nullptr)
+		{
+			continue;
+		}
+
+		/*
+		**  A sector served straight from a mapped container is copied
+		**  into the buffer so the snapshot does not depend on it.
+		*/
+		PpWord *start = dp->bufEnd - SectorSize;
+		i32 bufOffset = dp->bufPtr == nullptr ? -1 : static_cast<i32>(dp->bufPtr - start);
+		if (dp->bufPtr != nullptr && start != dp->buffer)
+		{
+			memcpy(dp->buffer, start, SectorSize * sizeof(PpWord));
+		}
+
+		SnapshotVar(fcb, dp->position, restore);
+		SnapshotVar(fcb, dp->sector, restore);
+		SnapshotVar(fcb, dp->track, restore);
+		SnapshotVar(fcb, dp->cylinder, restore);
+		SnapshotVar(fcb, dp->detailedStatus, restore);
+		SnapshotVar(fcb, dp->buffer, restore);
+		SnapshotVar(fcb, bufOffset, restore);
+
+		if (restore)
+		{
+			dp->bufPtr = bufOffset < 0 || bufOffset > SectorSize ? nullptr : dp->buffer + bufOffset;
+			dp->bufEnd = dp->buffer + SectorSize;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Copy one sector of a classic or packed container
+**                  into the sparse container being built.
+**
+**  Parameters:     Name        Description.
+**                  job         conversion
+**                  from        old container
+**                  sector      sector number
+**
+**  Returns:        false if the sparse container could not be written.
+**
+**------------------------------------------------------------------------*/
+static bool dd8xxConvertSector(ConvertJob *job, FILE *from, u32 sector)
+{
+	DiskParam *conv = &job->conv;
+	PpWord words[SectorSize];
+	u8 raw[SectorSize * 2];
+	u8 packed[SparseSectorSize];
+	size_t got = 0;
+
+	/*
+	**  The old container keeps its own layout, the sparse parameters
+	**  describe the new one.
+	*/
+	if (DiskSeek(from, static_cast<i64>(sector) * job->sectorSize) == 0)
+	{
+		got = fread(raw, 1, job->sectorSize, from);
+	}
+
+	memset(raw + got, 0, job->sectorSize - got);
+
+	if (job->classic)
+	{
+		memcpy(words, raw, sizeof(words));
+	}
+	else
+	{
+		bitpack8To12(raw, words, SectorSize / 2);
+	}
+
+	memset(packed, 0, sizeof(packed));
+	bitpack12To8(words, packed, SectorSize / 2);
+	conv->position = static_cast<i64>(sector) * SparseSectorSize;
+
+	return(dd8xxSparseWrite(conv, job->nfcb, packed));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the thread which copies a container for a
+**                  conversion.
+**
+**  Parameters:     Name        Description.
+**                  job         conversion
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxConvertCreateThread(ConvertJob *job)
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(dd8xxConvertThread),
+		static_cast<LPVOID>(job),                               // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create disk conversion thread\n");
+		exit(1);
+	}
+
+	CloseHandle(hThread);
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, dd8xxConvertThread, job);
+	if (rc != 0)
+	{
+		fprintf(stderr, "Failed to create disk conversion thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Disk conversion thread. Copies every sector of the
+**                  old container into the sparse one through its own
+**                  file handle, then asks the drive's mainframe to
+**                  finish the conversion.
+**
+**  Parameters:     Name        Description.
+**                  param       conversion
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void dd8xxConvertThread(void *param)
+#else
+static void *dd8xxConvertThread(void *param)
+#endif
+{
+	ConvertJob *job = static_cast<ConvertJob *>(param);
+	bool ok = true;
+
+	for (u32 i = 0; ok && i < job->sectors && BigIron->emulationActive; i++)
+	{
+		ok = dd8xxConvertSector(job, job->rfcb, i);
+	}
+
+	fclose(job->rfcb);
+
+	job->ok = ok;
+	BigIron->chasis[job->mfrID]->diskConvert = true;
+
+#if !defined(_WIN32)
+	return(NULL);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Flush and release the cache, overlay, sparse index or
+**                  mapping of one drive, leaving plain file I/O on its
+**                  container.
+**
+**  Parameters:     Name        Description.
+**                  ds          device slot
+**                  unitNo      unit number
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxRelease(DevSlot *ds, int unitNo)
+{
+	DiskParam *dp = static_cast<DiskParam *>(ds->context[unitNo]);
+
+	/*
+	**  Write back the cache and take it away from the cache thread
+	**  before the channel closes the container.
+	*/
+	if (dp->cache != nullptr)
+	{
+		EnterCriticalSection(&diskListMutex);
+		DiskCache *cp = dp->cache;
+		dd8xxCacheFlush(dp, ds->fcb[unitNo]);
+		dp->cache = nullptr;
+		LeaveCriticalSection(&diskListMutex);
+
+		DeleteCriticalSection(&cp->cacheLock);
+		DeleteCriticalSection(&cp->fileLock);
+		free(cp->slot);
+		free(cp->bucket);
+		free(cp->data);
+		free(cp->ioBuf);
+		free(cp->ioPos);
+		free(cp);
+	}
+
+	if (dp->overlay != nullptr)
+	{
+		fflush(ds->fcb[unitNo]);
+		dd8xxOverlayClose(dp);
+	}
+
+	if (dp->sparse != nullptr)
+	{
+		fflush(ds->fcb[unitNo]);
+		dd8xxSparseClose(dp);
+	}
+
+	if (dp->map == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	if (!FlushViewOfFile(dp->map, 0) || !FlushFileBuffers(dp->fileHandle))
+	{
+		fprintf(stderr, "Error writing disk on channel %o unit %o\n", ds->channel->id, unitNo);
+	}
+
+	UnmapViewOfFile(dp->map);
+	CloseHandle(dp->mapHandle);
+#else
+	if (msync(dp->map, static_cast<size_t>(dp->mapBytes), MS_SYNC) != 0)
+	{
+		fprintf(stderr, "Error writing disk on channel %o unit %o\n", ds->channel->id, unitNo);
+	}
+
+	munmap(dp->map, static_cast<size_t>(dp->mapBytes));
+#endif
+	dp->map = nullptr;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take a drive off the list of drives.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxUnlink(DiskParam *dp)
+{
+	EnterCriticalSection(&diskListMutex);
+
+	DiskParam **link = &firstDisk;
+	lastDisk = nullptr;
+	while (*link != nullptr)
+	{
+		if (*link == dp)
+		{
+			*link = dp->nextDisk;
+		}
+		else
+		{
+			lastDisk = *link;
+			link = &(*link)->nextDisk;
+		}
+	}
+
+	LeaveCriticalSection(&diskListMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Work out seek offset.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**
+**  Returns:        Byte offset (not word!) or -1 when seek target
+**                  is invalid.
+**
+**------------------------------------------------------------------------*/
+static i64 dd8xxSeek(DiskParam *dp, u8 mfrId)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	dp->bufPtr = nullptr;
+
+	mfr->activeDevice->status = 0;
+
+	if (dp->cylinder >= dp->size.maxCylinders)
+	{
+#if DEBUG
+		fprintf(dd8xxLog, "ch %o, cylinder %d invalid\n", activeChannel->id, dp->cylinder);
+#endif
+		logError(LogErrorLocation, "ch %o, cylinder %d invalid\n", mfr->activeChannel->id, dp->cylinder);
+		mfr->activeDevice->status = 01000;
+		return(-1);
+	}
+
+	if (dp->track >= dp->size.maxTracks)
+	{
+#if DEBUG
+		fprintf(dd8xxLog, "ch %o, track %d invalid\n", activeChannel->id, dp->track);
+#endif
+		logError(LogErrorLocation, "ch %o, track %d invalid\n", mfr->activeChannel->id, dp->track);
+		mfr->activeDevice->status = 01000;
+		return(-1);
+	}
+
+	if (dp->sector >= dp->size.maxSectors)
+	{
+#if DEBUG
+		fprintf(dd8xxLog, "ch %o, sector %d invalid\n", activeChannel->id, dp->sector);
+#endif
+		logError(LogErrorLocation, "ch %o, sector %d invalid\n", mfr->activeChannel->id, dp->sector);
+		mfr->activeDevice->status = 01000;
+		return(-1);
+	}
+
+	i64 result = static_cast<i64>(dp->cylinder) * dp->size.maxTracks * dp->size.maxSectors;
+	result += dp->track * dp->size.maxSectors;
+	result += dp->sector;
+	result *= dp->sectorSize;
+
+	dp->position = result;
+
+	return(result);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Position to next sector taking into account interlace.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**
+**  Returns:        Byte offset (not word!) or -1 when seek target
+**                  is invalid.
+**
+**------------------------------------------------------------------------*/
+static i64 dd8xxSeekNextSector(DiskParam *dp, u8 mfrId)
+{
+	dp->sector += dp->interlace;
+
+	if (dp->interlace == 1)
+	{
+		if (dp->sector == dp->size.maxSectors)
+		{
+			dp->sector = 0;
+			dp->track += 1;
+
+			if (dp->track == dp->size.maxTracks)
+			{
+				/*
+				**  Wrap to the start of the current cylinder.
+				*/
+				dp->track = 0;
+				dp->sector = 0;
+			}
+		}
+	}
+	else
+	{
+		if (dp->sector == dp->size.maxSectors)
+		{
+			dp->sector = 0;
+			dp->track += 1;
+			if (dp->track == dp->size.maxTracks)
+			{
+				/*
+				**  Now start all odd sectors.
+				*/
+				dp->track = 0;
+				dp->sector = 1;
+			}
+		}
+		else if (dp->sector == dp->size.maxSectors + 1)
+		{
+			dp->sector = 1;
+			dp->track += 1;
+
+			if (dp->track == dp->size.maxTracks)
+			{
+				/*
+				**  Wrap to the start of the current cylinder.
+				*/
+				dp->track = 0;
+				dp->sector = 0;
+			}
+		}
+	}
+
+	return(dd8xxSeek(dp, mfrId));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Position the container of a drive at the next sector.
+**                  A cached drive shares its file with the cache thread
+**                  and seeks under the file lock for every transfer, so
+**                  it is left alone here.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  pos         Byte offset.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxPosition(DiskParam *dp, FILE *fcb, i64 pos)
+{
+	if (dp->cache == nullptr)
+	{
+		DiskSeek(fcb, pos);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform a 12 bit PP word read from a classic disk container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**
+**  Returns:        PP word read.
+**
+**------------------------------------------------------------------------*/
+static PpWord dd8xxReadClassic(DiskParam *dp, FILE *fcb)
+{
+	/*
+	**  Read an entire sector if the current buffer is empty. A mapped
+	**  container already holds the sector in this format, so it is
+	**  used in place.
+	*/
+	if (dp->bufPtr == nullptr)
+	{
+		u64 start = rtcHostMicroseconds();
+
+		if (dp->map != nullptr)
+		{
+			dp->bufPtr = reinterpret_cast<PpWord *>(dp->map + dp->position);
+		}
+		else if (dp->overlay != nullptr)
+		{
+			dp->bufPtr = dp->buffer;
+			dd8xxOverlayRead(dp, fcb, reinterpret_cast<u8 *>(dp->buffer));
+		}
+		else if (dp->cache != nullptr)
+		{
+			dp->bufPtr = dp->buffer;
+			dd8xxCacheRead(dp, fcb, reinterpret_cast<u8 *>(dp->buffer));
+		}
+		else
+		{
+			dp->bufPtr = dp->buffer;
+			fread(dp->buffer, 1, dp->sectorSize, fcb);
+		}
+
+		dp->bufEnd = dp->bufPtr + SectorSize;
+		dp->stats.sectorsRead += 1;
+		dp->stats.ioUs += rtcHostMicroseconds() - start;
+	}
+
+	/*
+	**  Fail gracefully if we read too much data.
+	*/
+	if (dp->bufPtr >= dp->bufEnd)
+	{
+		return(0);
+	}
+
+	return(*dp->bufPtr++);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform a 12 bit PP word write to a classic disk container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  data        PP word to be written.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxWriteClassic(DiskParam *dp, FILE *fcb, PpWord data)
+{
+	/*
+	**  Fail gracefully if we write too much data.
+	*/
+	if (dp->bufPtr >= dp->bufEnd)
+	{
+		return;
+	}
+
+	/*
+	**  Reset pointer if the current buffer is empty.
+	*/
+	if (dp->bufPtr == nullptr)
+	{
+		dp->bufPtr = dp->buffer;
+		dp->bufEnd = dp->buffer + SectorSize;
+	}
+
+	*dp->bufPtr++ = data;
+
+	/*
+	**  Write the data if we got a full sector.
+	*/
+	if (dp->bufPtr == dp->buffer + SectorSize)
+	{
+		u64 start = rtcHostMicroseconds();
+
+		if (dp->map != nullptr)
+		{
+			memcpy(dp->map + dp->position, dp->buffer, dp->sectorSize);
+			dd8xxMapWritten(dp, dp->map + dp->position);
+		}
+		else if (dp->overlay != nullptr)
+		{
+			dd8xxOverlayWrite(dp, fcb, reinterpret_cast<u8 *>(dp->buffer));
+		}
+		else if (dp->cache != nullptr)
+		{
+			dd8xxCacheWrite(dp, fcb, reinterpret_cast<u8 *>(dp->buffer));
+		}
+		else
+		{
+			fwrite(dp->buffer, 1, dp->sectorSize, fcb);
+		}
+
+		dp->stats.sectorsWritten += 1;
+		dp->stats.ioUs += rtcHostMicroseconds() - start;
+
+		if (dp->convDirty != nullptr)
+		{
+			i64 sector = dp->position / dp->sectorSize;
+			if (sector >= 0 && sector < dp->convSectors)
+			{
+				dp->convDirty[sector >> 3] |= static_cast<u8>(1 << (sector & 7));
+			}
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform a 12 bit PP word read from a packed disk container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**
+**  Returns:        PP word read.
+**
+**------------------------------------------------------------------------*/
+static PpWord dd8xxReadPacked(DiskParam *dp, FILE *fcb)
+{
+	static u8 sector[512];
+
+	/*
+	**  Read an entire sector if the current buffer is empty. A mapped
+	**  container is unpacked in place.
+	*/
+	if (dp->bufPtr == nullptr)
+	{
+		u8 *sp = sector;
+		u64 start = rtcHostMicroseconds();
+
+		dp->bufPtr = dp->buffer;
+		dp->bufEnd = dp->buffer + SectorSize;
+		if (dp->map != nullptr)
+		{
+			sp = dp->map + dp->position;
+		}
+		else if (dp->overlay != nullptr)
+		{
+			dd8xxOverlayRead(dp, fcb, sector);
+		}
+		else if (dp->sparse != nullptr)
+		{
+			dd8xxSparseRead(dp, fcb, sector);
+		}
+		else if (dp->cache != nullptr)
+		{
+			dd8xxCacheRead(dp, fcb, sector);
+		}
+		else
+		{
+			fread(sector, 1, dp->sectorSize, fcb);
+		}
+
+		dp->stats.sectorsRead += 1;
+		dp->stats.ioUs += rtcHostMicroseconds() - start;
+
+		/*
+		**  Unpack the sector into the buffer.
+		*/
+		bitpack8To12(sp, dp->buffer, SectorSize / 2);
+	}
+
+	/*
+	**  Fail gracefully if we read too much data.
+	*/
+	if (dp->bufPtr >= dp->bufEnd)
+	{
+		return(0);
+	}
+
+	/*
+	**  Return one data word.
+	*/
+	return((*dp->bufPtr++) & Mask12);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform a 12 bit PP word write to a packed disk container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  data        PP word to be written.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxWritePacked(DiskParam *dp, FILE *fcb, PpWord data)
+{
+	static u8 sector[512];
+
+	/*
+	**  Fail gracefully if we write too much data.
+	*/
+	if (dp->bufPtr >= dp->bufEnd)
+	{
+		return;
+	}
+
+	/*
+	**  Reset pointer if the current buffer is empty.
+	*/
+	if (dp->bufPtr == nullptr)
+	{
+		dp->bufPtr = dp->buffer;
+		dp->bufEnd = dp->buffer + SectorSize;
+	}
+
+	*dp->bufPtr++ = data;
+
+	/*
+	**  Write the data if we got a full sector.
+	*/
+	if (dp->bufPtr == dp->buffer + SectorSize)
+	{
+		/*
+		**  Pack the buffer into a sector, in place if mapped.
+		*/
+		u8 *sp = dp->map != nullptr ? dp->map + dp->position : sector;
+		bitpack12To8(dp->buffer, sp, SectorSize / 2);
+
+		/*
+		**  Write the sector.
+		*/
+		u64 start = rtcHostMicroseconds();
+		if (dp->map != nullptr)
+		{
+			dd8xxMapWritten(dp, dp->map + dp->position);
+		}
+		else if (dp->overlay != nullptr)
+		{
+			dd8xxOverlayWrite(dp, fcb, sector);
+		}
+		else if (dp->sparse != nullptr)
+		{
+			dd8xxSparseWrite(dp, fcb, sector);
+		}
+		else if (dp->cache != nullptr)
+		{
+			dd8xxCacheWrite(dp, fcb, sector);
+		}
+		else
+		{
+			fwrite(sector, 1, dp->sectorSize, fcb);
+		}
+
+		dp->stats.sectorsWritten += 1;
+		dp->stats.ioUs += rtcHostMicroseconds() - start;
+
+		if (dp->convDirty != nullptr)
+		{
+			i64 sector = dp->position / dp->sectorSize;
+			if (sector >= 0 && sector < dp->convSectors)
+			{
+				dp->convDirty[sector >> 3] |= static_cast<u8>(1 << (sector & 7));
+			}
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform a sector read from a disk container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  sector      Pointer to sector to read into.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxSectorRead(DiskParam *dp, FILE *fcb, PpWord *sector)
+{
+	for (u16 byteCount = SectorSize; byteCount > 0; byteCount--)
+	{
+		*sector++ = dp->read(dp, fcb);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform a sector write to a disk container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  sector      Pointer to sector to write.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxSectorWrite(DiskParam *dp, FILE *fcb, PpWord *sector)
+{
+	for (u16 byteCount = SectorSize; byteCount > 0; byteCount--)
+	{
+		dp->write(dp, fcb, *sector++);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Manipulate 844 utility (flaw) map.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  flawState   Flaw state from PP.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd844SetClearFlaw(DiskParam *dp, PpWord flawState, u8 mfrId)
+{
+	int index;
+	PpWord sectorFlaw;
+	PpWord trackFlaw;
+
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	u8 unitNo = mfr->activeDevice->selectedUnit;
+	FILE *fcb = mfr->activeDevice->fcb[unitNo];
+
+	/*
+	**  Assemble flaw words.
+	*/
+	if ((flawState & 1) == 1)
+	{
+		trackFlaw = 1;
+		sectorFlaw = 0;
+	}
+	else
+	{
+		trackFlaw = 0;
+		sectorFlaw = 1;
+	}
+
+	bool setFlaw = (flawState & 2) != 0;
+
+	PpWord flawWord0 = static_cast<PpWord>((sectorFlaw << 11) | (trackFlaw << 10) | (dp->cylinder & Mask10));
+	PpWord flawWord1 = static_cast<PpWord>(((dp->track & Mask6) << 6) | (dp->sector & Mask6));
+
+	/*
+	**  Read the 844 utility map sector.
+	*/
+	dp->cylinder = dp->size.maxCylinders - 1;
+	dp->track = 0;
+	dp->sector = 2;
+	dd8xxPosition(dp, fcb, dd8xxSeek(dp, mfrId));
+	dd8xxSectorRead(dp, fcb, mySector);
+
+	/*
+	**  Process request.
+	*/
+	if (setFlaw)
+	{
+		/*
+		**  Find a free flaw entry.
+		*/
+		index = 0;
+		while (index < SectorSize)
+		{
+			index += 2;
+			if (mySector[index] == 0)
+			{
+				break;
+			}
+		}
+
+		/*
+		**  If a free flaw entry was found, set it.
+		*/
+		if (index < SectorSize)
+		{
+			mySector[index + 0] = flawWord0;
+			mySector[index + 1] = flawWord1;
+		}
+	}
+	else
+	{
+		/*
+		**  Find the matching entry.
+		*/
+		index = 0;
+		while (index < SectorSize)
+		{
+			if (mySector[index + 0] == flawWord0
+				&& mySector[index + 1] == flawWord1)
+			{
+				break;
+			}
+
+			index += 2;
+		}
+
+		/*
+		**  If a matching entry was found, clear it.
+		*/
+		if (index < SectorSize)
+		{
+			mySector[index + 0] = 0;
+			mySector[index + 1] = 0;
+		}
+	}
+
+	/*
+	**  Update the 844 utility map sector.
+	*/
+	dd8xxPosition(dp, fcb, dd8xxSeek(dp, mfrId));
+	dd8xxSectorWrite(dp, fcb, mySector);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Map a disk container, extending it to the full size
+**                  of the drive if necessary.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**
+**  Returns:        true if mapped, false to keep using file I/O.
+**
+**------------------------------------------------------------------------*/
+static bool dd8xxMap(DiskParam *dp, FILE *fcb)
+{
+	u64 bytes = static_cast<u64>(dp->size.maxCylinders) * dp->size.maxTracks * dp->size.maxSectors * dp->sectorSize;
+
+	fflush(fcb);
+
+#if defined(_WIN32)
+	dp->fileHandle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(fcb)));
+	dp->mapHandle = CreateFileMappingA(dp->fileHandle, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes & 0xFFFFFFFF), nullptr);
+	if (dp->mapHandle == nullptr)
+	{
+		return(false);
+	}
+
+	dp->map = static_cast<u8 *>(MapViewOfFile(dp->mapHandle, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(bytes)));
+	if (dp->map == nullptr)
+	{
+		CloseHandle(dp->mapHandle);
+		return(false);
+	}
+#else
+	int fd = fileno(fcb);
+	if (lseek(fd, 0, SEEK_END) < static_cast<off_t>(bytes) && ftruncate(fd, bytes) != 0)
+	{
+		return(false);
+	}
+
+	void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		return(false);
+	}
+
+	dp->map = static_cast<u8 *>(p);
+#endif
+
+	dp->mapBytes = bytes;
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Apply the sync policy to a sector just written to a
+**                  mapped container.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  sector      Sector in the mapping.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxMapWritten(DiskParam *dp, u8 *sector)
+{
+	if (diskSync == 0)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	FlushViewOfFile(sector, dp->sectorSize);
+	if (diskSync == 2)
+	{
+		FlushFileBuffers(dp->fileHandle);
+	}
+#else
+	/*
+	**  644 and 483 byte sectors straddle page boundaries. msync wants
+	**  a page aligned start, so sync from the start of the sector's
+	**  first page to the end of the sector.
+	*/
+	uintptr_t pageMask = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)) - 1;
+	u8 *page = reinterpret_cast<u8 *>(reinterpret_cast<uintptr_t>(sector) & ~pageMask);
+	msync(page, (sector - page) + dp->sectorSize, diskSync == 2 ? MS_SYNC : MS_ASYNC);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set up the sector cache of a drive, from then on the
+**                  cache thread writes it back.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheCreate(DiskParam *dp, FILE *fcb)
+{
+	DiskCache *cp = static_cast<DiskCache *>(calloc(1, sizeof(DiskCache)));
+	u32 ioSectors = 1 + cacheReadAhead * 2;
+
+	/*
+	**  At most half the cache may be dirty, so a miss always finds a
+	**  clean sector to replace.
+	*/
+	if (cp != nullptr)
+	{
+		cp->slots = cacheSectors < 2 ? 2 : cacheSectors;
+		cp->dirtyMax = cp->slots / 2;
+		if (ioSectors < cp->dirtyMax)
+		{
+			ioSectors = cp->dirtyMax;
+		}
+
+		cp->hashMask = 1;
+		while (cp->hashMask < cp->slots)
+		{
+			cp->hashMask <<= 1;
+		}
+
+		cp->hashMask -= 1;
+		cp->slot = static_cast<DiskCacheSlot *>(calloc(cp->slots, sizeof(DiskCacheSlot)));
+		cp->bucket = static_cast<u32 *>(malloc((static_cast<size_t>(cp->hashMask) + 1) * sizeof(u32)));
+		cp->data = static_cast<u8 *>(malloc(static_cast<size_t>(cp->slots) * dp->sectorSize));
+		cp->ioBuf = static_cast<u8 *>(malloc(static_cast<size_t>(ioSectors) * dp->sectorSize));
+		cp->ioPos = static_cast<i64 *>(malloc(cp->dirtyMax * sizeof(i64)));
+	}
+
+	if (cp == nullptr || cp->slot == nullptr || cp->bucket == nullptr || cp->data == nullptr || cp->ioBuf == nullptr || cp->ioPos == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate dd8xx sector cache\n");
+		exit(1);
+	}
+
+	for (u32 i = 0; i <= cp->hashMask; i++)
+	{
+		cp->bucket[i] = CacheNoSlot;
+	}
+
+	for (u32 i = 0; i < cp->slots; i++)
+	{
+		cp->slot[i].hashNext = i + 1 < cp->slots ? i + 1 : CacheNoSlot;
+	}
+
+	cp->free = 0;
+	cp->lruNew = CacheNoSlot;
+	cp->lruOld = CacheNoSlot;
+	cp->sectorSize = dp->sectorSize;
+
+	InitializeCriticalSection(&cp->cacheLock);
+	InitializeCriticalSection(&cp->fileLock);
+	cp->fcb = fcb;
+
+	EnterCriticalSection(&diskListMutex);
+	dp->cache = cp;
+	LeaveCriticalSection(&diskListMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read the sector at the current position through the
+**                  cache. A miss reads the sector and the sectors which
+**                  follow it on the track, enough to cover cacheReadAhead
+**                  further sectors in the current interlace order.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  sector      Raw container sector to fill.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheRead(DiskParam *dp, FILE *fcb, u8 *sector)
+{
+	DiskCache *cp = dp->cache;
+	DiskCacheSlot *sp;
+
+	EnterCriticalSection(&cp->cacheLock);
+	sp = dd8xxCacheFind(cp, dp->position);
+	if (sp != nullptr)
+	{
+		memcpy(sector, cp->data + (sp - cp->slot) * dp->sectorSize, dp->sectorSize);
+		if (!sp->dirty)
+		{
+			dd8xxCacheUnlink(cp, sp);
+			dd8xxCacheLink(cp, sp);
+		}
+
+		cp->hits += 1;
+		LeaveCriticalSection(&cp->cacheLock);
+		return;
+	}
+
+	cp->misses += 1;
+	LeaveCriticalSection(&cp->cacheLock);
+
+	u32 count = 1 + cacheReadAhead * dp->interlace;
+	u32 left = dp->size.maxSectors - dp->sector;
+	if (count > left)
+	{
+		count = left;
+	}
+
+	EnterCriticalSection(&cp->fileLock);
+	DiskSeek(fcb, dp->position);
+	u32 got = static_cast<u32>(fread(cp->ioBuf, dp->sectorSize, count, fcb));
+	if (got == 0)
+	{
+		memset(cp->ioBuf, 0, dp->sectorSize);
+	}
+
+	memcpy(sector, cp->ioBuf, dp->sectorSize);
+
+	EnterCriticalSection(&cp->cacheLock);
+	for (u32 i = 0; i < got; i++)
+	{
+		i64 position = dp->position + static_cast<i64>(i) * dp->sectorSize;
+		if (dd8xxCacheFind(cp, position) != nullptr)
+		{
+			continue;
+		}
+
+		sp = dd8xxCacheVictim(cp);
+		if (sp == nullptr)
+		{
+			break;
+		}
+
+		memcpy(cp->data + (sp - cp->slot) * dp->sectorSize, cp->ioBuf + i * dp->sectorSize, dp->sectorSize);
+		dd8xxCacheInsert(cp, sp, position);
+		if (i != 0)
+		{
+			cp->readAhead += 1;
+		}
+	}
+	LeaveCriticalSection(&cp->cacheLock);
+	LeaveCriticalSection(&cp->fileLock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the sector at the current position into the
+**                  cache and wake the cache thread when the drive's
+**                  first sector becomes dirty. If too many sectors are
+**                  waiting for the cache thread they are written here
+**                  instead.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  sector      Raw container sector.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheWrite(DiskParam *dp, FILE *fcb, u8 *sector)
+{
+	DiskCache *cp = dp->cache;
+	DiskCacheSlot *sp;
+
+	EnterCriticalSection(&cp->cacheLock);
+	sp = dd8xxCacheFind(cp, dp->position);
+	if (sp == nullptr)
+	{
+		sp = dd8xxCacheVictim(cp);
+		dd8xxCacheInsert(cp, sp, dp->position);
+	}
+
+	memcpy(cp->data + (sp - cp->slot) * dp->sectorSize, sector, dp->sectorSize);
+
+	bool wake = false;
+	if (!sp->dirty)
+	{
+		dd8xxCacheUnlink(cp, sp);
+		sp->dirty = true;
+		wake = cp->dirtyCount == 0;
+		cp->dirtyCount += 1;
+	}
+
+	bool full = cp->dirtyCount >= cp->dirtyMax;
+	LeaveCriticalSection(&cp->cacheLock);
+
+	if (wake)
+	{
+		EnterCriticalSection(&diskFlushMutex);
+		diskFlushPending = true;
+		LeaveCriticalSection(&diskFlushMutex);
+		WakeConditionVariable(&diskFlushWork);
+	}
+
+	if (full)
+	{
+		cp->stalls += 1;
+		dd8xxCacheFlush(dp, fcb);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write all dirty sectors of a drive to its container.
+**                  Sectors are copied out under the cache lock and
+**                  written under the file lock only, so cache hits go on
+**                  while the host writes.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheFlush(DiskParam *dp, FILE *fcb)
+{
+	DiskCache *cp = dp->cache;
+	u32 count = 0;
+
+	EnterCriticalSection(&cp->fileLock);
+
+	EnterCriticalSection(&cp->cacheLock);
+	for (u32 i = 0; i < cp->slots && count < cp->dirtyMax; i++)
+	{
+		DiskCacheSlot *sp = cp->slot + i;
+		if (sp->dirty)
+		{
+			memcpy(cp->ioBuf + count * dp->sectorSize, cp->data + i * dp->sectorSize, dp->sectorSize);
+			cp->ioPos[count++] = sp->position;
+			sp->dirty = false;
+			dd8xxCacheLink(cp, sp);
+			cp->dirtyCount -= 1;
+		}
+	}
+	LeaveCriticalSection(&cp->cacheLock);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		DiskSeek(fcb, cp->ioPos[i]);
+		if (fwrite(cp->ioBuf + i * dp->sectorSize, 1, dp->sectorSize, fcb) != static_cast<size_t>(dp->sectorSize))
+		{
+			logError(LogErrorLocation, "ch %o, unit %o write error\n", dp->channelNo, dp->unitNo);
+		}
+	}
+
+	if (count != 0)
+	{
+		fflush(fcb);
+		cp->written += count;
+	}
+
+	LeaveCriticalSection(&cp->fileLock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Look up a sector in the cache. Called with cacheLock.
+**
+**  Parameters:     Name        Description.
+**                  cp          Cache.
+**                  position    Container byte offset.
+**
+**  Returns:        Slot or nullptr.
+**
+**------------------------------------------------------------------------*/
+static DiskCacheSlot *dd8xxCacheFind(DiskCache *cp, i64 position)
+{
+	u32 i = cp->bucket[static_cast<u32>(position / cp->sectorSize) & cp->hashMask];
+
+	while (i != CacheNoSlot)
+	{
+		if (cp->slot[i].position == position)
+		{
+			return(cp->slot + i);
+		}
+
+		i = cp->slot[i].hashNext;
+	}
+
+	return(nullptr);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take the slot to replace: an unused one, else the
+**                  least recently used clean one, which is removed from
+**                  its hash chain. Called with cacheLock.
+**
+**  Parameters:     Name        Description.
+**                  cp          Cache.
+**
+**  Returns:        Slot or nullptr if every slot is dirty.
+**
+**------------------------------------------------------------------------*/
+static DiskCacheSlot *dd8xxCacheVictim(DiskCache *cp)
+{
+	DiskCacheSlot *sp;
+
+	if (cp->free != CacheNoSlot)
+	{
+		sp = cp->slot + cp->free;
+		cp->free = sp->hashNext;
+		return(sp);
+	}
 
-					}
-					else
-					{
-						logError(LogErrorLocation, "channel %02o - invalid select: %4.4o", mfr->activeChannel->id, static_cast<u32>(mfr->activeDevice->fcode));
-						mfr->activeDevice->selectedUnit = -1;
-					}
-				}
-				else
-				{
-					dp->detailedStatus[12] |= 01000;
-				}
-				break;
+	if (cp->lruOld == CacheNoSlot)
+	{
+		return(nullptr);
+	}
 
-			case 3:
-				if (dp != nullptr)
-				{
-					dp->cylinder = mfr->activeChannel->data;
-				}
-				break;
+	sp = cp->slot + cp->lruOld;
+	dd8xxCacheUnlink(cp, sp);
 
-			case 2:
-				if (dp != nullptr)
-				{
-					dp->track = mfr->activeChannel->data;
-				}
-				break;
+	u32 *link = cp->bucket + (static_cast<u32>(sp->position / cp->sectorSize) & cp->hashMask);
+	while (cp->slot + *link != sp)
+	{
+		link = &cp->slot[*link].hashNext;
+	}
 
-			case 1:
-				if (dp != nullptr)
-				{
-					if (mfr->activeDevice->fcode == Fc8xxSeekFull)
-					{
-						dp->interlace = 1;
-					}
-					else
-					{
-						dp->interlace = 2;
-					}
+	*link = sp->hashNext;
+	sp->valid = false;
 
-					dp->sector = mfr->activeChannel->data;
-					pos = dd8xxSeek(dp, mfrId);
-					if (pos >= 0 && fcb != nullptr)
-					{
-						fseek(fcb, pos, SEEK_SET);
-					}
-				}
-				else
-				{
-					mfr->activeDevice->status = 05020;
-				}
-				break;
+	return(sp);
+}
 
-			default:
-				mfr->activeDevice->recordLength = 0;
-				break;
-			}
+/*--------------------------------------------------------------------------
+**  Purpose:        Enter a slot taken by dd8xxCacheVictim as the clean,
+**                  most recently used copy of a sector. Called with
+**                  cacheLock.
+**
+**  Parameters:     Name        Description.
+**                  cp          Cache.
+**                  sp          Slot.
+**                  position    Container byte offset.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheInsert(DiskCache *cp, DiskCacheSlot *sp, i64 position)
+{
+	u32 *bucket = cp->bucket + (static_cast<u32>(position / cp->sectorSize) & cp->hashMask);
+
+	sp->position = position;
+	sp->valid = true;
+	sp->dirty = false;
+	sp->hashNext = *bucket;
+	*bucket = static_cast<u32>(sp - cp->slot);
+	dd8xxCacheLink(cp, sp);
+}
 
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
-#endif
+/*--------------------------------------------------------------------------
+**  Purpose:        Put a clean slot at the recently used end of the LRU
+**                  list. Called with cacheLock.
+**
+**  Parameters:     Name        Description.
+**                  cp          Cache.
+**                  sp          Slot.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheLink(DiskCache *cp, DiskCacheSlot *sp)
+{
+	u32 i = static_cast<u32>(sp - cp->slot);
 
-			mfr->activeChannel->full = false;
-		}
-		break;
+	sp->lruNewer = CacheNoSlot;
+	sp->lruOlder = cp->lruNew;
+	if (cp->lruNew != CacheNoSlot)
+	{
+		cp->slot[cp->lruNew].lruNewer = i;
+	}
+	else
+	{
+		cp->lruOld = i;
+	}
 
-	case Fc8xxDeadstart:
-		if (!mfr->activeChannel->full)
-		{
-			if (mfr->activeDevice->recordLength == SectorSize)
-			{
-				/*
-				**  The first word in the sector contains the data length.
-				*/
-				mfr->activeDevice->recordLength = dp->read(dp, fcb);
-				if (mfr->activeDevice->recordLength > SectorSize)
-				{
-					mfr->activeDevice->recordLength = SectorSize;
-				}
+	cp->lruNew = i;
+}
 
-				mfr->activeChannel->data = mfr->activeDevice->recordLength;
-			}
-			else
-			{
-				mfr->activeChannel->data = dp->read(dp, fcb);
-			}
+/*--------------------------------------------------------------------------
+**  Purpose:        Take a slot off the LRU list. Called with cacheLock.
+**
+**  Parameters:     Name        Description.
+**                  cp          Cache.
+**                  sp          Slot.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCacheUnlink(DiskCache *cp, DiskCacheSlot *sp)
+{
+	if (sp->lruNewer != CacheNoSlot)
+	{
+		cp->slot[sp->lruNewer].lruOlder = sp->lruOlder;
+	}
+	else
+	{
+		cp->lruNew = sp->lruOlder;
+	}
 
-			mfr->activeChannel->full = true;
+	if (sp->lruOlder != CacheNoSlot)
+	{
+		cp->slot[sp->lruOlder].lruNewer = sp->lruNewer;
+	}
+	else
+	{
+		cp->lruOld = sp->lruNewer;
+	}
+}
 
-			if (--mfr->activeDevice->recordLength == 0)
-			{
-				mfr->activeChannel->discAfterInput = true;
-				pos = dd8xxSeekNextSector(dp, mfrId);
-				if (pos >= 0)
-				{
-					fseek(fcb, pos, SEEK_SET);
-				}
-			}
-		}
-		break;
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the disk cache thread.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxCreateThread()
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(dd8xxThread),
+		static_cast<LPVOID>(nullptr),                               // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create disk cache thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	rc = pthread_create(&thread, &attr, dd8xxThread, NULL);
+	if (rc < 0)
+	{
+		fprintf(stderr, "Failed to create disk cache thread\n");
+		exit(1);
+	}
+#endif
+}
 
-	case Fc8xxRead:
-	case Fc8xxReadFlawedSector:
-	case Fc8xxGapRead:
-		if (!mfr->activeChannel->full)
-		{
-			mfr->activeChannel->data = dp->read(dp, fcb);
-			mfr->activeChannel->full = true;
-#if DEBUG
-			dd8xxLogByte(activeChannel->data);
+/*--------------------------------------------------------------------------
+**  Purpose:        Disk cache thread. Sleeps until a drive gets dirty
+**                  sectors, lets writes collect for CacheFlushMs
+**                  milliseconds and then writes the dirty sectors of
+**                  every cached drive.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void dd8xxThread(void *param)
+#else
+static void *dd8xxThread(void *param)
 #endif
+{
+	(void)param;
 
-			if (--mfr->activeDevice->recordLength == 0)
-			{
-				mfr->activeChannel->discAfterInput = true;
-				pos = dd8xxSeekNextSector(dp, mfrId);
-				if (mfr->activeDevice->fcode == Fc8xxGapRead && pos >= 0)
-				{
-					pos = dd8xxSeekNextSector(dp, mfrId);
-				}
-				if (pos >= 0)
-				{
-					fseek(fcb, pos, SEEK_SET);
-				}
-			}
+	while (BigIron->emulationActive)
+	{
+		EnterCriticalSection(&diskFlushMutex);
+		while (!diskFlushPending && BigIron->emulationActive)
+		{
+			SleepConditionVariableCS(&diskFlushWork, &diskFlushMutex, INFINITE);
 		}
-		break;
 
-	case Fc8xxWrite:
-	case Fc8xxWriteFlawedSector:
-	case Fc8xxWriteLastSector:
-	case Fc8xxWriteVerify:
-		if (mfr->activeChannel->full)
-		{
-			dp->write(dp, fcb, mfr->activeChannel->data);
-			mfr->activeChannel->full = false;
+		diskFlushPending = false;
+		LeaveCriticalSection(&diskFlushMutex);
 
-#if DEBUG
-			dd8xxLogByte(activeChannel->data);
+#if defined(_WIN32)
+		Sleep(CacheFlushMs);
+#else
+		usleep(CacheFlushMs * 1000);
 #endif
-			if (--mfr->activeDevice->recordLength == 0)
+
+		EnterCriticalSection(&diskListMutex);
+		for (DiskParam *dp = firstDisk; dp != nullptr && BigIron->emulationActive; dp = dp->nextDisk)
+		{
+			if (dp->cache != nullptr && dp->cache->dirtyCount != 0)
 			{
-				pos = dd8xxSeekNextSector(dp, mfrId);
-				if (pos >= 0)
-				{
-					fseek(fcb, pos, SEEK_SET);
-				}
+				dd8xxCacheFlush(dp, dp->cache->fcb);
 			}
 		}
-		break;
-
-	case Fc8xxGeneralStatus:
-		if (!mfr->activeChannel->full)
-		{
-			mfr->activeChannel->data = mfr->activeDevice->status;
-			mfr->activeChannel->full = true;
+		LeaveCriticalSection(&diskListMutex);
+	}
 
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#if !defined(_WIN32)
+	return NULL;
 #endif
+}
 
-			if (--mfr->activeDevice->recordLength == 0)
-			{
-				mfr->activeChannel->discAfterInput = true;
-			}
-		}
-		break;
+/*--------------------------------------------------------------------------
+**  Purpose:        Open the copy-on-write overlay of a drive, creating it
+**                  if it does not exist yet, and open its base container
+**                  for reading. The base is mapped read only where
+**                  possible, so drives of several emulators which share
+**                  a base also share its pages in the host's file cache.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fname       overlay file name
+**                  baseName    base container file name
+**
+**  Returns:        File control block of the overlay.
+**
+**------------------------------------------------------------------------*/
+static FILE *dd8xxOverlayOpen(DiskParam *dp, char *fname, char *baseName)
+{
+	OverlayHeader header;
+	u32 sectors = dp->size.maxCylinders * dp->size.maxTracks * dp->size.maxSectors;
 
-	case Fc8xxReadCheckword:
-		if (!mfr->activeChannel->full)
+	DiskOverlay *op = static_cast<DiskOverlay *>(calloc(1, sizeof(DiskOverlay)));
+	if (op != nullptr)
+	{
+		op->bitmapBytes = (sectors + 7) / 8;
+		op->bitmap = static_cast<u8 *>(calloc(op->bitmapBytes, 1));
+	}
+
+	if (op == nullptr || op->bitmap == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate dd8xx overlay\n");
+		exit(1);
+	}
+
+	op->baseFcb = fopen(baseName, "rb");
+	if (op->baseFcb == nullptr)
+	{
+		fprintf(stderr, "Failed to open base container %s\n", baseName);
+		exit(1);
+	}
+
+	FILE *fcb = fopen(fname, "r+b");
+	if (fcb != nullptr)
+	{
+		if (!dd8xxOverlayHeader(fcb, &header)
+			|| header.sectorSize != static_cast<u32>(dp->sectorSize)
+			|| header.sectors != sectors
+			|| fread(op->bitmap, 1, op->bitmapBytes, fcb) != op->bitmapBytes)
 		{
-			mfr->activeChannel->data = 0;
-			mfr->activeChannel->full = true;
+			fprintf(stderr, "%s is not an overlay for this type of disk\n", fname);
+			exit(1);
+		}
 
-			if (--mfr->activeDevice->recordLength == 0)
-			{
-				mfr->activeChannel->discAfterInput = true;
-			}
+		if (strcmp(header.base, baseName) != 0)
+		{
+			printf("Overlay %s was created on %s, now used on %s\n", fname, header.base, baseName);
 		}
-		break;
-	case Fc8xxDetailedStatus:
-		if (!mfr->activeChannel->full)
+	}
+	else
+	{
+		/*
+		**  New overlay - everything still comes from the base.
+		*/
+		fcb = fopen(fname, "w+b");
+		if (fcb == nullptr)
 		{
-			mfr->activeChannel->data = dp->detailedStatus[12 - mfr->activeDevice->recordLength];
-			mfr->activeChannel->full = true;
+			fprintf(stderr, "Failed to open %s\n", fname);
+			exit(1);
+		}
 
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+#if defined(_WIN32)
+		DWORD bytes;
+		DeviceIoControl(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(fcb))), FSCTL_SET_SPARSE,
+			nullptr, 0, nullptr, 0, &bytes, nullptr);
 #endif
 
-			if (--mfr->activeDevice->recordLength == 0)
-			{
-				mfr->activeChannel->discAfterInput = true;
-			}
+		memset(&header, 0, sizeof(header));
+		strcpy(header.magic, OverlayMagic);
+		header.version = OverlayVersion;
+		header.sectorSize = dp->sectorSize;
+		header.sectors = sectors;
+		header.dataOffset = (sizeof(header) + op->bitmapBytes + OverlayAlign - 1) / OverlayAlign * OverlayAlign;
+		strncpy(header.base, baseName, sizeof(header.base) - 1);
+
+		if (fwrite(&header, sizeof(header), 1, fcb) != 1
+			|| fwrite(op->bitmap, 1, op->bitmapBytes, fcb) != op->bitmapBytes
+			|| fflush(fcb) != 0)
+		{
+			fprintf(stderr, "Failed to create overlay %s\n", fname);
+			exit(1);
 		}
-		break;
+	}
 
-	case Fc8xxDetailedStatus2:
-		if (!mfr->activeChannel->full)
+	op->dataOffset = header.dataOffset;
+	for (u32 i = 0; i < sectors; i++)
+	{
+		if ((op->bitmap[i >> 3] & (1 << (i & 7))) != 0)
 		{
-			mfr->activeChannel->data = dp->detailedStatus[20 - mfr->activeDevice->recordLength];
-			mfr->activeChannel->full = true;
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
-#endif
-
-			if (--mfr->activeDevice->recordLength == 0)
-			{
-				mfr->activeChannel->discAfterInput = true;
-			}
+			op->written += 1;
 		}
-		break;
+	}
 
-	case Fc8xxReadFactoryData:
-	case Fc8xxReadUtilityMap:
-		if (!mfr->activeChannel->full)
+	/*
+	**  Map the base. If that fails it is read with file I/O.
+	*/
+#if defined(_WIN32)
+	LARGE_INTEGER size;
+	HANDLE baseHandle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(op->baseFcb)));
+	if (GetFileSizeEx(baseHandle, &size) && size.QuadPart > 0)
+	{
+		op->baseMapHandle = CreateFileMappingA(baseHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (op->baseMapHandle != nullptr)
 		{
-			mfr->activeChannel->data = dp->read(dp, fcb);
-			mfr->activeChannel->full = true;
-
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
-#endif
-
-			if (--mfr->activeDevice->recordLength == 0)
+			op->baseMap = static_cast<u8 *>(MapViewOfFile(op->baseMapHandle, FILE_MAP_READ, 0, 0, 0));
+			if (op->baseMap == nullptr)
 			{
-				mfr->activeChannel->discAfterInput = true;
+				CloseHandle(op->baseMapHandle);
+			}
+			else
+			{
+				op->baseBytes = static_cast<u64>(size.QuadPart);
 			}
 		}
-		break;
-
-	case Fc8xxSetClearFlaw:
-		if (mfr->activeChannel->full)
+	}
+#else
+	struct stat st;
+	int baseFd = fileno(op->baseFcb);
+	if (fstat(baseFd, &st) == 0 && st.st_size > 0)
+	{
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, baseFd, 0);
+		if (p != MAP_FAILED)
 		{
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
-#endif
-			dd844SetClearFlaw(dp, mfr->activeChannel->data, mfrId);
-			mfr->activeChannel->full = false;
+			op->baseMap = static_cast<u8 *>(p);
+			op->baseBytes = static_cast<u64>(st.st_size);
 		}
-		break;
-
-	case Fc8xxStartMemLoad:
-		if (mfr->activeChannel->full)
-		{
-			mfr->activeChannel->full = false;
-#if DEBUG
-			fprintf(dd8xxLog, " %04o[%d]", activeChannel->data, activeChannel->data);
+	}
 #endif
-		}
-		break;
 
-	case Fc8xxFormatPack:
-	case Fc8xxManipulateProcessor:
-	case Fc8xxIoLength:
-	case Fc8xxOpComplete:
-	case Fc8xxDisableReserve:
-	case Fc8xxContinue:
-	case Fc8xxDropSeeks:
-	case Fc8xxOnSectorStatus:
-	case Fc8xxDriveRelease:
-	case Fc8xxReturnCylAddr:
-	case Fc8xxGapWrite:
-	case Fc8xxGapWriteVerify:
-	case Fc8xxGapReadCheckword:
-	default:
-		mfr->activeChannel->full = false;
-		break;
-	}
+	printf("Overlay %s on %s holds %lu of %lu sectors\n", fname, baseName,
+		static_cast<unsigned long>(op->written), static_cast<unsigned long>(sectors));
+
+	dp->overlay = op;
+
+	return(fcb);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Handle channel activation.
+**  Purpose:        Read the sector at the current position from the
+**                  overlay if it has been written, else from the base.
 **
 **  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block of the overlay.
+**                  sector      Raw container sector to fill.
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxActivate(u8 mfrId)
+static void dd8xxOverlayRead(DiskParam *dp, FILE *fcb, u8 *sector)
 {
-#if DEBUG
-	fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o Activate",
-		traceSequenceNo,
-		activePpu->id,
-		activeDevice->channel->id);
+	DiskOverlay *op = dp->overlay;
+	u64 position = static_cast<u64>(dp->position);
+	u32 index = static_cast<u32>(position / dp->sectorSize);
+	size_t got = 0;
 
-	fflush(dd8xxLog);
-#endif
+	if ((op->bitmap[index >> 3] & (1 << (index & 7))) != 0)
+	{
+		DiskSeek(fcb, op->dataOffset + position);
+		got = fread(sector, 1, dp->sectorSize, fcb);
+	}
+	else if (op->baseMap != nullptr)
+	{
+		if (position < op->baseBytes)
+		{
+			got = static_cast<size_t>(op->baseBytes - position);
+			if (got > static_cast<size_t>(dp->sectorSize))
+			{
+				got = dp->sectorSize;
+			}
+
+			memcpy(sector, op->baseMap + position, got);
+		}
+	}
+	else
+	{
+		DiskSeek(op->baseFcb, position);
+		got = fread(sector, 1, dp->sectorSize, op->baseFcb);
+	}
+
+	/*
+	**  Sectors beyond the end of a short base read as zero.
+	*/
+	if (got < static_cast<size_t>(dp->sectorSize))
+	{
+		memset(sector + got, 0, dp->sectorSize - got);
+	}
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Handle disconnecting of channel.
+**  Purpose:        Write the sector at the current position to the
+**                  overlay and mark it as held there. The base is never
+**                  written.
 **
 **  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**                  fcb         File control block of the overlay.
+**                  sector      Raw container sector.
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxDisconnect(u8 mfrId)
+static void dd8xxOverlayWrite(DiskParam *dp, FILE *fcb, u8 *sector)
 {
-	/*
-	**  Abort pending device disconnects - the PP is doing the disconnect.
-	*/
-
-	MMainFrame *mfr = BigIron->chasis[mfrId];
-	mfr->activeChannel->discAfterInput = false;
+	DiskOverlay *op = dp->overlay;
+	u64 position = static_cast<u64>(dp->position);
+	u32 index = static_cast<u32>(position / dp->sectorSize);
+	u8 *bits = op->bitmap + (index >> 3);
 
-#if DEBUG
-	fprintf(dd8xxLog, "\n%06d PP:%02o CH:%02o Disconnect",
-		traceSequenceNo,
-		activePpu->id,
-		activeDevice->channel->id);
+	DiskSeek(fcb, op->dataOffset + position);
+	if (fwrite(sector, 1, dp->sectorSize, fcb) != static_cast<size_t>(dp->sectorSize))
+	{
+		logError(LogErrorLocation, "ch %o, unit %o write error\n", dp->channelNo, dp->unitNo);
+		return;
+	}
 
-	fflush(dd8xxLog);
-#endif
+	/*
+	**  First write of this sector - record it after the data.
+	*/
+	if ((*bits & (1 << (index & 7))) == 0)
+	{
+		*bits |= 1 << (index & 7);
+		op->written += 1;
+		fseek(fcb, sizeof(OverlayHeader) + (index >> 3), SEEK_SET);
+		fwrite(bits, 1, 1, fcb);
+	}
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Work out seek offset.
+**  Purpose:        Release the base of an overlay.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
 **
-**  Returns:        Byte offset (not word!) or -1 when seek target
-**                  is invalid.
+**  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static i32 dd8xxSeek(DiskParam *dp, u8 mfrId)
+static void dd8xxOverlayClose(DiskParam *dp)
 {
-	MMainFrame *mfr = BigIron->chasis[mfrId];
-
-	dp->bufPtr = nullptr;
-
-	mfr->activeDevice->status = 0;
+	DiskOverlay *op = dp->overlay;
 
-	if (dp->cylinder >= dp->size.maxCylinders)
+	if (op->baseMap != nullptr)
 	{
-#if DEBUG
-		fprintf(dd8xxLog, "ch %o, cylinder %d invalid\n", activeChannel->id, dp->cylinder);
+#if defined(_WIN32)
+		UnmapViewOfFile(op->baseMap);
+		CloseHandle(op->baseMapHandle);
+#else
+		munmap(op->baseMap, static_cast<size_t>(op->baseBytes));
 #endif
-		logError(LogErrorLocation, "ch %o, cylinder %d invalid\n", mfr->activeChannel->id, dp->cylinder);
-		mfr->activeDevice->status = 01000;
-		return(-1);
 	}
 
-	if (dp->track >= dp->size.maxTracks)
-	{
-#if DEBUG
-		fprintf(dd8xxLog, "ch %o, track %d invalid\n", activeChannel->id, dp->track);
-#endif
-		logError(LogErrorLocation, "ch %o, track %d invalid\n", mfr->activeChannel->id, dp->track);
-		mfr->activeDevice->status = 01000;
-		return(-1);
-	}
+	fclose(op->baseFcb);
+	free(op->bitmap);
+	free(op);
+	dp->overlay = nullptr;
+}
 
-	if (dp->sector >= dp->size.maxSectors)
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and check the header of an overlay file.
+**
+**  Parameters:     Name        Description.
+**                  fcb         File control block of the overlay.
+**                  header      Header to fill.
+**
+**  Returns:        true if the file is an overlay, positioned at its
+**                  bitmap.
+**
+**------------------------------------------------------------------------*/
+static bool dd8xxOverlayHeader(FILE *fcb, OverlayHeader *header)
+{
+	fseek(fcb, 0, SEEK_SET);
+	if (fread(header, sizeof(OverlayHeader), 1, fcb) != 1)
 	{
-#if DEBUG
-		fprintf(dd8xxLog, "ch %o, sector %d invalid\n", activeChannel->id, dp->sector);
-#endif
-		logError(LogErrorLocation, "ch %o, sector %d invalid\n", mfr->activeChannel->id, dp->sector);
-		mfr->activeDevice->status = 01000;
-		return(-1);
+		return(false);
 	}
 
-	i32 result = dp->cylinder * dp->size.maxTracks * dp->size.maxSectors;
-	result += dp->track * dp->size.maxSectors;
-	result += dp->sector;
-	result *= dp->sectorSize;
+	header->base[sizeof(header->base) - 1] = '\0';
 
-	return(result);
+	return(memcmp(header->magic, OverlayMagic, sizeof(OverlayMagic)) == 0
+		&& header->version == OverlayVersion
+		&& header->sectorSize != 0
+		&& header->dataOffset >= sizeof(OverlayHeader) + (header->sectors + 7) / 8);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Position to next sector taking into account interlace.
+**  Purpose:        Set up access to a sparse container. The file must
+**                  start with a sparse header, or be new and empty when
+**                  create is set, in which case the header and an empty
+**                  index are written.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
+**                  fcb         File control block.
+**                  create      true if the file has just been created.
 **
-**  Returns:        Byte offset (not word!) or -1 when seek target
-**                  is invalid.
+**  Returns:        false if the file is not a sparse container.
 **
 **------------------------------------------------------------------------*/
-static i32 dd8xxSeekNextSector(DiskParam *dp, u8 mfrId)
+static bool dd8xxSparseOpen(DiskParam *dp, FILE *fcb, bool create)
 {
-	dp->sector += dp->interlace;
+	SparseHeader header;
+	u32 sectors = dp->size.maxCylinders * dp->size.maxTracks * dp->size.maxSectors;
 
-	if (dp->interlace == 1)
+	fseek(fcb, 0, SEEK_SET);
+	if (fread(&header, sizeof(header), 1, fcb) != 1)
 	{
-		if (dp->sector == dp->size.maxSectors)
+		if (!create)
 		{
-			dp->sector = 0;
-			dp->track += 1;
+			return(false);
+		}
 
-			if (dp->track == dp->size.maxTracks)
-			{
-				/*
-				**  Wrap to the start of the current cylinder.
-				*/
-				dp->track = 0;
-				dp->sector = 0;
-			}
+		memset(&header, 0, sizeof(header));
+		strcpy(header.magic, SparseMagic);
+		header.version = SparseVersion;
+		header.sectorSize = SparseSectorSize;
+		header.sectors = sectors;
+		header.dataOffset = (sizeof(header) + static_cast<u64>(sectors) * sizeof(u64) + SparseAlign - 1) / SparseAlign * SparseAlign;
+	}
+	else if (memcmp(header.magic, SparseMagic, sizeof(SparseMagic)) != 0 || header.version != SparseVersion)
+	{
+		return(false);
+	}
+	else
+	{
+		create = false;
+	}
+
+	if (header.sectorSize != SparseSectorSize || header.sectors != sectors)
+	{
+		fprintf(stderr, "Sparse container on channel %o unit %o has the wrong geometry\n", dp->channelNo, dp->unitNo);
+		exit(1);
+	}
+
+	DiskSparse *sp = static_cast<DiskSparse *>(calloc(1, sizeof(DiskSparse)));
+	if (sp != nullptr)
+	{
+		sp->index = static_cast<u64 *>(calloc(sectors, sizeof(u64)));
+	}
+
+	if (sp == nullptr || sp->index == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate dd8xx sparse index\n");
+		exit(1);
+	}
+
+	sp->sectors = sectors;
+	sp->dataEnd = header.dataOffset;
+
+	if (create)
+	{
+		if (fwrite(&header, sizeof(header), 1, fcb) != 1
+			|| fwrite(sp->index, sizeof(u64), sectors, fcb) != sectors
+			|| fflush(fcb) != 0)
+		{
+			fprintf(stderr, "Failed to create sparse container on channel %o unit %o\n", dp->channelNo, dp->unitNo);
+			exit(1);
 		}
 	}
 	else
 	{
-		if (dp->sector == dp->size.maxSectors)
+		if (fread(sp->index, sizeof(u64), sectors, fcb) != sectors)
 		{
-			dp->sector = 0;
-			dp->track += 1;
-			if (dp->track == dp->size.maxTracks)
-			{
-				/*
-				**  Now start all odd sectors.
-				*/
-				dp->track = 0;
-				dp->sector = 1;
-			}
+			fprintf(stderr, "Sparse container on channel %o unit %o is truncated\n", dp->channelNo, dp->unitNo);
+			exit(1);
 		}
-		else if (dp->sector == dp->size.maxSectors + 1)
+
+		/*
+		**  Slots below the end of the data which no sector uses were
+		**  released by zeroed sectors and are reused first.
+		*/
+		u64 *used = static_cast<u64 *>(malloc(sectors * sizeof(u64)));
+		if (used == nullptr)
 		{
-			dp->sector = 1;
-			dp->track += 1;
+			fprintf(stderr, "Failed to allocate dd8xx sparse index\n");
+			exit(1);
+		}
 
-			if (dp->track == dp->size.maxTracks)
+		for (u32 i = 0; i < sectors; i++)
+		{
+			if (sp->index[i] != 0)
 			{
-				/*
-				**  Wrap to the start of the current cylinder.
-				*/
-				dp->track = 0;
-				dp->sector = 0;
+				used[sp->stored++] = sp->index[i];
+			}
+		}
+
+		qsort(used, sp->stored, sizeof(u64), dd8xxSparseCompare);
+
+		u64 slot = header.dataOffset;
+		for (u32 i = 0; i < sp->stored; i++)
+		{
+			for (; slot < used[i]; slot += SparseSectorSize)
+			{
+				dd8xxSparseRelease(sp, slot);
 			}
+
+			slot = used[i] + SparseSectorSize;
 		}
+
+		sp->dataEnd = slot;
+		free(used);
 	}
 
-	return(dd8xxSeek(dp, mfrId));
+	dp->read = dd8xxReadPacked;
+	dp->write = dd8xxWritePacked;
+	dp->sectorSize = SparseSectorSize;
+	dp->sparse = sp;
+
+	return(true);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform a 12 bit PP word read from a classic disk container.
+**  Purpose:        Read the sector at the current position of a sparse
+**                  container.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
 **                  fcb         File control block.
+**                  sector      Packed sector to fill.
 **
-**  Returns:        PP word read.
+**  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static PpWord dd8xxReadClassic(DiskParam *dp, FILE *fcb)
+static void dd8xxSparseRead(DiskParam *dp, FILE *fcb, u8 *sector)
 {
-	/*
-	**  Read an entire sector if the current buffer is empty.
-	*/
-	if (dp->bufPtr == nullptr)
+	u64 offset = dp->sparse->index[dp->position / SparseSectorSize];
+	size_t got = 0;
+
+	if (offset != 0)
 	{
-		dp->bufPtr = dp->buffer;
-		fread(dp->buffer, 1, dp->sectorSize, fcb);
+		DiskSeek(fcb, offset);
+		got = fread(sector, 1, SparseSectorSize, fcb);
 	}
 
-	/*
-	**  Fail gracefully if we read too much data.
-	*/
-	if (dp->bufPtr >= dp->buffer + SectorSize)
+	if (got < SparseSectorSize)
 	{
-		return(0);
+		memset(sector + got, 0, SparseSectorSize - got);
 	}
-
-	return(*dp->bufPtr++);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform a 12 bit PP word write to a classic disk container.
+**  Purpose:        Write the sector at the current position of a sparse
+**                  container. A sector of zeros gives up its slot, any
+**                  other sector gets one if it has none yet.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
 **                  fcb         File control block.
-**                  data        PP word to be written.
+**                  sector      Packed sector.
 **
-**  Returns:        Nothing.
+**  Returns:        false on a write error.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxWriteClassic(DiskParam *dp, FILE *fcb, PpWord data)
+static bool dd8xxSparseWrite(DiskParam *dp, FILE *fcb, u8 *sector)
 {
-	/*
-	**  Fail gracefully if we write too much data.
-	*/
-	if (dp->bufPtr >= dp->buffer + SectorSize)
+	DiskSparse *sp = dp->sparse;
+	u32 index = static_cast<u32>(dp->position / SparseSectorSize);
+	u64 offset = sp->index[index];
+	bool zero = true;
+
+	for (u32 i = 0; i < SparseSectorSize && zero; i++)
 	{
-		return;
+		zero = sector[i] == 0;
 	}
 
-	/*
-	**  Reset pointer if the current buffer is empty.
-	*/
-	if (dp->bufPtr == nullptr)
+	if (zero)
 	{
-		dp->bufPtr = dp->buffer;
+		if (offset == 0)
+		{
+			return(true);
+		}
+
+		dd8xxSparseRelease(sp, offset);
+		sp->stored -= 1;
+		offset = 0;
 	}
+	else if (offset == 0)
+	{
+		if (sp->freeCount != 0)
+		{
+			offset = sp->free[--sp->freeCount];
+		}
+		else
+		{
+			offset = sp->dataEnd;
+			sp->dataEnd += SparseSectorSize;
+		}
 
-	*dp->bufPtr++ = data;
+		sp->stored += 1;
+	}
 
 	/*
-	**  Write the data if we got a full sector.
+	**  Data first, then the index entry which points at it.
 	*/
-	if (dp->bufPtr == dp->buffer + SectorSize)
+	if (offset != 0)
 	{
-		fwrite(dp->buffer, 1, dp->sectorSize, fcb);
+		if (DiskSeek(fcb, offset) != 0 || fwrite(sector, 1, SparseSectorSize, fcb) != SparseSectorSize)
+		{
+			logError(LogErrorLocation, "ch %o, unit %o write error\n", dp->channelNo, dp->unitNo);
+			return(false);
+		}
+
+		if (sp->index[index] == offset)
+		{
+			return(true);
+		}
+	}
+
+	sp->index[index] = offset;
+	if (DiskSeek(fcb, sizeof(SparseHeader) + static_cast<u64>(index) * sizeof(u64)) != 0
+		|| fwrite(&offset, sizeof(offset), 1, fcb) != 1)
+	{
+		logError(LogErrorLocation, "ch %o, unit %o write error\n", dp->channelNo, dp->unitNo);
+		return(false);
 	}
+
+	return(true);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform a 12 bit PP word read from a packed disk container.
+**  Purpose:        Put a slot of a sparse container on its free list.
 **
 **  Parameters:     Name        Description.
-**                  dp          Disk parameters (context).
-**                  fcb         File control block.
+**                  sp          Sparse container.
+**                  offset      File offset of the slot.
 **
-**  Returns:        PP word read.
+**  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static PpWord dd8xxReadPacked(DiskParam *dp, FILE *fcb)
+static void dd8xxSparseRelease(DiskSparse *sp, u64 offset)
 {
-	static u8 sector[512];
-
-	/*
-	**  Read an entire sector if the current buffer is empty.
-	*/
-	if (dp->bufPtr == nullptr)
+	if (sp->freeCount == sp->freeMax)
 	{
-		dp->bufPtr = dp->buffer;
-		fread(sector, 1, dp->sectorSize, fcb);
-
-		/*
-		**  Unpack the sector into the buffer.
-		*/
-		u8 *sp = sector;
-		PpWord *pp = dp->buffer;
-		for (u16 byteCount = SectorSize; byteCount > 0; byteCount -= 2)
+		u32 max = sp->freeMax == 0 ? 256 : sp->freeMax * 2;
+		u64 *list = static_cast<u64 *>(realloc(sp->free, max * sizeof(u64)));
+		if (list == nullptr)
 		{
-			*pp++ = (sp[0] << 4) + (sp[1] >> 4);
-			*pp++ = (sp[1] << 8) + (sp[2] >> 0);
-			sp += 3;
+			/*
+			**  The slot is just not reused.
+			*/
+			return;
 		}
-	}
 
-	/*
-	**  Fail gracefully if we read too much data.
-	*/
-	if (dp->bufPtr >= dp->buffer + SectorSize)
-	{
-		return(0);
+		sp->free = list;
+		sp->freeMax = max;
 	}
 
-	/*
-	**  Return one data word.
-	*/
-	return((*dp->bufPtr++) & Mask12);
+	sp->free[sp->freeCount++] = offset;
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform a 12 bit PP word write to a packed disk container.
+**  Purpose:        Release the index of a sparse container.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
-**                  fcb         File control block.
-**                  data        PP word to be written.
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxWritePacked(DiskParam *dp, FILE *fcb, PpWord data)
+static void dd8xxSparseClose(DiskParam *dp)
 {
-	static u8 sector[512];
+	free(dp->sparse->index);
+	free(dp->sparse->free);
+	free(dp->sparse);
+	dp->sparse = nullptr;
+}
 
-	/*
-	**  Fail gracefully if we write too much data.
-	*/
-	if (dp->bufPtr >= dp->buffer + SectorSize)
-	{
-		return;
-	}
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare two file offsets for qsort.
+**
+**  Parameters:     Name        Description.
+**                  a           first offset
+**                  b           second offset
+**
+**  Returns:        <0, 0 or >0.
+**
+**------------------------------------------------------------------------*/
+static int dd8xxSparseCompare(const void *a, const void *b)
+{
+	u64 x = *static_cast<const u64 *>(a);
+	u64 y = *static_cast<const u64 *>(b);
 
-	/*
-	**  Reset pointer if the current buffer is empty.
-	*/
-	if (dp->bufPtr == nullptr)
-	{
-		dp->bufPtr = dp->buffer;
-	}
+	return(x < y ? -1 : x > y ? 1 : 0);
+}
 
-	*dp->bufPtr++ = data;
+/*--------------------------------------------------------------------------
+**  Purpose:        Count a completed seek in the drive's seek distance
+**                  histogram.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxStatsSeek(DiskParam *dp)
+{
+	i32 distance = abs(dp->cylinder - dp->stats.lastCylinder);
+	int bucket = 0;
 
-	/*
-	**  Write the data if we got a full sector.
-	*/
-	if (dp->bufPtr == dp->buffer + SectorSize)
+	while (distance != 0 && bucket < DiskSeekBuckets - 1)
 	{
-		/*
-		**  Pack the buffer into a sector.
-		*/
-		u8 *sp = sector;
-		PpWord *pp = dp->buffer;
-		for (u16 byteCount = SectorSize; byteCount > 0; byteCount -= 2)
-		{
-			*sp++ = static_cast<u8>(pp[0] >> 4);
-			*sp = static_cast<u8>(pp[0] << 4);
-			*sp++ |= static_cast<u8>(pp[1] >> 8);
-			*sp++ = static_cast<u8>(pp[1] >> 0);
-			pp += 2;
-		}
-
-		/*
-		**  Write the sector.
-		*/
-		fwrite(sector, 1, dp->sectorSize, fcb);
+		distance >>= 1;
+		bucket += 1;
 	}
+
+	dp->stats.seekDistance[bucket] += 1;
+	dp->stats.seeks += 1;
+	dp->stats.lastCylinder = dp->cylinder;
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform a sector read from a disk container.
+**  Purpose:        Advance a drive's 64 bit latency clock by the time
+**                  rtcClock moved since it was last looked at. rtcClock
+**                  wraps after about 71 minutes, which the drive's busy
+**                  time must not.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
-**                  fcb         File control block.
-**                  sector      Pointer to sector to read into.
 **
-**  Returns:        Nothing.
+**  Returns:        Current latency clock.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxSectorRead(DiskParam *dp, FILE *fcb, PpWord *sector)
+static u64 dd8xxLatencyNow(DiskParam *dp)
 {
-	for (u16 byteCount = SectorSize; byteCount > 0; byteCount--)
-	{
-		*sector++ = dp->read(dp, fcb);
-	}
+	u32 now = rtcClock;
+
+	dp->latencyClock += now - dp->latencyRtc;
+	dp->latencyRtc = now;
+
+	return(dp->latencyClock);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform a sector write to a disk container.
+**  Purpose:        Check whether the latency model still has a drive busy
+**                  with a seek or a sector transfer.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
-**                  fcb         File control block.
-**                  sector      Pointer to sector to write.
 **
-**  Returns:        Nothing.
+**  Returns:        true if busy.
 **
 **------------------------------------------------------------------------*/
-static void dd8xxSectorWrite(DiskParam *dp, FILE *fcb, PpWord *sector)
+static bool dd8xxBusy(DiskParam *dp)
 {
-	for (u16 byteCount = SectorSize; byteCount > 0; byteCount--)
-	{
-		dp->write(dp, fcb, *sector++);
-	}
+	return(dp->sectorUs != 0 && dd8xxLatencyNow(dp) < dp->busyUntil);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Manipulate 844 utility (flaw) map.
+**  Purpose:        Model the time taken by a seek. The heads start moving
+**                  when the drive is no longer busy and take the minimum
+**                  seek time for one cylinder, rising with the square root
+**                  of the distance to the maximum for a full stroke.
 **
 **  Parameters:     Name        Description.
 **                  dp          Disk parameters (context).
-**                  flawState   Flaw state from PP.
+**                  distance    Cylinders to move.
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void dd844SetClearFlaw(DiskParam *dp, PpWord flawState, u8 mfrId)
+static void dd8xxLatencySeek(DiskParam *dp, i32 distance)
 {
-	int index;
-	PpWord sectorFlaw;
-	PpWord trackFlaw;
-
-	MMainFrame *mfr = BigIron->chasis[mfrId];
-
-	u8 unitNo = mfr->activeDevice->selectedUnit;
-	FILE *fcb = mfr->activeDevice->fcb[unitNo];
-
-	/*
-	**  Assemble flaw words.
-	*/
-	if ((flawState & 1) == 1)
-	{
-		trackFlaw = 1;
-		sectorFlaw = 0;
-	}
-	else
+	if (dp->sectorUs == 0 || distance == 0)
 	{
-		trackFlaw = 0;
-		sectorFlaw = 1;
+		return;
 	}
 
-	bool setFlaw = (flawState & 2) != 0;
-
-	PpWord flawWord0 = static_cast<PpWord>((sectorFlaw << 11) | (trackFlaw << 10) | (dp->cylinder & Mask10));
-	PpWord flawWord1 = static_cast<PpWord>(((dp->track & Mask6) << 6) | (dp->sector & Mask6));
+	u64 start = dd8xxBusy(dp) ? dp->busyUntil : dp->latencyClock;
+	double stroke = sqrt(static_cast<double>(distance - 1) / (dp->size.maxCylinders - 1));
 
-	/*
-	**  Read the 844 utility map sector.
-	*/
-	dp->cylinder = dp->size.maxCylinders - 1;
-	dp->track = 0;
-	dp->sector = 2;
-	fseek(fcb, dd8xxSeek(dp, mfrId), SEEK_SET);
-	fread(mySector, 2, SectorSize, fcb);
+	dp->busyUntil = start + dp->seekMinUs + static_cast<u64>((dp->seekMaxUs - dp->seekMinUs) * stroke);
+}
 
-	/*
-	**  Process request.
-	*/
-	if (setFlaw)
+/*--------------------------------------------------------------------------
+**  Purpose:        Model the time taken by a sector transfer: waiting for
+**                  the sector to come under the heads, then reading or
+**                  writing it. The rotational position is derived from
+**                  the emulated clock, so consecutive sectors follow each
+**                  other without a further wait.
+**
+**  Parameters:     Name        Description.
+**                  dp          Disk parameters (context).
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void dd8xxLatencySector(DiskParam *dp)
+{
+	if (dp->sectorUs == 0)
 	{
-		/*
-		**  Find a free flaw entry.
-		*/
-		index = 0;
-		while (index < SectorSize)
-		{
-			index += 2;
-			if (mySector[index] == 0)
-			{
-				break;
-			}
-		}
-
-		/*
-		**  If a free flaw entry was found, set it.
-		*/
-		if (index < SectorSize)
-		{
-			mySector[index + 0] = flawWord0;
-			mySector[index + 1] = flawWord1;
-		}
+		return;
 	}
-	else
-	{
-		/*
-		**  Find the matching entry.
-		*/
-		index = 0;
-		while (index < SectorSize)
-		{
-			if (mySector[index + 0] == flawWord0
-				&& mySector[index + 1] == flawWord1)
-			{
-				break;
-			}
 
-			index += 2;
-		}
-
-		/*
-		**  If a matching entry was found, clear it.
-		*/
-		if (index < SectorSize)
-		{
-			mySector[index + 0] = 0;
-			mySector[index + 1] = 0;
-		}
-	}
+	u64 start = dd8xxBusy(dp) ? dp->busyUntil : dp->latencyClock;
+	u32 sectors = dp->size.maxSectors;
+	u64 next = start / dp->sectorUs + 1;
+	u32 wait = static_cast<u32>((dp->sector + sectors - next % sectors) % sectors);
 
-	/*
-	**  Update the 844 utility map sector.
-	*/
-	fseek(fcb, dd8xxSeek(dp, mfrId), SEEK_SET);
-	dd8xxSectorWrite(dp, fcb, mySector);
+	dp->busyUntil = (next + wait + 1) * dp->sectorUs;
 }
 
 /*--------------------------------------------------------------------------
@@ -2042,7 +4770,7 @@ void dd8xxDumpDisk(char *params)
 			}
 			pos = dd8xxSeek(dp);
 		}
-		fseek(fcb, pos, SEEK_SET);
+		DiskSeek(fcb, pos);
 	}
 	fclose(dump);
 }
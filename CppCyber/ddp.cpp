@@ -261,6 +261,7 @@ bool DdpTransfer(u32 ecsAddress, CpWord *data, bool writeToEcs)
 	if (writeToEcs)
 	{
 		BigIron->extMem[ecsAddress] = *data & Mask60;
+		MarkDirty(BigIron->ecsStore.dirty, ecsAddress);
 	}
 	else
 	{
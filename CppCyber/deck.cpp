@@ -0,0 +1,905 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: deck.cpp
+**
+**  Description:
+**      Card decks for the card readers. Each reader has an input tray
+**      holding a queue of decks. A loader thread reads queued deck files
+**      into memory and converts them into cards with the reader's parse
+**      function, a few decks ahead of the reader, so reading a card never
+**      touches the file system. The reader takes the next deck once it
+**      has read the last card of the previous one.
+**
+**      A hot folder may be watched for deck files, which are moved into
+**      its "queued" sub-directory and loaded into a card reader one after
+**      another. Linux uses inotify to notice new files at once; otherwise,
+**      and to catch anything missed, the folder is scanned every few
+**      seconds for files which have not changed for a while.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  Decks loaded ahead of the one being read.
+*/
+#define DeckPreload             4
+
+/*
+**  Size of each read from a deck file.
+*/
+#define DeckReadSize            (64 * 1024)
+
+/*
+**  Interval at which the loader looks for work and the hot folder is
+**  scanned, and the age a file must reach before a scan takes it.
+*/
+#define DeckLoadMs              1000
+#define DeckScanMs              2000
+#define DeckSettleSec           2
+
+/*
+**  Most files taken from the hot folder in one scan.
+*/
+#define DeckScanMax             256
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  Queued deck.
+*/
+typedef struct deck
+{
+	struct deck *next;
+	char        name[_MAX_PATH + 1];
+	DeckCard    *cards;
+	u32         count;
+	u32         index;              /* next card to read */
+	volatile bool loaded;
+} Deck;
+
+/*
+**  Card reader input tray. The queue is shared with the loader thread
+**  and covered by lock; the deck being read belongs to the emulation.
+*/
+struct deckTray
+{
+	struct deckTray *next;
+	DeckParse   parse;
+	void        *param;
+	u32         lineSize;           /* longest line passed to parse, plus one */
+	Deck        *first;             /* queued decks */
+	Deck        *last;
+	Deck        *current;           /* deck being read */
+	CRITICAL_SECTION lock;
+};
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void deckStartup();
+static void deckLoad(DeckTray *tp, Deck *dp);
+static void deckFree(Deck *dp);
+static void deckScan();
+static void deckTake(char *name);
+static bool deckPath(char *path, char *name, const char *sub);
+static int deckCompare(const void *a, const void *b);
+static void deckCreateThread(bool watcher);
+#if defined(_WIN32)
+static void deckThread(void *param);
+static void deckWatcher(void *param);
+#else
+static void *deckThread(void *param);
+static void *deckWatcher(void *param);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static DeckTray *firstTray = nullptr;
+static bool deckInitialised = false;
+static CRITICAL_SECTION deckMutex;
+static CONDITION_VARIABLE deckWork;
+
+/*
+**  Hot folder and the card reader it feeds.
+*/
+static bool deckWatching = false;
+static char deckFolder[_MAX_PATH + 1];
+static int deckMfrID;
+static int deckChannelNo;
+static int deckEquipmentNo;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create a card reader input tray.
+**
+**  Parameters:     Name        Description.
+**                  parse       function converting a line into a card
+**                  lineSize    longest line passed to parse, plus one
+**                  param       parameter passed to parse
+**
+**  Returns:        Tray.
+**
+**------------------------------------------------------------------------*/
+DeckTray *deckTrayOpen(DeckParse parse, u32 lineSize, void *param)
+{
+	DeckTray *tp = static_cast<DeckTray *>(calloc(1, sizeof(DeckTray)));
+	if (tp == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate card reader input tray\n");
+		exit(1);
+	}
+
+	tp->parse = parse;
+	tp->param = param;
+	tp->lineSize = lineSize;
+	InitializeCriticalSection(&tp->lock);
+
+	deckStartup();
+
+	EnterCriticalSection(&deckMutex);
+	tp->next = firstTray;
+	firstTray = tp;
+	LeaveCriticalSection(&deckMutex);
+
+	return(tp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue a deck file. Only its name is kept; the loader
+**                  thread opens and reads it when its turn comes, so a
+**                  long queue holds no open files.
+**
+**  Parameters:     Name        Description.
+**                  tp          tray
+**                  fileName    deck file
+**
+**  Returns:        true if the file exists and was queued.
+**
+**------------------------------------------------------------------------*/
+bool deckQueue(DeckTray *tp, char *fileName)
+{
+	struct stat s;
+
+	if (strlen(fileName) > _MAX_PATH || stat(fileName, &s) != 0 || (s.st_mode & S_IFREG) == 0)
+	{
+		return(false);
+	}
+
+	Deck *dp = static_cast<Deck *>(calloc(1, sizeof(Deck)));
+	if (dp == nullptr)
+	{
+		return(false);
+	}
+
+	strcpy(dp->name, fileName);
+
+	EnterCriticalSection(&tp->lock);
+	if (tp->last == nullptr)
+	{
+		tp->first = dp;
+	}
+	else
+	{
+		tp->last->next = dp;
+	}
+
+	tp->last = dp;
+	LeaveCriticalSection(&tp->lock);
+
+	WakeConditionVariable(&deckWork);
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take the next deck into the reader if it is loaded.
+**                  Decks which could not be read are dropped.
+**
+**  Parameters:     Name        Description.
+**                  tp          tray
+**
+**  Returns:        true if there is a deck to read.
+**
+**------------------------------------------------------------------------*/
+bool deckFeed(DeckTray *tp)
+{
+	if (tp->current != nullptr)
+	{
+		return(true);
+	}
+
+	if (tp->first == nullptr)
+	{
+		return(false);
+	}
+
+	EnterCriticalSection(&tp->lock);
+	while (tp->first != nullptr && tp->first->loaded)
+	{
+		Deck *dp = tp->first;
+		tp->first = dp->next;
+		if (tp->first == nullptr)
+		{
+			tp->last = nullptr;
+		}
+
+		if (dp->count != 0)
+		{
+			tp->current = dp;
+			break;
+		}
+
+		deckFree(dp);
+	}
+
+	LeaveCriticalSection(&tp->lock);
+
+	return(tp->current != nullptr);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the next card of the deck being read.
+**
+**  Parameters:     Name        Description.
+**                  tp          tray
+**
+**  Returns:        Card, or nullptr once the deck is exhausted; the
+**                  following deck is only taken by deckFeed.
+**
+**------------------------------------------------------------------------*/
+DeckCard *deckNextCard(DeckTray *tp)
+{
+	Deck *dp = tp->current;
+	if (dp == nullptr)
+	{
+		return(nullptr);
+	}
+
+	if (dp->index < dp->count)
+	{
+		return(dp->cards + dp->index++);
+	}
+
+	tp->current = nullptr;
+	deckFree(dp);
+
+	WakeConditionVariable(&deckWork);
+
+	return(nullptr);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Configure the hot folder watched for decks.
+**
+**  Parameters:     Name        Description.
+**                  params      "mainframe,channel,equipment,directory"
+**                              of the card reader and folder
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void deckHotFolder(char *params)
+{
+	char queued[_MAX_PATH + 1];
+	struct stat s;
+
+	int numParam = sscanf(params, "%o,%o,%o,%255s", &deckMfrID, &deckChannelNo, &deckEquipmentNo, deckFolder);
+	if (numParam != 4
+		|| deckMfrID < 0 || deckMfrID >= MaxMainFrames
+		|| deckChannelNo < 0 || deckChannelNo >= MaxChannels
+		|| deckEquipmentNo < 0 || deckEquipmentNo >= MaxEquipment)
+	{
+		fprintf(stderr, "Invalid card hot folder '%s' - expected <mainframe>,<channel>,<equipment>,<directory>\n", params);
+		exit(1);
+	}
+
+	if (stat(deckFolder, &s) != 0 || (s.st_mode & S_IFDIR) == 0)
+	{
+		fprintf(stderr, "Card hot folder '%s' is not a directory\n", deckFolder);
+		exit(1);
+	}
+
+	/*
+	**  Decks taken from the folder are kept in its queued sub-directory.
+	*/
+	snprintf(queued, sizeof(queued), "%s/queued", deckFolder);
+	if (stat(queued, &s) != 0)
+	{
+#if defined(_WIN32)
+		_mkdir(queued);
+#else
+		mkdir(queued, 0755);
+#endif
+	}
+
+	deckWatching = true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Start watching the hot folder, once the card readers
+**                  have been initialised.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void deckWatch()
+{
+	if (!deckWatching)
+	{
+		return;
+	}
+
+	deckStartup();
+	deckCreateThread(true);
+
+	printf("Card hot folder %s feeds the card reader on mainframe %o channel %o equipment %o\n",
+		deckFolder, deckMfrID, deckChannelNo, deckEquipmentNo);
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Initialise the deck loader and start its thread, once.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void deckStartup()
+{
+	if (deckInitialised)
+	{
+		return;
+	}
+
+	InitializeCriticalSection(&deckMutex);
+	InitializeConditionVariable(&deckWork);
+	deckInitialised = true;
+
+	deckCreateThread(false);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read a deck file into memory and convert it into cards.
+**                  A deck which can't be opened or read ends up without
+**                  cards; its file is left where it is.
+**
+**  Parameters:     Name        Description.
+**                  tp          tray
+**                  dp          deck
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void deckLoad(DeckTray *tp, Deck *dp)
+{
+	char *text = nullptr;
+	u32 bytes = 0;
+	u32 size = 0;
+	u32 lines = 0;
+
+	FILE *fcb = fopen(dp->name, "r");
+	if (fcb == nullptr)
+	{
+		printf("Failed to open card deck %s\n", dp->name);
+		EnterCriticalSection(&tp->lock);
+		dp->loaded = true;
+		LeaveCriticalSection(&tp->lock);
+		return;
+	}
+
+	/*
+	**  Read the whole file.
+	*/
+	for (;;)
+	{
+		if (size - bytes < DeckReadSize)
+		{
+			size += DeckReadSize * 4;
+			char *p = static_cast<char *>(realloc(text, size + 1));
+			if (p == nullptr)
+			{
+				printf("Out of memory reading card deck %s\n", dp->name);
+				bytes = 0;
+				break;
+			}
+
+			text = p;
+		}
+
+		size_t got = fread(text + bytes, 1, DeckReadSize, fcb);
+		bytes += static_cast<u32>(got);
+		if (got < DeckReadSize)
+		{
+			if (ferror(fcb))
+			{
+				printf("Failed to read card deck %s\n", dp->name);
+				bytes = 0;
+			}
+
+			break;
+		}
+	}
+
+	fclose(fcb);
+
+	for (u32 i = 0; i < bytes; i++)
+	{
+		if (text[i] == '\n' || i == bytes - 1)
+		{
+			lines += 1;
+		}
+	}
+
+	if (lines != 0)
+	{
+		dp->cards = static_cast<DeckCard *>(malloc(lines * sizeof(DeckCard)));
+	}
+
+	if (dp->cards != nullptr)
+	{
+		/*
+		**  Hand each line to the reader as fgets with a buffer of
+		**  lineSize would; the rest of a longer line is dropped.
+		*/
+		char *line = static_cast<char *>(malloc(tp->lineSize));
+		char *cp = text;
+		char *end = text + bytes;
+
+		while (line != nullptr && cp < end)
+		{
+			char *nl = static_cast<char *>(memchr(cp, '\n', end - cp));
+			u32 length = static_cast<u32>((nl == nullptr ? end : nl + 1) - cp);
+			u32 copy = length < tp->lineSize - 1 ? length : tp->lineSize - 1;
+
+			memcpy(line, cp, copy);
+			line[copy] = 0;
+			tp->parse(tp->param, line, dp->cards + dp->count++);
+			cp += length;
+		}
+
+		free(line);
+	}
+
+	free(text);
+
+	EnterCriticalSection(&tp->lock);
+	dp->loaded = true;
+	LeaveCriticalSection(&tp->lock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release a deck.
+**
+**  Parameters:     Name        Description.
+**                  dp          deck
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void deckFree(Deck *dp)
+{
+	free(dp->cards);
+	free(dp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take all files in the hot folder which have not changed
+**                  for DeckSettleSec seconds, in name order.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void deckScan()
+{
+	static char *names[DeckScanMax];
+	char path[_MAX_PATH + 1];
+	struct stat s;
+	int count = 0;
+	time_t now = time(nullptr);
+
+#if defined(_WIN32)
+	struct _finddata_t fd;
+
+	snprintf(path, sizeof(path), "%s/*", deckFolder);
+	intptr_t handle = _findfirst(path, &fd);
+	if (handle == -1)
+	{
+		return;
+	}
+
+	do
+	{
+		char *name = fd.name;
+#else
+	DIR *dir = opendir(deckFolder);
+	if (dir == nullptr)
+	{
+		return;
+	}
+
+	struct dirent *de;
+	while ((de = readdir(dir)) != nullptr)
+	{
+		char *name = de->d_name;
+#endif
+		if (count >= DeckScanMax || name[0] == '.' || !deckPath(path, name, ""))
+		{
+			continue;
+		}
+
+		if (stat(path, &s) != 0 || (s.st_mode & S_IFREG) == 0 || now - s.st_mtime < DeckSettleSec)
+		{
+			continue;
+		}
+
+		names[count++] = strdup(name);
+#if defined(_WIN32)
+	} while (_findnext(handle, &fd) == 0);
+
+	_findclose(handle);
+#else
+	}
+
+	closedir(dir);
+#endif
+
+	qsort(names, count, sizeof(char *), deckCompare);
+
+	for (int i = 0; i < count; i++)
+	{
+		deckTake(names[i]);
+		free(names[i]);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Move a deck file from the hot folder into its queued
+**                  sub-directory and load it into the card reader.
+**                  Files whose queued name would not fit are left in
+**                  the hot folder.
+**
+**  Parameters:     Name        Description.
+**                  name        file name in the hot folder
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void deckTake(char *name)
+{
+	char path[_MAX_PATH + 1];
+	char queued[_MAX_PATH + 1];
+	struct stat s;
+
+	if (!deckPath(path, name, "") || !deckPath(queued, name, "queued/"))
+	{
+		return;
+	}
+
+	/*
+	**  Don't replace an earlier deck of the same name.
+	*/
+	for (int i = 1; stat(queued, &s) == 0 && i < 1000; i++)
+	{
+		snprintf(queued, sizeof(queued), "%s/queued/%s.%d", deckFolder, name, i);
+	}
+
+	if (rename(path, queued) != 0)
+	{
+		return;
+	}
+
+	u8 mfrID = static_cast<u8>(deckMfrID);
+	u8 channelNo = static_cast<u8>(deckChannelNo);
+	u8 equipmentNo = static_cast<u8>(deckEquipmentNo);
+	if (!cr405LoadDeck(mfrID, channelNo, equipmentNo, queued))
+	{
+		cr3447LoadDeck(mfrID, channelNo, equipmentNo, queued);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Build the path of a file in the hot folder or one of
+**                  its sub-directories. Room is left for the suffix
+**                  deckTake adds to a repeated name.
+**
+**  Parameters:     Name        Description.
+**                  path        result, _MAX_PATH + 1 characters
+**                  name        file name
+**                  sub         sub-directory with trailing '/', or ""
+**
+**  Returns:        false if the path would not fit.
+**
+**------------------------------------------------------------------------*/
+static bool deckPath(char *path, char *name, const char *sub)
+{
+	if (strlen(deckFolder) + strlen(sub) + strlen(name) + 8 > _MAX_PATH)
+	{
+		return(false);
+	}
+
+	snprintf(path, _MAX_PATH + 1, "%s/%s%s", deckFolder, sub, name);
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare two file names for qsort.
+**
+**  Parameters:     Name        Description.
+**                  a           first name
+**                  b           second name
+**
+**  Returns:        strcmp result.
+**
+**------------------------------------------------------------------------*/
+static int deckCompare(const void *a, const void *b)
+{
+	return(strcmp(*static_cast<char * const *>(a), *static_cast<char * const *>(b)));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the deck loader or hot folder watcher thread.
+**
+**  Parameters:     Name        Description.
+**                  watcher     true for the hot folder watcher
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void deckCreateThread(bool watcher)
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(watcher ? deckWatcher : deckThread),
+		static_cast<LPVOID>(nullptr),                               // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create card deck thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, watcher ? deckWatcher : deckThread, NULL);
+	if (rc != 0)
+	{
+		fprintf(stderr, "Failed to create card deck thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Deck loader thread. Loads the first DeckPreload decks
+**                  of every tray, waking when a deck is queued or read
+**                  or every DeckLoadMs milliseconds.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void deckThread(void *param)
+#else
+static void *deckThread(void *param)
+#endif
+{
+	(void)param;
+
+	EnterCriticalSection(&deckMutex);
+	while (BigIron->emulationActive)
+	{
+		bool loaded = false;
+
+		for (DeckTray *tp = firstTray; tp != nullptr; tp = tp->next)
+		{
+			Deck *dp;
+			int ahead = 0;
+
+			EnterCriticalSection(&tp->lock);
+			for (dp = tp->first; dp != nullptr && dp->loaded && ahead < DeckPreload; dp = dp->next)
+			{
+				ahead += 1;
+			}
+
+			LeaveCriticalSection(&tp->lock);
+
+			/*
+			**  Only the emulation removes decks, and only loaded ones,
+			**  so dp stays valid while it is loaded.
+			*/
+			if (dp != nullptr && !dp->loaded && ahead < DeckPreload)
+			{
+				deckLoad(tp, dp);
+				loaded = true;
+			}
+		}
+
+		if (!loaded)
+		{
+			SleepConditionVariableCS(&deckWork, &deckMutex, DeckLoadMs);
+		}
+	}
+
+	LeaveCriticalSection(&deckMutex);
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hot folder watcher thread. Takes files as inotify
+**                  reports them written or moved in, and scans the
+**                  folder every DeckScanMs milliseconds.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void deckWatcher(void *param)
+#else
+static void *deckWatcher(void *param)
+#endif
+{
+	(void)param;
+
+#if defined(__linux__)
+	static char events[4096];
+
+	int fd = inotify_init1(IN_NONBLOCK);
+	if (fd >= 0 && inotify_add_watch(fd, deckFolder, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+#endif
+
+	while (BigIron->emulationActive)
+	{
+		deckScan();
+
+#if defined(__linux__)
+		if (fd >= 0)
+		{
+			struct pollfd pfd;
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+
+			while (BigIron->emulationActive && poll(&pfd, 1, DeckScanMs) > 0)
+			{
+				ssize_t got = read(fd, events, sizeof(events));
+				for (char *p = events; got > 0 && p < events + got;)
+				{
+					struct inotify_event *ev = reinterpret_cast<struct inotify_event *>(p);
+					if (ev->len != 0 && (ev->mask & IN_ISDIR) == 0 && ev->name[0] != '.')
+					{
+						deckTake(ev->name);
+					}
+
+					p += sizeof(struct inotify_event) + ev->len;
+				}
+			}
+
+			continue;
+		}
+
+		usleep(DeckScanMs * 1000);
+#elif defined(_WIN32)
+		Sleep(DeckScanMs);
+#else
+		usleep(DeckScanMs * 1000);
+#endif
+	}
+
+#if defined(__linux__)
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+#endif
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*---------------------------  End Of File  ------------------------------*/
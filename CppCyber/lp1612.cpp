@@ -75,6 +75,12 @@
 **  -----------------------------------------
 */
 
+typedef struct lp1612Context
+{
+	Spool *spool;
+	bool printed;
+} Lp1612Context;
+
 /*
 **  ---------------------------
 **  Private Function Prototypes
@@ -142,12 +148,21 @@ void lp1612Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	dp->io = lp1612Io;
 	dp->selectedUnit = 0;
 
+	Lp1612Context *lc = static_cast<Lp1612Context *>(calloc(1, sizeof(Lp1612Context)));
+	if (lc == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate LP1612 context block\n");
+		exit(1);
+	}
+
+	dp->context[0] = static_cast<void *>(lc);
+
 	/*
 	**  Open the device file.
 	*/
 	sprintf(fname, "LP1612_C%02o", channelNo);
-	dp->fcb[0] = fopen(fname, "w+t");
-	if (dp->fcb[0] == nullptr)
+	lc->spool = spoolOpen(fname, "w+t");
+	if (lc->spool == nullptr)
 	{
 		fprintf(stderr, "Failed to open %s\n", fname);
 		exit(1);
@@ -174,7 +189,6 @@ void lp1612RemovePaper(char *params)
 	int equipmentNo;
 	int mfrID;
 	time_t currentTime;
-	char fname[80];
 	char fnameNew[80];
 
 	/*
@@ -212,18 +226,12 @@ void lp1612RemovePaper(char *params)
 		return;
 	}
 
-	/*
-	**  Close the old device file.
-	*/
-	fflush(dp->fcb[0]);
-	fclose(dp->fcb[0]);
-	dp->fcb[0] = nullptr;
+	Lp1612Context *lc = static_cast<Lp1612Context *>(dp->context[0]);
 
 	/*
-	**  Rename the device file to the format "LP1612_yyyymmdd_hhmmss".
+	**  Have the spooler rename the device file to the format
+	**  "LP1612_yyyymmdd_hhmmss" once the queued print data is written.
 	*/
-	sprintf(fname, "LP1612_C%02o", channelNo);
-
 	time(&currentTime);
 	struct tm t = *localtime(&currentTime);
 	sprintf(fnameNew, "LP1612_%04d%02d%02d_%02d%02d%02d.txt",  // drs add .txt
@@ -234,25 +242,7 @@ void lp1612RemovePaper(char *params)
 		t.tm_min,
 		t.tm_sec);
 
-	if (rename(fname, fnameNew) != 0)
-	{
-		printf("Could not rename %s to %s - %s\n", fname, fnameNew, strerror(errno));
-		return;
-	}
-
-	/*
-	**  Open the device file.
-	*/
-	dp->fcb[0] = fopen(fname, "w");
-
-	/*
-	**  Check if the open succeeded.
-	*/
-	if (dp->fcb[0] == nullptr)
-	{
-		printf("Failed to open %s\n", fname);
-		return;
-	}
+	spoolComplete(lc->spool, fnameNew, nullptr);
 
 	printf("Paper removed from 1612 printer\n");
 }
@@ -270,7 +260,7 @@ static FcStatus lp1612Func(PpWord funcCode, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	FILE *fcb = mfr->activeDevice->fcb[0];
+	Lp1612Context *lc = static_cast<Lp1612Context *>(mfr->activeDevice->context[0]);
 
 	switch (funcCode)
 	{
@@ -281,23 +271,31 @@ static FcStatus lp1612Func(PpWord funcCode, u8 mfrId)
 		break;
 
 	case FcPrintSingleSpace:
-		fprintf(fcb, "\n");
+		spoolPut(lc->spool, '\n');
 		break;
 
 	case FcPrintDoubleSpace:
-		fprintf(fcb, "\n\n");
+		spoolPut(lc->spool, '\n');
+		spoolPut(lc->spool, '\n');
 		break;
 
 	case FcPrintMoveChannel7:
-		fprintf(fcb, "\n");
+		spoolPut(lc->spool, '\n');
 		break;
 
 	case FcPrintMoveTOF:
-		fprintf(fcb, "\f");
+		spoolPut(lc->spool, '\f');
+
+		// A page eject ends a job on this printer, so flush the print file
+		if (lc->printed)
+		{
+			spoolFlush(lc->spool);
+			lc->printed = false;
+		}
 		break;
 
 	case FcPrintPrint:
-		fprintf(fcb, "\n");
+		spoolPut(lc->spool, '\n');
 		break;
 
 	case FcPrintSuppressLF:
@@ -333,7 +331,7 @@ static void lp1612Io(u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	FILE *fcb = mfr->activeDevice->fcb[0];
+	Lp1612Context *lc = static_cast<Lp1612Context *>(mfr->activeDevice->context[0]);
 
 	switch (mfr->activeDevice->fcode)
 	{
@@ -354,8 +352,9 @@ static void lp1612Io(u8 mfrId)
 	case FcPrintFormat6:
 		if (mfr->activeChannel->full)
 		{
-			fputc(extBcdToAscii[mfr->activeChannel->data & 077], fcb);
+			spoolPut(lc->spool, extBcdToAscii[mfr->activeChannel->data & 077]);
 			mfr->activeChannel->full = false;
+			lc->printed = true;
 		}
 		break;
 
@@ -38,10 +38,6 @@
 */
 #include "stdafx.h"
 #define DEBUG 0
-#if defined(_WIN32)
-#include <process.h>
-#endif
-#include <errno.h>
 #include "dcc6681.h"
 
 /*
@@ -168,6 +164,7 @@ typedef struct lpContext
 	int flags;
 	bool printed;
 	bool keepInt;
+	Spool *spool;
 } LpContext;
 
 
@@ -354,8 +351,8 @@ static void lp3000Init(u8 mfrID, u8 unitNo, u8 eqNo, u8 channelNo, int flags)
 	sprintf(tempfname, "LP5xx_M%o_C%02o_E%o", mfrID, channelNo, eqNo);		//drs
 	strcpy(fname, printDir);
 	strcat(fname, tempfname);
-	up->fcb[0] = fopen(fname, "w");
-	if (up->fcb[0] == nullptr)
+	lc->spool = spoolOpen(fname, "w");
+	if (lc->spool == nullptr)
 	{
 		fprintf(stderr, "Failed to open %s\n", fname);
 		exit(1);
@@ -386,7 +383,6 @@ void lp3000RemovePaper(char *params)
 	int mfrID;
 	time_t currentTime;
 	char tempfname[256];
-	char fname[256];
 	char fnameNew[256];
 
 	/*
@@ -424,20 +420,12 @@ void lp3000RemovePaper(char *params)
 		return;
 	}
 
-	/*
-	**  Close the old device file.
-	*/
-	fflush(dp->fcb[0]);
-	fclose(dp->fcb[0]);
-	dp->fcb[0] = nullptr;
+	LpContext *lc = static_cast<LpContext *>(dp->context[0]);
 
 	/*
-	**  Rename the device file to the format "LP5xx_yyyymmdd_hhmmss".
+	**  Have the spooler rename the device file to the format
+	**  "LP5xx_yyyymmdd_hhmmss" once the queued print data is written.
 	*/
-	sprintf(tempfname, "LP5xx_M%o_C%02o_E%o", mfrID, channelNo, equipmentNo);
-	strcpy(fname, printDir);
-	strcat(fname, tempfname);
-
 	time(&currentTime);
 	struct tm t = *localtime(&currentTime);
 	sprintf(tempfname, "LP5xx_%04d%02d%02d_%02d%02d%02d.txt",    //drs add .txt
@@ -451,45 +439,14 @@ void lp3000RemovePaper(char *params)
 	strcpy(fnameNew, printDir);
 	strcat(fnameNew, tempfname);
 
-	if (rename(fname, fnameNew) != 0)
-	{
-		printf("Could not rename %s to %s - %s\n", fname, fnameNew, strerror(errno));
-		return;
-	}
-
 	/*
-	**  Open the device file.
+	**  With automatic paper removal the completed file is handed to the
+	**  printApp post-processor.
 	*/
-	dp->fcb[0] = fopen(fname, "w");
-
-	/*
-	**  Check if the open succeeded.
-	*/
-	if (dp->fcb[0] == nullptr)
-	{
-		printf("Failed to open %s\n", fname);
-		return;
-	}
+	spoolComplete(lc->spool, fnameNew, BigIron->autoRemovePaper != 0 && strlen(printApp) > 5 ? printApp : nullptr);
 
 	printf("\nPaper removed from 5xx printer\n");
 	printf("\nOperator> ");
-
-#if defined(_WIN32)
-	if (BigIron->autoRemovePaper != 0 && strlen(printApp) > 5)
-	{
-		for (int i = 0; i < 256; i++)
-		{
-			if (fnameNew[i] == 0)
-				break;
-			if (fnameNew[i] == '/')
-				fnameNew[i] = '\\';
-		}
-		// ReSharper disable once CppEntityNeverUsed
-		intptr_t ret = _spawnl(_P_DETACH, printApp, printApp, fnameNew, printApp, nullptr);
-		printf("\n\nOperator> ");
-	}
-#endif
-
 }
 
 /*--------------------------------------------------------------------------
@@ -507,7 +464,6 @@ static FcStatus lp3000Func(PpWord funcCode, u8 mfrId)
 
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	FILE *fcb = mfr->active3000Device->fcb[0];
 	LpContext *lc = static_cast<LpContext *>(mfr->active3000Device->context[0]);
 
 	/*
@@ -541,7 +497,7 @@ static FcStatus lp3000Func(PpWord funcCode, u8 mfrId)
 		// Release is sent at end of job, so flush the print file
 		if (lc->printed)
 		{
-			fflush(fcb);
+			spoolFlush(lc->spool);
 			if (BigIron->autoRemovePaper != 0)
 			{
 				u8 mfrID = mfr->active3000Device->mfrID;
@@ -555,7 +511,7 @@ static FcStatus lp3000Func(PpWord funcCode, u8 mfrId)
 	case FcPrintSingle:
 	case FcPrintLastLine:
 		// Treat last-line codes as a single blank line
-		fputc('\n', fcb);
+		spoolPut(lc->spool, '\n');
 #if DEBUG
 		lp3000DebugData();
 #endif
@@ -563,14 +519,15 @@ static FcStatus lp3000Func(PpWord funcCode, u8 mfrId)
 
 	case FcPrintEject:
 		// Turn eject into a formfeed character
-		fputc('\f', fcb);
+		spoolPut(lc->spool, '\f');
 #if DEBUG
 		lp3000DebugData();
 #endif
 		return(FcProcessed);
 
 	case FcPrintDouble:
-		fprintf(fcb, "\n\n");
+		spoolPut(lc->spool, '\n');
+		spoolPut(lc->spool, '\n');
 #if DEBUG
 		lp3000DebugData();
 #endif
@@ -802,7 +759,6 @@ static void lp3000Io(u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	FILE *fcb = mfr->active3000Device->fcb[0];
 	LpContext *lc = static_cast<LpContext *>(mfr->active3000Device->context[0]);
 
 	/*
@@ -827,13 +783,13 @@ static void lp3000Io(u8 mfrId)
 			if (lc->flags & Lp3000Type501)
 			{
 				// 501 printer, output display code
-				fputc(bcdToAscii[(mfr->activeChannel->data >> 6) & Mask6], fcb);
-				fputc(bcdToAscii[mfr->activeChannel->data & Mask6], fcb);
+				spoolPut(lc->spool, bcdToAscii[(mfr->activeChannel->data >> 6) & Mask6]);
+				spoolPut(lc->spool, bcdToAscii[mfr->activeChannel->data & Mask6]);
 			}
 			else
 			{
 				// 512 printer, output ASCII
-				fputc(mfr->activeChannel->data & 0377, fcb);
+				spoolPut(lc->spool, static_cast<char>(mfr->activeChannel->data & 0377));
 			}
 			mfr->activeChannel->full = false;
 			lc->printed = true;
@@ -881,12 +837,12 @@ static void lp3000Disconnect(u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	FILE *fcb = mfr->active3000Device->fcb[0];
+	LpContext *lc = static_cast<LpContext *>(mfr->active3000Device->context[0]);
 
 	if (mfr->active3000Device->fcode == Fc6681Output)
 	{
 		// Rule is "space after the line is printed" so do that here
-		fputc('\n', fcb);
+		spoolPut(lc->spool, '\n');
 #if DEBUG
 		lp3000DebugData();
 #endif
@@ -0,0 +1,2061 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: memstore.cpp
+**
+**  Description:
+**      Allocate central and extended memory and optionally back it by
+**      a file in the persistence directory.
+**
+**      By default the backing file is mapped into the address space so
+**      CM and ECS are the file contents. Startup does not read the whole
+**      file, shutdown does not write it, and an optional background sync
+**      limits what a host crash can lose. If the file can not be mapped
+**      (or persistMap=0) the file is read at startup and written at
+**      shutdown as before.
+**
+**      Optionally a consistent checkpoint of CM and ECS is written every
+**      few seconds to <name>.ckp0 and <name>.ckp1 in turn. Writes to
+**      memory mark their page in a
+**      dirty map; the CPU 0 thread of each mainframe copies the dirty
+**      pages aside between PP barrel passes, when no PP or CPU of that
+**      mainframe is running, and this thread then writes them out while
+**      emulation continues. ECS is copied once every mainframe has
+**      stopped. A checkpoint file starts with a header which is marked
+**      complete, with a sequence number, only once all pages of a
+**      checkpoint are on disk. A crash while one file is written leaves
+**      the other complete, and the newest complete checkpoint may be
+**      restored at startup.
+**
+**      Memory which is not mapped may be allocated on huge pages, and
+**      each mainframe's CM may be placed on its own NUMA node with that
+**      mainframe's emulation threads bound to the node's processors.
+**      Either falls back to ordinary allocation when the host can not
+**      provide it; startup logs what was obtained.
+**
+**      ECS may instead live in a named shared memory segment, so that
+**      each mainframe can run as a separate emulator process. The ECS
+**      flag register then lives in a second small segment and is only
+**      changed by atomic operations.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxStores               (MaxMainFrames + 1)
+#define MemPolicyPreferred      1       /* MPOL_PREFERRED for mbind */
+#if !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT          26
+#endif
+
+/*
+**  Checkpoint file layout: header, then the store's pages in order.
+**  Each store has two files which are written in turn.
+*/
+#define CkpMagic                "CYBCKP"
+#define CkpVersion              2
+#define CkpDataOffset           64
+
+/*
+**  Longest a mainframe waits for the others at a checkpoint cut before
+**  the checkpoint is given up, e.g. while one runs an operator command.
+*/
+#define CutWaitUs               1000000
+
+/*
+**  How often a process attaching to shared ECS looks whether its
+**  creator has finished initialising it.
+*/
+#define ShareWaitMs             100
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct ckpHeader
+{
+	char        magic[8];           /* CkpMagic */
+	u32         version;            /* CkpVersion */
+	u32         words;              /* store size */
+	u32         complete;           /* 1 once all pages of the checkpoint are written */
+	u32         sequence;           /* checkpoint number, the newest complete one is restored */
+	i64         taken;              /* time of the checkpoint */
+} CkpHeader;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static bool memStoreMap(MemStore *ms, char *fileName);
+static void memStoreShare(MemStore *ms, char *fileName);
+static void memStoreUnshare(MemStore *ms);
+static void memStoreShareJoin(MemStore *ms);
+static void memStoreShareLock(MemStore *ms);
+static void memStoreShareUnlock(MemStore *ms);
+static bool memStoreAlive(i32 pid);
+static void memStoreRead(MemStore *ms, char *fileName);
+static CpWord *memStoreAlloc(MemStore *ms);
+static void memStoreRelease(MemStore *ms);
+static u32 memStorePageKB();
+static bool memStoreEnableLargePages();
+static int memStoreNodeCount();
+static void memStoreFlush(MemStore *ms);
+static void memStoreCheckpoint();
+static void memStoreStage(MemStore *ms);
+static bool memStoreCkpHeader(MemStore *ms, bool complete, i64 taken);
+static bool memStoreCkpPage(MemStore *ms, FILE *fcb, u32 page, CpWord *data);
+static bool memStoreCkpSync(FILE *fcb);
+static void memStoreAbandon();
+static void memStoreRestore(MemStore *ms);
+static void memStoreCreateThread();
+#if defined(_WIN32)
+static void memStoreThread(void *param);
+#else
+static void *memStoreThread(void *param);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static bool mapStores = true;
+static u32 syncSeconds = 0;
+static MemStore *stores[MaxStores];
+static int storeCount = 0;
+static u32 syncCount = 0;
+static u64 syncUs = 0;
+static u32 checkpointSeconds = 0;
+static bool checkpointRestore = false;
+static i64 checkpointRestored = 0;
+static u32 checkpointCount = 0;
+static u32 checkpointSequence = 0;
+static u32 checkpointPages = 0;
+static u32 cutCount = 0;
+static u64 cutUs = 0;
+static u64 cutMaxUs = 0;
+static int cutsOutstanding = 0;
+static bool cutAbandoned = false;
+static u32 cutAbandonCount = 0;
+static u32 hugePageMB = 0;
+static bool numaPlace = false;
+static int numaNodes = 1;
+static char shareName[40];
+static MemStore *sharedStore = nullptr;
+static CRITICAL_SECTION storeMutex;
+static CONDITION_VARIABLE cutDone;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set up backing store options. Must be called before
+**                  the first memStoreOpen.
+**
+**  Parameters:     Name        Description.
+**                  map         true to map backing files, false to copy
+**                  sync        seconds between background syncs of mapped
+**                              files, 0 to sync only at shutdown
+**                  checkpoint  seconds between checkpoints, 0 for none
+**                  restore     true to start from the last checkpoint
+**                  hugePages   huge page size in MB (2 or 1024), 0 for none
+**                  numa        true to place each mainframe's CM on a node
+**                  share       name of the shared ECS segment, "" for none
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreInit(bool map, u32 sync, u32 checkpoint, bool restore, u32 hugePages, bool numa, char *share)
+{
+	strncpy(shareName, share, sizeof(shareName) - 1);
+
+	InitializeCriticalSection(&storeMutex);
+	InitializeConditionVariable(&cutDone);
+
+	mapStores = map;
+	syncSeconds = mapStores ? sync : 0;
+	checkpointSeconds = checkpoint;
+	checkpointRestore = restore && checkpoint != 0;
+
+	hugePageMB = hugePages;
+	if (hugePageMB != 0 && !memStoreEnableLargePages())
+	{
+		printf("Huge pages not permitted for this process, using normal pages\n");
+		hugePageMB = 0;
+	}
+
+	numaPlace = numa;
+	if (numaPlace)
+	{
+		numaNodes = memStoreNodeCount();
+		if (numaNodes < 2)
+		{
+			printf("Host has a single NUMA node, CM placement not used\n");
+			numaPlace = false;
+		}
+	}
+
+	if (*persistDir != '\0' && (syncSeconds != 0 || checkpointSeconds != 0))
+	{
+		memStoreCreateThread();
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate a block of CM or ECS.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**                  name        backing file name within persistDir
+**                  words       size in 60 bit words
+**                  mfrID       mainframe which takes the checkpoint cut
+**                  local       true if only mainframe mfrID uses it (CM)
+**
+**  Returns:        Pointer to zeroed or restored memory.
+**
+**------------------------------------------------------------------------*/
+CpWord *memStoreOpen(MemStore *ms, char *name, u32 words, u8 mfrID, bool local)
+{
+	char fileName[256];
+
+	memset(ms, 0, sizeof(MemStore));
+	strcpy(ms->name, name);
+	ms->words = words;
+	ms->pages = (words + MemPageWords - 1) >> MemPageShift;
+	ms->mfrID = mfrID;
+	ms->local = local;
+	ms->node = numaPlace && local ? mfrID % numaNodes : -1;
+
+	if (!local && *shareName != '\0' && words != 0)
+	{
+		if (*persistDir != '\0')
+		{
+			sprintf(fileName, "%s/%s", persistDir, name);
+		}
+		else
+		{
+			*fileName = '\0';
+		}
+
+		memStoreShare(ms, fileName);
+	}
+	else if (*persistDir != '\0')
+	{
+		sprintf(fileName, "%s/%s", persistDir, name);
+
+		if (!mapStores || words == 0 || !memStoreMap(ms, fileName))
+		{
+			memStoreRead(ms, fileName);
+		}
+	}
+	else
+	{
+		ms->mem = memStoreAlloc(ms);
+	}
+
+	if (ms->mem == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate %s memory\n", name);
+		exit(1);
+	}
+
+	if ((hugePageMB != 0 || numaPlace) && words != 0)
+	{
+		if (ms->node < 0)
+		{
+			printf("%s on %lu KB pages%s\n", name, static_cast<unsigned long>(ms->pageKB), ms->mapped ? " (mapped file)" : "");
+		}
+		else
+		{
+			printf("%s on %lu KB pages%s, NUMA node %d\n", name, static_cast<unsigned long>(ms->pageKB),
+				ms->mapped ? " (mapped file)" : "", ms->node);
+		}
+	}
+
+	/*
+	**  Other processes write a shared store, so its dirty map would be
+	**  incomplete.
+	*/
+	if (*persistDir != '\0' && checkpointSeconds != 0 && words != 0 && ms->share == nullptr)
+	{
+		/*
+		**  Every page is dirty to start with, so the first checkpoint
+		**  is a full image and later ones only update it.
+		*/
+		ms->dirty = static_cast<u8*>(malloc(ms->pages));
+		ms->ckpBehind = static_cast<u8*>(calloc(ms->pages, 1));
+		if (ms->dirty == nullptr || ms->ckpBehind == nullptr)
+		{
+			fprintf(stderr, "Failed to allocate %s dirty page map\n", name);
+			exit(1);
+		}
+
+		memset(ms->dirty, 1, ms->pages);
+
+		for (int slot = 0; slot < 2; slot++)
+		{
+			sprintf(fileName, "%s/%s.ckp%d", persistDir, name, slot);
+			ms->ckpFcb[slot] = fopen(fileName, "r+b");
+			if (ms->ckpFcb[slot] == nullptr)
+			{
+				ms->ckpFcb[slot] = fopen(fileName, "w+b");
+				if (ms->ckpFcb[slot] == nullptr)
+				{
+					fprintf(stderr, "Failed to create %s checkpoint file\n", name);
+					exit(1);
+				}
+			}
+		}
+
+		memStoreRestore(ms);
+	}
+
+	if (*persistDir != '\0')
+	{
+		EnterCriticalSection(&storeMutex);
+		stores[storeCount++] = ms;
+		LeaveCriticalSection(&storeMutex);
+	}
+
+	return ms->mem;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Persist and release a block of CM or ECS.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreClose(MemStore *ms)
+{
+	if (ms->mem == nullptr)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&storeMutex);
+	for (int i = 0; i < storeCount; i++)
+	{
+		if (stores[i] == ms)
+		{
+			stores[i] = stores[--storeCount];
+			break;
+		}
+	}
+	LeaveCriticalSection(&storeMutex);
+
+	if (ms->share != nullptr)
+	{
+		memStoreUnshare(ms);
+	}
+	else if (ms->mapped)
+	{
+		memStoreFlush(ms);
+#if defined(_WIN32)
+		UnmapViewOfFile(ms->mem);
+		CloseHandle(ms->mapHandle);
+		CloseHandle(ms->fileHandle);
+#else
+		munmap(ms->mem, ms->words * sizeof(CpWord));
+		close(ms->fd);
+#endif
+	}
+	else
+	{
+		if (ms->fcb != nullptr)
+		{
+			fseek(ms->fcb, 0, SEEK_SET);
+			if (fwrite(ms->mem, sizeof(CpWord), ms->words, ms->fcb) != ms->words)
+			{
+				fprintf(stderr, "Error writing %s backing file\n", ms->name);
+			}
+
+			fclose(ms->fcb);
+		}
+
+		memStoreRelease(ms);
+	}
+
+	for (int slot = 0; slot < 2; slot++)
+	{
+		if (ms->ckpFcb[slot] != nullptr)
+		{
+			fclose(ms->ckpFcb[slot]);
+		}
+	}
+
+	free(ms->dirty);
+	free(ms->ckpBehind);
+	free(ms->stage);
+	free(ms->stagePage);
+
+	ms->mem = nullptr;
+	ms->dirty = nullptr;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take the checkpoint cut for one mainframe. Called by
+**                  its CPU 0 thread between PP barrel passes, outside
+**                  SysPpMutex. PpuMutex is held here, so neither the PPs
+**                  nor the CPUs of the mainframe run and its CM is not
+**                  changing. ECS is shared, so it is copied by the last
+**                  mainframe to arrive while the others wait here. Dirty
+**                  pages are only copied, the checkpoint thread writes
+**                  them out.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe ID
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreCut(u8 mfrID)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrID];
+	u64 start = rtcHostMicroseconds();
+
+	RESERVE(&mfr->PpuMutex);
+	EnterCriticalSection(&storeMutex);
+
+	mfr->checkpointCut = false;
+
+	if (cutsOutstanding <= 0 || cutAbandoned)
+	{
+		LeaveCriticalSection(&storeMutex);
+		RELEASE(&mfr->PpuMutex);
+		return;
+	}
+
+	for (int i = 0; i < storeCount; i++)
+	{
+		if (stores[i]->dirty != nullptr && stores[i]->local && stores[i]->mfrID == mfrID)
+		{
+			memStoreStage(stores[i]);
+		}
+	}
+
+	cutsOutstanding -= 1;
+	if (cutsOutstanding == 0)
+	{
+		for (int i = 0; i < storeCount; i++)
+		{
+			if (stores[i]->dirty != nullptr && !stores[i]->local)
+			{
+				memStoreStage(stores[i]);
+			}
+		}
+
+		WakeAllConditionVariable(&cutDone);
+	}
+
+	while (cutsOutstanding > 0 && !cutAbandoned && BigIron->emulationActive)
+	{
+		if (rtcHostMicroseconds() - start >= CutWaitUs)
+		{
+			memStoreAbandon();
+			break;
+		}
+
+		SleepConditionVariableCS(&cutDone, &storeMutex, 100);
+	}
+
+	u64 pause = rtcHostMicroseconds() - start;
+	cutUs += pause;
+	cutCount += 1;
+	if (pause > cutMaxUs)
+	{
+		cutMaxUs = pause;
+	}
+
+	LeaveCriticalSection(&storeMutex);
+	RELEASE(&mfr->PpuMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write all dirty pages of mapped stores to disk.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreSync()
+{
+	u64 start = rtcHostMicroseconds();
+
+	EnterCriticalSection(&storeMutex);
+	for (int i = 0; i < storeCount; i++)
+	{
+		if (stores[i]->mapped)
+		{
+			memStoreFlush(stores[i]);
+		}
+	}
+	LeaveCriticalSection(&storeMutex);
+
+	syncUs += rtcHostMicroseconds() - start;
+	syncCount += 1;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show backing store statistics.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreShowStats()
+{
+	if (*persistDir == '\0')
+	{
+		return;
+	}
+
+	printf("\n    Backing store (%s):\n", persistDir);
+	EnterCriticalSection(&storeMutex);
+	for (int i = 0; i < storeCount; i++)
+	{
+		printf("        %-12s %8lu words  %s%s\n", stores[i]->name, static_cast<unsigned long>(stores[i]->words),
+			stores[i]->mapped ? "mapped" : "copied", stores[i]->share != nullptr ? ", shared" : "");
+	}
+	LeaveCriticalSection(&storeMutex);
+
+	if (syncCount != 0)
+	{
+		printf("        %lu syncs, average %.3f ms\n", static_cast<unsigned long>(syncCount),
+			static_cast<double>(syncUs) / syncCount / 1000.0);
+	}
+
+	if (checkpointSeconds != 0)
+	{
+		printf("        %lu checkpoints every %lu s, %lu pages in last\n", static_cast<unsigned long>(checkpointCount),
+			static_cast<unsigned long>(checkpointSeconds), static_cast<unsigned long>(checkpointPages));
+		if (cutCount != 0)
+		{
+			printf("        emulation paused average %.3f ms, max %.3f ms\n",
+				static_cast<double>(cutUs) / cutCount / 1000.0, static_cast<double>(cutMaxUs) / 1000.0);
+		}
+
+		if (cutAbandonCount != 0)
+		{
+			printf("        %lu checkpoints given up waiting for a mainframe\n", static_cast<unsigned long>(cutAbandonCount));
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Let the processes waiting to attach to shared ECS go
+**                  ahead. Called by the process which created the
+**                  segment once it has loaded or restored the contents.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreShareReady()
+{
+	if (sharedStore != nullptr && sharedStore->shareCreator && sharedStore->share->ready == 0)
+	{
+#if defined(_WIN32)
+		MemoryBarrier();
+#else
+		__sync_synchronize();
+#endif
+		sharedStore->share->ready = 1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Tell whether this process may replace the contents of
+**                  a store, i.e. the store is not shared or no other
+**                  process was using it when this one attached.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        true if the contents are this process's own.
+**
+**------------------------------------------------------------------------*/
+bool memStoreShareOwner(MemStore *ms)
+{
+	return(ms->share == nullptr || ms->shareCreator);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Bind the calling emulation thread to the processors
+**                  of the NUMA node holding its mainframe's CM.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe ID
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memStoreBindThread(u8 mfrID)
+{
+	if (!numaPlace)
+	{
+		return;
+	}
+
+	int node = mfrID % numaNodes;
+
+#if defined(_WIN32)
+	ULONGLONG mask;
+
+	if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) || mask == 0
+		|| SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(mask)) == 0)
+	{
+		printf("Failed to bind mainframe %d thread to NUMA node %d\n", mfrID, node);
+	}
+#elif defined(__linux__)
+	char fileName[80];
+	cpu_set_t set;
+	int first;
+	int last;
+	char sep;
+
+	sprintf(fileName, "/sys/devices/system/node/node%d/cpulist", node);
+	FILE *fcb = fopen(fileName, "r");
+	if (fcb == nullptr)
+	{
+		printf("Failed to bind mainframe %d thread to NUMA node %d\n", mfrID, node);
+		return;
+	}
+
+	/*
+	**  The list looks like "0-7,16-23".
+	*/
+	CPU_ZERO(&set);
+	while (fscanf(fcb, "%d", &first) == 1)
+	{
+		last = first;
+		sep = static_cast<char>(fgetc(fcb));
+		if (sep == '-')
+		{
+			if (fscanf(fcb, "%d", &last) != 1)
+			{
+				break;
+			}
+
+			sep = static_cast<char>(fgetc(fcb));
+		}
+
+		for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+		{
+			CPU_SET(cpu, &set);
+		}
+
+		if (sep != ',')
+		{
+			break;
+		}
+	}
+
+	fclose(fcb);
+
+	if (CPU_COUNT(&set) == 0 || sched_setaffinity(0, sizeof(set), &set) != 0)
+	{
+		printf("Failed to bind mainframe %d thread to NUMA node %d\n", mfrID, node);
+	}
+#endif
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Map a backing file, creating or extending it as needed.
+**                  A file which existed but was too short is cleared, as
+**                  the copy path has always done.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**                  fileName    backing file path
+**
+**  Returns:        true if mapped, false to fall back to copying.
+**
+**------------------------------------------------------------------------*/
+static bool memStoreMap(MemStore *ms, char *fileName)
+{
+	u64 bytes = static_cast<u64>(ms->words) * sizeof(CpWord);
+	u64 oldBytes;
+
+#if defined(_WIN32)
+	LARGE_INTEGER size;
+
+	ms->fileHandle = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (ms->fileHandle == INVALID_HANDLE_VALUE)
+	{
+		printf("Can't open %s backing file for mapping, copying instead\n", ms->name);
+		return false;
+	}
+
+	if (!GetFileSizeEx(ms->fileHandle, &size))
+	{
+		size.QuadPart = 0;
+	}
+
+	oldBytes = static_cast<u64>(size.QuadPart);
+
+	/*
+	**  Mapping more than the file holds extends it with zeros.
+	*/
+	ms->mapHandle = CreateFileMappingA(ms->fileHandle, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes & 0xFFFFFFFF), nullptr);
+	if (ms->mapHandle == nullptr)
+	{
+		CloseHandle(ms->fileHandle);
+		printf("Can't map %s backing file, copying instead\n", ms->name);
+		return false;
+	}
+
+	ms->mem = static_cast<CpWord*>(MapViewOfFileExNuma(ms->mapHandle, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(bytes),
+		nullptr, ms->node < 0 ? NUMA_NO_PREFERRED_NODE : static_cast<DWORD>(ms->node)));
+	if (ms->mem == nullptr)
+	{
+		CloseHandle(ms->mapHandle);
+		CloseHandle(ms->fileHandle);
+		printf("Can't map %s backing file, copying instead\n", ms->name);
+		return false;
+	}
+#else
+	struct stat s;
+
+	ms->fd = open(fileName, O_RDWR | O_CREAT, 0644);
+	if (ms->fd < 0)
+	{
+		printf("Can't open %s backing file for mapping, copying instead\n", ms->name);
+		return false;
+	}
+
+	oldBytes = fstat(ms->fd, &s) == 0 ? static_cast<u64>(s.st_size) : 0;
+	if (oldBytes < bytes && ftruncate(ms->fd, bytes) != 0)
+	{
+		close(ms->fd);
+		printf("Can't extend %s backing file, copying instead\n", ms->name);
+		return false;
+	}
+
+	void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, ms->fd, 0);
+	if (p == MAP_FAILED)
+	{
+		close(ms->fd);
+		printf("Can't map %s backing file, copying instead\n", ms->name);
+		return false;
+	}
+
+	ms->mem = static_cast<CpWord*>(p);
+
+	/*
+	**  Page cache placement is up to the kernel.
+	*/
+	ms->node = -1;
+#endif
+
+	ms->mapped = true;
+	ms->pageKB = memStorePageKB();
+
+	if (oldBytes != 0 && oldBytes < bytes)
+	{
+		printf("Unexpected length of %s backing file, clearing %s\n", ms->name, ms->name);
+		memset(ms->mem, 0, static_cast<size_t>(bytes));
+	}
+
+	return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Attach to the named shared ECS segment and its flag
+**                  register, creating them if this is the first process.
+**                  With a persist directory the segment is the mapped
+**                  backing file, otherwise it is anonymous memory which
+**                  lasts while any process has it attached. A process
+**                  which attaches to a segment created by another waits
+**                  until the creator has initialised it.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**                  fileName    backing file path, "" for none
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreShare(MemStore *ms, char *fileName)
+{
+	char objName[80];
+	u64 bytes = static_cast<u64>(ms->words) * sizeof(CpWord);
+	u64 oldBytes = 0;
+
+	if (*fileName != '\0' && !mapStores)
+	{
+		fprintf(stderr, "Shared ECS requires persistMap=1\n");
+		exit(1);
+	}
+
+	/*
+	**  Map the flag register, which also holds the list of processes
+	**  using the segment, and lock it against other processes attaching
+	**  or detaching.
+	*/
+#if defined(_WIN32)
+	sprintf(objName, "CppCyber_%s_lock", shareName);
+	ms->shareLock = CreateMutexA(nullptr, FALSE, objName);
+	if (ms->shareLock == nullptr)
+	{
+		fprintf(stderr, "Failed to create shared ECS lock %s\n", objName);
+		exit(1);
+	}
+
+	sprintf(objName, "CppCyber_%s_flags", shareName);
+	ms->shareHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(EcsShare), objName);
+	if (ms->shareHandle == nullptr)
+	{
+		fprintf(stderr, "Failed to create shared ECS flag register %s\n", objName);
+		exit(1);
+	}
+
+	ms->share = static_cast<EcsShare*>(MapViewOfFile(ms->shareHandle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(EcsShare)));
+	if (ms->share == nullptr)
+	{
+		fprintf(stderr, "Failed to map shared ECS flag register %s\n", objName);
+		exit(1);
+	}
+
+	memStoreShareLock(ms);
+#else
+	struct stat s;
+
+	sprintf(objName, "/CppCyber_%s_flags", shareName);
+	for (;;)
+	{
+		ms->shareFd = shm_open(objName, O_RDWR | O_CREAT, 0600);
+		if (ms->shareFd < 0)
+		{
+			fprintf(stderr, "Failed to create shared ECS flag register %s\n", objName);
+			exit(1);
+		}
+
+		/*
+		**  The last process to detach may have removed the segment
+		**  after it was opened here, then a new one must be created.
+		*/
+		memStoreShareLock(ms);
+		if (fstat(ms->shareFd, &s) == 0 && s.st_nlink != 0)
+		{
+			break;
+		}
+
+		close(ms->shareFd);
+	}
+
+	if (ftruncate(ms->shareFd, sizeof(EcsShare)) != 0)
+	{
+		fprintf(stderr, "Failed to create shared ECS flag register %s\n", objName);
+		exit(1);
+	}
+
+	void *p = mmap(NULL, sizeof(EcsShare), PROT_READ | PROT_WRITE, MAP_SHARED, ms->shareFd, 0);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map shared ECS flag register %s\n", objName);
+		exit(1);
+	}
+
+	ms->share = static_cast<EcsShare*>(p);
+#endif
+
+	memStoreShareJoin(ms);
+	memStoreShareUnlock(ms);
+
+	/*
+	**  Map the segment.
+	*/
+#if defined(_WIN32)
+	ms->fileHandle = INVALID_HANDLE_VALUE;
+	if (*fileName != '\0')
+	{
+		LARGE_INTEGER size;
+
+		ms->fileHandle = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+			OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (ms->fileHandle == INVALID_HANDLE_VALUE)
+		{
+			fprintf(stderr, "Failed to open %s backing file\n", ms->name);
+			exit(1);
+		}
+
+		if (GetFileSizeEx(ms->fileHandle, &size))
+		{
+			oldBytes = static_cast<u64>(size.QuadPart);
+		}
+	}
+
+	sprintf(objName, "CppCyber_%s_ecs", shareName);
+	ms->mapHandle = CreateFileMappingA(ms->fileHandle, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes & 0xFFFFFFFF), objName);
+	if (ms->mapHandle == nullptr)
+	{
+		fprintf(stderr, "Failed to create shared ECS %s\n", objName);
+		exit(1);
+	}
+
+	ms->mem = static_cast<CpWord*>(MapViewOfFile(ms->mapHandle, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(bytes)));
+#else
+	if (*fileName != '\0')
+	{
+		ms->fd = open(fileName, O_RDWR | O_CREAT, 0644);
+	}
+	else
+	{
+		sprintf(objName, "/CppCyber_%s_ecs", shareName);
+		ms->fd = shm_open(objName, O_RDWR | O_CREAT, 0600);
+	}
+
+	if (ms->fd < 0)
+	{
+		fprintf(stderr, "Failed to open shared ECS\n");
+		exit(1);
+	}
+
+	oldBytes = fstat(ms->fd, &s) == 0 ? static_cast<u64>(s.st_size) : 0;
+	if (oldBytes < bytes && ftruncate(ms->fd, bytes) != 0)
+	{
+		fprintf(stderr, "Failed to size shared ECS\n");
+		exit(1);
+	}
+
+	p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, ms->fd, 0);
+	ms->mem = p == MAP_FAILED ? nullptr : static_cast<CpWord*>(p);
+#endif
+
+	if (ms->mem == nullptr)
+	{
+		fprintf(stderr, "Failed to map shared ECS\n");
+		exit(1);
+	}
+
+	ms->mapped = *fileName != '\0';
+	ms->pageKB = memStorePageKB();
+	ms->node = -1;
+	sharedStore = ms;
+
+	/*
+	**  Only the creator may clear a backing file of the wrong size.
+	*/
+	if (ms->shareCreator && oldBytes != 0 && oldBytes < bytes && ms->mapped)
+	{
+		printf("Unexpected length of %s backing file, clearing %s\n", ms->name, ms->name);
+		memset(ms->mem, 0, static_cast<size_t>(bytes));
+	}
+
+	printf("%s shared as '%s' (%s)\n", ms->name, shareName, ms->shareCreator ? "created" : "attached");
+
+	/*
+	**  Wait until the creator has loaded, cleared or restored the
+	**  contents.
+	*/
+	if (!ms->shareCreator && ms->share->ready == 0)
+	{
+		printf("Waiting for process %ld to initialise %s\n", static_cast<long>(ms->share->creator), ms->name);
+		while (ms->share->ready == 0)
+		{
+			if (!memStoreAlive(ms->share->creator))
+			{
+				fprintf(stderr, "Process %ld which created shared %s exited before initialising it\n",
+					static_cast<long>(ms->share->creator), ms->name);
+				exit(1);
+			}
+
+#if defined(_WIN32)
+			Sleep(ShareWaitMs);
+#else
+			usleep(ShareWaitMs * 1000);
+#endif
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Enter this process in the list of processes using a
+**                  shared segment. Entries of processes which no longer
+**                  run, e.g. because they crashed, are dropped first. If
+**                  no other process is left this one becomes the creator
+**                  and starts the segment afresh. Called with the share
+**                  locked.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreShareJoin(MemStore *ms)
+{
+	EcsShare *sp = ms->share;
+	int live = 0;
+	int slot = -1;
+
+#if defined(_WIN32)
+	i32 self = static_cast<i32>(GetCurrentProcessId());
+#else
+	i32 self = static_cast<i32>(getpid());
+#endif
+
+	for (int i = 0; i < MaxEcsSharers; i++)
+	{
+		if (sp->pid[i] != 0 && !memStoreAlive(sp->pid[i]))
+		{
+			sp->pid[i] = 0;
+		}
+
+		if (sp->pid[i] != 0)
+		{
+			live += 1;
+		}
+		else if (slot < 0)
+		{
+			slot = i;
+		}
+	}
+
+	if (slot < 0)
+	{
+		fprintf(stderr, "More than %d processes share ECS '%s'\n", MaxEcsSharers, shareName);
+		exit(1);
+	}
+
+	ms->shareCreator = live == 0;
+	if (ms->shareCreator)
+	{
+		sp->flagRegister = 0;
+		sp->ready = 0;
+		sp->words = static_cast<i32>(ms->words);
+		sp->creator = self;
+	}
+	else if (static_cast<u32>(sp->words) != ms->words)
+	{
+		fprintf(stderr, "ECS size differs from the other processes sharing '%s'\n", shareName);
+		exit(1);
+	}
+
+	sp->pid[slot] = self;
+	ms->shareSlot = slot;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Detach from the shared ECS segment. The last process
+**                  to detach removes the segments.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreUnshare(MemStore *ms)
+{
+	if (ms->mapped)
+	{
+		memStoreFlush(ms);
+	}
+
+	memStoreShareLock(ms);
+	ms->share->pid[ms->shareSlot] = 0;
+
+#if defined(_WIN32)
+	memStoreShareUnlock(ms);
+
+	/*
+	**  Named mappings go away with their last handle.
+	*/
+	UnmapViewOfFile(ms->mem);
+	CloseHandle(ms->mapHandle);
+	if (ms->fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(ms->fileHandle);
+	}
+
+	UnmapViewOfFile(ms->share);
+	CloseHandle(ms->shareHandle);
+	CloseHandle(ms->shareLock);
+#else
+	char objName[80];
+	u64 bytes = static_cast<u64>(ms->words) * sizeof(CpWord);
+	bool last = true;
+
+	for (int i = 0; i < MaxEcsSharers; i++)
+	{
+		if (ms->share->pid[i] != 0 && memStoreAlive(ms->share->pid[i]))
+		{
+			last = false;
+		}
+	}
+
+	munmap(ms->mem, bytes);
+	close(ms->fd);
+	munmap(ms->share, sizeof(EcsShare));
+
+	/*
+	**  Still locked, so no process attaches to the segments meanwhile.
+	*/
+	if (last)
+	{
+		sprintf(objName, "/CppCyber_%s_flags", shareName);
+		shm_unlink(objName);
+		if (!ms->mapped)
+		{
+			sprintf(objName, "/CppCyber_%s_ecs", shareName);
+			shm_unlink(objName);
+		}
+	}
+
+	memStoreShareUnlock(ms);
+	close(ms->shareFd);
+#endif
+
+	ms->share = nullptr;
+	sharedStore = nullptr;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Lock the shared segment against other processes
+**                  attaching or detaching. The host drops the lock of a
+**                  process which dies.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreShareLock(MemStore *ms)
+{
+#if defined(_WIN32)
+	/*
+	**  WAIT_ABANDONED also hands over the lock.
+	*/
+	WaitForSingleObject(ms->shareLock, INFINITE);
+#else
+	while (flock(ms->shareFd, LOCK_EX) != 0 && errno == EINTR)
+	{
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unlock the shared segment.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreShareUnlock(MemStore *ms)
+{
+#if defined(_WIN32)
+	ReleaseMutex(ms->shareLock);
+#else
+	flock(ms->shareFd, LOCK_UN);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Tell whether a process is still running.
+**
+**  Parameters:     Name        Description.
+**                  pid         process ID
+**
+**  Returns:        true if it runs.
+**
+**------------------------------------------------------------------------*/
+static bool memStoreAlive(i32 pid)
+{
+#if defined(_WIN32)
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+	if (process == nullptr)
+	{
+		return(GetLastError() == ERROR_ACCESS_DENIED);
+	}
+
+	bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+
+	return(alive);
+#else
+	return(kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate memory and read its contents from a backing
+**                  file, creating the file if it does not exist.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**                  fileName    backing file path
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreRead(MemStore *ms, char *fileName)
+{
+	ms->mem = memStoreAlloc(ms);
+	if (ms->mem == nullptr)
+	{
+		return;
+	}
+
+	/*
+	**  Try to open existing file.
+	*/
+	ms->fcb = fopen(fileName, "r+b");
+	if (ms->fcb != nullptr)
+	{
+		/*
+		**  Read contents.
+		*/
+		if (fread(ms->mem, sizeof(CpWord), ms->words, ms->fcb) != ms->words)
+		{
+			printf("Unexpected length of %s backing file, clearing %s\n", ms->name, ms->name);
+			memset(ms->mem, 0, ms->words * sizeof(CpWord));
+		}
+	}
+	else
+	{
+		/*
+		**  Create a new file.
+		*/
+		ms->fcb = fopen(fileName, "w+b");
+		if (ms->fcb == nullptr)
+		{
+			fprintf(stderr, "Failed to create %s backing file\n", ms->name);
+			exit(1);
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write dirty pages of a mapped store and wait until
+**                  they reach the disk.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreFlush(MemStore *ms)
+{
+#if defined(_WIN32)
+	if (!FlushViewOfFile(ms->mem, 0) || !FlushFileBuffers(ms->fileHandle))
+	{
+		fprintf(stderr, "Error writing %s backing file\n", ms->name);
+	}
+#else
+	if (msync(ms->mem, ms->words * sizeof(CpWord), MS_SYNC) != 0)
+	{
+		fprintf(stderr, "Error writing %s backing file\n", ms->name);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate zeroed memory for a store which is not mapped,
+**                  on huge pages and on the store's NUMA node if asked
+**                  for. Falls back to normal pages, and to calloc when
+**                  neither option is in use.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Pointer to memory or nullptr.
+**
+**------------------------------------------------------------------------*/
+static CpWord *memStoreAlloc(MemStore *ms)
+{
+	u64 bytes = static_cast<u64>(ms->words) * sizeof(CpWord);
+	void *p = nullptr;
+
+	ms->pageKB = memStorePageKB();
+	ms->allocBytes = 0;
+
+	if ((hugePageMB == 0 && ms->node < 0) || bytes == 0)
+	{
+		return static_cast<CpWord*>(calloc(ms->words, sizeof(CpWord)));
+	}
+
+#if defined(_WIN32)
+	DWORD node = ms->node < 0 ? NUMA_NO_PREFERRED_NODE : static_cast<DWORD>(ms->node);
+
+	if (hugePageMB != 0)
+	{
+		/*
+		**  Windows offers only its large page minimum (2 MB on x64).
+		*/
+		u64 large = GetLargePageMinimum();
+		if (large != 0)
+		{
+			u64 rounded = (bytes + large - 1) & ~(large - 1);
+			p = VirtualAllocExNuma(GetCurrentProcess(), nullptr, static_cast<SIZE_T>(rounded),
+				MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+			if (p != nullptr)
+			{
+				ms->allocBytes = rounded;
+				ms->pageKB = static_cast<u32>(large / 1024);
+			}
+		}
+
+		if (p == nullptr)
+		{
+			printf("%s: huge pages not available, using normal pages\n", ms->name);
+		}
+	}
+
+	if (p == nullptr)
+	{
+		p = VirtualAllocExNuma(GetCurrentProcess(), nullptr, static_cast<SIZE_T>(bytes),
+			MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+		ms->allocBytes = bytes;
+	}
+#else
+	if (hugePageMB != 0)
+	{
+#if defined(MAP_HUGETLB)
+		u64 huge = static_cast<u64>(hugePageMB) << 20;
+		u64 rounded = (bytes + huge - 1) & ~(huge - 1);
+		int sizeBits = hugePageMB == 1024 ? 30 : 21;
+
+		p = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (sizeBits << MAP_HUGE_SHIFT), -1, 0);
+		if (p == MAP_FAILED)
+		{
+			p = nullptr;
+		}
+		else
+		{
+			ms->allocBytes = rounded;
+			ms->pageKB = hugePageMB * 1024;
+		}
+#endif
+	}
+
+	if (p == nullptr)
+	{
+		p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		ms->allocBytes = bytes;
+
+		if (hugePageMB != 0)
+		{
+#if defined(MADV_HUGEPAGE)
+			printf("%s: no reserved huge pages, %s\n", ms->name,
+				madvise(p, bytes, MADV_HUGEPAGE) == 0 ? "asked for transparent huge pages" : "using normal pages");
+#else
+			printf("%s: huge pages not available, using normal pages\n", ms->name);
+#endif
+		}
+	}
+
+#if defined(__linux__)
+	/*
+	**  Nothing has been touched yet, so the policy decides where every
+	**  page will live.
+	*/
+	if (ms->node >= 0)
+	{
+		unsigned long mask = 1UL << ms->node;
+		if (syscall(SYS_mbind, p, ms->allocBytes, MemPolicyPreferred, &mask, sizeof(mask) * 8, 0) != 0)
+		{
+			ms->node = -1;
+		}
+	}
+#else
+	ms->node = -1;
+#endif
+#endif
+
+	return static_cast<CpWord*>(p);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release memory obtained by memStoreAlloc.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreRelease(MemStore *ms)
+{
+	if (ms->allocBytes == 0)
+	{
+		free(ms->mem);
+		return;
+	}
+
+#if defined(_WIN32)
+	VirtualFree(ms->mem, 0, MEM_RELEASE);
+#else
+	munmap(ms->mem, ms->allocBytes);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the normal host page size.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Page size in KB.
+**
+**------------------------------------------------------------------------*/
+static u32 memStorePageKB()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwPageSize / 1024;
+#else
+	return static_cast<u32>(sysconf(_SC_PAGESIZE) / 1024);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Make sure the process may use huge pages. Windows
+**                  needs the "Lock pages in memory" privilege enabled;
+**                  elsewhere availability is only known when allocating.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        false if huge pages can not be used.
+**
+**------------------------------------------------------------------------*/
+static bool memStoreEnableLargePages()
+{
+#if defined(_WIN32)
+	HANDLE token;
+	TOKEN_PRIVILEGES tp;
+
+	if (GetLargePageMinimum() == 0 || !OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+	{
+		return false;
+	}
+
+	tp.PrivilegeCount = 1;
+	tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool ok = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &tp.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &tp, 0, nullptr, nullptr)
+		&& GetLastError() == ERROR_SUCCESS;
+
+	CloseHandle(token);
+	return ok;
+#else
+	return true;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Count the host's NUMA nodes.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Number of nodes, 1 if unknown.
+**
+**------------------------------------------------------------------------*/
+static int memStoreNodeCount()
+{
+#if defined(_WIN32)
+	ULONG highest;
+
+	if (!GetNumaHighestNodeNumber(&highest))
+	{
+		return 1;
+	}
+
+	return static_cast<int>(highest) + 1;
+#elif defined(__linux__)
+	char fileName[80];
+	struct stat s;
+	int count = 0;
+
+	for (;;)
+	{
+		sprintf(fileName, "/sys/devices/system/node/node%d", count);
+		if (stat(fileName, &s) != 0)
+		{
+			break;
+		}
+
+		count += 1;
+	}
+
+	return count == 0 ? 1 : count;
+#else
+	return 1;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take a checkpoint: ask every mainframe for a cut, wait
+**                  until all have copied their dirty pages and write those
+**                  pages to the checkpoint files.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreCheckpoint()
+{
+	u32 pages = 0;
+
+	EnterCriticalSection(&storeMutex);
+
+	cutAbandoned = false;
+	cutsOutstanding = BigIron->initMainFrames;
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		BigIron->chasis[k]->checkpointCut = true;
+	}
+
+	while (cutsOutstanding > 0 && !cutAbandoned && BigIron->emulationActive)
+	{
+		SleepConditionVariableCS(&cutDone, &storeMutex, 1000);
+	}
+
+	if (cutsOutstanding > 0 || cutAbandoned)
+	{
+		LeaveCriticalSection(&storeMutex);
+		return;
+	}
+
+	/*
+	**  Pages are updated in place, so the file written next is marked
+	**  incomplete until it holds this checkpoint. The other file keeps
+	**  the previous one.
+	*/
+	i64 taken = static_cast<i64>(time(nullptr));
+	bool ok = true;
+
+	for (int i = 0; i < storeCount; i++)
+	{
+		if (stores[i]->ckpFcb[0] != nullptr && !memStoreCkpHeader(stores[i], false, 0))
+		{
+			ok = false;
+		}
+	}
+
+	for (int i = 0; i < storeCount; i++)
+	{
+		MemStore *ms = stores[i];
+		if (ms->ckpFcb[0] == nullptr)
+		{
+			continue;
+		}
+
+		FILE *fcb = ms->ckpFcb[ms->ckpSlot];
+		FILE *prev = ms->ckpFcb[ms->ckpSlot ^ 1];
+
+		for (u32 n = 0; ok && n < ms->stageCount; n++)
+		{
+			ok = memStoreCkpPage(ms, fcb, ms->stagePage[n], ms->stage + (n << MemPageShift));
+			ms->ckpBehind[ms->stagePage[n]] = 2;
+		}
+
+		/*
+		**  Pages which the previous checkpoint wrote and this one did
+		**  not are unchanged since, copy them from the other file.
+		*/
+		CpWord page[MemPageWords];
+		for (u32 n = 0; ok && n < ms->pages; n++)
+		{
+			if (ms->ckpBehind[n] == 1)
+			{
+				u32 words = ms->words - (n << MemPageShift);
+				if (words > MemPageWords)
+				{
+					words = MemPageWords;
+				}
+
+				ok = fseek(prev, CkpDataOffset + static_cast<long>(n) * MemPageWords * sizeof(CpWord), SEEK_SET) == 0
+					&& fread(page, sizeof(CpWord), words, prev) == words
+					&& memStoreCkpPage(ms, fcb, n, page);
+			}
+		}
+
+		/*
+		**  The other file lacks what this checkpoint wrote.
+		*/
+		for (u32 n = 0; n < ms->pages; n++)
+		{
+			ms->ckpBehind[n] = ms->ckpBehind[n] == 2 ? 1 : 0;
+		}
+
+		if (!memStoreCkpSync(fcb))
+		{
+			ok = false;
+		}
+
+		pages += ms->stageCount;
+		ms->stageCount = 0;
+	}
+
+	/*
+	**  A failed write leaves the file marked incomplete and it is
+	**  written again next time. Every page is marked dirty so that
+	**  checkpoint writes a whole image.
+	*/
+	checkpointSequence += 1;
+	for (int i = 0; i < storeCount; i++)
+	{
+		MemStore *ms = stores[i];
+		if (ms->ckpFcb[0] == nullptr)
+		{
+			continue;
+		}
+
+		if (!ok)
+		{
+			memset(ms->dirty, 1, ms->pages);
+			memset(ms->ckpBehind, 1, ms->pages);
+		}
+		else if (memStoreCkpHeader(ms, true, taken))
+		{
+			ms->ckpSlot ^= 1;
+		}
+	}
+
+	checkpointPages = pages;
+	checkpointCount += 1;
+
+	LeaveCriticalSection(&storeMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Copy the dirty pages of a store aside and clear them.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreStage(MemStore *ms)
+{
+	u32 count = 0;
+
+	for (u32 page = 0; page < ms->pages; page++)
+	{
+		if (ms->dirty[page] == 0)
+		{
+			continue;
+		}
+
+		ms->dirty[page] = 0;
+
+		if (count == ms->stageSize)
+		{
+			/*
+			**  Grow the staging area, to the whole store at most.
+			*/
+			u32 size = count == 0 ? 64 : count * 2;
+			if (size > ms->pages)
+			{
+				size = ms->pages;
+			}
+
+			ms->stage = static_cast<CpWord*>(realloc(ms->stage, static_cast<size_t>(size) * MemPageWords * sizeof(CpWord)));
+			ms->stagePage = static_cast<u32*>(realloc(ms->stagePage, size * sizeof(u32)));
+			if (ms->stage == nullptr || ms->stagePage == nullptr)
+			{
+				fprintf(stderr, "Failed to allocate %s checkpoint staging area\n", ms->name);
+				exit(1);
+			}
+
+			ms->stageSize = size;
+		}
+
+		u32 words = ms->words - (page << MemPageShift);
+		if (words > MemPageWords)
+		{
+			words = MemPageWords;
+		}
+
+		memcpy(ms->stage + (count << MemPageShift), ms->mem + (page << MemPageShift), words * sizeof(CpWord));
+		ms->stagePage[count++] = page;
+	}
+
+	ms->stageCount = count;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Give up the current checkpoint because a mainframe did
+**                  not reach its cut in time. Pages already copied are
+**                  marked dirty again for the next checkpoint. Caller
+**                  holds storeMutex.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreAbandon()
+{
+	cutAbandoned = true;
+	cutAbandonCount += 1;
+
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		BigIron->chasis[k]->checkpointCut = false;
+	}
+
+	for (int i = 0; i < storeCount; i++)
+	{
+		MemStore *ms = stores[i];
+		for (u32 n = 0; n < ms->stageCount; n++)
+		{
+			ms->dirty[ms->stagePage[n]] = 1;
+		}
+
+		ms->stageCount = 0;
+	}
+
+	WakeAllConditionVariable(&cutDone);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the header of the checkpoint file written next
+**                  and wait until it is on disk.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**                  complete    true if the file holds a whole checkpoint
+**                  taken       time of that checkpoint
+**
+**  Returns:        true if written.
+**
+**------------------------------------------------------------------------*/
+static bool memStoreCkpHeader(MemStore *ms, bool complete, i64 taken)
+{
+	CkpHeader header;
+	FILE *fcb = ms->ckpFcb[ms->ckpSlot];
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, CkpMagic);
+	header.version = CkpVersion;
+	header.words = ms->words;
+	header.complete = complete ? 1 : 0;
+	header.sequence = complete ? checkpointSequence : 0;
+	header.taken = taken;
+
+	if (fseek(fcb, 0, SEEK_SET) != 0
+		|| fwrite(&header, sizeof(header), 1, fcb) != 1
+		|| !memStoreCkpSync(fcb))
+	{
+		fprintf(stderr, "Error writing %s checkpoint file\n", ms->name);
+		return(false);
+	}
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write one page to a checkpoint file.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**                  fcb         checkpoint file
+**                  page        page number
+**                  data        page contents
+**
+**  Returns:        true if written.
+**
+**------------------------------------------------------------------------*/
+static bool memStoreCkpPage(MemStore *ms, FILE *fcb, u32 page, CpWord *data)
+{
+	u32 words = ms->words - (page << MemPageShift);
+	if (words > MemPageWords)
+	{
+		words = MemPageWords;
+	}
+
+	if (fseek(fcb, CkpDataOffset + static_cast<long>(page) * MemPageWords * sizeof(CpWord), SEEK_SET) != 0
+		|| fwrite(data, sizeof(CpWord), words, fcb) != words)
+	{
+		fprintf(stderr, "Error writing %s checkpoint file\n", ms->name);
+		return(false);
+	}
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write a checkpoint file's buffers and wait until the
+**                  host has it on disk.
+**
+**  Parameters:     Name        Description.
+**                  fcb         checkpoint file
+**
+**  Returns:        true if successful.
+**
+**------------------------------------------------------------------------*/
+static bool memStoreCkpSync(FILE *fcb)
+{
+	if (fflush(fcb) != 0)
+	{
+		return(false);
+	}
+
+#if defined(_WIN32)
+	return(_commit(_fileno(fcb)) == 0);
+#else
+	return(fsync(fileno(fcb)) == 0);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the newest complete checkpoint of a store of this
+**                  size and, if restoring, load the store from it. The
+**                  other checkpoint file is written next. Stores restored
+**                  from different checkpoints are reported.
+**
+**  Parameters:     Name        Description.
+**                  ms          store descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreRestore(MemStore *ms)
+{
+	CkpHeader header[2];
+	int newest = -1;
+
+	for (int slot = 0; slot < 2; slot++)
+	{
+		if (fseek(ms->ckpFcb[slot], 0, SEEK_SET) == 0
+			&& fread(&header[slot], sizeof(header[slot]), 1, ms->ckpFcb[slot]) == 1
+			&& memcmp(header[slot].magic, CkpMagic, sizeof(CkpMagic)) == 0
+			&& header[slot].version == CkpVersion
+			&& header[slot].words == ms->words
+			&& header[slot].complete == 1
+			&& (newest < 0 || header[slot].sequence > header[newest].sequence))
+		{
+			newest = slot;
+		}
+	}
+
+	if (newest < 0)
+	{
+		ms->ckpSlot = 0;
+		if (checkpointRestore)
+		{
+			printf("%s has no complete checkpoint of this store, not restored\n", ms->name);
+		}
+
+		return;
+	}
+
+	ms->ckpSlot = newest ^ 1;
+	if (header[newest].sequence > checkpointSequence)
+	{
+		checkpointSequence = header[newest].sequence;
+	}
+
+	if (!checkpointRestore)
+	{
+		return;
+	}
+
+	FILE *fcb = ms->ckpFcb[newest];
+	if (fseek(fcb, CkpDataOffset, SEEK_SET) != 0
+		|| fread(ms->mem, sizeof(CpWord), ms->words, fcb) != ms->words)
+	{
+		fprintf(stderr, "Error reading %s checkpoint file\n", ms->name);
+		exit(1);
+	}
+
+	time_t taken = static_cast<time_t>(header[newest].taken);
+	printf("%s restored from checkpoint of %s", ms->name, ctime(&taken));
+
+	if (checkpointRestored != 0 && checkpointRestored != header[newest].taken)
+	{
+		printf("Warning: %s was restored from a different checkpoint than the stores before it\n", ms->name);
+	}
+
+	checkpointRestored = header[newest].taken;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create backing store thread.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void memStoreCreateThread()
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(memStoreThread),
+		static_cast<LPVOID>(nullptr),                               // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create backing store thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	rc = pthread_create(&thread, &attr, memStoreThread, NULL);
+	if (rc < 0)
+	{
+		fprintf(stderr, "Failed to create backing store thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Backing store thread. Wakes once a second to notice
+**                  shutdown, syncs every syncSeconds and checkpoints every
+**                  checkpointSeconds.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void memStoreThread(void *param)
+#else
+static void *memStoreThread(void *param)
+#endif
+{
+	u32 seconds = 0;
+	u32 checkpointTimer = 0;
+
+	(void)param;
+
+	while (BigIron->emulationActive)
+	{
+#if defined(_WIN32)
+		Sleep(1000);
+#else
+		sleep(1);
+#endif
+		if (!BigIron->emulationActive)
+		{
+			break;
+		}
+
+		if (checkpointSeconds != 0 && ++checkpointTimer >= checkpointSeconds)
+		{
+			memStoreCheckpoint();
+			checkpointTimer = 0;
+		}
+
+		if (syncSeconds != 0 && ++seconds >= syncSeconds)
+		{
+			memStoreSync();
+			seconds = 0;
+		}
+	}
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*---------------------------  End Of File  ------------------------------*/
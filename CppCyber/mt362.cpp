@@ -170,6 +170,11 @@ typedef struct tapeParam
 	PpWord      recordLength;
 	PpWord      ioBuffer[MaxPpBuf];
 	PpWord      *bp;
+
+	/*
+	**  TAP container.
+	*/
+	TapFile     *tap;
 } TapeParam;
 
 /*
@@ -189,7 +194,7 @@ static void mt362xFuncRead(u8 mfrId);
 static void mt362xFuncReadBkw(u8 mfrId);
 static void mt362xFuncForespace(u8 mfrId);
 static void mt362xFuncBackspace(u8 mfrId);
-static void mt362xPackAndConvert(u32 recLen, u8 mfrId);
+static void mt362xPackAndConvert(u8 *data, u32 recLen, u8 mfrId);
 static void mt362xUnload(TapeParam *tp, u8 mfrId);
 static char *mt362xFunc2String(PpWord funcCode);
 
@@ -378,6 +383,7 @@ static void mt362xInit(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceN
 		}
 
 		dp->fcb[unitNo] = fcb;
+		tp->tap = tapOpen(fcb, deviceName, MaxByteBuf);
 
 		tp->blockNo = 0;
 		tp->unitReady = true;
@@ -520,6 +526,8 @@ void mt362xLoadTape(char *params)
 		return;
 	}
 
+	tp->tap = tapOpen(fcb, str, MaxByteBuf);
+
 	/*
 	**  Setup show_tape path name.
 	*/
@@ -608,6 +616,8 @@ void mt362xUnloadTape(char *params)
 	/*
 	**  Close the file.
 	*/
+	tapClose(tp->tap);
+	tp->tap = nullptr;
 	fclose(dp->fcb[unitNo]);
 	dp->fcb[unitNo] = nullptr;
 
@@ -738,7 +748,7 @@ static void mt362xSetupStatus(TapeParam *tp, u8 mfrId)
 		{
 			if (tp->unitReady)
 			{
-				if (ftell(mfr->active3000Device->fcb[mfr->active3000Device->selectedUnit]) > MaxTapeSize)
+				if (tapPosition(tp->tap) > MaxTapeSize)
 				{
 					tp->endOfTape = true;
 				}
@@ -897,7 +907,7 @@ static FcStatus mt362xFunc(PpWord funcCode, u8 mfrId)
 		if (tp->unitReady)
 		{
 			mt362xResetStatus(tp);
-			fseek(mfr->active3000Device->fcb[unitNo], 0, SEEK_SET);
+			tapRewind(tp->tap);
 			if (tp->blockNo != 0)
 			{
 				if (!tp->rewinding)
@@ -920,6 +930,8 @@ static FcStatus mt362xFunc(PpWord funcCode, u8 mfrId)
 			tp->blockNo = 0;
 			tp->unitReady = false;
 			tp->ringIn = false;
+			tapClose(tp->tap);
+			tp->tap = nullptr;
 			fclose(mfr->active3000Device->fcb[unitNo]);
 			mfr->active3000Device->fcb[unitNo] = nullptr;
 			tp->endOfOperation = true;
@@ -987,23 +999,12 @@ static FcStatus mt362xFunc(PpWord funcCode, u8 mfrId)
 			mt362xResetStatus(tp);
 			tp->blockNo += 1;
 
-			/*
-			**  The following fseek makes fwrite behave as desired after an fread.
-			*/
-			fseek(mfr->active3000Device->fcb[unitNo], 0, SEEK_CUR);
-
 			/*
 			**  Write a TAP tape mark.
 			*/
-			u32 recLen1 = 0;
-			fwrite(&recLen1, sizeof(recLen1), 1, mfr->active3000Device->fcb[unitNo]);
+			tapWrite(tp->tap, nullptr, 0);
 			tp->fileMark = true;
 
-			/*
-			**  The following fseek prepares for any subsequent fread.
-			*/
-			fseek(mfr->active3000Device->fcb[unitNo], 0, SEEK_CUR);
-
 			tp->endOfOperation = true;
 			tp->intStatus |= Int362xEndOfOp;
 		}
@@ -1308,7 +1309,7 @@ static void mt362xDisconnect(u8 mfrId)
 {
 	TapeParam *tp;
 	u32 i;
-	u64 recLen1;
+	u32 recLen1;
 
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
@@ -1344,11 +1345,10 @@ static void mt362xDisconnect(u8 mfrId)
 			return;
 		}
 
-		FILE *fcb = mfr->active3000Device->fcb[unitNo];
 		tp->bp = tp->ioBuffer;
 		// ReSharper disable once CppInitializedValueIsAlwaysRewritten
-		u64 recLen0 = 0;
-		u64 recLen2 = mfr->active3000Device->recordLength;
+		u32 recLen0 = 0;
+		u32 recLen2 = mfr->active3000Device->recordLength;
 		PpWord *ip = tp->ioBuffer;
 		u8 *rp = rawBuffer;
 
@@ -1367,20 +1367,16 @@ static void mt362xDisconnect(u8 mfrId)
 					ip += 1;
 				}
 
-				recLen0 = rp - rawBuffer;
+				recLen0 = static_cast<u32>(rp - rawBuffer);
 			}
 			else
 			{
 				/*
 				**  No conversion, just unpack.
 				*/
-				for (i = 0; i < recLen2; i += 2)
-				{
-					*rp++ = ((ip[0] >> 4) & 0xFF);
-					*rp++ = ((ip[0] << 4) & 0xF0) | ((ip[1] >> 8) & 0x0F);
-					*rp++ = ((ip[1] >> 0) & 0xFF);
-					ip += 2;
-				}
+				i = (recLen2 + 1) / 2;
+				bitpack12To8(ip, rp, i);
+				rp += i * 3;
 
 				/*
 				**  Calculate the actual length.
@@ -1414,45 +1410,17 @@ static void mt362xDisconnect(u8 mfrId)
 				/*
 				**  No conversion, just unpack.
 				*/
-				for (i = 0; i < recLen2; i++)
-				{
-					*rp++ = ((*ip >> 6) & Mask6);
-					*rp++ = ((*ip >> 0) & Mask6);
-					ip += 1;
-				}
+				bitpack12To6(ip, rp, recLen2);
+				rp += recLen2 * 2;
 			}
 
-			recLen0 = rp - rawBuffer;
+			recLen0 = static_cast<u32>(rp - rawBuffer);
 		}
 
-		/*
-		** The TAP record length is little endian - convert if necessary.
-		*/
-		if (BigIron->bigEndian)
-		{
-			recLen1 = MSystem::ConvertEndian(static_cast<u32>(recLen0));
-		}
-		else
-		{
-			recLen1 = recLen0;
-		}
-
-		/*
-		**  The following fseek makes fwrite behave as desired after an fread.
-		*/
-		fseek(fcb, 0, SEEK_CUR);
-
 		/*
 		**  Write the TAP record.
 		*/
-		fwrite(&recLen1, sizeof(recLen1), 1, fcb);
-		fwrite(&rawBuffer, 1, recLen0, fcb);
-		fwrite(&recLen1, sizeof(recLen1), 1, fcb);
-
-		/*
-		**  The following fseek prepares for any subsequent fread.
-		*/
-		fseek(fcb, 0, SEEK_CUR);
+		tapWrite(tp->tap, rawBuffer, recLen0);
 
 		/*
 		**  Writing completed.
@@ -1480,10 +1448,7 @@ static void mt362xDisconnect(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt362xFuncRead(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
+	u8 *data;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->active3000Device->selectedUnit;
@@ -1493,18 +1458,11 @@ static void mt362xFuncRead(u8 mfrId)
 	tp->recordLength = 0;
 
 	/*
-	**  Determine if the tape is at the load point.
+	**  Read the next TAP record.
 	*/
-	// ReSharper disable once CppUseAuto
-	// ReSharper disable once CppEntityNeverUsed
-	i32 position = ftell(mfr->active3000Device->fcb[unitNo]);
+	i32 recLen = tapRead(tp->tap, &data);
 
-	/*
-	**  Read and verify TAP record length header.
-	*/
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->active3000Device->fcb[unitNo]));
-
-	if (len != 1)
+	if (recLen == TapEof)
 	{
 		tp->intStatus |= Int362xEndOfOp;
 		tp->endOfOperation = true;
@@ -1517,31 +1475,15 @@ static void mt362xFuncRead(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->intStatus |= Int362xError | Int362xEndOfOp;
 		tp->parityError = true;
 		tp->endOfOperation = true;
 		return;
 	}
 
-	if (recLen1 == 0)
+	if (recLen == TapMark)
 	{
 		/*
 		**  Report a tape mark and return.
@@ -1557,73 +1499,16 @@ static void mt362xFuncRead(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  Read and verify the actual raw data.
-	*/
-	len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->active3000Device->fcb[unitNo]));
-
-	if (recLen1 != static_cast<u32>(len))
-	{
-		logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-		tp->intStatus |= Int362xError | Int362xEndOfOp;
-		tp->parityError = true;
-		tp->endOfOperation = true;
-		return;
-	}
-
-	/*
-	**  Read and verify the TAP record length trailer.
-	*/
-	len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->active3000Device->fcb[unitNo]));
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->intStatus |= Int362xError | Int362xEndOfOp;
-		tp->parityError = true;
-		tp->endOfOperation = true;
-		return;
-	}
-
-	if (recLen0 != recLen2)
-	{
-		/*
-		**  This is some weird shit to deal with "padded" TAP records. My brain refuses to understand
-		**  why anyone would have the precise length of a record and then make the reader guess what
-		**  the real length is.
-		*/
-		if (BigIron->bigEndian)
-		{
-			/*
-			**  The TAP record length is little endian - convert if necessary.
-			*/
-			recLen2 = MSystem::ConvertEndian(recLen2);
-		}
-
-		if (recLen1 == ((recLen2 >> 8) & 0xFFFFFF))
-		{
-			fseek(mfr->active3000Device->fcb[unitNo], 1, SEEK_CUR);
-		}
-		else
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %d", mfr->activeChannel->id, recLen2);
-			tp->intStatus |= Int362xError | Int362xEndOfOp;
-			tp->parityError = true;
-			tp->endOfOperation = true;
-			return;
-		}
-	}
-
 	/*
 	**  Convert the raw data into PP words suitable for a channel.
 	*/
-	mt362xPackAndConvert(recLen1, mfrId);
+	mt362xPackAndConvert(data, recLen, mfrId);
 
 	/*
 	**  Setup length, buffer pointer and block number.
 	*/
 #if DEBUG
-	fprintf(mt362xLog, "Read fwd %d PP words (%d 8-bit bytes)\n", active3000Device->recordLength, recLen1);
+	fprintf(mt362xLog, "Read fwd %d PP words (%d 8-bit bytes)\n", active3000Device->recordLength, recLen);
 #endif
 
 	tp->recordLength = mfr->active3000Device->recordLength;
@@ -1641,10 +1526,7 @@ static void mt362xFuncRead(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt362xFuncReadBkw(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
+	u8 *data;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->active3000Device->selectedUnit;
@@ -1654,130 +1536,42 @@ static void mt362xFuncReadBkw(u8 mfrId)
 	tp->recordLength = 0;
 
 	/*
-	**  Check if we are already at the beginning of the tape.
+	**  Read the previous TAP record, which leaves the tape positioned
+	**  at its header.
 	*/
-	i32 position = ftell(mfr->active3000Device->fcb[unitNo]);
-	if (position == 0)
+	i32 recLen = tapReadBackward(tp->tap, &data);
+
+	if (recLen == TapBot)
 	{
+		/*
+		**  We are already at the beginning of the tape.
+		*/
 		tp->blockNo = 0;
 		tp->intStatus |= Int362xEndOfOp;
 		tp->endOfOperation = true;
 		return;
 	}
 
-	/*
-	**  Position to the previous record's trailer and read the length
-	**  of the record (leaving the file position ahead of the just read
-	**  record trailer).
-	*/
-	fseek(mfr->active3000Device->fcb[unitNo], -4, SEEK_CUR);
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->active3000Device->fcb[unitNo]));
-	fseek(mfr->active3000Device->fcb[unitNo], -4, SEEK_CUR);
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->intStatus |= Int362xError | Int362xEndOfOp;
-		tp->parityError = true;
-		tp->endOfOperation = true;
-		return;
-	}
-
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->intStatus |= Int362xError | Int362xEndOfOp;
 		tp->parityError = true;
 		tp->endOfOperation = true;
 		return;
 	}
 
-	position -= 4;
-	if (recLen1 != 0)
+	if (recLen != TapMark)
 	{
-		/*
-		**  Skip backward over the TAP record body and header.
-		*/
-		position -= 4 + recLen1;
-		fseek(mfr->active3000Device->fcb[unitNo], position, SEEK_SET);
-
-		/*
-		**  Read and verify the TAP record header.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->active3000Device->fcb[unitNo]));
-
-		if (len != 1)
-		{
-			logError(LogErrorLocation, "channel %02o - missing TAP record header", mfr->activeChannel->id);
-			tp->intStatus |= Int362xError | Int362xEndOfOp;
-			tp->parityError = true;
-			tp->endOfOperation = true;
-			return;
-		}
-
-		if (recLen0 != recLen2)
-		{
-			/*
-			**  This is more weird shit to deal with "padded" TAP records.
-			*/
-			position -= 1;
-			fseek(mfr->active3000Device->fcb[unitNo], position, SEEK_SET);
-			len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->active3000Device->fcb[unitNo]));
-
-			if (len != 1 || recLen0 != recLen2)
-			{
-				logError(LogErrorLocation, "channel %02o - invalid record length2: %d %08X != %08X", mfr->activeChannel->id, len, recLen0, recLen2);
-				tp->intStatus |= Int362xError | Int362xEndOfOp;
-				tp->parityError = true;
-				tp->endOfOperation = true;
-				return;
-			}
-		}
-
-		/*
-		**  Read and verify the actual raw data.
-		*/
-		len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->active3000Device->fcb[unitNo]));
-
-		if (recLen1 != static_cast<u32>(len))
-		{
-			logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-			tp->intStatus |= Int362xError | Int362xEndOfOp;
-			tp->parityError = true;
-			tp->endOfOperation = true;
-			return;
-		}
-
-		/*
-		**  Position to the TAP record header.
-		*/
-		fseek(mfr->active3000Device->fcb[unitNo], position, SEEK_SET);
-
 		/*
 		**  Convert the raw data into PP words suitable for a channel.
 		*/
-		mt362xPackAndConvert(recLen1, mfrId);
+		mt362xPackAndConvert(data, recLen, mfrId);
 
 		/*
 		**  Setup length and buffer pointer.
 		*/
 #if DEBUG
-		fprintf(mt362xLog, "Read bkwd %d PP words (%d 8-bit bytes)\n", active3000Device->recordLength, recLen1);
+		fprintf(mt362xLog, "Read bkwd %d PP words (%d 8-bit bytes)\n", active3000Device->recordLength, recLen);
 #endif
 
 		tp->recordLength = mfr->active3000Device->recordLength;
@@ -1800,7 +1594,7 @@ static void mt362xFuncReadBkw(u8 mfrId)
 	/*
 	**  Set block number.
 	*/
-	if (position == 0)
+	if (tapPosition(tp->tap) == 0)
 	{
 		tp->blockNo = 0;
 	}
@@ -1820,27 +1614,17 @@ static void mt362xFuncReadBkw(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt362xFuncForespace(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->active3000Device->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->active3000Device->context[unitNo]);
 
 	/*
-	**  Determine if the tape is at the load point.
-	*/
-	// ReSharper disable once CppEntityNeverUsed
-	i32 position = ftell(mfr->active3000Device->fcb[unitNo]);
-
-	/*
-	**  Read and verify TAP record length header.
+	**  Skip the next TAP record.
 	*/
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->active3000Device->fcb[unitNo]));
+	i32 recLen = tapRead(tp->tap, nullptr);
 
-	if (len != 1)
+	if (recLen == TapEof)
 	{
 		tp->intStatus |= Int362xEndOfOp;
 		tp->endOfOperation = true;
@@ -1851,30 +1635,15 @@ static void mt362xFuncForespace(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
+	if (recLen == TapError)
 	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
-	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
+		tp->intStatus |= Int362xError | Int362xEndOfOp;
 		tp->parityError = true;
 		tp->endOfOperation = true;
 		return;
 	}
 
-	if (recLen1 == 0)
+	if (recLen == TapMark)
 	{
 		/*
 		**  Report a tape mark and return.
@@ -1890,61 +1659,6 @@ static void mt362xFuncForespace(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  Skip the actual raw data.
-	*/
-	if (fseek(mfr->active3000Device->fcb[unitNo], recLen1, SEEK_CUR) != 0)
-	{
-		logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-		tp->intStatus |= Int362xError | Int362xEndOfOp;
-		tp->parityError = true;
-		tp->endOfOperation = true;
-		return;
-	}
-
-	/*
-	**  Read and verify the TAP record length trailer.
-	*/
-	len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->active3000Device->fcb[unitNo]));
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->intStatus |= Int362xError | Int362xEndOfOp;
-		tp->parityError = true;
-		tp->endOfOperation = true;
-		return;
-	}
-
-	if (recLen0 != recLen2)
-	{
-		/*
-		**  This is some weird shit to deal with "padded" TAP records. My brain refuses to understand
-		**  why anyone would have the precise length of a record and then make the reader guess what
-		**  the real length is.
-		*/
-		if (BigIron->bigEndian)
-		{
-			/*
-			**  The TAP record length is little endian - convert if necessary.
-			*/
-			recLen2 = MSystem::ConvertEndian(recLen2);
-		}
-
-		if (recLen1 == ((recLen2 >> 8) & 0xFFFFFF))
-		{
-			fseek(mfr->active3000Device->fcb[unitNo], 1, SEEK_CUR);
-		}
-		else
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %d", mfr->activeChannel->id, recLen2);
-			tp->intStatus |= Int362xError | Int362xEndOfOp;
-			tp->parityError = true;
-			tp->endOfOperation = true;
-			return;
-		}
-	}
-
 	tp->blockNo += 1;
 }
 
@@ -1958,117 +1672,36 @@ static void mt362xFuncForespace(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt362xFuncBackspace(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->active3000Device->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->active3000Device->context[unitNo]);
 
 	/*
-	**  Check if we are already at the beginning of the tape.
+	**  Position to the previous TAP record header.
 	*/
-	i32 position = ftell(mfr->active3000Device->fcb[unitNo]);
-	if (position == 0)
+	i32 recLen = tapReadBackward(tp->tap, nullptr);
+
+	if (recLen == TapBot)
 	{
+		/*
+		**  We are already at the beginning of the tape.
+		*/
 		tp->intStatus |= Int362xEndOfOp;
 		tp->endOfOperation = true;
 		tp->blockNo = 0;
 		return;
 	}
 
-	/*
-	**  Position to the previous record's trailer and read the length
-	**  of the record (leaving the file position ahead of the just read
-	**  record trailer).
-	*/
-	fseek(mfr->active3000Device->fcb[unitNo], -4, SEEK_CUR);
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->active3000Device->fcb[unitNo]));
-	fseek(mfr->active3000Device->fcb[unitNo], -4, SEEK_CUR);
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->intStatus |= Int362xError | Int362xEndOfOp;
-		tp->parityError = true;
-		tp->endOfOperation = true;
-		return;
-	}
-
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->intStatus |= Int362xError | Int362xEndOfOp;
 		tp->parityError = true;
 		tp->endOfOperation = true;
 		return;
 	}
 
-	position -= 4;
-	if (recLen1 != 0)
-	{
-		/*
-		**  Skip backward over the TAP record body and header.
-		*/
-		position -= 4 + recLen1;
-		fseek(mfr->active3000Device->fcb[unitNo], position, SEEK_SET);
-
-		/*
-		**  Read and verify the TAP record header.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->active3000Device->fcb[unitNo]));
-
-		if (len != 1)
-		{
-			logError(LogErrorLocation, "channel %02o - missing TAP record header", mfr->activeChannel->id);
-			tp->intStatus |= Int362xError | Int362xEndOfOp;
-			tp->parityError = true;
-			tp->endOfOperation = true;
-			return;
-		}
-
-		if (recLen0 != recLen2)
-		{
-			/*
-			**  This is more weird shit to deal with "padded" TAP records.
-			*/
-			position -= 1;
-			fseek(mfr->active3000Device->fcb[unitNo], position, SEEK_SET);
-			len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->active3000Device->fcb[unitNo]));
-
-			if (len != 1 || recLen0 != recLen2)
-			{
-				logError(LogErrorLocation, "channel %02o - invalid record length2: %d %08X != %08X", mfr->activeChannel->id, len, recLen0, recLen2);
-				tp->intStatus |= Int362xError | Int362xEndOfOp;
-				tp->parityError = true;
-				tp->endOfOperation = true;
-				return;
-			}
-		}
-
-		/*
-		**  Position to the TAP record header.
-		*/
-		fseek(mfr->active3000Device->fcb[unitNo], position, SEEK_SET);
-	}
-	else
+	if (recLen == TapMark)
 	{
 		/*
 		**  A tape mark consists of only a single TAP record header of zero.
@@ -2085,7 +1718,7 @@ static void mt362xFuncBackspace(u8 mfrId)
 	/*
 	**  Set block number.
 	*/
-	if (position == 0)
+	if (tapPosition(tp->tap) == 0)
 	{
 		tp->blockNo = 0;
 	}
@@ -2099,12 +1732,13 @@ static void mt362xFuncBackspace(u8 mfrId)
 **  Purpose:        Pack and convert 8 bit frames read into channel data.
 **
 **  Parameters:     Name        Description.
+**                  data        record data
 **                  recLen      read tape record length
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void mt362xPackAndConvert(u32 recLen, u8 mfrId)
+static void mt362xPackAndConvert(u8 *data, u32 recLen, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 	i8 unitNo = mfr->active3000Device->selectedUnit;
@@ -2115,44 +1749,36 @@ static void mt362xPackAndConvert(u32 recLen, u8 mfrId)
 	**  Convert the raw data into PP words suitable for a channel.
 	*/
 	u16 *op = tp->ioBuffer;
-	u8 *rp = rawBuffer;
+	u8 *rp = data;
 
 	if (tp->bcdMode)
 	{
-		/*
-		**  Pad.
-		*/
-		rawBuffer[recLen] = 0;
-
-		for (i = 0; i < recLen; i += 2)
+		for (i = 0; i + 1 < recLen; i += 2)
 		{
 			*op++ = (static_cast<PpWord>(asciiToBcd[rp[0]]) << 6) | (static_cast<PpWord>(asciiToBcd[rp[1]]) << 0);
 			rp += 2;
 		}
 
+		if (i < recLen)
+		{
+			/*
+			**  Odd trailing character is padded with a zero byte.
+			*/
+			*op++ = (static_cast<PpWord>(asciiToBcd[rp[0]]) << 6) | (static_cast<PpWord>(asciiToBcd[0]) << 0);
+		}
+
 		mfr->active3000Device->recordLength = static_cast<PpWord>(op - tp->ioBuffer);
 	}
 	else
 	{
 		if (tp->tracks == 9)
 		{
-			/*
-			**  Pad.
-			*/
-			rawBuffer[recLen] = 0;
-
 			/*
 			**  Convert the raw data into PP Word data.
 			*/
-			for (i = 0; i < recLen; i += 3)
-			{
-				u16 c1 = *rp++;
-				u16 c2 = *rp++;
-				u16 c3 = *rp++;
-
-				*op++ = ((c1 << 4) | (c2 >> 4)) & Mask12;
-				*op++ = ((c2 << 8) | (c3 >> 0)) & Mask12;
-			}
+			i = (recLen + 2) / 3;
+			bitpack8To12Bytes(rp, op, recLen, 0);
+			op += i * 2;
 
 			/*
 			**  Now calculate the number of PP words.
@@ -2166,16 +1792,9 @@ static void mt362xPackAndConvert(u32 recLen, u8 mfrId)
 		}
 		else
 		{
-			/*
-			**  Pad.
-			*/
-			rawBuffer[recLen] = 0;
-
-			for (i = 0; i < recLen; i += 2)
-			{
-				*op++ = (static_cast<PpWord>(rp[0] & Mask6) << 6) | (static_cast<PpWord>(rp[1] & Mask6) << 0);
-				rp += 2;
-			}
+			i = (recLen + 1) / 2;
+			bitpack6To12Bytes(rp, op, recLen);
+			op += i;
 
 			mfr->active3000Device->recordLength = static_cast<PpWord>(op - tp->ioBuffer);
 		}
@@ -2201,6 +1820,8 @@ static void mt362xUnload(TapeParam *tp, u8 mfrId)
 	tp->ringIn = false;
 	tp->endOfOperation = true;
 	i8 unitNo = mfr->active3000Device->selectedUnit;
+	tapClose(tp->tap);
+	tp->tap = nullptr;
 	fclose(mfr->active3000Device->fcb[unitNo]);
 	mfr->active3000Device->fcb[unitNo] = nullptr;
 }
@@ -115,6 +115,7 @@ typedef struct tapeBuf
 {
 	PpWord      ioBuffer[MaxPpBuf];
 	PpWord      *bp;
+	TapFile     *tap;
 } TapeBuf;
 
 /*
@@ -139,7 +140,6 @@ static char *mt607Func2String(PpWord funcCode);
 **  Private Variables
 **  -----------------
 */
-static u8 rawBuffer[MaxByteBuf];
 
 #if DEBUG
 static FILE *mt607Log = nullptr;
@@ -220,6 +220,8 @@ void mt607Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 		exit(1);
 	}
 
+	static_cast<TapeBuf *>(dp->context[unitNo])->tap = tapOpen(dp->fcb[unitNo], fname, MaxByteBuf);
+
 	/*
 	**  Print a friendly message.
 	*/
@@ -237,10 +239,6 @@ void mt607Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 **------------------------------------------------------------------------*/
 static FcStatus mt607Func(PpWord funcCode, u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 #if DEBUG
@@ -273,7 +271,7 @@ static FcStatus mt607Func(PpWord funcCode, u8 mfrId)
 
 	case Fc607Rewind:
 		mfr->activeDevice->fcode = 0;
-		fseek(mfr->activeDevice->fcb[mfr->activeDevice->selectedUnit], 0, SEEK_SET);
+		tapRewind(static_cast<TapeBuf *>(mfr->activeDevice->context[mfr->activeDevice->selectedUnit])->tap);
 		break;
 
 	case Fc607StatusReq:
@@ -306,30 +304,19 @@ static FcStatus mt607Func(PpWord funcCode, u8 mfrId)
 		tp->bp = tp->ioBuffer;
 
 		/*
-		**  Read and verify TAP record length header.
+		**  Read the next TAP record.
 		*/
-		u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[mfr->activeDevice->selectedUnit]));
+		u8 *data;
+		i32 recLen = tapRead(tp->tap, &data);
 
-		if (len != 1)
+		if (recLen == TapEof)
 		{
 			mfr->activeChannel->status = St607EOT;
 			mfr->activeDevice->recordLength = 0;
 			break;
 		}
 
-		/*
-		**  The TAP record length is little endian - convert if necessary.
-		*/
-		if (BigIron->bigEndian)
-		{
-			recLen1 = MSystem::ConvertEndian(recLen0);
-		}
-		else
-		{
-			recLen1 = recLen0;
-		}
-
-		if (recLen1 == 0)
+		if (recLen == TapMark)
 		{
 			mfr->activeDevice->recordLength = 0;
 #if DEBUG
@@ -338,35 +325,8 @@ static FcStatus mt607Func(PpWord funcCode, u8 mfrId)
 			break;
 		}
 
-		if (recLen1 > MaxByteBuf)
-		{
-			logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
-			mfr->activeChannel->status = St607NotReadyMask;
-			mfr->activeDevice->recordLength = 0;
-			break;
-		}
-
-		/*
-		**  Read and verify the actual raw data.
-		*/
-		len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->activeDevice->fcb[mfr->activeDevice->selectedUnit]));
-
-		if (recLen1 != static_cast<u32>(len))
+		if (recLen == TapError)
 		{
-			logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-			mfr->activeChannel->status = St607NotReadyMask;
-			mfr->activeDevice->recordLength = 0;
-			break;
-		}
-
-		/*
-		**  Read and verify the TAP record length trailer.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[mfr->activeDevice->selectedUnit]));
-
-		if (len != 1 || recLen0 != recLen2)
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %08x", mfr->activeChannel->id, recLen2);
 			mfr->activeChannel->status = St607NotReadyMask;
 			mfr->activeDevice->recordLength = 0;
 			break;
@@ -376,23 +336,16 @@ static FcStatus mt607Func(PpWord funcCode, u8 mfrId)
 		**  Convert the raw data into PP words suitable for a channel.
 		*/
 		u16 *op = tp->ioBuffer;
-		u8 *rp = rawBuffer;
 
-		for (u32 i = 0; i < recLen1; i += 3)
-		{
-			u16 c1 = *rp++;
-			u16 c2 = *rp++;
-			u16 c3 = *rp++;
-
-			*op++ = ((c1 << 4) | (c2 >> 4)) & Mask12;
-			*op++ = ((c2 << 8) | (c3 >> 0)) & Mask12;
-		}
+		u32 groups = (recLen + 2) / 3;
+		bitpack8To12Bytes(data, op, recLen, 0);
+		op += groups * 2;
 
 		mfr->activeDevice->recordLength = static_cast<PpWord>(op - tp->ioBuffer);
 		mfr->activeChannel->status = St607Ready;
 
 #if DEBUG
-		fprintf(mt607Log, "Read fwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen1);
+		fprintf(mt607Log, "Read fwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen);
 #endif
 		break;
 	}
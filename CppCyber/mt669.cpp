@@ -268,6 +268,7 @@ typedef struct tapeParam
 	PpWord      recordLength;
 	PpWord      ioBuffer[MaxPpBuf];
 	PpWord      *bp;
+	TapFile     *tap;
 } TapeParam;
 
 /*
@@ -284,7 +285,8 @@ static FcStatus mt669Func(PpWord funcCode, u8 mfrId);
 static void mt669Io(u8 mfrId);
 static void mt669Activate(u8 mfrId);
 static void mt669Disconnect(u8 mfrId);
-static void mt669PackAndConvert(u32 recLen, u8 mfId);
+static void mt669Snapshot(DevSlot *ds, FILE *fcb, bool restore);
+static void mt669PackAndConvert(u8 *data, u32 recLen, u8 mfId);
 static void mt669FuncRead(u8 mfId);
 static void mt669FuncForespace(u8 mfId);
 static void mt669FuncBackspace(u8 mfId);
@@ -350,6 +352,7 @@ void mt669Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	*/
 	dp->activate = mt669Activate;
 	dp->disconnect = mt669Disconnect;
+	dp->snapshot = mt669Snapshot;
 	dp->func = mt669Func;
 	dp->io = mt669Io;
 	dp->selectedUnit = -1;
@@ -442,6 +445,7 @@ void mt669Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 		}
 
 		dp->fcb[unitNo] = fcb;
+		tp->tap = tapOpen(fcb, deviceName, MaxByteBuf);
 
 		tp->blockNo = 0;
 		tp->unitReady = true;
@@ -616,6 +620,7 @@ void mt669LoadTape(char *params)
 	**  Setup show_tape path name.
 	*/
 	strncpy(tp->fileName, str, _MAX_PATH);
+	tp->tap = tapOpen(fcb, str, MaxByteBuf);
 
 	/*
 	**  Setup status.
@@ -701,6 +706,8 @@ void mt669UnloadTape(char *params)
 	/*
 	**  Close the file.
 	*/
+	tapClose(tp->tap);
+	tp->tap = nullptr;
 	fclose(dp->fcb[unitNo]);
 	dp->fcb[unitNo] = nullptr;
 
@@ -849,7 +856,7 @@ static void mt669SetupGeneralStatus(TapeParam *tp, u8 mfrId)
 		if (tp->unitReady)
 		{
 			cp->deviceStatus[1] |= St669Ready;
-			if (ftell(mfr->activeDevice->fcb[mfr->activeDevice->selectedUnit]) > MaxTapeSize)
+			if (tapPosition(tp->tap) > MaxTapeSize)
 			{
 				cp->deviceStatus[1] |= St669EOT;
 			}
@@ -1125,7 +1132,7 @@ static FcStatus mt669Func(PpWord funcCode, u8 mfrId)
 		if (unitNo != -1 && tp->unitReady)
 		{
 			mt669ResetStatus(tp);
-			fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_SET);
+			tapRewind(tp->tap);
 			if (tp->blockNo != 0)
 			{
 				if (!tp->rewinding)
@@ -1145,6 +1152,8 @@ static FcStatus mt669Func(PpWord funcCode, u8 mfrId)
 			tp->blockNo = 0;
 			tp->unitReady = false;
 			tp->ringIn = false;
+			tapClose(tp->tap);
+			tp->tap = nullptr;
 			fclose(mfr->activeDevice->fcb[unitNo]);
 			mfr->activeDevice->fcb[unitNo] = nullptr;
 		}
@@ -1154,24 +1163,38 @@ static FcStatus mt669Func(PpWord funcCode, u8 mfrId)
 	case Fc669SearchTapeMarkF:
 		if (unitNo != -1 && tp->unitReady)
 		{
+			u32 passed;
 			mt669ResetStatus(tp);
 
-			do
+			bool found = tapSearchMark(tp->tap, true, &passed, &tp->fileMark);
+			tp->blockNo += passed;
+			if (!found)
 			{
-				mt669FuncForespace(mfrId);
-			} while (!tp->fileMark && !tp->endOfTape && !tp->alert);
+				do
+				{
+					mt669FuncForespace(mfrId);
+				} while (!tp->fileMark && !tp->endOfTape && !tp->alert);
+			}
 		}
 		return(FcProcessed);
 
 	case Fc669SearchTapeMarkB:
 		if (unitNo != -1 && tp->unitReady)
 		{
+			u32 passed;
 			mt669ResetStatus(tp);
 
-			do
+			if (tapSearchMark(tp->tap, false, &passed, &tp->fileMark))
+			{
+				tp->blockNo = tapPosition(tp->tap) == 0 ? 0 : tp->blockNo - passed;
+			}
+			else
 			{
-				mt669FuncBackspace(mfrId);
-			} while (!tp->fileMark && tp->blockNo != 0 && !tp->alert);
+				do
+				{
+					mt669FuncBackspace(mfrId);
+				} while (!tp->fileMark && tp->blockNo != 0 && !tp->alert);
+			}
 		}
 
 		if (tp->blockNo == 0)
@@ -1218,26 +1241,13 @@ static FcStatus mt669Func(PpWord funcCode, u8 mfrId)
 		{
 			mt669ResetStatus(tp);
 			tp->bp = tp->ioBuffer;
-			// ReSharper disable once CppEntityNeverUsed
-			i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
 			tp->blockNo += 1;
 
-			/*
-			**  The following fseek makes fwrite behave as desired after an fread.
-			*/
-			fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_CUR);
-
 			/*
 			**  Write a TAP tape mark.
 			*/
-			u32 recLen1 = 0;
-			fwrite(&recLen1, sizeof(recLen1), 1, mfr->activeDevice->fcb[unitNo]);
+			tapWrite(tp->tap, nullptr, 0);
 			tp->fileMark = true;
-
-			/*
-			**  The following fseek prepares for any subsequent fread.
-			*/
-			fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_CUR);
 		}
 
 		return(FcProcessed);
@@ -1423,7 +1433,7 @@ static FcStatus mt669Func(PpWord funcCode, u8 mfrId)
 
 		mt669ResetStatus(tp);
 		mfr->activeDevice->selectedUnit = unitNo;
-		fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_SET);
+		tapRewind(tp->tap);
 		tp->selectedConversion = 0;
 		tp->packedMode = true;
 		tp->blockNo = 0;
@@ -1835,7 +1845,6 @@ static void mt669Disconnect(u8 mfrId)
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
 	u32 i;
-	u64 recLen1;
 
 	/*
 	**  Abort pending device disconnects - the PP is doing the disconnect.
@@ -1862,10 +1871,9 @@ static void mt669Disconnect(u8 mfrId)
 		return;
 	}
 
-	FILE *fcb = mfr->activeDevice->fcb[unitNo];
 	tp->bp = tp->ioBuffer;
-	u64 recLen0 = 0;
-	u64 recLen2 = mfr->activeDevice->recordLength;
+	u32 recLen0 = 0;
+	u32 recLen2 = mfr->activeDevice->recordLength;
 	PpWord *ip = tp->ioBuffer;
 	u8 *rp = rawBuffer;
 	bool oddFrameCount = mfr->activeDevice->fcode == Fc669WriteOdd;
@@ -1877,13 +1885,9 @@ static void mt669Disconnect(u8 mfrId)
 		/*
 		**  No conversion, just unpack.
 		*/
-		for (i = 0; i < recLen2; i += 2)
-		{
-			*rp++ = ((ip[0] >> 4) & 0xFF);
-			*rp++ = ((ip[0] << 4) & 0xF0) | ((ip[1] >> 8) & 0x0F);
-			*rp++ = ((ip[1] >> 0) & 0xFF);
-			ip += 2;
-		}
+		i = (recLen2 + 1) / 2;
+		bitpack12To8(ip, rp, i);
+		rp += i * 3;
 
 		/*
 		**  Now implement the Mode 1 Write table on page B-6 of the
@@ -1923,16 +1927,10 @@ static void mt669Disconnect(u8 mfrId)
 		/*
 		**  Convert the channel data to appropriate character set.
 		*/
-		u8 *writeConv = cp->writeConv[tp->selectedConversion - 1];
-
-		for (i = 0; i < recLen2; i++)
-		{
-			*rp++ = writeConv[(*ip >> 6) & 077];
-			*rp++ = writeConv[(*ip >> 0) & 077];
-			ip += 1;
-		}
+		bitpackConvert12To8(ip, rp, recLen2, cp->writeConv[tp->selectedConversion - 1]);
+		rp += recLen2 * 2;
 
-		recLen0 = rp - rawBuffer;
+		recLen0 = static_cast<u32>(rp - rawBuffer);
 		if (oddFrameCount)
 		{
 			recLen0 -= 1;
@@ -1940,34 +1938,10 @@ static void mt669Disconnect(u8 mfrId)
 		break;
 	}
 
-	/*
-	** The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(static_cast<u32>(recLen0));
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  The following fseek makes fwrite behave as desired after an fread.
-	*/
-	fseek(fcb, 0, SEEK_CUR);
-
 	/*
 	**  Write the TAP record.
 	*/
-	fwrite(&recLen1, sizeof(recLen1), 1, fcb);
-	fwrite(&rawBuffer, 1, recLen0, fcb);
-	fwrite(&recLen1, sizeof(recLen1), 1, fcb);
-
-	/*
-	**  The following fseek prepares for any subsequent fread.
-	*/
-	fseek(fcb, 0, SEEK_CUR);
+	tapWrite(tp->tap, rawBuffer, recLen0);
 
 	/*
 	**  Writing completed.
@@ -1980,16 +1954,97 @@ static void mt669Disconnect(u8 mfrId)
 	tp->frameCount = 0;
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Save or restore the controller and tape unit state.
+**                  Mounted tapes are remounted from their file names on
+**                  restore; the channel then restores the file positions.
+**
+**  Parameters:     Name        Description.
+**                  ds          device slot
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void mt669Snapshot(DevSlot *ds, FILE *fcb, bool restore)
+{
+	CtrlParam *cp = static_cast<CtrlParam*>(ds->controllerContext);
+	FILE *convFileHandle = cp->convFileHandle;
+
+	snapshotData(fcb, cp, sizeof(CtrlParam), restore);
+	cp->convFileHandle = convFileHandle;
+
+	for (int unitNo = 0; unitNo < MaxUnits2; unitNo++)
+	{
+		TapeParam *tp = static_cast<TapeParam*>(ds->context[unitNo]);
+		if (tp == nullptr)
+		{
+			continue;
+		}
+
+		/*
+		**  Keep the parts of the unit context which belong to this run.
+		*/
+		TapeParam *nextTape = tp->nextTape;
+		u8 channelNo = tp->channelNo;
+		u8 eqNo = tp->eqNo;
+		bool loaded = ds->fcb[unitNo] != nullptr;
+		bool hasBp = tp->bp != nullptr;
+		i32 bpOffset = hasBp ? static_cast<i32>(tp->bp - tp->ioBuffer) : 0;
+		TapFile *tap = tp->tap;
+
+		SnapshotVar(fcb, loaded, restore);
+		SnapshotVar(fcb, hasBp, restore);
+		SnapshotVar(fcb, bpOffset, restore);
+		snapshotData(fcb, tp, sizeof(TapeParam), restore);
+
+		if (!restore)
+		{
+			continue;
+		}
+
+		tp->nextTape = nextTape;
+		tp->channelNo = channelNo;
+		tp->eqNo = eqNo;
+		tp->unitNo = static_cast<u8>(unitNo);
+		tp->bp = hasBp ? tp->ioBuffer + bpOffset : nullptr;
+		tp->tap = tap;
+
+		if (loaded && ds->fcb[unitNo] == nullptr)
+		{
+			ds->fcb[unitNo] = fopen(tp->fileName, tp->ringIn ? "r+b" : "rb");
+			if (ds->fcb[unitNo] == nullptr)
+			{
+				printf("Failed to remount %s on channel %o equipment %o unit %o\n", tp->fileName, channelNo, eqNo, unitNo);
+				tp->unitReady = false;
+			}
+			else
+			{
+				tp->tap = tapOpen(ds->fcb[unitNo], tp->fileName, MaxByteBuf);
+			}
+		}
+		else if (!loaded && ds->fcb[unitNo] != nullptr)
+		{
+			tapClose(tp->tap);
+			tp->tap = nullptr;
+			fclose(ds->fcb[unitNo]);
+			ds->fcb[unitNo] = nullptr;
+		}
+	}
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Pack and convert 8 bit frames read into channel data.
 **
 **  Parameters:     Name        Description.
+**                  data        read tape record
 **                  recLen      read tape record length
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void mt669PackAndConvert(u32 recLen, u8 mfrId)
+static void mt669PackAndConvert(u8 *data, u32 recLen, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
@@ -1997,7 +2052,6 @@ static void mt669PackAndConvert(u32 recLen, u8 mfrId)
 	TapeParam *tp = static_cast<TapeParam*>(mfr->activeDevice->context[unitNo]);
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
 	u32 i;
-	u16 c1;
 
 	/*
 	**  Determine odd count setting.
@@ -2008,7 +2062,7 @@ static void mt669PackAndConvert(u32 recLen, u8 mfrId)
 	**  Convert the raw data into PP words suitable for a channel.
 	*/
 	u16 *op = tp->ioBuffer;
-	u8 *rp = rawBuffer;
+	u8 *rp = data;
 
 	switch (tp->selectedConversion)
 	{
@@ -2022,24 +2076,14 @@ static void mt669PackAndConvert(u32 recLen, u8 mfrId)
 		**  7021-1/2 manual (60403900E). The fill byte is all 1's (see page
 		**  B-2).
 		*/
+		bitpack8To12Bytes(rp, op, recLen, 0xFF);
 		if (tp->oddCount)
 		{
-			rawBuffer[recLen] = 0xFF;
 			recLen += 1;
 		}
 
-		/*
-		**  Convert the raw data into PP Word data.
-		*/
-		for (i = 0; i < recLen; i += 3)
-		{
-			c1 = *rp++;
-			u16 c2 = *rp++;
-			u16 c3 = *rp++;
-
-			*op++ = ((c1 << 4) | (c2 >> 4)) & Mask12;
-			*op++ = ((c2 << 8) | (c3 >> 0)) & Mask12;
-		}
+		i = (recLen + 2) / 3;
+		op += i * 2;
 
 		/*
 		**  Now calculate the number of PP words taking into account the
@@ -2061,29 +2105,17 @@ static void mt669PackAndConvert(u32 recLen, u8 mfrId)
 		/*
 		**  Convert the Raw data to appropriate character set.
 		*/
-		u8 *readConv = cp->readConv[tp->selectedConversion - 1];
-		for (i = 0; i < recLen; i++)
+		if (bitpackConvert8To12(rp, op, recLen, cp->readConv[tp->selectedConversion - 1]))
 		{
-			c1 = readConv[*rp++];
-			if ((c1 & (1 << 6)) != 0)
-			{
-				/*
-				**  Indicate illegal character.
-				*/
-				tp->alert = true;
-				tp->flagBitDetected = true;
-			}
-
-			if ((i & 1) == 0)
-			{
-				*op = (c1 & Mask6) << 6;
-			}
-			else
-			{
-				*op++ |= c1 & Mask6;
-			}
+			/*
+			**  Indicate illegal character.
+			*/
+			tp->alert = true;
+			tp->flagBitDetected = true;
 		}
 
+		op += recLen / 2;
+
 		mfr->activeDevice->recordLength = static_cast<PpWord>(op - tp->ioBuffer);
 
 		if (tp->oddCount)
@@ -2104,10 +2136,7 @@ static void mt669PackAndConvert(u32 recLen, u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt669FuncRead(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
+	u8 *data;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 	i8 unitNo = mfr->activeDevice->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->activeDevice->context[unitNo]);
@@ -2118,16 +2147,16 @@ static void mt669FuncRead(u8 mfrId)
 	/*
 	**  Determine if the tape is at the load point.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
+	bool loadPoint = tapPosition(tp->tap) == 0;
 
 	/*
-	**  Read and verify TAP record length header.
+	**  Read the next TAP record.
 	*/
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
+	i32 recLen = tapRead(tp->tap, &data);
 
-	if (len != 1)
+	if (recLen == TapEof)
 	{
-		if (position == 0)
+		if (loadPoint)
 		{
 			tp->errorCode = EcBlankTape;
 		}
@@ -2143,30 +2172,14 @@ static void mt669FuncRead(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
+	if (recLen == TapError)
 	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
-	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcMiscUnitError;
 		return;
 	}
 
-	if (recLen1 == 0)
+	if (recLen == TapMark)
 	{
 		/*
 		**  Report a tape mark and return.
@@ -2180,73 +2193,19 @@ static void mt669FuncRead(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  Read and verify the actual raw data.
-	*/
-	len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->activeDevice->fcb[unitNo]));
-
-	if (recLen1 != static_cast<u32>(len))
-	{
-		logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-		tp->alert = true;
-		tp->errorCode = EcMiscUnitError;
-		return;
-	}
-
-	/*
-	**  Read and verify the TAP record length trailer.
-	*/
-	len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcMiscUnitError;
-		return;
-	}
-
-	if (recLen0 != recLen2)
-	{
-		/*
-		**  This is some weird shit to deal with "padded" TAP records. My brain refuses to understand
-		**  why anyone would have the precise length of a record and then make the reader guess what
-		**  the real length is.
-		*/
-		if (BigIron->bigEndian)
-		{
-			/*
-			**  The TAP record length is little endian - convert if necessary.
-			*/
-			recLen2 = MSystem::ConvertEndian(recLen2);
-		}
-
-		if (recLen1 == ((recLen2 >> 8) & 0xFFFFFF))
-		{
-			fseek(mfr->activeDevice->fcb[unitNo], 1, SEEK_CUR);
-		}
-		else
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %d", mfr->activeChannel->id, recLen2);
-			tp->alert = true;
-			tp->errorCode = EcMiscUnitError;
-			return;
-		}
-	}
-
 	/*
 	**  Convert the raw data into PP words suitable for a channel.
 	*/
-	mt669PackAndConvert(recLen1, mfrId);
+	mt669PackAndConvert(data, recLen, mfrId);
 
 	/*
 	**  Setup length, buffer pointer and block number.
 	*/
 #if DEBUG
-	fprintf(mt669Log, "Read fwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen1);
+	fprintf(mt669Log, "Read fwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen);
 #endif
 
-	tp->frameCount = static_cast<PpWord>(recLen1);
+	tp->frameCount = static_cast<PpWord>(recLen);
 	tp->recordLength = mfr->activeDevice->recordLength;
 	tp->bp = tp->ioBuffer;
 	tp->blockNo += 1;
@@ -2262,9 +2221,7 @@ static void mt669FuncRead(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt669FuncReadBkw(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
+	u8 *data;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 	i8 unitNo = mfr->activeDevice->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->activeDevice->context[unitNo]);
@@ -2273,127 +2230,43 @@ static void mt669FuncReadBkw(u8 mfrId)
 	tp->recordLength = 0;
 
 	/*
-	**  Check if we are already at the beginning of the tape.
+	**  Read the previous TAP record, which leaves the tape positioned
+	**  at its header.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
-	if (position == 0)
+	i32 recLen = tapReadBackward(tp->tap, &data);
+
+	if (recLen == TapBot)
 	{
+		/*
+		**  We are already at the beginning of the tape.
+		*/
 		tp->suppressBot = false;
 		tp->blockNo = 0;
 		return;
 	}
 
-	/*
-	**  Position to the previous record's trailer and read the length
-	**  of the record (leaving the file position ahead of the just read
-	**  record trailer).
-	*/
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcMiscUnitError;
-		return;
-	}
-
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcMiscUnitError;
 		return;
 	}
 
-	position -= 4;
-	if (recLen1 != 0)
+	if (recLen != TapMark)
 	{
-		/*
-		**  Skip backward over the TAP record body and header.
-		*/
-		position -= 4 + recLen1;
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-
-		/*
-		**  Read and verify the TAP record header.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-		if (len != 1)
-		{
-			logError(LogErrorLocation, "channel %02o - missing TAP record header", mfr->activeChannel->id);
-			tp->alert = true;
-			tp->errorCode = EcMiscUnitError;
-			return;
-		}
-
-		if (recLen0 != recLen2)
-		{
-			/*
-			**  This is more weird shit to deal with "padded" TAP records.
-			*/
-			position -= 1;
-			fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-			len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-			if (len != 1 || recLen0 != recLen2)
-			{
-				logError(LogErrorLocation, "channel %02o - invalid record length2: %d %08X != %08X", mfr->activeChannel->id, len, recLen0, recLen2);
-				tp->alert = true;
-				tp->errorCode = EcMiscUnitError;
-				return;
-			}
-		}
-
-		/*
-		**  Read and verify the actual raw data.
-		*/
-		len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->activeDevice->fcb[unitNo]));
-
-		if (recLen1 != static_cast<u32>(len))
-		{
-			logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-			tp->alert = true;
-			tp->errorCode = EcMiscUnitError;
-			return;
-		}
-
-		/*
-		**  Position to the TAP record header.
-		*/
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-
 		/*
 		**  Convert the raw data into PP words suitable for a channel.
 		*/
-		mt669PackAndConvert(recLen1, mfrId);
+		mt669PackAndConvert(data, recLen, mfrId);
 
 		/*
 		**  Setup length and buffer pointer.
 		*/
 #if DEBUG
-		fprintf(mt669Log, "Read bkwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen1);
+		fprintf(mt669Log, "Read bkwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen);
 #endif
 
-		tp->frameCount = static_cast<PpWord>(recLen1);
+		tp->frameCount = static_cast<PpWord>(recLen);
 		tp->recordLength = mfr->activeDevice->recordLength;
 		tp->bp = tp->ioBuffer + tp->recordLength - 1;
 	}
@@ -2412,7 +2285,7 @@ static void mt669FuncReadBkw(u8 mfrId)
 	/*
 	**  Set block number.
 	*/
-	if (position == 0)
+	if (tapPosition(tp->tap) == 0)
 	{
 		tp->suppressBot = true;
 		tp->blockNo = 0;
@@ -2433,9 +2306,6 @@ static void mt669FuncReadBkw(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt669FuncForespace(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
@@ -2444,16 +2314,16 @@ static void mt669FuncForespace(u8 mfrId)
 	/*
 	**  Determine if the tape is at the load point.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
+	bool loadPoint = tapPosition(tp->tap) == 0;
 
 	/*
-	**  Read and verify TAP record length header.
+	**  Skip the next TAP record.
 	*/
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
+	i32 recLen = tapRead(tp->tap, nullptr);
 
-	if (len != 1)
+	if (recLen == TapEof)
 	{
-		if (position == 0)
+		if (loadPoint)
 		{
 			tp->errorCode = EcBlankTape;
 		}
@@ -2469,93 +2339,23 @@ static void mt669FuncForespace(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcMiscUnitError;
 		return;
 	}
 
-	if (recLen1 == 0)
+	if (recLen == TapMark)
 	{
 		/*
-		**  Report a tape mark and return.
+		**  Report a tape mark.
 		*/
 		tp->fileMark = true;
-		tp->blockNo += 1;
 
 #if DEBUG
 		fprintf(mt669Log, "Tape mark\n");
 #endif
-		return;
-	}
-
-	/*
-	**  Skip the actual raw data.
-	*/
-	if (fseek(mfr->activeDevice->fcb[unitNo], recLen1, SEEK_CUR) != 0)
-	{
-		logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-		tp->alert = true;
-		tp->errorCode = EcMiscUnitError;
-		return;
-	}
-
-	/*
-	**  Read and verify the TAP record length trailer.
-	*/
-	len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcMiscUnitError;
-		return;
-	}
-
-	if (recLen0 != recLen2)
-	{
-		/*
-		**  This is some weird shit to deal with "padded" TAP records. My brain refuses to understand
-		**  why anyone would have the precise length of a record and then make the reader guess what
-		**  the real length is.
-		*/
-		if (BigIron->bigEndian)
-		{
-			/*
-			**  The TAP record length is little endian - convert if necessary.
-			*/
-			recLen2 = MSystem::ConvertEndian(recLen2);
-		}
-
-		if (recLen1 == ((recLen2 >> 8) & 0xFFFFFF))
-		{
-			fseek(mfr->activeDevice->fcb[unitNo], 1, SEEK_CUR);
-		}
-		else
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %d", mfr->activeChannel->id, recLen2);
-			tp->alert = true;
-			tp->errorCode = EcMiscUnitError;
-			return;
-		}
 	}
 
 	tp->blockNo += 1;
@@ -2571,110 +2371,33 @@ static void mt669FuncForespace(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt669FuncBackspace(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->activeDevice->context[unitNo]);
 
 	/*
-	**  Check if we are already at the beginning of the tape.
+	**  Position to the previous TAP record header.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
-	if (position == 0)
-	{
-		tp->blockNo = 0;
-		return;
-	}
-
-	/*
-	**  Position to the previous record's trailer and read the length
-	**  of the record (leaving the file position ahead of the just read
-	**  record trailer).
-	*/
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
+	i32 recLen = tapReadBackward(tp->tap, nullptr);
 
-	if (len != 1)
+	if (recLen == TapBot)
 	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcMiscUnitError;
+		/*
+		**  We are already at the beginning of the tape.
+		*/
+		tp->blockNo = 0;
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
+	if (recLen == TapError)
 	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
-	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcMiscUnitError;
 		return;
 	}
 
-	position -= 4;
-	if (recLen1 != 0)
-	{
-		/*
-		**  Skip backward over the TAP record body and header.
-		*/
-		position -= 4 + recLen1;
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-
-		/*
-		**  Read and verify the TAP record header.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-		if (len != 1)
-		{
-			logError(LogErrorLocation, "channel %02o - missing TAP record header", mfr->activeChannel->id);
-			tp->alert = true;
-			tp->errorCode = EcMiscUnitError;
-			return;
-		}
-
-		if (recLen0 != recLen2)
-		{
-			/*
-			**  This is more weird shit to deal with "padded" TAP records.
-			*/
-			position -= 1;
-			fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-			len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-			if (len != 1 || recLen0 != recLen2)
-			{
-				logError(LogErrorLocation, "channel %02o - invalid record length2: %d %08X != %08X", mfr->activeChannel->id, len, recLen0, recLen2);
-				tp->alert = true;
-				tp->errorCode = EcMiscUnitError;
-				return;
-			}
-		}
-
-		/*
-		**  Position to the TAP record header.
-		*/
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-	}
-	else
+	if (recLen == TapMark)
 	{
 		/*
 		**  A tape mark consists of only a single TAP record header of zero.
@@ -2689,7 +2412,7 @@ static void mt669FuncBackspace(u8 mfrId)
 	/*
 	**  Set block number.
 	*/
-	if (position == 0)
+	if (tapPosition(tp->tap) == 0)
 	{
 		tp->blockNo = 0;
 	}
@@ -171,6 +171,7 @@ typedef struct tapeParam
 	**  Info for show_tape operator command.
 	*/
 	struct tapeParam * nextTape;
+	u8          mfrId;
 	u8          channelNo;
 	u8          eqNo;
 	u8          unitNo;
@@ -197,6 +198,7 @@ typedef struct tapeParam
 	PpWord      deviceStatus[17];   // first element not used
 	PpWord      ioBuffer[MaxPpBuf];
 	PpWord      *bp;
+	TapFile     *tap;
 } TapeParam;
 
 /*
@@ -204,6 +206,7 @@ typedef struct tapeParam
 **  Private Function Prototypes
 **  ---------------------------
 */
+static bool mt679Mount(DevSlot *dp, u8 unitNo, char *fileName, bool ringIn);
 static void mt679ResetStatus(TapeParam *tp);
 static void mt679SetupStatus(TapeParam *tp, u8 mfrId);
 static void mt679PackConversionTable(u8 *convTable, u8 mfrId);
@@ -213,8 +216,9 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId);
 static void mt679Io(u8 mfrId);
 static void mt679Activate(u8 mfrId);
 static void mt679Disconnect(u8 mfrId);
+static void mt679Snapshot(DevSlot *ds, FILE *fcb, bool restore);
 static void mt679FlushWrite(u8 mfrId);
-static void mt679PackAndConvert(u32 recLen, u8 mfrId);
+static void mt679PackAndConvert(u8 *data, u32 recLen, u8 mfrId);
 static void mt679FuncRead(u8 mfrId);
 static void mt679FuncForespace(u8 mfrId);
 static void mt679FuncBackspace(u8 mfrId);
@@ -278,6 +282,7 @@ void mt679Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	*/
 	dp->activate = mt679Activate;
 	dp->disconnect = mt679Disconnect;
+	dp->snapshot = mt679Snapshot;
 	dp->func = mt679Func;
 	dp->io = mt679Io;
 	dp->selectedUnit = -1;
@@ -372,6 +377,7 @@ void mt679Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 		}
 
 		dp->fcb[unitNo] = fcb;
+		tp->tap = tapOpen(fcb, deviceName, MaxByteBuf);
 
 		tp->blockNo = 0;
 		tp->unitReady = true;
@@ -385,6 +391,7 @@ void mt679Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	/*
 	**  Setup show_tape values.
 	*/
+	tp->mfrId = mfrID;
 	tp->channelNo = channelNo;
 	tp->eqNo = eqNo;
 	tp->unitNo = unitNo;
@@ -447,7 +454,6 @@ void mt679LoadTape(char *params)
 	int equipmentNo;
 	int unitNo;
 	int mfrID;
-	FILE *fcb;
 	u8 unitMode;
 
 	/*
@@ -458,7 +464,7 @@ void mt679LoadTape(char *params)
 	/*
 	**  Check parameters.
 	*/
-	if (numParam != 5)
+	if (numParam != 6)
 	{
 		printf("Not enough or invalid parameters\n");
 		return;
@@ -516,47 +522,55 @@ void mt679LoadTape(char *params)
 		return;
 	}
 
-	/*
-	**  Open the file in the requested mode.
-	*/
-	if (unitMode == 'w')
+	if (!mt679Mount(dp, static_cast<u8>(unitNo), str, unitMode == 'w'))
 	{
-		fcb = fopen(str, "r+b");
-		if (fcb == nullptr)
-		{
-			fcb = fopen(str, "w+b");
-		}
-	}
-	else
-	{
-		fcb = fopen(str, "rb");
+		printf("Failed to open %s\n", str);
+		return;
 	}
 
-	dp->fcb[unitNo] = fcb;
+	printf("Successfully loaded %s\n", str);
+}
 
-	/*
-	**  Check if the open succeeded.
-	*/
-	if (fcb == nullptr)
+/*--------------------------------------------------------------------------
+**  Purpose:        Mount a tape on the first free unit of a mainframe
+**                  (tape library interface). Called on that mainframe's
+**                  PP thread.
+**
+**  Parameters:     Name        Description.
+**                  mfrId       mainframe
+**                  fileName    TAP container
+**                  ringIn      true to mount with write ring
+**
+**  Returns:        1 if mounted, 0 if no unit is free, -1 if the
+**                  container could not be opened.
+**
+**------------------------------------------------------------------------*/
+i8 mt679MountFree(u8 mfrId, char *fileName, bool ringIn)
+{
+	for (TapeParam *tp = firstTape; tp != nullptr; tp = tp->nextTape)
 	{
-		printf("Failed to open %s\n", str);
-		return;
-	}
+		if (tp->mfrId != mfrId || tp->unitReady)
+		{
+			continue;
+		}
 
-	/*
-	**  Setup show_tape path name.
-	*/
-	strncpy(tp->fileName, str, _MAX_PATH);
+		DevSlot *dp = channelFindDevice(tp->channelNo, DtMt679, tp->mfrId);
+		if (dp == nullptr || dp->fcb[tp->unitNo] != nullptr)
+		{
+			continue;
+		}
 
-	/*
-	**  Setup status.
-	*/
-	mt679ResetStatus(tp);
-	tp->ringIn = unitMode == 'w';
-	tp->blockNo = 0;
-	tp->unitReady = true;
+		if (!mt679Mount(dp, tp->unitNo, fileName, ringIn))
+		{
+			printf("\nFailed to open %s\n", fileName);
+			return(-1);
+		}
 
-	printf("Successfully loaded %s\n", str);
+		printf("\nLoaded %s on MT679 mainframe %o channel %o equipment %o unit %o\n", fileName, tp->mfrId, tp->channelNo, tp->eqNo, tp->unitNo);
+		return(1);
+	}
+
+	return(0);
 }
 
 /*--------------------------------------------------------------------------
@@ -583,7 +597,7 @@ void mt679UnloadTape(char *params)
 	/*
 	**  Check parameters.
 	*/
-	if (numParam != 3)
+	if (numParam != 4)
 	{
 		printf("Not enough or invalid parameters\n");
 		return;
@@ -632,8 +646,11 @@ void mt679UnloadTape(char *params)
 	/*
 	**  Close the file.
 	*/
+	tapClose(tp->tap);
+	tp->tap = nullptr;
 	fclose(dp->fcb[unitNo]);
 	dp->fcb[unitNo] = nullptr;
+	vtlRelease(tp->fileName);
 
 	/*
 	**  Clear show_tape path name.
@@ -690,6 +707,74 @@ void mt679ShowTapeStatus()
 **
 **--------------------------------------------------------------------------
 */
+/*--------------------------------------------------------------------------
+**  Purpose:        Mount a tape on an unloaded unit.
+**
+**  Parameters:     Name        Description.
+**                  dp          device slot
+**                  unitNo      unit number
+**                  fileName    TAP container
+**                  ringIn      true to mount with write ring
+**
+**  Returns:        TRUE if the container could be opened.
+**
+**------------------------------------------------------------------------*/
+static bool mt679Mount(DevSlot *dp, u8 unitNo, char *fileName, bool ringIn)
+{
+	FILE *fcb;
+	TapeParam *tp = static_cast<TapeParam *>(dp->context[unitNo]);
+
+	/*
+	**  Compressed containers can only be read.
+	*/
+	if (tapCompressed(fileName))
+	{
+		ringIn = false;
+	}
+
+	/*
+	**  Open the file in the requested mode.
+	*/
+	if (ringIn)
+	{
+		fcb = fopen(fileName, "r+b");
+		if (fcb == nullptr)
+		{
+			fcb = fopen(fileName, "w+b");
+		}
+	}
+	else
+	{
+		fcb = fopen(fileName, "rb");
+	}
+
+	dp->fcb[unitNo] = fcb;
+
+	/*
+	**  Check if the open succeeded.
+	*/
+	if (fcb == nullptr)
+	{
+		return(false);
+	}
+
+	/*
+	**  Setup show_tape path name.
+	*/
+	strncpy(tp->fileName, fileName, _MAX_PATH);
+	tp->tap = tapOpen(fcb, fileName, MaxByteBuf);
+
+	/*
+	**  Setup status.
+	*/
+	mt679ResetStatus(tp);
+	tp->ringIn = ringIn;
+	tp->blockNo = 0;
+	tp->unitReady = true;
+
+	return(true);
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Reset device status at start of new function.
 **
@@ -782,7 +867,7 @@ static void mt679SetupStatus(TapeParam *tp, u8 mfrId)
 		if (tp->unitReady)
 		{
 			tp->deviceStatus[1] |= St679Ready;
-			if (ftell(mfr->activeDevice->fcb[mfr->activeDevice->selectedUnit]) > MaxTapeSize)
+			if (tapPosition(tp->tap) > MaxTapeSize)
 			{
 				tp->deviceStatus[1] |= St679EOT;
 			}
@@ -882,19 +967,11 @@ static void mt679PackConversionTable(u8 *convTable, u8 mfrId)
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
-	PpWord *op = cp->packedConv;
-	u8 *ip = convTable;
+	PpWord *op = cp->packedConv + 85 * 2;
+	u8 *ip = convTable + 85 * 3;
 	u16 c1, c2;
 
-	for (int i = 0; i < 85; i++)
-	{
-		c1 = *ip++;
-		c2 = *ip++;
-		u16 c3 = *ip++;
-
-		*op++ = ((c1 << 4) | (c2 >> 4)) & Mask12;
-		*op++ = ((c2 << 8) | (c3 >> 0)) & Mask12;
-	}
+	bitpack8To12(convTable, cp->packedConv, 85);
 
 	// ReSharper disable once CppAssignedValueIsNeverUsed
 	c1 = *ip++;
@@ -918,6 +995,7 @@ static void mt679Pack6BitTable(u8 *convTable, u8 mfrId)
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
+
 	PpWord *op = cp->packedConv;
 	u8 *ip = convTable;
 
@@ -944,16 +1022,10 @@ static void mt679UnpackConversionTable(u8 *convTable, u8 mfrId)
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
-	PpWord *ip = cp->packedConv;
-	u8 *op = convTable;
+	PpWord *ip = cp->packedConv + 85 * 2;
+	u8 *op = convTable + 85 * 3;
 
-	for (int i = 0; i < 85; i++)
-	{
-		*op++ = ((ip[0] >> 4) & 0xFF);
-		*op++ = ((ip[0] << 4) & 0xF0) | ((ip[1] >> 8) & 0x0F);
-		*op++ = ((ip[1] >> 0) & 0xFF);
-		ip += 2;
-	}
+	bitpack12To8(cp->packedConv, convTable, 85);
 
 	// ReSharper disable once CppAssignedValueIsNeverUsed
 	*op++ = ((ip[0] >> 4) & 0xFF);    // discard last 4 bits
@@ -1036,6 +1108,13 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId)
 
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
 
+	/*
+	**  Mount any library tapes which are waiting for a free unit of
+	**  this mainframe, so the driver finds them on its next status
+	**  request.
+	*/
+	vtlPoll(mfrId);
+
 	i8 unitNo = mfr->activeDevice->selectedUnit;
 	if (unitNo != -1)
 	{
@@ -1139,7 +1218,7 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId)
 		if (unitNo != -1 && tp->unitReady)
 		{
 			mt679ResetStatus(tp);
-			fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_SET);
+			tapRewind(tp->tap);
 			if (tp->blockNo != 0)
 			{
 				if (!tp->rewinding)
@@ -1158,8 +1237,11 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId)
 			tp->blockNo = 0;
 			tp->unitReady = false;
 			tp->ringIn = false;
+			tapClose(tp->tap);
+			tp->tap = nullptr;
 			fclose(mfr->activeDevice->fcb[unitNo]);
 			mfr->activeDevice->fcb[unitNo] = nullptr;
+			vtlRelease(tp->fileName);
 		}
 		return(FcProcessed);
 
@@ -1207,24 +1289,38 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId)
 	case Fc679SearchTapeMarkF:
 		if (unitNo != -1 && tp->unitReady)
 		{
+			u32 passed;
 			mt679ResetStatus(tp);
 
-			do
+			bool found = tapSearchMark(tp->tap, true, &passed, &tp->fileMark);
+			tp->blockNo += passed;
+			if (!found)
 			{
-				mt679FuncForespace(mfrId);
-			} while (!tp->fileMark && !tp->endOfTape && !tp->alert);
+				do
+				{
+					mt679FuncForespace(mfrId);
+				} while (!tp->fileMark && !tp->endOfTape && !tp->alert);
+			}
 		}
 		return(FcProcessed);
 
 	case Fc679SearchTapeMarkB:
 		if (unitNo != -1 && tp->unitReady)
 		{
+			u32 passed;
 			mt679ResetStatus(tp);
 
-			do
+			if (tapSearchMark(tp->tap, false, &passed, &tp->fileMark))
+			{
+				tp->blockNo = tapPosition(tp->tap) == 0 ? 0 : tp->blockNo - passed;
+			}
+			else
 			{
-				mt679FuncBackspace(mfrId);
-			} while (!tp->fileMark && tp->blockNo != 0 && !tp->alert);
+				do
+				{
+					mt679FuncBackspace(mfrId);
+				} while (!tp->fileMark && tp->blockNo != 0 && !tp->alert);
+			}
 		}
 
 		if (tp->blockNo == 0)
@@ -1315,7 +1411,7 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId)
 
 		mt679ResetStatus(tp);
 		mfr->activeDevice->selectedUnit = unitNo;
-		fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_SET);
+		tapRewind(tp->tap);
 		cp->selectedConversion = 0;
 		cp->packedMode = true;
 		tp->blockNo = 0;
@@ -1401,26 +1497,13 @@ static FcStatus mt679Func(PpWord funcCode, u8 mfrId)
 		{
 			mt679ResetStatus(tp);
 			tp->bp = tp->ioBuffer;
-			// ReSharper disable once CppEntityNeverUsed
-			i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
 			tp->blockNo += 1;
 
-			/*
-			**  The following fseek makes fwrite behave as desired after an fread.
-			*/
-			fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_CUR);
-
 			/*
 			**  Write a TAP tape mark.
 			*/
-			u32 recLen1 = 0;
-			fwrite(&recLen1, sizeof(recLen1), 1, mfr->activeDevice->fcb[unitNo]);
+			tapWrite(tp->tap, nullptr, 0);
 			tp->fileMark = true;
-
-			/*
-			**  The following fseek prepares for any subsequent fread.
-			*/
-			fseek(mfr->activeDevice->fcb[unitNo], 0, SEEK_CUR);
 		}
 
 		return(FcProcessed);
@@ -1850,6 +1933,86 @@ static void mt679Disconnect(u8 mfrId)
 	}
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Save or restore the controller and tape unit state.
+**                  Mounted tapes are remounted from their file names on
+**                  restore; the channel then restores the file positions.
+**
+**  Parameters:     Name        Description.
+**                  ds          device slot
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void mt679Snapshot(DevSlot *ds, FILE *fcb, bool restore)
+{
+	CtrlParam *cp = static_cast<CtrlParam*>(ds->controllerContext);
+	FILE *convFileHandle = cp->convFileHandle;
+
+	snapshotData(fcb, cp, sizeof(CtrlParam), restore);
+	cp->convFileHandle = convFileHandle;
+
+	for (int unitNo = 0; unitNo < MaxUnits2; unitNo++)
+	{
+		TapeParam *tp = static_cast<TapeParam*>(ds->context[unitNo]);
+		if (tp == nullptr)
+		{
+			continue;
+		}
+
+		/*
+		**  Keep the parts of the unit context which belong to this run.
+		*/
+		TapeParam *nextTape = tp->nextTape;
+		u8 channelNo = tp->channelNo;
+		u8 eqNo = tp->eqNo;
+		bool loaded = ds->fcb[unitNo] != nullptr;
+		bool hasBp = tp->bp != nullptr;
+		i32 bpOffset = hasBp ? static_cast<i32>(tp->bp - tp->ioBuffer) : 0;
+		TapFile *tap = tp->tap;
+
+		SnapshotVar(fcb, loaded, restore);
+		SnapshotVar(fcb, hasBp, restore);
+		SnapshotVar(fcb, bpOffset, restore);
+		snapshotData(fcb, tp, sizeof(TapeParam), restore);
+
+		if (!restore)
+		{
+			continue;
+		}
+
+		tp->nextTape = nextTape;
+		tp->channelNo = channelNo;
+		tp->eqNo = eqNo;
+		tp->unitNo = static_cast<u8>(unitNo);
+		tp->bp = hasBp ? tp->ioBuffer + bpOffset : nullptr;
+		tp->tap = tap;
+
+		if (loaded && ds->fcb[unitNo] == nullptr)
+		{
+			ds->fcb[unitNo] = fopen(tp->fileName, tp->ringIn ? "r+b" : "rb");
+			if (ds->fcb[unitNo] == nullptr)
+			{
+				printf("Failed to remount %s on channel %o equipment %o unit %o\n", tp->fileName, channelNo, eqNo, unitNo);
+				tp->unitReady = false;
+			}
+			else
+			{
+				tp->tap = tapOpen(ds->fcb[unitNo], tp->fileName, MaxByteBuf);
+			}
+		}
+		else if (!loaded && ds->fcb[unitNo] != nullptr)
+		{
+			tapClose(tp->tap);
+			tp->tap = nullptr;
+			fclose(ds->fcb[unitNo]);
+			ds->fcb[unitNo] = nullptr;
+		}
+	}
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Flush accumulated write data.
 **
@@ -1864,7 +2027,6 @@ static void mt679FlushWrite(u8 mfrId)
 
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
 	u32 i;
-	u64 recLen1;
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->activeDevice->context[unitNo]);
@@ -1882,10 +2044,9 @@ static void mt679FlushWrite(u8 mfrId)
 		return;
 	}
 
-	FILE *fcb = mfr->activeDevice->fcb[unitNo];
 	tp->bp = tp->ioBuffer;
-	u64 recLen0 = 0;
-	u64 recLen2 = mfr->activeDevice->recordLength;
+	u32 recLen0 = 0;
+	u32 recLen2 = mfr->activeDevice->recordLength;
 	PpWord *ip = tp->ioBuffer;
 	u8 *rp = rawBuffer;
 
@@ -1896,15 +2057,11 @@ static void mt679FlushWrite(u8 mfrId)
 		/*
 		**  No conversion, just unpack.
 		*/
-		for (i = 0; i < recLen2; i += 2)
-		{
-			*rp++ = ((ip[0] >> 4) & 0xFF);
-			*rp++ = ((ip[0] << 4) & 0xF0) | ((ip[1] >> 8) & 0x0F);
-			*rp++ = ((ip[1] >> 0) & 0xFF);
-			ip += 2;
-		}
+		i = (recLen2 + 1) / 2;
+		bitpack12To8(ip, rp, i);
+		rp += i * 3;
 
-		recLen0 = rp - rawBuffer;
+		recLen0 = static_cast<u32>(rp - rawBuffer);
 
 		if ((recLen2 & 1) != 0)
 		{
@@ -1923,16 +2080,10 @@ static void mt679FlushWrite(u8 mfrId)
 		/*
 		**  Convert the channel data to appropriate character set.
 		*/
-		u8 *writeConv = cp->writeConv[cp->selectedConversion - 1];
-
-		for (i = 0; i < recLen2; i++)
-		{
-			*rp++ = writeConv[(*ip >> 6) & 077];
-			*rp++ = writeConv[(*ip >> 0) & 077];
-			ip += 1;
-		}
+		bitpackConvert12To8(ip, rp, recLen2, cp->writeConv[cp->selectedConversion - 1]);
+		rp += recLen2 * 2;
 
-		recLen0 = rp - rawBuffer;
+		recLen0 = static_cast<u32>(rp - rawBuffer);
 		if (cp->oddFrameCount)
 		{
 			recLen0 -= 1;
@@ -1940,34 +2091,10 @@ static void mt679FlushWrite(u8 mfrId)
 		break;
 	}
 
-	/*
-	** The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(static_cast<u32>(recLen0));
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  The following fseek makes fwrite behave as desired after an fread.
-	*/
-	fseek(fcb, 0, SEEK_CUR);
-
 	/*
 	**  Write the TAP record.
 	*/
-	fwrite(&recLen1, sizeof(recLen1), 1, fcb);
-	fwrite(&rawBuffer, 1, recLen0, fcb);
-	fwrite(&recLen1, sizeof(recLen1), 1, fcb);
-
-	/*
-	**  The following fseek prepares for any subsequent fread.
-	*/
-	fseek(fcb, 0, SEEK_CUR);
+	tapWrite(tp->tap, rawBuffer, recLen0);
 
 	/*
 	**  Writing completed.
@@ -1980,12 +2107,13 @@ static void mt679FlushWrite(u8 mfrId)
 **  Purpose:        Pack and convert 8 bit frames read into channel data.
 **
 **  Parameters:     Name        Description.
+**                  data        read tape record
 **                  recLen      read tape record length
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void mt679PackAndConvert(u32 recLen, u8 mfrId)
+static void mt679PackAndConvert(u8 *data, u32 recLen, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
@@ -1993,19 +2121,12 @@ static void mt679PackAndConvert(u32 recLen, u8 mfrId)
 	TapeParam *tp = static_cast<TapeParam*>(mfr->activeDevice->context[unitNo]);
 	CtrlParam *cp = static_cast<CtrlParam*>(mfr->activeDevice->controllerContext);
 	u32 i;
-	u16 c1;
 
 	/*
 	**  Convert the raw data into PP words suitable for a channel.
 	*/
 	u16 *op = tp->ioBuffer;
-	u8 *rp = rawBuffer;
-
-	/*
-	**  Fill the last few bytes with zeroes.
-	*/
-	rawBuffer[recLen + 0] = 0;
-	rawBuffer[recLen + 1] = 0;
+	u8 *rp = data;
 
 	switch (cp->selectedConversion)
 	{
@@ -2016,15 +2137,9 @@ static void mt679PackAndConvert(u32 recLen, u8 mfrId)
 		/*
 		**  Convert the raw data into PP Word data.
 		*/
-		for (i = 0; i < recLen; i += 3)
-		{
-			c1 = *rp++;
-			u16 c2 = *rp++;
-			u16 c3 = *rp++;
-
-			*op++ = ((c1 << 4) | (c2 >> 4)) & Mask12;
-			*op++ = ((c2 << 8) | (c3 >> 0)) & Mask12;
-		}
+		i = (recLen + 2) / 3;
+		bitpack8To12Bytes(rp, op, recLen, 0);
+		op += i * 2;
 
 		mfr->activeDevice->recordLength = static_cast<PpWord>(op - tp->ioBuffer);
 
@@ -2050,29 +2165,17 @@ static void mt679PackAndConvert(u32 recLen, u8 mfrId)
 		/*
 		**  Convert the Raw data to appropriate character set.
 		*/
-		u8 *readConv = cp->readConv[cp->selectedConversion - 1];
-		for (i = 0; i < recLen; i++)
+		if (bitpackConvert8To12(rp, op, recLen, cp->readConv[cp->selectedConversion - 1]))
 		{
-			c1 = readConv[*rp++];
-			if ((c1 & (1 << 6)) != 0)
-			{
-				/*
-				**  Indicate illegal character.
-				*/
-				tp->alert = true;
-				tp->flagBitDetected = true;
-			}
-
-			if ((i & 1) == 0)
-			{
-				*op = (c1 & Mask6) << 6;
-			}
-			else
-			{
-				*op++ |= c1 & Mask6;
-			}
+			/*
+			**  Indicate illegal character.
+			*/
+			tp->alert = true;
+			tp->flagBitDetected = true;
 		}
 
+		op += recLen / 2;
+
 		mfr->activeDevice->recordLength = static_cast<PpWord>(op - tp->ioBuffer);
 
 		if ((recLen % 2) != 0)
@@ -2094,9 +2197,7 @@ static void mt679PackAndConvert(u32 recLen, u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt679FuncRead(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
+	u8 *data;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
@@ -2108,16 +2209,16 @@ static void mt679FuncRead(u8 mfrId)
 	/*
 	**  Determine if the tape is at the load point.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
+	bool loadPoint = tapPosition(tp->tap) == 0;
 
 	/*
-	**  Read and verify TAP record length header.
+	**  Read the next TAP record.
 	*/
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
+	i32 recLen = tapRead(tp->tap, &data);
 
-	if (len != 1)
+	if (recLen == TapEof)
 	{
-		if (position == 0)
+		if (loadPoint)
 		{
 			tp->errorCode = EcBlankTape;
 		}
@@ -2133,30 +2234,14 @@ static void mt679FuncRead(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
+	if (recLen == TapError)
 	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
-	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcDiagnosticError;
 		return;
 	}
 
-	if (recLen1 == 0)
+	if (recLen == TapMark)
 	{
 		/*
 		**  Report a tape mark and return.
@@ -2170,70 +2255,16 @@ static void mt679FuncRead(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  Read and verify the actual raw data.
-	*/
-	len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->activeDevice->fcb[unitNo]));
-
-	if (recLen1 != static_cast<u32>(len))
-	{
-		logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-		tp->alert = true;
-		tp->errorCode = EcDiagnosticError;
-		return;
-	}
-
-	/*
-	**  Read and verify the TAP record length trailer.
-	*/
-	len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcDiagnosticError;
-		return;
-	}
-
-	if (recLen0 != recLen2)
-	{
-		/*
-		**  This is some weird shit to deal with "padded" TAP records. My brain refuses to understand
-		**  why anyone would have the precise length of a record and then make the reader guess what
-		**  the real length is.
-		*/
-		if (BigIron->bigEndian)
-		{
-			/*
-			**  The TAP record length is little endian - convert if necessary.
-			*/
-			recLen2 = MSystem::ConvertEndian(recLen2);
-		}
-
-		if (recLen1 == ((recLen2 >> 8) & 0xFFFFFF))
-		{
-			fseek(mfr->activeDevice->fcb[unitNo], 1, SEEK_CUR);
-		}
-		else
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %d", mfr->activeChannel->id, recLen2);
-			tp->alert = true;
-			tp->errorCode = EcDiagnosticError;
-			return;
-		}
-	}
-
 	/*
 	**  Convert the raw data into PP words suitable for a channel.
 	*/
-	mt679PackAndConvert(recLen1, mfrId);
+	mt679PackAndConvert(data, recLen, mfrId);
 
 	/*
 	**  Setup length, buffer pointer and block number.
 	*/
 #if DEBUG
-	fprintf(mt679Log, "Read fwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen1);
+	fprintf(mt679Log, "Read fwd %d PP words (%d 8-bit bytes)\n", activeDevice->recordLength, recLen);
 #endif
 
 	tp->recordLength = mfr->activeDevice->recordLength;
@@ -2251,10 +2282,7 @@ static void mt679FuncRead(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt679FuncReadBkw(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
+	u8 *data;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
@@ -2264,118 +2292,34 @@ static void mt679FuncReadBkw(u8 mfrId)
 	tp->recordLength = 0;
 
 	/*
-	**  Check if we are already at the beginning of the tape.
+	**  Read the previous TAP record, which leaves the tape positioned
+	**  at its header.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
-	if (position == 0)
+	i32 recLen = tapReadBackward(tp->tap, &data);
+
+	if (recLen == TapBot)
 	{
+		/*
+		**  We are already at the beginning of the tape.
+		*/
 		tp->suppressBot = false;
 		tp->blockNo = 0;
 		return;
 	}
 
-	/*
-	**  Position to the previous record's trailer and read the length
-	**  of the record (leaving the file position ahead of the just read
-	**  record trailer).
-	*/
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcDiagnosticError;
-		return;
-	}
-
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcDiagnosticError;
 		return;
 	}
 
-	position -= 4;
-	if (recLen1 != 0)
+	if (recLen != TapMark)
 	{
-		/*
-		**  Skip backward over the TAP record body and header.
-		*/
-		position -= 4 + recLen1;
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-
-		/*
-		**  Read and verify the TAP record header.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-		if (len != 1)
-		{
-			logError(LogErrorLocation, "channel %02o - missing TAP record header", mfr->activeChannel->id);
-			tp->alert = true;
-			tp->errorCode = EcDiagnosticError;
-			return;
-		}
-
-		if (recLen0 != recLen2)
-		{
-			/*
-			**  This is more weird shit to deal with "padded" TAP records.
-			*/
-			position -= 1;
-			fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-			len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-			if (len != 1 || recLen0 != recLen2)
-			{
-				logError(LogErrorLocation, "channel %02o - invalid record length2: %d %08X != %08X", mfr->activeChannel->id, len, recLen0, recLen2);
-				tp->alert = true;
-				tp->errorCode = EcDiagnosticError;
-				return;
-			}
-		}
-
-		/*
-		**  Read and verify the actual raw data.
-		*/
-		len = static_cast<u32>(fread(rawBuffer, 1, recLen1, mfr->activeDevice->fcb[unitNo]));
-
-		if (recLen1 != static_cast<u32>(len))
-		{
-			logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-			tp->alert = true;
-			tp->errorCode = EcDiagnosticError;
-			return;
-		}
-
-		/*
-		**  Position to the TAP record header.
-		*/
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-
 		/*
 		**  Convert the raw data into PP words suitable for a channel.
 		*/
-		mt679PackAndConvert(recLen1, mfrId);
+		mt679PackAndConvert(data, recLen, mfrId);
 
 		/*
 		**  Setup length and buffer pointer.
@@ -2402,7 +2346,7 @@ static void mt679FuncReadBkw(u8 mfrId)
 	/*
 	**  Set block number.
 	*/
-	if (position == 0)
+	if (tapPosition(tp->tap) == 0)
 	{
 		tp->suppressBot = true;
 		tp->blockNo = 0;
@@ -2423,10 +2367,6 @@ static void mt679FuncReadBkw(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt679FuncForespace(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
@@ -2435,16 +2375,16 @@ static void mt679FuncForespace(u8 mfrId)
 	/*
 	**  Determine if the tape is at the load point.
 	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
+	bool loadPoint = tapPosition(tp->tap) == 0;
 
 	/*
-	**  Read and verify TAP record length header.
+	**  Skip the next TAP record.
 	*/
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
+	i32 recLen = tapRead(tp->tap, nullptr);
 
-	if (len != 1)
+	if (recLen == TapEof)
 	{
-		if (position == 0)
+		if (loadPoint)
 		{
 			tp->errorCode = EcBlankTape;
 		}
@@ -2460,93 +2400,23 @@ static void mt679FuncForespace(u8 mfrId)
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcDiagnosticError;
 		return;
 	}
 
-	if (recLen1 == 0)
+	if (recLen == TapMark)
 	{
 		/*
-		**  Report a tape mark and return.
+		**  Report a tape mark.
 		*/
 		tp->fileMark = true;
-		tp->blockNo += 1;
 
 #if DEBUG
 		fprintf(mt679Log, "Tape mark\n");
 #endif
-		return;
-	}
-
-	/*
-	**  Skip the actual raw data.
-	*/
-	if (fseek(mfr->activeDevice->fcb[unitNo], recLen1, SEEK_CUR) != 0)
-	{
-		logError(LogErrorLocation, "channel %02o - short tape record read: %d", mfr->activeChannel->id, len);
-		tp->alert = true;
-		tp->errorCode = EcDiagnosticError;
-		return;
-	}
-
-	/*
-	**  Read and verify the TAP record length trailer.
-	*/
-	len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-	if (len != 1)
-	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcDiagnosticError;
-		return;
-	}
-
-	if (recLen0 != recLen2)
-	{
-		/*
-		**  This is some weird shit to deal with "padded" TAP records. My brain refuses to understand
-		**  why anyone would have the precise length of a record and then make the reader guess what
-		**  the real length is.
-		*/
-		if (BigIron->bigEndian)
-		{
-			/*
-			**  The TAP record length is little endian - convert if necessary.
-			*/
-			recLen2 = MSystem::ConvertEndian(recLen2);
-		}
-
-		if (recLen1 == ((recLen2 >> 8) & 0xFFFFFF))
-		{
-			fseek(mfr->activeDevice->fcb[unitNo], 1, SEEK_CUR);
-		}
-		else
-		{
-			logError(LogErrorLocation, "channel %02o - invalid tape record trailer: %d", mfr->activeChannel->id, recLen2);
-			tp->alert = true;
-			tp->errorCode = EcDiagnosticError;
-			return;
-		}
 	}
 
 	tp->blockNo += 1;
@@ -2562,111 +2432,33 @@ static void mt679FuncForespace(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mt679FuncBackspace(u8 mfrId)
 {
-	u32 recLen0;
-	u32 recLen1;
-	u32 recLen2;
-
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	i8 unitNo = mfr->activeDevice->selectedUnit;
 	TapeParam *tp = static_cast<TapeParam *>(mfr->activeDevice->context[unitNo]);
 
 	/*
-	**  Check if we are already at the beginning of the tape.
-	*/
-	i32 position = ftell(mfr->activeDevice->fcb[unitNo]);
-	if (position == 0)
-	{
-		tp->blockNo = 0;
-		return;
-	}
-
-	/*
-	**  Position to the previous record's trailer and read the length
-	**  of the record (leaving the file position ahead of the just read
-	**  record trailer).
+	**  Position to the previous TAP record header.
 	*/
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
-	u32 len = static_cast<u32>(fread(&recLen0, sizeof(recLen0), 1, mfr->activeDevice->fcb[unitNo]));
-	fseek(mfr->activeDevice->fcb[unitNo], -4, SEEK_CUR);
+	i32 recLen = tapReadBackward(tp->tap, nullptr);
 
-	if (len != 1)
+	if (recLen == TapBot)
 	{
-		logError(LogErrorLocation, "channel %02o - missing tape record trailer", mfr->activeChannel->id);
-		tp->alert = true;
-		tp->errorCode = EcDiagnosticError;
+		/*
+		**  We are already at the beginning of the tape.
+		*/
+		tp->blockNo = 0;
 		return;
 	}
 
-	/*
-	**  The TAP record length is little endian - convert if necessary.
-	*/
-	if (BigIron->bigEndian)
-	{
-		recLen1 = MSystem::ConvertEndian(recLen0);
-	}
-	else
-	{
-		recLen1 = recLen0;
-	}
-
-	/*
-	**  Check if record length is reasonable.
-	*/
-	if (recLen1 > MaxByteBuf)
+	if (recLen == TapError)
 	{
-		logError(LogErrorLocation, "channel %02o - tape record too long: %d", mfr->activeChannel->id, recLen1);
 		tp->alert = true;
 		tp->errorCode = EcDiagnosticError;
 		return;
 	}
 
-	position -= 4;
-	if (recLen1 != 0)
-	{
-		/*
-		**  Skip backward over the TAP record body and header.
-		*/
-		position -= 4 + recLen1;
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-
-		/*
-		**  Read and verify the TAP record header.
-		*/
-		len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-		if (len != 1)
-		{
-			logError(LogErrorLocation, "channel %02o - missing TAP record header", mfr->activeChannel->id);
-			tp->alert = true;
-			tp->errorCode = EcDiagnosticError;
-			return;
-		}
-
-		if (recLen0 != recLen2)
-		{
-			/*
-			**  This is more weird shit to deal with "padded" TAP records.
-			*/
-			position -= 1;
-			fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-			len = static_cast<u32>(fread(&recLen2, sizeof(recLen2), 1, mfr->activeDevice->fcb[unitNo]));
-
-			if (len != 1 || recLen0 != recLen2)
-			{
-				logError(LogErrorLocation, "channel %02o - invalid record length2: %d %08X != %08X", mfr->activeChannel->id, len, recLen0, recLen2);
-				tp->alert = true;
-				tp->errorCode = EcDiagnosticError;
-				return;
-			}
-		}
-
-		/*
-		**  Position to the TAP record header.
-		*/
-		fseek(mfr->activeDevice->fcb[unitNo], position, SEEK_SET);
-	}
-	else
+	if (recLen == TapMark)
 	{
 		/*
 		**  A tape mark consists of only a single TAP record header of zero.
@@ -2681,7 +2473,7 @@ static void mt679FuncBackspace(u8 mfrId)
 	/*
 	**  Set block number.
 	*/
-	if (position == 0)
+	if (tapPosition(tp->tap) == 0)
 	{
 		tp->blockNo = 0;
 	}
@@ -2691,7 +2483,6 @@ static void mt679FuncBackspace(u8 mfrId)
 	}
 }
 
-
 /*--------------------------------------------------------------------------
 **  Purpose:        Convert function code to string.
 **
@@ -78,8 +78,7 @@ typedef struct portParam
 {
 	u8          id;
 	u8			mfrId;
-	bool        active;
-	SOCKET         connFd;
+	MuxPort     *port;
 } PortParam;
 
 /*
@@ -92,7 +91,6 @@ static void mux6676Io(u8 mfrId);
 static void mux6676Activate(u8 mfrId);
 static void mux6676Disconnect(u8 mfrId);
 static void mux6676CreateThread(DevSlot *dp);
-static int mux6676CheckInput(PortParam *mp);
 static bool mux6676InputRequired(u8 mfrId);
 #if defined(_WIN32)
 static void mux6676Thread(void *param);
@@ -172,8 +170,7 @@ void mux6676Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	for (u8 i = 0; i < mfr->mux6676TelnetConns; i++)
 	{
 		mp->mfrId = mfrID;
-		mp->active = false;
-		mp->connFd = 0;
+		mp->port = muxPortOpen("mux6676", i);
 		mp->id = i;
 		mp += 1;
 	}
@@ -243,8 +240,6 @@ static FcStatus mux6676Func(PpWord funcCode, u8 mfrId)
 static void mux6676Io(u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
-	// ReSharper disable once CppJoinDeclarationAndAssignment
-	char x;
 	PortParam *cp = static_cast<PortParam *>(mfr->activeDevice->context[0]);
 	PortParam *mp;
 	u8 portNumber;
@@ -266,7 +261,7 @@ static void mux6676Io(u8 mfrId)
 			if (portNumber < mfr->mux6676TelnetConns)
 			{
 				mp = cp + portNumber;
-				if (mp->active)
+				if (muxPortActive(mp->port))
 				{
 					/*
 					**  Port with active TCP connection.
@@ -276,23 +271,16 @@ static void mux6676Io(u8 mfrId)
 					{
 					case 4:
 						/*
-						**  Send data with parity stripped off.
+						**  Queue data with parity stripped off.
 						*/
-						// ReSharper disable once CppJoinDeclarationAndAssignment
-						x = (mfr->activeChannel->data >> 1) & 0x7f;
-						send(mp->connFd, &x, 1, 0);
+						muxPortPut(mp->port, (mfr->activeChannel->data >> 1) & 0x7f);
 						break;
 
 					case 6:
 						/*
 						**  Disconnect.
 						*/
-#if defined(_WIN32)
-						closesocket(mp->connFd);
-#else
-						close(mp->connFd);
-#endif
-						mp->active = false;
+						muxPortClose(mp->port);
 						printf("mux6676: Host closed connection on port %d\n", mp->id);
 						break;
 
@@ -313,13 +301,13 @@ static void mux6676Io(u8 mfrId)
 			if (portNumber < mfr->mux6676TelnetConns)
 			{
 				mp = cp + portNumber;
-				if (mp->active)
+				if (muxPortActive(mp->port))
 				{
 					/*
 					**  Port with active TCP connection.
 					*/
 					mfr->activeChannel->data |= 01000;
-					if ((in = mux6676CheckInput(mp)) > 0)
+					if ((in = muxPortGet(mp->port)) > 0)
 					{
 						mfr->activeChannel->data |= ((in & 0x7F) << 1) | 04000;
 					}
@@ -353,7 +341,8 @@ static void mux6676Activate(u8 mfrId)
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Handle disconnecting of channel.
+**  Purpose:        Handle disconnecting of channel. Output collected
+**                  during the transfer is sent now.
 **
 **  Parameters:     Name        Description.
 **
@@ -362,6 +351,19 @@ static void mux6676Activate(u8 mfrId)
 **------------------------------------------------------------------------*/
 static void mux6676Disconnect(u8 mfrId)
 {
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	if (mfr->activeDevice->fcode != Fc6676Output)
+	{
+		return;
+	}
+
+	PortParam *mp = static_cast<PortParam *>(mfr->activeDevice->context[0]);
+	for (int i = 0; i < mfr->mux6676TelnetConns; i++)
+	{
+		muxPortFlush(mp->port);
+		mp += 1;
+	}
 }
 
 /*--------------------------------------------------------------------------
@@ -494,7 +496,7 @@ static void *mux6676Thread(void *param)
 		PortParam *mp = static_cast<PortParam *>(dp->context[dp->selectedUnit]);
 		for (i = 0; i < mfr->mux6676TelnetConns; i++)
 		{
-			if (!mp->active)
+			if (!muxPortActive(mp->port))
 			{
 				break;
 			}
@@ -518,12 +520,12 @@ static void *mux6676Thread(void *param)
 		**  Wait for a connection.
 		*/
 		int fromLen = sizeof(from);
-		mp->connFd = accept(listenFd, reinterpret_cast<struct sockaddr *>(&from), &fromLen);
+		SOCKET connFd = accept(listenFd, reinterpret_cast<struct sockaddr *>(&from), &fromLen);
 
 		/*
 		**  Mark connection as active.
 		*/
-		mp->active = true;
+		muxPortAttach(mp->port, connFd);
 		printf("mux6676: Received connection on port %d\n", mp->id);
 	}
 
@@ -598,7 +600,7 @@ static void *mux6676Thread1(void *param)
 		PortParam *mp = static_cast<PortParam *>(dp->context[dp->selectedUnit]);
 		for (i = 0; i < mfr->mux6676TelnetConns; i++)
 		{
-			if (!mp->active)
+			if (!muxPortActive(mp->port))
 			{
 				break;
 			}
@@ -622,12 +624,12 @@ static void *mux6676Thread1(void *param)
 		**  Wait for a connection.
 		*/
 		int fromLen = sizeof(from);
-		mp->connFd = accept(listenFd, reinterpret_cast<struct sockaddr *>(&from), &fromLen);
+		SOCKET connFd = accept(listenFd, reinterpret_cast<struct sockaddr *>(&from), &fromLen);
 
 		/*
 		**  Mark connection as active.
 		*/
-		mp->active = true;
+		muxPortAttach(mp->port, connFd);
 		printf("mux6676: Received connection on port %d\n", mp->id);
 	}
 
@@ -638,67 +640,6 @@ static void *mux6676Thread1(void *param)
 
 
 
-/*--------------------------------------------------------------------------
-**  Purpose:        Check for input.
-**
-**  Parameters:     Name        Description.
-**                  mp          pointer to mux parameters.
-**
-**  Returns:        Nothing.
-**
-**------------------------------------------------------------------------*/
-static int mux6676CheckInput(PortParam *mp)
-{
-	fd_set readFds;
-	fd_set exceptFds;
-	struct timeval timeout;
-	char data;
-
-	FD_ZERO(&readFds);
-	FD_ZERO(&exceptFds);
-	FD_SET(mp->connFd, &readFds);
-	FD_SET(mp->connFd, &exceptFds);
-
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 0;
-
-	select(static_cast<int>(mp->connFd) + 1, &readFds, nullptr, &exceptFds, &timeout);
-	if (FD_ISSET(mp->connFd, &readFds))
-	{
-		int i = recv(mp->connFd, &data, 1, 0);
-		if (i == 1)
-		{
-			return(data);
-		}
-		else
-		{
-#if defined(_WIN32)
-			closesocket(mp->connFd);
-#else
-			close(mp->connFd);
-#endif
-			mp->active = false;
-			printf("mux6676: Connection dropped on port %d\n", mp->id);
-			return(-1);
-		}
-	}
-	else if (FD_ISSET(mp->connFd, &exceptFds))
-	{
-#if defined(_WIN32)
-		closesocket(mp->connFd);
-#else
-		close(mp->connFd);
-#endif
-		mp->active = false;
-		printf("mux6676: Connection dropped on port %d\n", mp->id);
-		return(-1);
-	}
-	else
-	{
-		return(0);
-	}
-}
-
 /*--------------------------------------------------------------------------
 **  Purpose:        Determine if input is required.
 **
@@ -712,31 +653,16 @@ static bool mux6676InputRequired(u8 mfrId)
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	PortParam *cp = static_cast<PortParam *>(mfr->activeDevice->context[0]);
-	PortParam *mp;
-	fd_set readFds;
-	fd_set exceptFds;
-	struct timeval timeout;
 
-	FD_ZERO(&readFds);
-	FD_ZERO(&exceptFds);
 	for (int i = 0; i < mfr->mux6676TelnetConns; i++)
 	{
-		mp = cp + i;
-		if (mp->active)
+		if (muxPortInputReady(cp[i].port))
 		{
-			FD_SET(mp->connFd, &readFds);
-			FD_SET(mp->connFd, &exceptFds);
+			return(true);
 		}
 	}
 
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 0;
-
-	// ReSharper disable once CppCStyleCast
-	// ReSharper disable once CppDeclaratorMightNotBeInitialized
-	int numSocks = select((int)mp->connFd + 1, &readFds, nullptr, &exceptFds, &timeout);
-
-	return(numSocks > 0);
+	return(false);
 }
 
 /*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,684 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: muxio.cpp
+**
+**  Description:
+**      TCP buffering for the ports of the terminal multiplexers (6676
+**      and two port mux). A single I/O thread receives whatever arrives
+**      on connected ports into a ring per port, so the PP side only looks
+**      at memory when it polls for input. Output is collected per port
+**      and sent when the buffer fills or the channel is disconnected.
+**      Linux waits on edge-triggered epoll events, other platforms select
+**      over the connected ports and a loopback wake socket, which is
+**      signalled when the set of connected ports changes.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#if defined(_WIN32)
+#include <winsock.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MuxRingSize             4096    // input ring per port, power of two
+#define MuxOutSize              512     // output collected per port
+#define MuxEvents               32
+#define MuxWaitMs               100
+#define MuxRetryMs              10
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if defined(_WIN32)
+#define muxBarrier()    MemoryBarrier()
+#else
+#define muxBarrier()    __sync_synchronize()
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+struct muxPort
+{
+	struct muxPort  *next;              // all ports, for the I/O thread
+	const char      *name;              // for messages
+	int             id;
+	SOCKET          connFd;
+	volatile bool   active;             // connected
+	volatile bool   closed;             // peer closed or receive error
+	volatile bool   stalled;            // ring was full, receive must be retried
+	u32             generation;         // connections attached so far
+	u32             selected;           // generation the I/O thread selected on
+
+	/*
+	**  Held by the I/O thread while it receives and by the emulation
+	**  while it attaches or closes a connection, so a receive never
+	**  meets a closed socket or updates the next connection.
+	*/
+	CRITICAL_SECTION lock;
+
+	/*
+	**  Input ring, filled by the I/O thread only (inHead) and drained by
+	**  the emulation only (inTail).
+	*/
+	u8              in[MuxRingSize];
+	volatile u32    inHead;
+	volatile u32    inTail;
+
+	/*
+	**  Output collected by the emulation.
+	*/
+	u8              out[MuxOutSize];
+	u32             outCount;
+};
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void muxCreateThread();
+#if defined(_WIN32)
+static void muxThread(void *param);
+#else
+static void *muxThread(void *param);
+#endif
+static void muxReceive(MuxPort *pp, u32 generation);
+#if !defined(__linux__) || defined(_WIN32)
+static void muxWake();
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static MuxPort *volatile firstPort = nullptr;
+#if defined(__linux__) && !defined(_WIN32)
+static int pollFd = -1;
+#else
+static SOCKET wakeFd;
+static struct sockaddr_in wakeAddr;
+#endif
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create a port. The I/O thread is started with the
+**                  first one.
+**
+**  Parameters:     Name        Description.
+**                  name        mux name used in messages
+**                  id          port number used in messages
+**
+**  Returns:        Pointer to the port.
+**
+**------------------------------------------------------------------------*/
+MuxPort *muxPortOpen(const char *name, int id)
+{
+	MuxPort *pp = static_cast<MuxPort *>(calloc(1, sizeof(MuxPort)));
+	if (pp == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate %s port buffers\n", name);
+		exit(1);
+	}
+
+	pp->name = name;
+	pp->id = id;
+	InitializeCriticalSection(&pp->lock);
+
+	if (firstPort == nullptr)
+	{
+#if defined(__linux__) && !defined(_WIN32)
+		pollFd = epoll_create1(0);
+		if (pollFd < 0)
+		{
+			fprintf(stderr, "Failed to create %s epoll instance\n", name);
+			exit(1);
+		}
+#else
+		/*
+		**  The I/O thread selects on this socket as well, so attaching
+		**  or closing a port can wake it up.
+		*/
+#if defined(_WIN32)
+		int addrLen = sizeof(wakeAddr);
+#else
+		socklen_t addrLen = sizeof(wakeAddr);
+#endif
+		memset(&wakeAddr, 0, sizeof(wakeAddr));
+		wakeAddr.sin_family = AF_INET;
+		wakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		wakeFd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (static_cast<int>(wakeFd) < 0
+			|| bind(wakeFd, reinterpret_cast<struct sockaddr *>(&wakeAddr), sizeof(wakeAddr)) != 0
+			|| getsockname(wakeFd, reinterpret_cast<struct sockaddr *>(&wakeAddr), &addrLen) != 0)
+		{
+			fprintf(stderr, "Failed to create %s wake socket\n", name);
+			exit(1);
+		}
+#endif
+		muxCreateThread();
+	}
+
+	/*
+	**  Ports are only added during initialisation, the I/O thread may
+	**  already be walking the list.
+	*/
+	pp->next = firstPort;
+	muxBarrier();
+	firstPort = pp;
+
+	return(pp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Attach a newly accepted connection to a free port.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**                  fd          connected socket
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void muxPortAttach(MuxPort *pp, SOCKET fd)
+{
+	EnterCriticalSection(&pp->lock);
+	pp->connFd = fd;
+	pp->closed = false;
+	pp->stalled = false;
+	pp->outCount = 0;
+	pp->generation += 1;
+	muxBarrier();
+	pp->active = true;
+	LeaveCriticalSection(&pp->lock);
+
+#if defined(__linux__) && !defined(_WIN32)
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = pp;
+	if (epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+	{
+		pp->closed = true;
+	}
+#else
+	muxWake();
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Tell whether a port has a connection.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**
+**  Returns:        TRUE if connected.
+**
+**------------------------------------------------------------------------*/
+bool muxPortActive(MuxPort *pp)
+{
+	return(pp->active);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Tell whether a port needs the PP's attention, i.e.
+**                  has input or has been dropped by the peer.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**
+**  Returns:        TRUE if input should be polled.
+**
+**------------------------------------------------------------------------*/
+bool muxPortInputReady(MuxPort *pp)
+{
+	return(pp->active && (pp->inHead != pp->inTail || pp->closed));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take the next input byte of a port. A port dropped by
+**                  the peer is closed once its input has been taken.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**
+**  Returns:        Input byte or -1 if there is none.
+**
+**------------------------------------------------------------------------*/
+int muxPortGet(MuxPort *pp)
+{
+	if (!pp->active)
+	{
+		return(-1);
+	}
+
+	if (pp->inHead != pp->inTail)
+	{
+		muxBarrier();
+		u8 data = pp->in[pp->inTail & (MuxRingSize - 1)];
+		muxBarrier();
+		pp->inTail += 1;
+		return(data);
+	}
+
+	if (pp->closed)
+	{
+		muxPortClose(pp);
+		printf("%s: Connection dropped on port %d\n", pp->name, pp->id);
+	}
+
+	return(-1);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue an output byte, sending the collected output
+**                  when the buffer is full.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**                  data        output byte
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void muxPortPut(MuxPort *pp, u8 data)
+{
+	if (!pp->active)
+	{
+		return;
+	}
+
+	pp->out[pp->outCount++] = data;
+	if (pp->outCount == MuxOutSize)
+	{
+		muxPortFlush(pp);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send the output collected for a port.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void muxPortFlush(MuxPort *pp)
+{
+	if (pp->outCount == 0)
+	{
+		return;
+	}
+
+	if (pp->active)
+	{
+		send(pp->connFd, reinterpret_cast<char *>(pp->out), pp->outCount, 0);
+	}
+
+	pp->outCount = 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close the connection of a port after sending any
+**                  collected output, and discard unread input.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void muxPortClose(MuxPort *pp)
+{
+	if (!pp->active)
+	{
+		return;
+	}
+
+	muxPortFlush(pp);
+
+	EnterCriticalSection(&pp->lock);
+#if defined(_WIN32)
+	closesocket(pp->connFd);
+#else
+#if defined(__linux__)
+	epoll_ctl(pollFd, EPOLL_CTL_DEL, pp->connFd, nullptr);
+#endif
+	close(pp->connFd);
+#endif
+
+	pp->inTail = pp->inHead;
+	muxBarrier();
+
+	/*
+	**  The port is free for the listener thread from here on.
+	*/
+	pp->active = false;
+	LeaveCriticalSection(&pp->lock);
+
+#if !defined(__linux__) || defined(_WIN32)
+	muxWake();
+#endif
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the mux I/O thread.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void muxCreateThread()
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	/*
+	**  Create mux I/O thread.
+	*/
+	HANDLE hThread = CreateThread(
+		nullptr,                                    // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(muxThread),
+		nullptr,                                    // no thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create mux I/O thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	/*
+	**  Create POSIX thread with default attributes.
+	*/
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, muxThread, nullptr);
+	if (rc < 0)
+	{
+		fprintf(stderr, "Failed to create mux I/O thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Mux I/O thread. Receives into the port input rings.
+**
+**  Parameters:     Name        Description.
+**                  param       unused
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void muxThread(void *param)
+#else
+static void *muxThread(void *param)
+#endif
+{
+	MuxPort *pp;
+
+#if defined(__linux__) && !defined(_WIN32)
+	struct epoll_event events[MuxEvents];
+	bool stalled = false;
+
+	while (BigIron->emulationActive)
+	{
+		int n = epoll_wait(pollFd, events, MuxEvents, stalled ? MuxRetryMs : MuxWaitMs);
+		for (int i = 0; i < n; i++)
+		{
+			pp = static_cast<MuxPort *>(events[i].data.ptr);
+			muxReceive(pp, pp->generation);
+		}
+
+		/*
+		**  Edge-triggered input which did not fit into a ring is not
+		**  reported again, so retry those ports until it does.
+		*/
+		stalled = false;
+		for (pp = firstPort; pp != nullptr; pp = pp->next)
+		{
+			if (pp->stalled && pp->active)
+			{
+				muxReceive(pp, pp->generation);
+				stalled |= pp->stalled;
+			}
+		}
+	}
+#else
+	fd_set readFds;
+	struct timeval timeout;
+	char wake[64];
+
+	while (BigIron->emulationActive)
+	{
+		SOCKET maxFd = wakeFd;
+		int count = 1;
+		bool stalled = false;
+
+		FD_ZERO(&readFds);
+		FD_SET(wakeFd, &readFds);
+		for (pp = firstPort; pp != nullptr && count < FD_SETSIZE; pp = pp->next)
+		{
+			if (!pp->active || pp->closed)
+			{
+				continue;
+			}
+
+			/*
+			**  A full ring is not read, retry it once the PP made room.
+			*/
+			if (pp->inHead - pp->inTail == MuxRingSize)
+			{
+				stalled = true;
+				continue;
+			}
+
+			pp->selected = pp->generation;
+			FD_SET(pp->connFd, &readFds);
+			if (maxFd < pp->connFd)
+			{
+				maxFd = pp->connFd;
+			}
+
+			count += 1;
+		}
+
+		timeout.tv_sec = 0;
+		timeout.tv_usec = (stalled ? MuxRetryMs : MuxWaitMs) * 1000;
+		if (select(static_cast<int>(maxFd) + 1, &readFds, nullptr, nullptr, &timeout) <= 0)
+		{
+			continue;
+		}
+
+		if (FD_ISSET(wakeFd, &readFds))
+		{
+			recv(wakeFd, wake, sizeof(wake), 0);
+		}
+
+		for (pp = firstPort; pp != nullptr; pp = pp->next)
+		{
+			if (pp->active && FD_ISSET(pp->connFd, &readFds))
+			{
+				muxReceive(pp, pp->selected);
+			}
+		}
+	}
+#endif
+
+#if !defined(_WIN32)
+	return(NULL);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Receive what a port's socket has into its input ring
+**                  (I/O thread). Sockets stay blocking for the emulation's
+**                  sends, so on Linux each receive is made non-blocking
+**                  and repeated until the socket is empty; elsewhere select
+**                  said there is data and a single receive takes it.
+**
+**  Parameters:     Name        Description.
+**                  pp          port
+**                  generation  connection the data is for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void muxReceive(MuxPort *pp, u32 generation)
+{
+	EnterCriticalSection(&pp->lock);
+
+	/*
+	**  The connection may have been closed, and the port attached again,
+	**  since the socket was reported readable.
+	*/
+	while (pp->active && !pp->closed && pp->generation == generation)
+	{
+		u32 room = MuxRingSize - (pp->inHead - pp->inTail);
+		if (room == 0)
+		{
+			pp->stalled = true;
+			break;
+		}
+
+		/*
+		**  Receive into the contiguous free part of the ring.
+		*/
+		u32 head = pp->inHead & (MuxRingSize - 1);
+		if (room > MuxRingSize - head)
+		{
+			room = MuxRingSize - head;
+		}
+
+#if defined(__linux__) && !defined(_WIN32)
+		int count = recv(pp->connFd, reinterpret_cast<char *>(pp->in + head), room, MSG_DONTWAIT);
+#else
+		int count = recv(pp->connFd, reinterpret_cast<char *>(pp->in + head), room, 0);
+#endif
+		if (count > 0)
+		{
+			muxBarrier();
+			pp->inHead += count;
+#if defined(__linux__) && !defined(_WIN32)
+			continue;
+#else
+			break;
+#endif
+		}
+
+		pp->stalled = false;
+#if !defined(_WIN32)
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			break;
+		}
+#endif
+
+		/*
+		**  Orderly shutdown or error - the emulation closes the socket
+		**  once it has taken the remaining input.
+		*/
+		muxBarrier();
+		pp->closed = true;
+		break;
+	}
+
+	LeaveCriticalSection(&pp->lock);
+}
+
+#if !defined(__linux__) || defined(_WIN32)
+/*--------------------------------------------------------------------------
+**  Purpose:        Wake the I/O thread so it selects over the connected
+**                  ports again.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void muxWake()
+{
+	char data = 0;
+
+	sendto(wakeFd, &data, 1, 0, reinterpret_cast<struct sockaddr *>(&wakeAddr), sizeof(wakeAddr));
+}
+#endif
+
+/*---------------------------  End Of File  ------------------------------*/
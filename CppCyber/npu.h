@@ -199,6 +199,15 @@
 */
 #define MaxBuffer       2048
 
+/*
+**  NPU buffer size classes.
+*/
+#define NpuBufSmall     0       // acknowledgments, echo, service messages
+#define NpuBufMedium    1
+#define NpuBufLarge     2       // MaxBuffer, downline blocks
+#define NpuBufClasses   3
+#define NetRingSize     4096    // per connection input ring, power of two
+
 /*
 **  Character definitions.
 */
@@ -243,9 +252,26 @@ typedef struct npuBuffer
     u16                 offset;
     u16                 numBytes;
     u8                  blockSeqNo;
-    u8                  data[MaxBuffer];
+    u8                  sizeClass;
+    u16                 size;           // capacity of data
+    u8                  *data;          // cache line aligned, follows the header
     } NpuBuffer;
 
+/*
+**  NPU buffer pool of one size class.
+*/
+typedef struct npuPool
+    {
+    NpuBuffer           *free;
+    int                 size;           // data bytes per buffer
+    int                 limit;          // most buffers the class may grow to
+    int                 total;          // buffers allocated so far
+    int                 freeCount;
+    int                 highWater;      // most buffers in use at any time
+    u32                 allocations;
+    u32                 exhausted;      // requests the class could not satisfy
+    } NpuPool;
+
 /*
 **  NPU buffer queue.
 */
@@ -388,6 +414,31 @@ typedef struct tcb
     bool                dbcNoEchoplex;
     bool                dbcNoCursorPos;
     bool                lastOpWasInput;
+
+    /*
+    **  Network thread hand-off. The ring is filled by the network thread
+    **  only (netRingIn) and drained by the emulation thread only (netRingOut).
+    */
+    u8                  netRing[NetRingSize];
+    volatile u32        netRingIn;
+    volatile u32        netRingOut;
+    volatile long       netSignalled;   // on signal queue or ready list
+    struct tcb          *netSignalNext;
+    struct tcb          *netReadyNext;
+    volatile bool       netActive;      // socket watched by network thread
+    volatile bool       netClosed;      // peer closed or receive error
+    volatile bool       netBlocked;     // send would block, wait for writable
+    volatile bool       netStalled;     // ring was full, receive must be retried
+    u32                 netSelected;    // generation the I/O thread selected on
+
+    /*
+    **  Held by the network thread while it receives and by the other
+    **  threads while they attach or close a connection, so a receive
+    **  never meets a closed socket or updates the next connection.
+    **  These survive a TIP reset and must stay last.
+    */
+    u32                 netGeneration;  // connections attached so far
+    CRITICAL_SECTION    netLock;
     } Tcb;
 
 /*
@@ -400,8 +451,36 @@ typedef struct npuConnType
 	u8                  connType;
 	u8					mfrId;
 	Tcb                 *startTcb;
+
+	/*
+	**  Admission rate limiter (token bucket).
+	*/
+	u32                 admitTokens;
+	u64                 admitTime;
+
+	/*
+	**  Admission statistics.
+	*/
+	u32                 accepted;       // connected to a TCB
+	u32                 refused;        // host not ready or no free port
+	u32                 aborted;        // host connect request failed
+	u32                 throttled;      // accept sweeps cut short by the rate limiter
+	u32                 lingering;      // refused sockets waiting to be closed
+	u32                 backlog;        // connections found waiting in last accept sweep
+	u32                 backlogPeak;
 } NpuConnType;
 
+/*
+**  Refused connection kept open until its message has been seen.
+*/
+typedef struct npuLinger
+{
+	struct npuLinger    *next;
+	int                 fd;
+	u64                 closeTime;      // host microseconds
+	NpuConnType         *ct;
+} NpuLinger;
+
 typedef struct npuParam
 {
 	PpWord      regCouplerStatus;
@@ -440,6 +519,8 @@ void npuLogMessage(char *format, ...);
 void npuBipInit(u8 mfrId);
 void npuBipReset(u8 mfrId);
 NpuBuffer *npuBipBufGet(u8 mfrId);
+NpuBuffer *npuBipBufGetSized(int size, u8 mfrId);
+void npuBipShowStats();
 void npuBipBufRelease(NpuBuffer *bp, u8 mfrId);
 void npuBipQueueAppend(NpuBuffer *bp, NpuQueue *queue);
 void npuBipQueuePrepend(NpuBuffer *bp, NpuQueue *queue);
@@ -490,13 +571,15 @@ void npuNetReset(u8 mfrId);
 void npuNetConnected(Tcb *tp);
 void npuNetDisconnected(Tcb *tp);
 void npuNetSend(Tcb *tp, u8 *data, int len, u8 mfrId);
+bool npuNetSendBuffer(Tcb *tp, NpuBuffer *bp, u8 *data, int len, u8 blockSeqNo, u8 mfrId);
 void npuNetQueueAck(Tcb *tp, u8 blockSeqNo, u8 mfrId);
 void npuNetCheckStatus(u8 mfrId);
+void npuNetShowStats();
 
 /*
 **  npu_async.c
 */
-void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId);
+bool npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId);
 void npuAsyncProcessUplineData(Tcb *tp, u8 mfrId);
 void npuAsyncFlushUplineTransparent(Tcb *tp, u8 mfrId);
 
@@ -105,10 +105,11 @@ static u8 netCRLF[] = { ChrCR, ChrLF };
 **                  bp          buffer with downline data message.
 **                  last        last buffer.
 **
-**  Returns:        Nothing.
+**  Returns:        TRUE if the buffer was queued for output as it is and
+**                  must not be released by the caller.
 **
 **------------------------------------------------------------------------*/
-void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId)
+bool npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
@@ -122,7 +123,7 @@ void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId)
 	if (cn == 0 || cn > mfr->npuTcbCount)
 	{
 		npuLogMessage("ASYNC: unexpected CN %d - message ignored", cn);
-		return;
+		return(false);
 	}
 
 	mfr->npuTp = mfr->npuTcbs + cn - 1;
@@ -137,9 +138,19 @@ void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId)
 
 	if ((dbc & DbcTransparent) != 0)
 	{
+		/*
+		**  Transparent data goes out straight from the downline buffer
+		**  unless it needs Telnet escaping.
+		*/
+		u8 blockSeqNo = static_cast<u8>(bp->data[BlkOffBTBSN] & (BlkMaskBSN << BlkShiftBSN));
+		if (npuNetSendBuffer(mfr->npuTp, bp, blk, len, blockSeqNo, mfrId))
+		{
+			return(true);
+		}
+
 		npuNetSend(mfr->npuTp, blk, len, mfrId);
-		npuNetQueueAck(mfr->npuTp, static_cast<u8>(bp->data[BlkOffBTBSN] & (BlkMaskBSN << BlkShiftBSN)), mfrId);
-		return;
+		npuNetQueueAck(mfr->npuTp, blockSeqNo, mfrId);
+		return(false);
 	}
 
 	/*
@@ -209,6 +220,7 @@ void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last, u8 mfrId)
 	}
 
 	npuNetQueueAck(mfr->npuTp, static_cast<u8>(bp->data[BlkOffBTBSN] & (BlkMaskBSN << BlkShiftBSN)), mfrId);
+	return(false);
 }
 
 /*--------------------------------------------------------------------------
@@ -37,7 +37,18 @@
 **  Private Constants
 **  -----------------
 */
-#define NumBuffs        1000
+#define CacheLine       64
+#define SlabBuffs       64      // buffers added to a class at a time
+
+/*
+**  Data bytes and most buffers per size class.
+*/
+#define SmallSize       64
+#define SmallLimit      8192
+#define MediumSize      512
+#define MediumLimit     4096
+#define LargeSize       MaxBuffer
+#define LargeLimit      2048
 
 /*
 **  -----------------------
@@ -56,6 +67,7 @@
 **  Private Function Prototypes
 **  ---------------------------
 */
+static bool npuBipPoolGrow(NpuPool *pp, u8 sizeClass);
 
 /*
 **  ----------------
@@ -68,6 +80,7 @@
 **  Private Variables
 **  -----------------
 */
+static const char *poolName[NpuBufClasses] = { "small", "medium", "large" };
 
 /*
 **--------------------------------------------------------------------------
@@ -90,32 +103,25 @@ void npuBipInit(u8 mfrId)
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
 	/*
-	**  Allocate data buffer pool.
+	**  Set up the data buffer pools with one slab each, they grow on
+	**  demand up to their limit.
 	*/
-	mfr->bufCount = NumBuffs;
-	mfr->bufPool = static_cast<NpuBuffer*>(calloc(NumBuffs, sizeof(NpuBuffer)));
-	if (mfr->bufPool == nullptr)
-	{
-		fprintf(stderr, "Failed to allocate NPU data buffer pool\n");
-		exit(1);
-	}
+	static const int sizes[NpuBufClasses] = { SmallSize, MediumSize, LargeSize };
+	static const int limits[NpuBufClasses] = { SmallLimit, MediumLimit, LargeLimit };
 
-	/*
-	**  Link buffers into pool and link in data.
-	*/
-	NpuBuffer *bp = mfr->bufPool;
-	for (int count = NumBuffs - 1; count > 0; count--)
+	for (u8 i = 0; i < NpuBufClasses; i++)
 	{
-		/*
-		**  Link to next buffer.
-		*/
-		NpuBuffer *np = bp + 1;
-		bp->next = np;
-		bp = np;
+		NpuPool *pp = mfr->bufPools + i;
+		memset(pp, 0, sizeof(NpuPool));
+		pp->size = sizes[i];
+		pp->limit = limits[i];
+		if (!npuBipPoolGrow(pp, i))
+		{
+			fprintf(stderr, "Failed to allocate NPU data buffer pool\n");
+			exit(1);
+		}
 	}
 
-	bp->next = nullptr;
-
 	/*
 	**  Allocate upline buffer queue.
 	*/
@@ -165,18 +171,24 @@ void npuBipReset(u8 mfrId)
 **
 **  Parameters:     Name        Description.
 **
-**  Returns:        Current buffer count.
+**  Returns:        Current number of free buffers of all size classes.
 **
 **------------------------------------------------------------------------*/
 int npuBipBufCount(u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
+	int count = 0;
+
+	for (int i = 0; i < NpuBufClasses; i++)
+	{
+		count += mfr->bufPools[i].freeCount;
+	}
 
-	return (mfr->bufCount);
+	return (count);
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Allocate NPU buffer from pool.
+**  Purpose:        Allocate full size NPU buffer from pool.
 **
 **  Parameters:     Name        Description.
 **
@@ -185,20 +197,52 @@ int npuBipBufCount(u8 mfrId)
 **
 **------------------------------------------------------------------------*/
 NpuBuffer *npuBipBufGet(u8 mfrId)
+{
+	return(npuBipBufGetSized(MaxBuffer, mfrId));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate NPU buffer of the smallest size class which
+**                  holds the requested number of bytes. If that class is
+**                  exhausted a larger one is used.
+**
+**  Parameters:     Name        Description.
+**                  size        number of data bytes needed
+**
+**  Returns:        Pointer to newly allocated buffer or nullptr if pool
+**                  is empty.
+**
+**------------------------------------------------------------------------*/
+NpuBuffer *npuBipBufGetSized(int size, u8 mfrId)
 {
 	MMainFrame *mfr = BigIron->chasis[mfrId];
+	NpuBuffer *bp = nullptr;
 
-	/*
-	**  Allocate buffer from pool.
-	*/
-	NpuBuffer *bp = mfr->bufPool;
-	if (bp != nullptr)
+	for (u8 i = 0; i < NpuBufClasses; i++)
 	{
+		NpuPool *pp = mfr->bufPools + i;
+		if (pp->size < size)
+		{
+			continue;
+		}
+
+		if (pp->free == nullptr && !npuBipPoolGrow(pp, i))
+		{
+			pp->exhausted += 1;
+			continue;
+		}
+
 		/*
 		**  Unlink allocated buffer.
 		*/
-		mfr->bufPool = bp->next;
-		mfr->bufCount -= 1;
+		bp = pp->free;
+		pp->free = bp->next;
+		pp->freeCount -= 1;
+		pp->allocations += 1;
+		if (pp->highWater < pp->total - pp->freeCount)
+		{
+			pp->highWater = pp->total - pp->freeCount;
+		}
 
 		/*
 		**  Initialise buffer.
@@ -207,14 +251,13 @@ NpuBuffer *npuBipBufGet(u8 mfrId)
 		bp->offset = 0;
 		bp->numBytes = 0;
 		bp->blockSeqNo = 0;
-		//        memset(bp->data, 0, MaxBuffer);     // debug only
-	}
-	else
-	{
-		npuLogMessage("BIP: Out of buffers");
-		printf("Fatal error: BIP: Out of buffers - limping on\n");
+		//        memset(bp->data, 0, bp->size);     // debug only
+		return(bp);
 	}
 
+	npuLogMessage("BIP: Out of buffers");
+	printf("Fatal error: BIP: Out of buffers - limping on\n");
+
 	return(bp);
 }
 
@@ -234,11 +277,48 @@ void npuBipBufRelease(NpuBuffer *bp, u8 mfrId)
 	if (bp != nullptr)
 	{
 		/*
-		**  Link buffer back into the pool.
+		**  Link buffer back into the pool of its size class.
 		*/
-		bp->next = mfr->bufPool;
-		mfr->bufPool = bp;
-		mfr->bufCount += 1;
+		NpuPool *pp = mfr->bufPools + bp->sizeClass;
+		bp->next = pp->free;
+		pp->free = bp;
+		pp->freeCount += 1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show buffer pool statistics of all NPUs.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuBipShowStats()
+{
+	bool header = false;
+
+	for (int m = 0; m < BigIron->initMainFrames; m++)
+	{
+		MMainFrame *mfr = BigIron->chasis[m];
+		if (mfr == nullptr || mfr->bufPools[NpuBufLarge].total == 0)
+		{
+			continue;
+		}
+
+		if (!header)
+		{
+			printf("\n    NPU buffers:\n");
+			header = true;
+		}
+
+		for (int i = 0; i < NpuBufClasses; i++)
+		{
+			NpuPool *pp = mfr->bufPools + i;
+			printf("        MF%d %-6s %4d bytes: %d of %d allocated, %d free, high water %d, %lu allocations, %lu exhausted\n",
+				m, poolName[i], pp->size, pp->total, pp->limit, pp->freeCount, pp->highWater,
+				static_cast<unsigned long>(pp->allocations), static_cast<unsigned long>(pp->exhausted));
+		}
 	}
 }
 
@@ -544,7 +624,7 @@ void npuBipRequestUplineCanned(u8 *msg, int msgSize, u8 mfrId)
 {
 	//MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	NpuBuffer *bp = npuBipBufGet(mfrId);
+	NpuBuffer *bp = npuBipBufGetSized(msgSize, mfrId);
 	if (bp == nullptr)
 	{
 		return;
@@ -590,4 +670,58 @@ void npuBipNotifyUplineSent(u8 mfrId)
 **--------------------------------------------------------------------------
 */
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a slab of buffers to a pool unless it has reached
+**                  its limit. Each buffer is a header followed by its
+**                  data, both starting on a cache line.
+**
+**  Parameters:     Name        Description.
+**                  pp          pool
+**                  sizeClass   size class of the pool
+**
+**  Returns:        TRUE if buffers were added.
+**
+**------------------------------------------------------------------------*/
+static bool npuBipPoolGrow(NpuPool *pp, u8 sizeClass)
+{
+	int count = pp->limit - pp->total;
+	if (count <= 0)
+	{
+		return(false);
+	}
+
+	if (count > SlabBuffs)
+	{
+		count = SlabBuffs;
+	}
+
+	size_t header = (sizeof(NpuBuffer) + CacheLine - 1) & ~static_cast<size_t>(CacheLine - 1);
+	size_t stride = header + pp->size;
+
+	/*
+	**  Slabs are never freed, like the fixed pool they replace.
+	*/
+	u8 *slab = static_cast<u8 *>(calloc(1, stride * count + CacheLine - 1));
+	if (slab == nullptr)
+	{
+		return(false);
+	}
+
+	u8 *p = reinterpret_cast<u8 *>((reinterpret_cast<uintptr_t>(slab) + CacheLine - 1) & ~static_cast<uintptr_t>(CacheLine - 1));
+	for (int i = 0; i < count; i++, p += stride)
+	{
+		NpuBuffer *bp = reinterpret_cast<NpuBuffer *>(p);
+		bp->sizeClass = sizeClass;
+		bp->size = static_cast<u16>(pp->size);
+		bp->data = p + header;
+		bp->next = pp->free;
+		pp->free = bp;
+	}
+
+	pp->total += count;
+	pp->freeCount += count;
+
+	return(true);
+}
+
 /*---------------------------  End Of File  ------------------------------*/
@@ -47,6 +47,10 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <signal.h>
+#include <sys/uio.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
 #endif
 
 /*
@@ -55,12 +59,28 @@
 **  -----------------
 */
 #define Ms200       200000
+#define NetEvents   64
+#define NetWaitMs   100
+#define NetRetryMs  10
+#define NetListenBacklog    64
+#define NetAdmitRate        20      // connections per second and port
+#define NetAdmitBurst       20
+#define NetRefusedMs        2000    // keep refused connections open this long
+#define NetAbortedMs        1000
+#define NetIovMax           64      // buffers gathered per send
 
 /*
 **  -----------------------
 **  Private Macro Functions
 **  -----------------------
 */
+#if defined(_WIN32)
+#define netBarrier()    MemoryBarrier()
+#else
+#define netBarrier()    __sync_synchronize()
+#endif
+
+#define netPending(tp)  ((tp)->netRingIn != (tp)->netRingOut || ((tp)->netClosed && (tp)->netActive))
 
 /*
 **  -----------------------------------------
@@ -74,16 +94,30 @@
 **  ---------------------------
 */
 static void npuNetCreateThread(u8 mfrID);
+static void npuNetCreateIoThread(MMainFrame *mfr);
 #if defined(_WIN32)
 static void npuNetThread(void *param);
 static void npuNetThread1(void *param);
+static void npuNetIoThread(void *param);
 #else
 static void *npuNetThread(void *param);
 static void *npuNetThread1(void *param);
+static void *npuNetIoThread(void *param);
 #endif
+static void npuNetAcceptLoop(u8 mfrId, SOCKET *listenFd);
+static u64 npuNetAdmitRefill(NpuConnType *ct, u64 now);
+static void npuNetLinger(int fd, u32 ms, NpuConnType *ct, MMainFrame *mfr);
+static u64 npuNetLingerExpire(MMainFrame *mfr, u64 now);
 static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct, u8 mfrId);
 static void npuNetQueueOutput(Tcb *tp, u8 *data, int len, u8 mfrId);
 static void npuNetTryOutput(Tcb *tp, u8 mfrId);
+static void npuNetWatch(Tcb *tp, MMainFrame *mfr);
+static void npuNetClose(Tcb *tp, MMainFrame *mfr);
+static void npuNetReceive(Tcb *tp, MMainFrame *mfr, u32 generation);
+static void npuNetSignal(Tcb *tp, MMainFrame *mfr);
+static void npuNetCollect(MMainFrame *mfr);
+static void npuNetRequeue(Tcb *tp, MMainFrame *mfr);
+static void npuNetTakeInput(Tcb *tp);
 
 /*
 **  ----------------
@@ -207,10 +241,11 @@ void npuNetInit(bool startup, u8 mfrId)
 		}
 
 		/*
-		**  Setup for input data processing.
+		**  Nothing is ready for input processing yet.
 		*/
-		mfr->pollIndex = mfr->npuNetTcpConns;
-
+		mfr->netSignalQ = nullptr;
+		mfr->netReadyHead = nullptr;
+		mfr->netReadyTail = nullptr;
 	}
 	/*
 	**  Only do the following when the emulator starts up.
@@ -224,10 +259,41 @@ void npuNetInit(bool startup, u8 mfrId)
 		signal(SIGPIPE, SIG_IGN);
 #endif
 
+#if defined(_WIN32)
+		/*
+		**  Create the event the watched sockets signal to the network
+		**  I/O thread.
+		*/
+		mfr->netEvent = WSACreateEvent();
+		if (mfr->netEvent == WSA_INVALID_EVENT)
+		{
+			fprintf(stderr, "npuNet: Can't create network event\n");
+			exit(1);
+		}
+#elif defined(__linux__)
+		/*
+		**  Create the epoll instance used by the network I/O thread.
+		*/
+		mfr->netPollFd = epoll_create1(0);
+		if (mfr->netPollFd < 0)
+		{
+			fprintf(stderr, "npuNet: Can't create epoll instance\n");
+			exit(1);
+		}
+#endif
+
+		Tcb *tp = mfr->npuTcbs;
+		for (i = 0; i < mfr->npuNetTcpConns; i++, tp++)
+		{
+			InitializeCriticalSection(&tp->netLock);
+		}
+
 		/*
-		**  Create the thread which will deal with TCP connections.
+		**  Create the thread which will deal with TCP connections and
+		**  the one which moves data between sockets and TCBs.
 		*/
 		npuNetCreateThread(mfrId);
+		npuNetCreateIoThread(mfr);
 	}
 }
 
@@ -256,18 +322,27 @@ void npuNetReset(u8 mfrId)
 			/*
 			**  Notify user that network is going down and then disconnect.
 			*/
-			send(tp->connFd, networkDownMsg, sizeof(networkDownMsg) - 1, 0);
-
-#if defined(_WIN32)
-			closesocket(tp->connFd);
-#else
-			close(tp->connFd);
-#endif
+			if (tp->netActive)
+			{
+				send(tp->connFd, networkDownMsg, sizeof(networkDownMsg) - 1, 0);
+				npuNetClose(tp, mfr);
+			}
 
 			tp->state = StTermIdle;
 			tp->connFd = 0;
 		}
 	}
+
+	/*
+	**  Forget about any input still waiting to be processed.
+	*/
+#if defined(_WIN32)
+	InterlockedExchangePointer(reinterpret_cast<PVOID volatile *>(&mfr->netSignalQ), nullptr);
+#else
+	__sync_lock_test_and_set(&mfr->netSignalQ, static_cast<Tcb *>(nullptr));
+#endif
+	mfr->netReadyHead = nullptr;
+	mfr->netReadyTail = nullptr;
 }
 
 
@@ -298,13 +373,13 @@ void npuNetConnected(Tcb *tp)
 void npuNetDisconnected(Tcb *tp)
 {
 	/*
-	**  Received disconnect - close socket.
+	**  Received disconnect - close socket unless the network side
+	**  has already done so.
 	*/
-#if defined(_WIN32)
-	closesocket(tp->connFd);
-#else
-	close(tp->connFd);
-#endif
+	if (tp->netActive)
+	{
+		npuNetClose(tp, BigIron->chasis[tp->mfrId]);
+	}
 
 	/*
 	**  Cleanup connection.
@@ -379,6 +454,43 @@ void npuNetSend(Tcb *tp, u8 *data, int len, u8 mfrId)
 	}
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue part of a downline buffer for output without
+**                  copying it. The buffer then belongs to the output queue
+**                  and is released when sent, after which TIP is told to
+**                  acknowledge the block sequence number.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  bp          downline buffer
+**                  data        data address within the buffer
+**                  len         data length
+**                  blockSeqNo  block sequence number to acknowledge
+**
+**  Returns:        TRUE if the buffer was taken, FALSE if the data needs
+**                  Telnet escaping and must go through npuNetSend.
+**
+**------------------------------------------------------------------------*/
+bool npuNetSendBuffer(Tcb *tp, NpuBuffer *bp, u8 *data, int len, u8 blockSeqNo, u8 mfrId)
+{
+	if (tp->connType == ConnTypePterm
+		&& (memchr(data, 0xFF, len) != nullptr || memchr(data, 0x0D, len) != nullptr))
+	{
+		return(false);
+	}
+
+	bp->offset = static_cast<u16>(data - bp->data);
+	bp->numBytes = static_cast<u16>(len);
+	bp->blockSeqNo = blockSeqNo;
+	npuBipQueueAppend(bp, &tp->outputQ);
+
+	/*
+	**  Try to output the data on the network connection.
+	*/
+	npuNetTryOutput(tp, mfrId);
+	return(true);
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Store block sequence number to acknowledge when send
 **                  has completed in last buffer.
@@ -399,7 +511,7 @@ void npuNetQueueAck(Tcb *tp, u8 blockSeqNo, u8 mfrId)
 	NpuBuffer *bp = npuBipQueueGetLast(&tp->outputQ);
 	if (bp == nullptr || bp->blockSeqNo != 0)
 	{
-		bp = npuBipBufGet(mfrId);
+		bp = npuBipBufGetSized(0, mfrId);
 		npuBipQueueAppend(bp, &tp->outputQ);
 	}
 
@@ -417,6 +529,11 @@ void npuNetQueueAck(Tcb *tp, u8 blockSeqNo, u8 mfrId)
 /*--------------------------------------------------------------------------
 **  Purpose:        Check for network status.
 **
+**                  All socket input is done by the network I/O thread,
+**                  this only looks at memory: TCBs with running timers or
+**                  pending output and the list of TCBs which have input
+**                  or a disconnect waiting.
+**
 **  Parameters:     Name        Description.
 **
 **  Returns:        Nothing.
@@ -424,22 +541,11 @@ void npuNetQueueAck(Tcb *tp, u8 blockSeqNo, u8 mfrId)
 **------------------------------------------------------------------------*/
 void npuNetCheckStatus(u8 mfrId)
 {
-	static fd_set readFds;
-	static fd_set writeFds;
-	struct timeval timeout;
 	MMainFrame *mfr = BigIron->chasis[mfrId];
+	Tcb *tp = mfr->npuTcbs;
 
-	// ReSharper disable once CppInitializedValueIsAlwaysRewritten
-	int readySockets = 0;
-	Tcb *tp;
-
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 0;
-
-	while (mfr->pollIndex < mfr->npuNetTcpConns)
+	for (int i = 0; i < mfr->npuNetTcpConns; i++, tp++)
 	{
-		tp = mfr->npuTcbs + mfr->pollIndex++;
-
 		if (tp->state == StTermIdle)
 		{
 			continue;
@@ -454,51 +560,37 @@ void npuNetCheckStatus(u8 mfrId)
 		}
 
 		/*
-		**  Handle network traffic.
+		**  Send data if any is pending and the socket is not known to be full.
 		*/
-		FD_ZERO(&readFds);
-		FD_ZERO(&writeFds);
-		FD_SET(tp->connFd, &readFds);
-		FD_SET(tp->connFd, &writeFds);
-		readySockets = select(tp->connFd + 1, &readFds, &writeFds, nullptr, &timeout);
-		if (readySockets <= 0)
+		if (!tp->netBlocked && npuBipQueueNotEmpty(&tp->outputQ))
 		{
-			continue;
+			npuNetTryOutput(tp, mfrId);
 		}
+	}
 
-		if (npuBipQueueNotEmpty(&tp->outputQ) && FD_ISSET(tp->connFd, &writeFds))
+	/*
+	**  Process the next connection which has input or was dropped.
+	*/
+	npuNetCollect(mfr);
+	while ((tp = mfr->netReadyHead) != nullptr)
+	{
+		mfr->netReadyHead = tp->netReadyNext;
+		if (mfr->netReadyHead == nullptr)
 		{
-			/*
-			**  Send data if any is pending.
-			*/
-			npuNetTryOutput(tp, mfrId);
+			mfr->netReadyTail = nullptr;
 		}
 
-		if (FD_ISSET(tp->connFd, &readFds))
+		if (tp->state == StTermIdle)
 		{
 			/*
-			**  Receive a block of data.
+			**  Host side has already disconnected - discard input.
 			*/
-			tp->inputCount = recv(tp->connFd, reinterpret_cast<char*>(tp->inputData), sizeof(tp->inputData), 0);
-			if (tp->inputCount <= 0)
-			{
-				/*
-				**  Received disconnect - close socket.
-				*/
-#if defined(_WIN32)
-				closesocket(tp->connFd);
-#else
-				close(tp->connFd);
-#endif
-
-				npuLogMessage("npuNet: Connection dropped on port %d\n", tp->portNumber);
-
-				/*
-				**  Notify SVM.
-				*/
-				npuSvmDiscRequestTerminal(tp, mfrId);
-			}
-			else if (tp->state == StTermHostConnected)
+			tp->netRingOut = tp->netRingIn;
+		}
+		else if (tp->netRingIn != tp->netRingOut)
+		{
+			npuNetTakeInput(tp);
+			if (tp->state == StTermHostConnected)
 			{
 				/*
 				**  Hand up to the ASYNC TIP.
@@ -507,15 +599,68 @@ void npuNetCheckStatus(u8 mfrId)
 			}
 
 			/*
-			**  The following return ensures that we resume with polling the next
-			**  connection in sequence otherwise low-numbered connections would get
+			**  Only one block per call and remaining input goes to the end of
+			**  the list, otherwise low-numbered or busy connections would get
 			**  preferential treatment.
 			*/
+			npuNetRequeue(tp, mfr);
 			return;
 		}
+		else if (tp->netClosed && tp->netActive)
+		{
+			/*
+			**  Received disconnect - close socket.
+			*/
+			npuNetClose(tp, mfr);
+			npuLogMessage("npuNet: Connection dropped on port %d\n", tp->portNumber);
+
+			/*
+			**  Notify SVM.
+			*/
+			npuSvmDiscRequestTerminal(tp, mfrId);
+		}
+
+		npuNetRequeue(tp, mfr);
 	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show connection admission statistics of all NPU ports.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuNetShowStats()
+{
+	bool header = false;
+
+	for (int m = 0; m < BigIron->initMainFrames; m++)
+	{
+		MMainFrame *mfr = BigIron->chasis[m];
+		if (mfr == nullptr)
+		{
+			continue;
+		}
+
+		for (int i = 0; i < mfr->numConnTypes; i++)
+		{
+			NpuConnType *ct = mfr->connTypes + i;
+			if (!header)
+			{
+				printf("\n    NPU connections (admission limit %d/s, burst %d):\n", NetAdmitRate, NetAdmitBurst);
+				header = true;
+			}
 
-	mfr->pollIndex = 0;
+			printf("        MF%d port %u: %lu accepted, %lu refused, %lu aborted, %lu lingering, backlog %lu (peak %lu), %lu throttled\n",
+				m, ct->tcpPort,
+				static_cast<unsigned long>(ct->accepted), static_cast<unsigned long>(ct->refused),
+				static_cast<unsigned long>(ct->aborted), static_cast<unsigned long>(ct->lingering),
+				static_cast<unsigned long>(ct->backlog), static_cast<unsigned long>(ct->backlogPeak),
+				static_cast<unsigned long>(ct->throttled));
+		}
+	}
 }
 
 /*
@@ -592,23 +737,14 @@ static void *npuNetThread(void *param)
 	u8 mfrId = reinterpret_cast<u8>(param);
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	static fd_set selectFds;
-	static fd_set acceptFds;
 	SOCKET listenFd[MaxConnTypes];
-	SOCKET maxFd = 0;
 	struct sockaddr_in server;
-	struct sockaddr_in from;
 	int i;
 	int optEnable = 1;
 #if defined(_WIN32)
-	// ReSharper disable once CppJoinDeclarationAndAssignment
-	int fromLen;
 	u_long blockEnable = 1;
-#else
-	socklen_t fromLen;
 #endif
 
-	FD_ZERO(&selectFds);
 	/*
 	**  Create a listening socket for every configured connection type.
 	*/
@@ -663,7 +799,7 @@ static void *npuNetThread(void *param)
 		/*
 		**  Start listening for new connections on this TCP port number
 		*/
-		if (listen(listenFd[i], 5) < 0)
+		if (listen(listenFd[i], NetListenBacklog) < 0)
 		{
 			fprintf(stderr, "npuNet: Can't listen\n");
 #if defined(_WIN32)
@@ -672,61 +808,12 @@ static void *npuNetThread(void *param)
 			return(NULL);
 #endif
 		}
-
-		/*
-		**  Determine highest FD for later select
-		*/
-		if (maxFd < listenFd[i])
-		{
-			maxFd = listenFd[i];
-		}
-
-		/*
-		**  Add to set of listening FDs for later select
-		*/
-		FD_SET(listenFd[i], &selectFds);
 	}
 
-	for (;;)
-	{
-		/*
-		**  Wait for a connection on all sockets for the configured connection types.
-		*/
-		memcpy(&acceptFds, &selectFds, sizeof(selectFds));
-		int rc = select(static_cast<int>(maxFd) + 1, &acceptFds, nullptr, nullptr, nullptr);
-		if (rc <= 0)
-		{
-			fprintf(stderr, "npuNetThread: select returned unexpected %d\n", rc);
-#if defined(_WIN32)
-			Sleep(1000);
-#else
-			sleep(1);
-#endif
-			continue;
-		}
-
-		/*
-		**  Find the listening socket(s) with pending connections and accept them.
-		*/
-		for (i = 0; i < mfr->numConnTypes; i++)
-		{
-			//if (mfrId != mfr->connTypes[i].mfrId)
-			//	continue;
-			if (FD_ISSET(listenFd[i], &acceptFds))
-			{
-				// ReSharper disable once CppJoinDeclarationAndAssignment
-				fromLen = sizeof(from);
-				SOCKET acceptFd = accept(listenFd[i], reinterpret_cast<struct sockaddr *>(&from), &fromLen);
-				if (acceptFd == -1)
-				{
-					printf("npuNetThread: spurious connection attempt\n");
-					continue;
-				}
-
-				npuNetProcessNewConnection(static_cast<int>(acceptFd), mfr->connTypes + i, mfrId);
-			}
-		}
-	}
+	/*
+	**  Accept and admit connections until the emulator stops.
+	*/
+	npuNetAcceptLoop(mfrId, listenFd);
 
 #if !defined(_WIN32)
 	return(NULL);
@@ -742,25 +829,14 @@ static void *npuNetThread1(void *param)
 	u8 mfrId = reinterpret_cast<u8>(param);
 	MMainFrame *mfr = BigIron->chasis[mfrId];
 
-	static fd_set selectFds;
-	static fd_set acceptFds;
 	SOCKET listenFd[MaxConnTypes];
-	// ReSharper disable once CppJoinDeclarationAndAssignment
-	SOCKET acceptFd;
-	SOCKET maxFd = 0;
 	struct sockaddr_in server;
-	struct sockaddr_in from;
 	int i;
 	int optEnable = 1;
 #if defined(_WIN32)
-	// ReSharper disable once CppJoinDeclarationAndAssignment
-	int fromLen;
 	u_long blockEnable = 1;
-#else
-	socklen_t fromLen;
 #endif
 
-	FD_ZERO(&selectFds);
 	/*
 	**  Create a listening socket for every configured connection type.
 	*/
@@ -816,7 +892,7 @@ static void *npuNetThread1(void *param)
 		/*
 		**  Start listening for new connections on this TCP port number
 		*/
-		if (listen(listenFd[i], 5) < 0)
+		if (listen(listenFd[i], NetListenBacklog) < 0)
 		{
 			fprintf(stderr, "npuNet: Can't listen\n");
 #if defined(_WIN32)
@@ -825,31 +901,115 @@ static void *npuNetThread1(void *param)
 			return(NULL);
 #endif
 		}
+	}
 
-		/*
-		**  Determine highest FD for later select
-		*/
-		if (maxFd < listenFd[i])
-		{
-			maxFd = listenFd[i];
-		}
+	/*
+	**  Accept and admit connections until the emulator stops.
+	*/
+	npuNetAcceptLoop(mfrId, listenFd);
 
-		/*
-		**  Add to set of listening FDs for later select
-		*/
-		FD_SET(listenFd[i], &selectFds);
+#if !defined(_WIN32)
+	return(NULL);
+#endif
+}
+
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Accept connections on the listening sockets of a
+**                  mainframe. Each port admits at most NetAdmitRate
+**                  connections per second (with bursts up to
+**                  NetAdmitBurst); further attempts stay in the TCP
+**                  backlog until the port has tokens again. Refused
+**                  connections are closed here once their linger time
+**                  has passed.
+**
+**  Parameters:     Name        Description.
+**                  mfrId       mainframe ID
+**                  listenFd    listening socket per connection type
+**
+**  Returns:        Never.
+**
+**------------------------------------------------------------------------*/
+static void npuNetAcceptLoop(u8 mfrId, SOCKET *listenFd)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+	fd_set acceptFds;
+	struct timeval timeout;
+	struct sockaddr_in from;
+	int i;
+#if defined(_WIN32)
+	int fromLen;
+#else
+	socklen_t fromLen;
+#endif
+
+	u64 now = rtcHostMicroseconds();
+	for (i = 0; i < mfr->numConnTypes; i++)
+	{
+		mfr->connTypes[i].admitTokens = NetAdmitBurst;
+		mfr->connTypes[i].admitTime = now;
 	}
 
 	for (;;)
 	{
-		//if (mfrId != mfr->connTypes[i].mfrId)
-		//	continue;
 		/*
-		**  Wait for a connection on all sockets for the configured connection types.
+		**  Close refused connections which have lingered long enough and
+		**  work out how long we may wait for the next event.
 		*/
-		memcpy(&acceptFds, &selectFds, sizeof(selectFds));
-		int rc = select(static_cast<int>(maxFd) + 1, &acceptFds, nullptr, nullptr, nullptr);
-		if (rc <= 0)
+		now = rtcHostMicroseconds();
+		u64 wait = npuNetLingerExpire(mfr, now);
+
+		/*
+		**  Wait for a connection on all sockets for the connection types
+		**  which are currently allowed to admit one.
+		*/
+		SOCKET maxFd = 0;
+		int count = 0;
+		FD_ZERO(&acceptFds);
+		for (i = 0; i < mfr->numConnTypes; i++)
+		{
+			u64 refill = npuNetAdmitRefill(mfr->connTypes + i, now);
+			if (refill != 0)
+			{
+				if (wait == 0 || refill < wait)
+				{
+					wait = refill;
+				}
+
+				continue;
+			}
+
+			if (maxFd < listenFd[i])
+			{
+				maxFd = listenFd[i];
+			}
+
+			FD_SET(listenFd[i], &acceptFds);
+			count += 1;
+		}
+
+		if (count == 0)
+		{
+			/*
+			**  Every port is throttled - just wait for tokens.
+			*/
+#if defined(_WIN32)
+			Sleep(static_cast<DWORD>((wait + 999) / 1000));
+#else
+			usleep(static_cast<useconds_t>(wait));
+#endif
+			continue;
+		}
+
+		timeout.tv_sec = static_cast<long>(wait / 1000000);
+		timeout.tv_usec = static_cast<long>(wait % 1000000);
+		int rc = select(static_cast<int>(maxFd) + 1, &acceptFds, nullptr, nullptr, wait == 0 ? nullptr : &timeout);
+		if (rc == 0)
+		{
+			continue;
+		}
+
+		if (rc < 0)
 		{
 			fprintf(stderr, "npuNetThread: select returned unexpected %d\n", rc);
 #if defined(_WIN32)
@@ -861,48 +1021,189 @@ static void *npuNetThread1(void *param)
 		}
 
 		/*
-		**  Find the listening socket(s) with pending connections and accept them.
+		**  Find the listening socket(s) with pending connections and accept
+		**  as many as the rate limiter allows.
 		*/
 		for (i = 0; i < mfr->numConnTypes; i++)
 		{
-			if (FD_ISSET(listenFd[i], &acceptFds))
+			NpuConnType *ct = mfr->connTypes + i;
+			if (!FD_ISSET(listenFd[i], &acceptFds))
+			{
+				continue;
+			}
+
+			ct->backlog = 0;
+			while (ct->admitTokens > 0)
 			{
-				// ReSharper disable once CppJoinDeclarationAndAssignment
 				fromLen = sizeof(from);
-				// ReSharper disable once CppJoinDeclarationAndAssignment
-				acceptFd = accept(listenFd[i], reinterpret_cast<struct sockaddr *>(&from), &fromLen);
+				SOCKET acceptFd = accept(listenFd[i], reinterpret_cast<struct sockaddr *>(&from), &fromLen);
 				if (acceptFd == -1)
 				{
-					printf("npuNetThread: spurious connection attempt\n");
-					continue;
+					if (ct->backlog == 0)
+					{
+						printf("npuNetThread: spurious connection attempt\n");
+					}
+
+					break;
 				}
 
-				npuNetProcessNewConnection(static_cast<int>(acceptFd), mfr->connTypes + i, mfrId);
+				ct->admitTokens -= 1;
+				ct->backlog += 1;
+				npuNetProcessNewConnection(static_cast<int>(acceptFd), ct, mfrId);
+			}
+
+			if (ct->admitTokens == 0)
+			{
+				ct->throttled += 1;
+			}
+
+			if (ct->backlogPeak < ct->backlog)
+			{
+				ct->backlogPeak = ct->backlog;
 			}
 		}
 	}
-
-#if !defined(_WIN32)
-	return(NULL);
-#endif
 }
 
-
 /*--------------------------------------------------------------------------
-**  Purpose:        Process new TCP connection
+**  Purpose:        Refill the admission tokens of a connection type.
 **
 **  Parameters:     Name        Description.
-**                  acceptFd    New connection's FD
+**                  ct          connection type
+**                  now         host time in microseconds
 **
-**  Returns:        Nothing.
+**  Returns:        0 if a connection may be admitted, otherwise the
+**                  microseconds until the next token is due.
 **
 **------------------------------------------------------------------------*/
-static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct, u8 mfrId)
+static u64 npuNetAdmitRefill(NpuConnType *ct, u64 now)
 {
-	//MMainFrame *mfr = BigIron->chasis[mfrId];
+	const u64 interval = 1000000 / NetAdmitRate;
+	u64 elapsed = now - ct->admitTime;
 
-	u8 i;
-	int optEnable = 1;
+	if (ct->admitTokens >= NetAdmitBurst)
+	{
+		ct->admitTime = now;
+		return(0);
+	}
+
+	u64 tokens = elapsed / interval;
+	if (tokens > 0)
+	{
+		ct->admitTime += tokens * interval;
+		if (ct->admitTokens + tokens >= NetAdmitBurst)
+		{
+			ct->admitTokens = NetAdmitBurst;
+		}
+		else
+		{
+			ct->admitTokens += static_cast<u32>(tokens);
+		}
+	}
+
+	if (ct->admitTokens > 0)
+	{
+		return(0);
+	}
+
+	return(interval - (now - ct->admitTime));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Keep a refused connection open for a while so the user
+**                  gets to see why, then let the accept loop close it.
+**
+**  Parameters:     Name        Description.
+**                  fd          socket of the refused connection
+**                  ms          milliseconds to keep it open
+**                  ct          connection type it arrived on
+**                  mfr         mainframe
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetLinger(int fd, u32 ms, NpuConnType *ct, MMainFrame *mfr)
+{
+	NpuLinger *lp = static_cast<NpuLinger *>(calloc(1, sizeof(NpuLinger)));
+	if (lp == nullptr)
+	{
+		/*
+		**  Out of memory - close straight away.
+		*/
+#if defined(_WIN32)
+		closesocket(fd);
+#else
+		close(fd);
+#endif
+		return;
+	}
+
+	lp->fd = fd;
+	lp->closeTime = rtcHostMicroseconds() + static_cast<u64>(ms) * 1000;
+	lp->ct = ct;
+	lp->next = mfr->netLinger;
+	mfr->netLinger = lp;
+	ct->lingering += 1;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close refused connections whose linger time is over.
+**
+**  Parameters:     Name        Description.
+**                  mfr         mainframe
+**                  now         host time in microseconds
+**
+**  Returns:        Microseconds until the next one is due, 0 if none
+**                  are left.
+**
+**------------------------------------------------------------------------*/
+static u64 npuNetLingerExpire(MMainFrame *mfr, u64 now)
+{
+	NpuLinger **lpp = &mfr->netLinger;
+	NpuLinger *lp;
+	u64 wait = 0;
+
+	while ((lp = *lpp) != nullptr)
+	{
+		if (lp->closeTime > now)
+		{
+			if (wait == 0 || lp->closeTime - now < wait)
+			{
+				wait = lp->closeTime - now;
+			}
+
+			lpp = &lp->next;
+			continue;
+		}
+
+#if defined(_WIN32)
+		closesocket(lp->fd);
+#else
+		close(lp->fd);
+#endif
+		lp->ct->lingering -= 1;
+		*lpp = lp->next;
+		free(lp);
+	}
+
+	return(wait);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Process new TCP connection
+**
+**  Parameters:     Name        Description.
+**                  acceptFd    New connection's FD
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct, u8 mfrId)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrId];
+
+	u8 i;
+	int optEnable = 1;
 #if defined(_WIN32)
 	u_long blockEnable = 1;
 #endif
@@ -933,16 +1234,10 @@ static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct, u8 mfrId)
 		send(acceptFd, notReadyMsg, sizeof(notReadyMsg) - 1, 0);
 
 		/*
-		**  Wait a bit and then disconnect.
+		**  Disconnect after a while, without holding up other connections.
 		*/
-#if defined(_WIN32)
-		Sleep(2000);
-		closesocket(acceptFd);
-#else
-		sleep(2);
-		close(acceptFd);
-#endif
-
+		npuNetLinger(acceptFd, NetRefusedMs, ct, mfr);
+		ct->refused += 1;
 		return;
 	}
 
@@ -971,16 +1266,10 @@ static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct, u8 mfrId)
 		send(acceptFd, noPortsAvailMsg, sizeof(noPortsAvailMsg) - 1, 0);
 
 		/*
-		**  Wait a bit and then disconnect.
+		**  Disconnect after a while, without holding up other connections.
 		*/
-#if defined(_WIN32)
-		Sleep(2000);
-		closesocket(acceptFd);
-#else
-		sleep(2);
-		close(acceptFd);
-#endif
-
+		npuNetLinger(acceptFd, NetRefusedMs, ct, mfr);
+		ct->refused += 1;
 		return;
 	}
 
@@ -1007,18 +1296,20 @@ static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct, u8 mfrId)
 		send(tp->connFd, abortMsg, sizeof(abortMsg) - 1, 0);
 
 		/*
-		**  Wait a bit and then disconnect.
+		**  Disconnect after a while, without holding up other connections.
 		*/
-#if defined(_WIN32)
-		Sleep(1000);
-		closesocket(tp->connFd);
-#else
-		sleep(1);
-		close(tp->connFd);
-#endif
-
+		npuNetLinger(tp->connFd, NetAbortedMs, ct, mfr);
+		ct->aborted += 1;
 		tp->state = StTermIdle;
+		return;
 	}
+
+	ct->accepted += 1;
+
+	/*
+	**  Hand the socket to the network I/O thread.
+	*/
+	npuNetWatch(tp, mfr);
 }
 
 /*--------------------------------------------------------------------------
@@ -1041,7 +1332,7 @@ static void npuNetQueueOutput(Tcb *tp, u8 *data, int len, u8 mfrId)
 	NpuBuffer *bp = npuBipQueueGetLast(&tp->outputQ);
 	if (bp == nullptr || bp->blockSeqNo != 0)
 	{
-		bp = npuBipBufGet(mfrId);
+		bp = npuBipBufGetSized(len, mfrId);
 		npuBipQueueAppend(bp, &tp->outputQ);
 	}
 
@@ -1051,7 +1342,7 @@ static void npuNetQueueOutput(Tcb *tp, u8 *data, int len, u8 mfrId)
 		**  Append data to the buffer.
 		*/
 		u8 *startAddress = bp->data + bp->offset + bp->numBytes;
-		int byteCount = MaxBuffer - bp->offset - bp->numBytes;
+		int byteCount = bp->size - bp->offset - bp->numBytes;
 		if (byteCount >= len)
 		{
 			byteCount = len;
@@ -1067,14 +1358,16 @@ static void npuNetQueueOutput(Tcb *tp, u8 *data, int len, u8 mfrId)
 		len -= byteCount;
 		if (len > 0)
 		{
-			bp = npuBipBufGet(mfrId);
+			bp = npuBipBufGetSized(len, mfrId);
 			npuBipQueueAppend(bp, &tp->outputQ);
 		}
 	}
 }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Try to send any queued data.
+**  Purpose:        Try to send any queued data. The queued buffers are
+**                  gathered into one send per NetIovMax buffers, using
+**                  WSASend on Windows and writev on POSIX hosts.
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
@@ -1085,7 +1378,6 @@ static void npuNetQueueOutput(Tcb *tp, u8 *data, int len, u8 mfrId)
 static void npuNetTryOutput(Tcb *tp, u8 mfrId)
 {
 	NpuBuffer *bp;
-	int result;
 
 	/*
 	**  Return if we are flow controlled.
@@ -1095,68 +1387,678 @@ static void npuNetTryOutput(Tcb *tp, u8 mfrId)
 		return;
 	}
 
-	/*
-	**  Process all queued output buffers.
-	*/
-	while ((bp = npuBipQueueExtract(&tp->outputQ)) != nullptr)
-	{
-		u8 *data = bp->data + bp->offset;
+#if defined(_WIN32)
+	WSABUF iov[NetIovMax];
+#else
+	struct iovec iov[NetIovMax];
+#endif
 
+	while (npuBipQueueNotEmpty(&tp->outputQ))
+	{
 		/*
-		**  Don't call into TCP if there is no data to send.
+		**  Gather the data of the queued buffers.
 		*/
-		if (bp->numBytes > 0)
+		int count = 0;
+		size_t total = 0;
+		for (bp = tp->outputQ.first; bp != nullptr && count < NetIovMax; bp = bp->next)
 		{
-			result = send(tp->connFd, reinterpret_cast<const char*>(data), bp->numBytes, 0);
+			if (bp->numBytes > 0)
+			{
+#if defined(_WIN32)
+				iov[count].buf = reinterpret_cast<char *>(bp->data + bp->offset);
+				iov[count].len = bp->numBytes;
+#else
+				iov[count].iov_base = bp->data + bp->offset;
+				iov[count].iov_len = bp->numBytes;
+#endif
+				total += bp->numBytes;
+				count += 1;
+			}
 		}
-		else
+
+		/*
+		**  Don't call into TCP if there is no data to send. The socket is
+		**  marked blocked before the send so that a writable notification
+		**  arriving while we are still in the send is not lost.
+		**
+		**  On an error, likely a "would block" type of error, there is no
+		**  need to do anything here. The network I/O thread will clear
+		**  netBlocked when we can send again. Any disconnects or other
+		**  errors will be handled by the receive side.
+		*/
+		size_t sent = 0;
+		if (count > 0)
 		{
-			result = 0;
+			tp->netBlocked = true;
+#if defined(_WIN32)
+			DWORD result = 0;
+			if (WSASend(tp->connFd, iov, count, &result, 0, nullptr, nullptr) == SOCKET_ERROR)
+			{
+				return;
+			}
+#else
+			ssize_t result = writev(tp->connFd, iov, count);
+			if (result < 0)
+			{
+				return;
+			}
+#endif
+
+			sent = static_cast<size_t>(result);
+			if (sent == total)
+			{
+				tp->netBlocked = false;
+			}
 		}
 
-		if (result >= bp->numBytes)
+#if !defined(_WIN32)
+		bool complete = sent == total;
+#endif
+
+		/*
+		**  Release the buffers the socket took completely and let TIP know
+		**  which block sequence numbers were processed. The first buffer
+		**  which was only partly taken has its offset and count updated.
+		*/
+		while ((bp = tp->outputQ.first) != nullptr)
 		{
-			/*
-			**  The socket took all our data - let TIP know what block sequence
-			**  number we processed, free the buffer and then continue.
-			*/
+			if (bp->numBytes > sent)
+			{
+				bp->offset += static_cast<u16>(sent);
+				bp->numBytes -= static_cast<u16>(sent);
+				break;
+			}
+
+			sent -= bp->numBytes;
+			npuBipQueueExtract(&tp->outputQ);
 			if (bp->blockSeqNo != 0)
 			{
 				npuTipNotifySent(tp, bp->blockSeqNo, mfrId);
 			}
 
 			npuBipBufRelease(bp, mfrId);
-			continue;
 		}
 
 		/*
-		**  Not all has been sent. Put the buffer back into the queue.
+		**  Winsock posts FD_WRITE only after a send failed with
+		**  WSAEWOULDBLOCK, so on Windows a partial send is retried until
+		**  the socket takes everything or refuses more.
+		*/
+#if !defined(_WIN32)
+		if (!complete)
+		{
+			return;
+		}
+#endif
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the network I/O thread of a mainframe.
+**
+**  Parameters:     Name        Description.
+**                  mfr         mainframe owning the TCBs
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetCreateIoThread(MMainFrame *mfr)
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	/*
+	**  Create network I/O thread.
+	*/
+	HANDLE hThread = CreateThread(
+		nullptr,                                    // no security attribute 
+		0,                                          // default stack size 
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(npuNetIoThread),
+		static_cast<LPVOID>(mfr),                   // thread parameter 
+		0,                                          // not suspended 
+		&dwThreadId);                               // returns thread ID 
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create npuNet I/O thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	/*
+	**  Create POSIX thread with default attributes.
+	*/
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, npuNetIoThread, mfr);
+	if (rc < 0)
+	{
+		fprintf(stderr, "Failed to create npuNet I/O thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Network I/O thread. Receives into the TCB input rings
+**                  and notes when blocked sockets become writable. On
+**                  Linux this waits on edge-triggered epoll events. On
+**                  Windows it blocks on the event the watched sockets
+**                  signal and then selects the ready ones, on other
+**                  platforms it selects over the watched sockets.
+**
+**  Parameters:     Name        Description.
+**                  param       mainframe owning the TCBs
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void npuNetIoThread(void *param)
+#else
+static void *npuNetIoThread(void *param)
+#endif
+{
+	MMainFrame *mfr = static_cast<MMainFrame *>(param);
+	Tcb *tp;
+	int i;
+
+#if defined(__linux__) && !defined(_WIN32)
+	struct epoll_event events[NetEvents];
+	bool stalled = false;
+
+	while (BigIron->emulationActive)
+	{
+		int n = epoll_wait(mfr->netPollFd, events, NetEvents, stalled ? NetRetryMs : NetWaitMs);
+		for (i = 0; i < n; i++)
+		{
+			tp = static_cast<Tcb *>(events[i].data.ptr);
+			if ((events[i].events & EPOLLOUT) != 0)
+			{
+				tp->netBlocked = false;
+			}
+
+			if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0)
+			{
+				npuNetReceive(tp, mfr, tp->netGeneration);
+			}
+		}
+
+		/*
+		**  Edge-triggered input which did not fit into a ring is not
+		**  reported again, so retry those connections until it does.
 		*/
-		npuBipQueuePrepend(bp, &tp->outputQ);
+		stalled = false;
+		tp = mfr->npuTcbs;
+		for (i = 0; i < mfr->npuNetTcpConns; i++, tp++)
+		{
+			if (tp->netStalled && tp->netActive)
+			{
+				npuNetReceive(tp, mfr, tp->netGeneration);
+				stalled |= tp->netStalled;
+			}
+		}
+	}
+#else
+	static fd_set readFds;
+	static fd_set writeFds;
+	struct timeval timeout;
+	Tcb *batch[FD_SETSIZE];
+#if defined(_WIN32)
+	bool stalled = false;
+#endif
 
+	while (BigIron->emulationActive)
+	{
+#if defined(_WIN32)
 		/*
-		**  Was there an error?
+		**  Sleep until a watched socket has network events or a socket
+		**  is added. Input which did not fit into a ring is not reported
+		**  again, so retry those connections until it does.
 		*/
-		if (result < 0)
+		WSAWaitForMultipleEvents(1, &mfr->netEvent, FALSE, stalled ? NetRetryMs : NetWaitMs, FALSE);
+		WSAResetEvent(mfr->netEvent);
+		stalled = false;
+#else
+		bool waited = false;
+#endif
+		i = 0;
+		while (i < mfr->npuNetTcpConns)
 		{
 			/*
-			**  Likely this is a "would block" type of error - no need to do
-			**  anything here. The select() call will later tell us when we
-			**  can send again. Any disconnects or other errors will be handled
-			**  by the receive handler.
+			**  Collect as many watched sockets as fit into one select.
 			*/
-			return;
+			int n = 0;
+			SOCKET maxFd = 0;
+			FD_ZERO(&readFds);
+			FD_ZERO(&writeFds);
+			for (; i < mfr->npuNetTcpConns && n < FD_SETSIZE; i++)
+			{
+				tp = mfr->npuTcbs + i;
+				if (!tp->netActive || tp->netClosed)
+				{
+					continue;
+				}
+
+				bool room = tp->netRingIn - tp->netRingOut < NetRingSize;
+#if defined(_WIN32)
+				stalled |= !room;
+#endif
+				if (!room && !tp->netBlocked)
+				{
+					continue;
+				}
+
+				if (room)
+				{
+					FD_SET(tp->connFd, &readFds);
+				}
+
+				if (tp->netBlocked)
+				{
+					FD_SET(tp->connFd, &writeFds);
+				}
+
+				if (maxFd < static_cast<SOCKET>(tp->connFd))
+				{
+					maxFd = tp->connFd;
+				}
+
+				tp->netSelected = tp->netGeneration;
+				batch[n++] = tp;
+			}
+
+			if (n == 0)
+			{
+				continue;
+			}
+
+			timeout.tv_sec = 0;
+#if defined(_WIN32)
+			timeout.tv_usec = 0;
+#else
+			timeout.tv_usec = NetRetryMs * 1000;
+			waited = true;
+#endif
+			if (select(static_cast<int>(maxFd) + 1, &readFds, &writeFds, nullptr, &timeout) <= 0)
+			{
+				continue;
+			}
+
+			for (int j = 0; j < n; j++)
+			{
+				tp = batch[j];
+				if (FD_ISSET(tp->connFd, &writeFds))
+				{
+					tp->netBlocked = false;
+				}
+
+				if (FD_ISSET(tp->connFd, &readFds))
+				{
+					npuNetReceive(tp, mfr, tp->netSelected);
+				}
+			}
+		}
+
+#if !defined(_WIN32)
+		if (!waited)
+		{
+			usleep(NetRetryMs * 1000);
+		}
+#endif
+	}
+#endif
+
+#if !defined(_WIN32)
+	return(NULL);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hand a newly connected socket to the network I/O thread.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  mfr         mainframe owning the TCB
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetWatch(Tcb *tp, MMainFrame *mfr)
+{
+	/*
+	**  Start the new connection on an empty ring. Only the producer
+	**  index moves, the emulation thread may still be draining it.
+	*/
+	EnterCriticalSection(&tp->netLock);
+	tp->netRingIn = tp->netRingOut;
+	tp->netClosed = false;
+	tp->netBlocked = false;
+	tp->netStalled = false;
+	tp->netGeneration += 1;
+	netBarrier();
+	tp->netActive = true;
+	LeaveCriticalSection(&tp->netLock);
+
+#if defined(_WIN32)
+	if (WSAEventSelect(tp->connFd, mfr->netEvent, FD_READ | FD_WRITE | FD_CLOSE) == SOCKET_ERROR)
+	{
+		/*
+		**  Let the emulation thread drop the connection.
+		*/
+		tp->netClosed = true;
+		npuNetSignal(tp, mfr);
+	}
+
+	WSASetEvent(mfr->netEvent);
+#elif defined(__linux__)
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = tp;
+	if (epoll_ctl(mfr->netPollFd, EPOLL_CTL_ADD, tp->connFd, &ev) < 0)
+	{
+		/*
+		**  Let the emulation thread drop the connection.
+		*/
+		tp->netClosed = true;
+		npuNetSignal(tp, mfr);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Stop watching a connection, close its socket and
+**                  discard unprocessed input.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  mfr         mainframe owning the TCB
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetClose(Tcb *tp, MMainFrame *mfr)
+{
+	EnterCriticalSection(&tp->netLock);
+	tp->netActive = false;
+#if defined(_WIN32)
+	closesocket(tp->connFd);
+#else
+#if defined(__linux__)
+	epoll_ctl(mfr->netPollFd, EPOLL_CTL_DEL, tp->connFd, nullptr);
+#endif
+	close(tp->connFd);
+#endif
+	netBarrier();
+	tp->netRingOut = tp->netRingIn;
+	LeaveCriticalSection(&tp->netLock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Receive everything the socket has into the TCB input
+**                  ring (network I/O thread).
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  mfr         mainframe owning the TCB
+**                  generation  connection the data is for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetReceive(Tcb *tp, MMainFrame *mfr, u32 generation)
+{
+	bool received = false;
+
+	EnterCriticalSection(&tp->netLock);
+
+	/*
+	**  The connection may have been closed, and the TCB attached again,
+	**  since the socket was reported ready.
+	*/
+	while (tp->netActive && !tp->netClosed && tp->netGeneration == generation)
+	{
+		u32 room = NetRingSize - (tp->netRingIn - tp->netRingOut);
+		if (room == 0)
+		{
+			tp->netStalled = true;
+			break;
 		}
 
 		/*
-		**  The socket did not take all data - update offset and count.
+		**  Receive into the contiguous free part of the ring.
 		*/
-		if (result > 0)
+		u32 in = tp->netRingIn & (NetRingSize - 1);
+		if (room > NetRingSize - in)
 		{
-			bp->offset += result;
-			bp->numBytes -= result;
+			room = NetRingSize - in;
+		}
+
+		int count = recv(tp->connFd, reinterpret_cast<char *>(tp->netRing + in), room, 0);
+		if (count > 0)
+		{
+			netBarrier();
+			tp->netRingIn += count;
+			received = true;
+			continue;
+		}
+
+		tp->netStalled = false;
+		if (count < 0)
+		{
+#if defined(_WIN32)
+			if (WSAGetLastError() == WSAEWOULDBLOCK)
+			{
+				break;
+			}
+#else
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				break;
+			}
+#endif
 		}
+
+		/*
+		**  Orderly shutdown or error - the emulation thread closes the socket.
+		*/
+		netBarrier();
+		tp->netClosed = true;
+		received = true;
+		break;
+	}
+
+	LeaveCriticalSection(&tp->netLock);
+
+	if (received)
+	{
+		npuNetSignal(tp, mfr);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Tell the emulation thread that a connection needs
+**                  attention (network I/O thread).
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  mfr         mainframe owning the TCB
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetSignal(Tcb *tp, MMainFrame *mfr)
+{
+	Tcb *head;
+
+	/*
+	**  Already queued or on the ready list - it will be looked at anyway.
+	*/
+#if defined(_WIN32)
+	if (InterlockedExchange(&tp->netSignalled, 1) != 0)
+#else
+	if (__sync_lock_test_and_set(&tp->netSignalled, 1) != 0)
+#endif
+	{
+		return;
+	}
+
+	do
+	{
+		head = mfr->netSignalQ;
+		tp->netSignalNext = head;
+#if defined(_WIN32)
+	} while (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile *>(&mfr->netSignalQ), tp, head) != head);
+#else
+	} while (__sync_val_compare_and_swap(&mfr->netSignalQ, head, tp) != head);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Move signalled connections to the end of the ready list
+**                  in the order they were signalled.
+**
+**  Parameters:     Name        Description.
+**                  mfr         mainframe owning the TCBs
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetCollect(MMainFrame *mfr)
+{
+	Tcb *list;
+	Tcb *order = nullptr;
+
+	if (mfr->netSignalQ == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	list = static_cast<Tcb *>(InterlockedExchangePointer(reinterpret_cast<PVOID volatile *>(&mfr->netSignalQ), nullptr));
+#else
+	list = __sync_lock_test_and_set(&mfr->netSignalQ, static_cast<Tcb *>(nullptr));
+#endif
+
+	/*
+	**  The signal queue is a stack, reverse it.
+	*/
+	while (list != nullptr)
+	{
+		Tcb *next = list->netSignalNext;
+		list->netSignalNext = order;
+		order = list;
+		list = next;
 	}
+
+	while (order != nullptr)
+	{
+		order->netReadyNext = nullptr;
+		if (mfr->netReadyTail == nullptr)
+		{
+			mfr->netReadyHead = order;
+		}
+		else
+		{
+			mfr->netReadyTail->netReadyNext = order;
+		}
+
+		mfr->netReadyTail = order;
+		order = order->netSignalNext;
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Put a connection back on the ready list if it still
+**                  needs attention, otherwise allow it to be signalled
+**                  again.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer (already removed from the list)
+**                  mfr         mainframe owning the TCB
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetRequeue(Tcb *tp, MMainFrame *mfr)
+{
+	if (!netPending(tp))
+	{
+		/*
+		**  Clear the flag, then look again: input which arrived in between
+		**  was not signalled because the flag was still set.
+		*/
+#if defined(_WIN32)
+		InterlockedExchange(&tp->netSignalled, 0);
+#else
+		__sync_lock_release(&tp->netSignalled);
+#endif
+		netBarrier();
+		if (!netPending(tp))
+		{
+			return;
+		}
+
+#if defined(_WIN32)
+		if (InterlockedExchange(&tp->netSignalled, 1) != 0)
+#else
+		if (__sync_lock_test_and_set(&tp->netSignalled, 1) != 0)
+#endif
+		{
+			return;
+		}
+	}
+
+	tp->netReadyNext = nullptr;
+	if (mfr->netReadyTail == nullptr)
+	{
+		mfr->netReadyHead = tp;
+	}
+	else
+	{
+		mfr->netReadyTail->netReadyNext = tp;
+	}
+
+	mfr->netReadyTail = tp;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Move the next block of input from the ring to the
+**                  TCB input buffer.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetTakeInput(Tcb *tp)
+{
+	u32 count = tp->netRingIn - tp->netRingOut;
+	if (count > sizeof(tp->inputData))
+	{
+		count = sizeof(tp->inputData);
+	}
+
+	netBarrier();
+	for (u32 i = 0; i < count; i++)
+	{
+		tp->inputData[i] = tp->netRing[(tp->netRingOut + i) & (NetRingSize - 1)];
+	}
+
+	netBarrier();
+	tp->netRingOut += count;
+	tp->inputCount = static_cast<int>(count);
 }
 
 /*---------------------------  End Of File  ------------------------------*/
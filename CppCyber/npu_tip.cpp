@@ -31,6 +31,7 @@
 **  -------------
 */
 #include "stdafx.h"
+#include <stddef.h>
 
 /*
 **  -----------------
@@ -320,11 +321,12 @@ void npuTipReset(u8 mfrId)
 		Tcb *tp = mfr->npuTcbs;
 
 		/*
-		**  Iterate through all TCBs.
+		**  Iterate through all TCBs. The network lock at the end of
+		**  each TCB is left alone, the network I/O thread may hold it.
 		*/
 		for (int i = 0; i < mfr->npuNetTcpConns; i++, tp++)
 		{
-			memset(tp, 0, sizeof(Tcb));
+			memset(tp, 0, offsetof(Tcb, netGeneration));
 			tp->portNumber = i + 1;
 			tp->params = defaultTc3;
 			tp->tipType = TtASYNC;
@@ -415,7 +417,13 @@ void npuTipProcessBuffer(NpuBuffer *bp, int priority, u8 mfrId)
 		if (tp->state == StTermHostConnected)
 		{
 			bool last = (block[BlkOffBTBSN] & BlkMaskBT) == BtHTMSG;
-			npuAsyncProcessDownlineData(block[BlkOffCN], bp, last, mfrId);
+			if (npuAsyncProcessDownlineData(block[BlkOffCN], bp, last, mfrId))
+			{
+				/*
+				**  The buffer is now on the output queue.
+				*/
+				return;
+			}
 		}
 		else
 		{
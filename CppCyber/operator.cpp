@@ -89,9 +89,15 @@ static void opHelpLoadCards();
 static void opCmdLoadTape(bool help, char *cmdParams);
 static void opHelpLoadTape();
 
+static void opCmdMountVsn(bool help, char *cmdParams);
+static void opHelpMountVsn();
+
 static void opCmdShowTape(bool help, char *cmdParams);
 static void opHelpShowTape();
 
+static void opCmdShowDisk(bool help, char *cmdParams);
+static void opHelpShowDisk();
+
 static void opCmdUnloadTape(bool help, char *cmdParams);
 static void opHelpUnloadTape();
 
@@ -107,6 +113,18 @@ static void opHelpShutdown();
 static void opCmdPause(bool help, char *cmdParams);
 static void opHelpPause();
 
+static void opCmdShowStats(bool help, char *cmdParams);
+static void opHelpShowStats();
+
+static void opCmdSnapshot(bool help, char *cmdParams);
+static void opHelpSnapshot();
+
+static void opCmdConvertDisk(bool help, char *cmdParams);
+static void opHelpConvertDisk();
+
+static void opCmdCheckBitpack(bool help, char *cmdParams);
+static void opHelpCheckBitpack();
+
 // ReSharper disable once CppFunctionIsNotImplemented
 static void opCmdDumpDisk(bool help, char *cmdParams);	// DRS
 // ReSharper disable once CppFunctionIsNotImplemented
@@ -125,18 +143,30 @@ static void opHelpDumpDisk();
 */
 static OpCmd decode[] =
 {
+	"cb",                       opCmdCheckBitpack,
+	"cd",                       opCmdConvertDisk,
 	"lc",                       opCmdLoadCards,
 	"lt",                       opCmdLoadTape,
+	"mv",                       opCmdMountVsn,
 	"rc",                       opCmdRemoveCards,
 	"rp",                       opCmdRemovePaper,
 	"p",                        opCmdPause,
 	"st",                       opCmdShowTape,
+	"sd",                       opCmdShowDisk,
+	"sn",                       opCmdSnapshot,
+	"ss",                       opCmdShowStats,
 	"ut",                       opCmdUnloadTape,
+	"check_bitpack",            opCmdCheckBitpack,
+	"convert_disk",             opCmdConvertDisk,
 	"load_cards",               opCmdLoadCards,
 	"load_tape",                opCmdLoadTape,
+	"mount_vsn",                opCmdMountVsn,
 	"remove_cards",             opCmdRemoveCards,
 	"remove_paper",             opCmdRemovePaper,
+	"show_disk",                opCmdShowDisk,
 	"show_tape",                opCmdShowTape,
+	"show_stats",               opCmdShowStats,
+	"snapshot",                 opCmdSnapshot,
 	"unload_tape",              opCmdUnloadTape,
 	"?",                        opCmdHelp,
 	"help",                     opCmdHelp,
@@ -151,6 +181,7 @@ static OpCmd decode[] =
 static void(*opCmdFunction)(bool help, char *cmdParams);
 static char opCmdParams[256];
 static volatile bool opPaused = false;
+static volatile long opClaimed = 0;
 
 /*
 **--------------------------------------------------------------------------
@@ -178,7 +209,9 @@ void opInit()
 
 /*--------------------------------------------------------------------------
 **  Purpose:        Operator request handler called from the main emulation
-**                  thread to avoid race conditions.
+**                  thread to avoid race conditions. Every mainframe's
+**                  CPU 0 thread calls it, the first one to claim the
+**                  request executes the command.
 **
 **  Parameters:     Name        Description.
 **
@@ -187,6 +220,15 @@ void opInit()
 **------------------------------------------------------------------------*/
 void opRequest()
 {
+#if defined(_WIN32)
+	if (InterlockedCompareExchange(&opClaimed, 1, 0) != 0)
+#else
+	if (!__sync_bool_compare_and_swap(&opClaimed, 0, 1))
+#endif
+	{
+		return;
+	}
+
 	if (opActive)
 	{
 		opCmdFunction(false, opCmdParams);
@@ -199,6 +241,8 @@ void opRequest()
 
 		fflush(stdout);
 	}
+
+	opClaimed = 0;
 }
 
 /*
@@ -528,7 +572,7 @@ static void opCmdShutdown(bool help, char *cmdParams)
 	**  Process command.
 	*/
 	opActive = false;
-	BigIron->emulationActive = false;
+	BigIron->StopEmulation();
 
 	printf("\nThanks for using %s\nGoodbye for now.\n\n", DtCyberVersion);
 }
@@ -684,6 +728,45 @@ static void opHelpLoadTape()
 	printf("'load_tape <mainframe>,<channel>,<equipment>,<unit>,<r|w>,<filename>' load specified tape.\n");
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Mount a tape from the tape library
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdMountVsn(bool help, char *cmdParams)
+{
+	/*
+	**  Process help request.
+	*/
+	if (help)
+	{
+		opHelpMountVsn();
+		return;
+	}
+
+	/*
+	**  Check parameters and process command.
+	*/
+	if (strlen(cmdParams) == 0)
+	{
+		printf("parameters expected\n");
+		opHelpMountVsn();
+		return;
+	}
+
+	vtlMount(cmdParams);
+}
+
+static void opHelpMountVsn()
+{
+	printf("'mount_vsn <vsn>[,<r|w>[,<mainframe>]]' mount tape <vsn> from the tape library on a free MT679 unit.\n");
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Unload a mounted tape
 **
@@ -759,6 +842,7 @@ static void opCmdShowTape(bool help, char *cmdParams)
 	mt669ShowTapeStatus();
 	mt679ShowTapeStatus();
 	mt362xShowTapeStatus();
+	vtlShowStatus();
 }
 
 static void opHelpShowTape()
@@ -766,6 +850,205 @@ static void opHelpShowTape()
 	printf("'show_tape' show status of all tape units.\n");
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Show I/O statistics of all disk drives
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdShowDisk(bool help, char *cmdParams)
+{
+	/*
+	**  Process help request.
+	*/
+	if (help)
+	{
+		opHelpShowDisk();
+		return;
+	}
+
+	/*
+	**  Show the statistics, or write them to the given file.
+	*/
+	if (strlen(cmdParams) == 0)
+	{
+		dd8xxShowDiskStatus();
+	}
+	else if (!dd8xxDumpDiskStats(cmdParams))
+	{
+		printf("Failed to write %s\n", cmdParams);
+	}
+}
+
+static void opHelpShowDisk()
+{
+	printf("'show_disk [<filename>]' show I/O statistics of all disk drives, or write them to a file as comma separated values.\n");
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show emulator statistics
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdShowStats(bool help, char *cmdParams)
+{
+	/*
+	**  Process help request.
+	*/
+	if (help)
+	{
+		opHelpShowStats();
+		return;
+	}
+
+	/*
+	**  Check parameters and process command.
+	*/
+	if (strlen(cmdParams) != 0)
+	{
+		printf("no parameters expected\n");
+		opHelpShowStats();
+		return;
+	}
+
+	threadShowStats();
+	memStoreShowStats();
+	dd8xxShowStats();
+	npuBipShowStats();
+	npuNetShowStats();
+}
+
+static void opHelpShowStats()
+{
+	printf("'show_stats' show emulator thread and subsystem statistics.\n");
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Save the machine state to a snapshot file.
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdSnapshot(bool help, char *cmdParams)
+{
+	/*
+	**  Process help request.
+	*/
+	if (help)
+	{
+		opHelpSnapshot();
+		return;
+	}
+
+	/*
+	**  Check parameters and process command.
+	*/
+	if (strlen(cmdParams) == 0)
+	{
+		printf("parameters expected\n");
+		opHelpSnapshot();
+		return;
+	}
+
+	snapshotSave(cmdParams);
+}
+
+static void opHelpSnapshot()
+{
+	printf("'snapshot <filename>' save the machine state; start with resume=<filename> to continue from it.\n");
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert a disk container to sparse format.
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdConvertDisk(bool help, char *cmdParams)
+{
+	/*
+	**  Process help request.
+	*/
+	if (help)
+	{
+		opHelpConvertDisk();
+		return;
+	}
+
+	/*
+	**  Check parameters and process command.
+	*/
+	if (strlen(cmdParams) == 0)
+	{
+		printf("parameters expected\n");
+		opHelpConvertDisk();
+		return;
+	}
+
+	dd8xxConvertDisk(cmdParams);
+}
+
+static void opHelpConvertDisk()
+{
+	printf("'convert_disk <mainframe>,<channel>,<unit>' convert an 844/885 container to sparse format while it is in use.\n");
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check and time the disk and tape pack kernels.
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdCheckBitpack(bool help, char *cmdParams)
+{
+	/*
+	**  Process help request.
+	*/
+	if (help)
+	{
+		opHelpCheckBitpack();
+		return;
+	}
+
+	/*
+	**  Check parameters and process command.
+	*/
+	if (strlen(cmdParams) != 0)
+	{
+		printf("no parameters expected\n");
+		opHelpCheckBitpack();
+		return;
+	}
+
+	(void)bitpackCheck(true);
+}
+
+static void opHelpCheckBitpack()
+{
+	printf("'check_bitpack' check the vector pack kernels against the scalar loops and time both, including coded record conversion.\n");
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Remove paper from printer.
 **
@@ -65,6 +65,105 @@
 **  --------------------
 */
 
+/*
+**  CppCyber.cpp
+*/
+void threadShowStats();
+
+/*
+**  bitpack.cpp
+*/
+void bitpack8To12(u8 *ip, PpWord *op, u32 groups);
+void bitpack12To8(PpWord *ip, u8 *op, u32 groups);
+void bitpack6To12(u8 *ip, PpWord *op, u32 words);
+void bitpack12To6(PpWord *ip, u8 *op, u32 words);
+void bitpack8To12Bytes(u8 *ip, PpWord *op, u32 bytes, u8 fill);
+void bitpack6To12Bytes(u8 *ip, PpWord *op, u32 bytes);
+bool bitpackConvert8To12(u8 *ip, PpWord *op, u32 bytes, u8 *table);
+void bitpackConvert12To8(PpWord *ip, u8 *op, u32 words, u8 *table);
+bool bitpackCheck(bool report);
+
+/*
+**  memstore.cpp
+*/
+void memStoreInit(bool map, u32 sync, u32 checkpoint, bool restore, u32 hugePages, bool numa, char *share);
+CpWord *memStoreOpen(MemStore *ms, char *name, u32 words, u8 mfrID, bool local);
+void memStoreClose(MemStore *ms);
+void memStoreCut(u8 mfrID);
+void memStoreSync();
+void memStoreShowStats();
+void memStoreBindThread(u8 mfrID);
+void memStoreShareReady();
+bool memStoreShareOwner(MemStore *ms);
+
+/*
+**  snapshot.cpp
+*/
+void snapshotInit();
+bool snapshotSave(char *fileName);
+void snapshotHold(u8 mfrID);
+void snapshotRestore(char *fileName);
+void snapshotData(FILE *fcb, void *data, size_t size, bool restore);
+#define SnapshotVar(fcb, var, restore) snapshotData((fcb), &(var), sizeof(var), (restore))
+
+/*
+**  tap.cpp
+*/
+TapFile *tapOpen(FILE *fcb, char *name, u32 maxRecord);
+bool tapCompressed(const char *name);
+void tapClose(TapFile *tf);
+i32 tapRead(TapFile *tf, u8 **data);
+i32 tapReadBackward(TapFile *tf, u8 **data);
+bool tapSearchMark(TapFile *tf, bool forward, u32 *passed, bool *mark);
+void tapWrite(TapFile *tf, u8 *data, u32 length);
+void tapRewind(TapFile *tf);
+i64 tapPosition(TapFile *tf);
+void tapSnapshot(FILE *fcb, bool restore);
+void tapTerminate();
+
+/*
+**  vtl.cpp
+*/
+void vtlInit(char *dir, char *request, char *ring);
+void vtlMount(char *params);
+void vtlWatch(u8 mfrId, char ch);
+void vtlPoll(u8 mfrId);
+void vtlRelease(char *fileName);
+void vtlShowStatus();
+void vtlTerminate();
+
+/*
+**  spool.cpp
+*/
+Spool *spoolOpen(char *fileName, const char *mode);
+void spoolPut(Spool *sp, char ch);
+void spoolFlush(Spool *sp);
+void spoolComplete(Spool *sp, char *newName, const char *app);
+void spoolWrite(Spool *sp, const char *data, u32 bytes);
+void spoolTerminate();
+
+/*
+**  deck.cpp
+*/
+DeckTray *deckTrayOpen(DeckParse parse, u32 lineSize, void *param);
+bool deckQueue(DeckTray *tp, char *fileName);
+bool deckFeed(DeckTray *tp);
+DeckCard *deckNextCard(DeckTray *tp);
+void deckHotFolder(char *params);
+void deckWatch();
+
+/*
+**  muxio.cpp
+*/
+MuxPort *muxPortOpen(const char *name, int id);
+void muxPortAttach(MuxPort *pp, SOCKET fd);
+bool muxPortActive(MuxPort *pp);
+bool muxPortInputReady(MuxPort *pp);
+int muxPortGet(MuxPort *pp);
+void muxPortPut(MuxPort *pp, u8 data);
+void muxPortFlush(MuxPort *pp);
+void muxPortClose(MuxPort *pp);
+
 /*
 **  deadstart.c
 */
@@ -78,6 +177,7 @@ void rtcTick();
 void rtcStartTimer();
 double rtcStopTimer();
 void rtcReadUsCounter();
+u64 rtcHostMicroseconds();
 
 /*
 **  channel.c
@@ -97,6 +197,7 @@ void channelIn(u8 mfrId);
 void channelSetFull(u8 mfrId);
 void channelSetEmpty(u8 mfrId);
 void channelStep(u8 mfrID);
+bool channelSnapshot(u8 mfrID, FILE *fcb, bool restore);
 
 /*
 **  mt362x.c
@@ -127,6 +228,7 @@ void mt669ShowTapeStatus();
 void mt679Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 void mt679Terminate(DevSlot *dp);
 void mt679LoadTape(char *params);
+i8 mt679MountFree(u8 mfrId, char *fileName, bool ringIn);
 void mt679UnloadTape(char *params);
 void mt679ShowTapeStatus();
 
@@ -135,6 +237,7 @@ void mt679ShowTapeStatus();
 */
 void cr405Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 void cr405LoadCards(char *params);
+bool cr405LoadDeck(u8 mfrID, u8 channelNo, u8 equipmentNo, char *fileName);
 
 /*
 **  cp3446.c
@@ -147,6 +250,7 @@ void cp3446RemoveCards(char *params);
 */
 void cr3447Init(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 void cr3447LoadCards(char *params);
+bool cr3447LoadDeck(u8 mfrID, u8 channelNo, u8 equipmentNo, char *fileName);
 
 /*
 **  lp1612.c
@@ -178,6 +282,15 @@ void dd844Init_2(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 void dd844Init_4(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 void dd885Init_1(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 void dd885Dump(char *cmdParams);
+void dd8xxInitOptions(bool map, u8 sync, u32 cache, u32 readAhead);
+void dd8xxShowStats();
+void dd8xxShowDiskStatus();
+bool dd8xxDumpDiskStats(char *fileName);
+void dd8xxTerminate(DevSlot *ds);
+void dd8xxFlushCaches();
+bool dd8xxMergeOverlay(char *overlayName, char *baseName);
+void dd8xxConvertDisk(char *params);
+void dd8xxConvertFinish(u8 mfrID);
 
 #if CcDumpDisk == 1
 void dd8xxDumpDisk(char *params);		// DRS
@@ -365,6 +478,7 @@ extern char autoDateYear[40];
 extern char persistDir[];
 extern char printDir[];
 extern char printApp[];
+extern char punchApp[];
 
 /*
 ** Charset translation maps  - charset.cpp - leave global!
@@ -162,6 +162,40 @@ void rtcTick()
 	rtcClock += rtcIncrement;
 }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Return host time in microseconds. Unlike rtcGetTick
+**                  this does not depend on the configured clock increment,
+**                  so it may be used for host side accounting.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Microseconds since an arbitrary origin.
+**
+**------------------------------------------------------------------------*/
+u64 rtcHostMicroseconds()
+{
+#if defined(_WIN32)
+	static i64 frequency = 0;
+	LARGE_INTEGER ctr;
+
+	if (frequency == 0)
+	{
+		LARGE_INTEGER lhz;
+
+		QueryPerformanceFrequency(&lhz);
+		frequency = lhz.QuadPart;
+	}
+
+	QueryPerformanceCounter(&ctr);
+	return(static_cast<u64>((ctr.QuadPart / frequency) * 1000000 + ((ctr.QuadPart % frequency) * 1000000) / frequency));
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return((u64)tv.tv_sec * (u64)1000000 + (u64)tv.tv_usec);
+#endif
+}
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Start timing measurement.
 **
@@ -0,0 +1,516 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: snapshot.cpp
+**
+**  Description:
+**      Save the complete machine state to a file and restore it at
+**      startup instead of deadstarting.
+**
+**      The snapshot holds CM and ECS, every CPU and PP, every channel and
+**      the devices on it (generic state, unit file positions and, where
+**      a device provides one, its own snapshot hook), the RTC and the NPU
+**      host interface. Network connections can not be saved; terminals
+**      which were connected are disconnected from the host on resume and
+**      simply reconnect.
+**
+**      The equipment configuration used to resume must be the one the
+**      snapshot was taken with.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define SnapshotMagic           "CYBSNAP"
+#define SnapshotVersion         5
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct
+{
+	char            magic[8];           /* SnapshotMagic */
+	u32             version;            /* SnapshotVersion */
+	u32             mainFrames;         /* configured mainframes */
+	u32             cpus;               /* CPUs per mainframe */
+	u32             pps;                /* PPs per mainframe */
+	u32             cmWords;            /* CM size per mainframe */
+	u32             ecsWords;           /* ECS size */
+	u32             model;              /* ModelType */
+} SnapshotHeader;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static bool snapshotWrite(char *fileName);
+static bool snapshotMainFrame(MMainFrame *mfr, FILE *fcb, bool restore);
+static bool snapshotNpu(MMainFrame *mfr, FILE *fcb, bool restore);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static bool snapshotError;
+static CRITICAL_SECTION holdMutex;
+static CONDITION_VARIABLE holdChange;
+static int holdCount = 0;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Initialise the snapshot barrier. Called before the
+**                  emulation threads start.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void snapshotInit()
+{
+	InitializeCriticalSection(&holdMutex);
+	InitializeConditionVariable(&holdChange);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Save the machine state. Called by the operator
+**                  interface on the CPU 0 thread of whichever mainframe
+**                  took the request. The CPU 0 threads of the other
+**                  mainframes are stopped at their barrel boundaries
+**                  first, so no CPU changes CM or registers while the
+**                  snapshot is written.
+**
+**  Parameters:     Name        Description.
+**                  fileName    snapshot file
+**
+**  Returns:        true if the snapshot was written.
+**
+**------------------------------------------------------------------------*/
+bool snapshotSave(char *fileName)
+{
+	u64 start = rtcHostMicroseconds();
+
+	/*
+	**  Stop the CPU 0 threads of the other mainframes. The caller's own
+	**  mainframe is stopped already, it runs this command.
+	*/
+	EnterCriticalSection(&holdMutex);
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		BigIron->chasis[k]->snapshotHold = true;
+	}
+
+	while (holdCount < BigIron->initMainFrames - 1 && BigIron->emulationActive)
+	{
+		SleepConditionVariableCS(&holdChange, &holdMutex, 100);
+	}
+	LeaveCriticalSection(&holdMutex);
+
+	bool ok = BigIron->emulationActive && snapshotWrite(fileName);
+
+	EnterCriticalSection(&holdMutex);
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		BigIron->chasis[k]->snapshotHold = false;
+	}
+
+	WakeAllConditionVariable(&holdChange);
+	LeaveCriticalSection(&holdMutex);
+
+	if (ok)
+	{
+		printf("Snapshot written to %s in %.3f s\n", fileName,
+			static_cast<double>(static_cast<i64>(rtcHostMicroseconds() - start)) / 1000000.0);
+	}
+
+	return(ok);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Stop a mainframe while another one saves a snapshot.
+**                  Called by its CPU 0 thread between PP barrel passes,
+**                  outside SysPpMutex and PpuMutex.
+**
+**  Parameters:     Name        Description.
+**                  mfrID       mainframe ID
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void snapshotHold(u8 mfrID)
+{
+	MMainFrame *mfr = BigIron->chasis[mfrID];
+
+	EnterCriticalSection(&holdMutex);
+	if (mfr->snapshotHold)
+	{
+		holdCount += 1;
+		WakeAllConditionVariable(&holdChange);
+		while (mfr->snapshotHold && BigIron->emulationActive)
+		{
+			SleepConditionVariableCS(&holdChange, &holdMutex, 100);
+		}
+
+		holdCount -= 1;
+	}
+	LeaveCriticalSection(&holdMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Restore the machine state. Called at startup after
+**                  all mainframes have been initialised and deadstarted
+**                  but before any emulation thread runs.
+**
+**  Parameters:     Name        Description.
+**                  fileName    snapshot file
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void snapshotRestore(char *fileName)
+{
+	SnapshotHeader header;
+
+	FILE *fcb = fopen(fileName, "rb");
+	if (fcb == nullptr)
+	{
+		fprintf(stderr, "Failed to open snapshot %s\n", fileName);
+		exit(1);
+	}
+
+	snapshotError = false;
+	snapshotData(fcb, &header, sizeof(header), true);
+	if (snapshotError || memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || header.version != SnapshotVersion)
+	{
+		fprintf(stderr, "%s is not a snapshot file\n", fileName);
+		exit(1);
+	}
+
+	if (header.mainFrames != static_cast<u32>(BigIron->initMainFrames)
+		|| header.cpus != static_cast<u32>(BigIron->initCpus)
+		|| header.pps != static_cast<u32>(BigIron->pps)
+		|| header.cmWords != BigIron->chasis[0]->cpuMaxMemory
+		|| header.ecsWords != BigIron->extMaxMemory
+		|| header.model != static_cast<u32>(BigIron->modelType))
+	{
+		fprintf(stderr, "Snapshot %s was taken with a different model, memory or PP configuration\n", fileName);
+		exit(1);
+	}
+
+	SnapshotVar(fcb, rtcClock, true);
+
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		if (!snapshotMainFrame(BigIron->chasis[k], fcb, true))
+		{
+			fprintf(stderr, "Snapshot %s does not match the equipment configuration\n", fileName);
+			exit(1);
+		}
+	}
+
+	/*
+	**  ECS comes last. Other processes running on shared ECS keep theirs.
+	*/
+	if (memStoreShareOwner(&BigIron->ecsStore))
+	{
+		snapshotData(fcb, BigIron->extMem, BigIron->extMaxMemory * sizeof(CpWord), true);
+	}
+	else
+	{
+		printf("ECS is shared with running processes, not restored from %s\n", fileName);
+	}
+
+	fclose(fcb);
+
+	if (snapshotError)
+	{
+		fprintf(stderr, "Snapshot %s is truncated\n", fileName);
+		exit(1);
+	}
+
+	/*
+	**  The operating system is already up, don't type the date at it.
+	*/
+	autoDate = false;
+	autoDate1 = false;
+	autoDate2 = false;
+	autoDate3 = false;
+
+	printf("Resumed from snapshot %s\n", fileName);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write or read one item of a snapshot. Errors are
+**                  remembered and reported once the snapshot is done.
+**
+**  Parameters:     Name        Description.
+**                  fcb         snapshot file
+**                  data        item
+**                  size        item size in bytes
+**                  restore     true to read, false to write
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void snapshotData(FILE *fcb, void *data, size_t size, bool restore)
+{
+	if (snapshotError || size == 0)
+	{
+		return;
+	}
+
+	if (restore)
+	{
+		snapshotError = fread(data, 1, size, fcb) != size;
+	}
+	else
+	{
+		snapshotError = fwrite(data, 1, size, fcb) != size;
+	}
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the machine state while every mainframe stands.
+**
+**  Parameters:     Name        Description.
+**                  fileName    snapshot file
+**
+**  Returns:        true if the snapshot was written.
+**
+**------------------------------------------------------------------------*/
+static bool snapshotWrite(char *fileName)
+{
+	SnapshotHeader header;
+
+	FILE *fcb = fopen(fileName, "wb");
+	if (fcb == nullptr)
+	{
+		printf("Failed to create %s\n", fileName);
+		return(false);
+	}
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, SnapshotMagic);
+	header.version = SnapshotVersion;
+	header.mainFrames = BigIron->initMainFrames;
+	header.cpus = BigIron->initCpus;
+	header.pps = BigIron->pps;
+	header.cmWords = BigIron->chasis[0]->cpuMaxMemory;
+	header.ecsWords = BigIron->extMaxMemory;
+	header.model = BigIron->modelType;
+
+	/*
+	**  Stop the PPs and second CPU of every mainframe. Every CPU 0 thread
+	**  is stopped at a barrel boundary.
+	*/
+#if MaxMainFrames > 1
+	RESERVE(&BigIron->SysPpMutex);
+#endif
+	for (int k = 0; k < BigIron->initMainFrames; k++)
+	{
+		RESERVE(&BigIron->chasis[k]->PpuMutex);
+	}
+
+	/*
+	**  Containers must hold every sector written before the snapshot.
+	*/
+	dd8xxFlushCaches();
+
+	snapshotError = false;
+	snapshotData(fcb, &header, sizeof(header), false);
+	SnapshotVar(fcb, rtcClock, false);
+
+	for (int k = 0; k < BigIron->initMainFrames && !snapshotError; k++)
+	{
+		snapshotMainFrame(BigIron->chasis[k], fcb, false);
+	}
+
+	snapshotData(fcb, BigIron->extMem, BigIron->extMaxMemory * sizeof(CpWord), false);
+
+	for (int k = BigIron->initMainFrames - 1; k >= 0; k--)
+	{
+		RELEASE(&BigIron->chasis[k]->PpuMutex);
+	}
+#if MaxMainFrames > 1
+	RELEASE(&BigIron->SysPpMutex);
+#endif
+
+	if (fclose(fcb) != 0)
+	{
+		snapshotError = true;
+	}
+
+	if (snapshotError)
+	{
+		printf("Error writing %s\n", fileName);
+		return(false);
+	}
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write or read the state of one mainframe.
+**
+**  Parameters:     Name        Description.
+**                  mfr         mainframe
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        false if the snapshot does not match the configuration.
+**
+**------------------------------------------------------------------------*/
+static bool snapshotMainFrame(MMainFrame *mfr, FILE *fcb, bool restore)
+{
+	SnapshotVar(fcb, mfr->ecsFlagRegister, restore);
+	SnapshotVar(fcb, mfr->monitorCpu, restore);
+	SnapshotVar(fcb, mfr->cycles, restore);
+
+	snapshotData(fcb, mfr->cpMem, mfr->cpuMaxMemory * sizeof(CpWord), restore);
+
+	for (int i = 0; i < BigIron->initCpus; i++)
+	{
+		mfr->Acpu[i]->Snapshot(fcb, restore);
+	}
+
+	for (int pp = 0; pp < BigIron->pps; pp++)
+	{
+		mfr->ppBarrel[pp]->Snapshot(fcb, restore);
+	}
+
+	if (!channelSnapshot(mfr->mainFrameID, fcb, restore))
+	{
+		return(false);
+	}
+
+	return(snapshotNpu(mfr, fcb, restore));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write or read the NPU host interface and terminal
+**                  state of one mainframe. Connections do not survive,
+**                  so on restore the host is told that every terminal
+**                  which was connected has gone away.
+**
+**  Parameters:     Name        Description.
+**                  mfr         mainframe
+**                  fcb         snapshot file
+**                  restore     true to read, false to write
+**
+**  Returns:        false if the snapshot does not match the configuration.
+**
+**------------------------------------------------------------------------*/
+static bool snapshotNpu(MMainFrame *mfr, FILE *fcb, bool restore)
+{
+	int count = mfr->npuTcbCount;
+
+	SnapshotVar(fcb, count, restore);
+	if (count != mfr->npuTcbCount)
+	{
+		return(false);
+	}
+
+	SnapshotVar(fcb, mfr->svmState, restore);
+	SnapshotVar(fcb, mfr->hipState, restore);
+	SnapshotVar(fcb, mfr->oldRegLevel, restore);
+
+	for (int i = 0; i < count; i++)
+	{
+		Tcb *tp = mfr->npuTcbs + i;
+		TermConnState state = tp->state;
+
+		SnapshotVar(fcb, state, restore);
+		SnapshotVar(fcb, tp->enabled, restore);
+		SnapshotVar(fcb, tp->termName, restore);
+		SnapshotVar(fcb, tp->tipType, restore);
+		SnapshotVar(fcb, tp->subTip, restore);
+		SnapshotVar(fcb, tp->deviceType, restore);
+		SnapshotVar(fcb, tp->codeSet, restore);
+		SnapshotVar(fcb, tp->params, restore);
+		SnapshotVar(fcb, tp->uplineBsn, restore);
+
+		if (restore)
+		{
+			/*
+			**  Anything short of an established connection just goes back
+			**  to idle, an established one is torn down with TCN/TA/R.
+			*/
+			tp->active = false;
+			if (state == StTermHostConnected && mfr->svmState == mfr->StReady)
+			{
+				tp->state = StTermHostConnected;
+				npuSvmDiscRequestTerminal(tp, mfr->mainFrameID);
+			}
+			else
+			{
+				tp->state = StTermIdle;
+			}
+		}
+	}
+
+	if (restore)
+	{
+		mfr->bipState = mfr->BipIdle;
+	}
+
+	return(true);
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,810 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: spool.cpp
+**
+**  Description:
+**      Output spooler shared by the line printers and the card punch.
+**      The emulation collects output in large chunks and pushes each
+**      completed chunk on a lock free list; a spooler thread takes the
+**      whole list at once and writes the chunks to the output files in
+**      large writes.
+**
+**      Completing a file is queued behind its data, so the spooler
+**      closes, renames and reopens the file in order. A completed file
+**      may then be handed to a post-processor such as printApp, which
+**      runs on a small pool of worker threads and is retried if it
+**      fails.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#include <errno.h>
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  Bytes of output collected before a chunk is handed to the spooler.
+*/
+#define SpoolChunkSize          (64 * 1024)
+
+/*
+**  stdio buffer of an output file.
+*/
+#define SpoolBufferSize         (256 * 1024)
+
+/*
+**  Longest the spooler thread waits before looking for work.
+*/
+#define SpoolFlushMs            100
+
+/*
+**  Number of post-processor workers, attempts per file and the delay
+**  before a failed attempt is repeated.
+*/
+#define SpoolWorkers            2
+#define SpoolAttempts           3
+#define SpoolRetryMs            2000
+
+/*
+**  Chunk kinds.
+*/
+#define SpoolData               0
+#define SpoolComplete           1
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  Output on its way to the spooler, or a request to complete the
+**  file (data holds the new file name).
+*/
+typedef struct spoolChunk
+{
+	struct spoolChunk *next;
+	Spool       *sp;
+	u8          kind;
+	const char  *app;               /* post-processor of the completed file */
+	u32         bytes;
+	char        data[SpoolChunkSize];
+} SpoolChunk;
+
+/*
+**  Output file.
+*/
+struct spool
+{
+	struct spool *next;
+	FILE        *fcb;               /* owned by the spooler thread */
+	char        name[_MAX_PATH + 1];
+	const char  *mode;
+	SpoolChunk  *fill;              /* chunk being filled by the emulation */
+};
+
+/*
+**  Completed file waiting for the post-processor.
+*/
+typedef struct spoolJob
+{
+	struct spoolJob *next;
+	const char  *app;
+	char        name[_MAX_PATH + 1];
+} SpoolJob;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void spoolStartup();
+static SpoolChunk *spoolNewChunk(Spool *sp);
+static void spoolPush(SpoolChunk *cp);
+static void spoolDrain();
+static void spoolFinish(SpoolChunk *cp);
+static void spoolSubmit(const char *app, char *fileName);
+static bool spoolRunApp(const char *app, char *fileName);
+static void spoolCreateThread(bool worker);
+#if defined(_WIN32)
+static void spoolThread(void *param);
+static void spoolWorker(void *param);
+#else
+static void *spoolThread(void *param);
+static void *spoolWorker(void *param);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static Spool *firstSpool = nullptr;
+static SpoolChunk *volatile spoolQueue = nullptr;
+static bool spoolInitialised = false;
+static bool spoolWorkersRunning = false;
+static CRITICAL_SECTION spoolMutex;
+static CONDITION_VARIABLE spoolWork;
+static SpoolJob *firstJob = nullptr;
+static SpoolJob *lastJob = nullptr;
+static CRITICAL_SECTION spoolJobMutex;
+static CONDITION_VARIABLE spoolJobWork;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Open an output file and register it with the spooler.
+**
+**  Parameters:     Name        Description.
+**                  fileName    output file name
+**                  mode        fopen mode
+**
+**  Returns:        Spool handle, or nullptr if the file can't be opened.
+**
+**------------------------------------------------------------------------*/
+Spool *spoolOpen(char *fileName, const char *mode)
+{
+	FILE *fcb = fopen(fileName, mode);
+	if (fcb == nullptr)
+	{
+		return(nullptr);
+	}
+
+	setvbuf(fcb, nullptr, _IOFBF, SpoolBufferSize);
+
+	Spool *sp = static_cast<Spool *>(calloc(1, sizeof(Spool)));
+	if (sp == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate spool control block\n");
+		exit(1);
+	}
+
+	sp->fcb = fcb;
+	strncpy(sp->name, fileName, _MAX_PATH);
+	sp->mode = mode;
+
+	spoolStartup();
+
+	EnterCriticalSection(&spoolMutex);
+	sp->next = firstSpool;
+	firstSpool = sp;
+	LeaveCriticalSection(&spoolMutex);
+
+	return(sp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a character to the output.
+**
+**  Parameters:     Name        Description.
+**                  sp          spool handle
+**                  ch          character
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void spoolPut(Spool *sp, char ch)
+{
+	SpoolChunk *cp = sp->fill;
+	if (cp == nullptr)
+	{
+		cp = sp->fill = spoolNewChunk(sp);
+	}
+
+	cp->data[cp->bytes++] = ch;
+	if (cp->bytes == SpoolChunkSize)
+	{
+		sp->fill = nullptr;
+		spoolPush(cp);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a block of characters to the output.
+**
+**  Parameters:     Name        Description.
+**                  sp          spool handle
+**                  data        characters
+**                  bytes       number of characters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void spoolWrite(Spool *sp, const char *data, u32 bytes)
+{
+	while (bytes != 0)
+	{
+		SpoolChunk *cp = sp->fill;
+		if (cp == nullptr)
+		{
+			cp = sp->fill = spoolNewChunk(sp);
+		}
+
+		u32 copy = SpoolChunkSize - cp->bytes;
+		if (copy > bytes)
+		{
+			copy = bytes;
+		}
+
+		memcpy(cp->data + cp->bytes, data, copy);
+		cp->bytes += copy;
+		data += copy;
+		bytes -= copy;
+
+		if (cp->bytes == SpoolChunkSize)
+		{
+			sp->fill = nullptr;
+			spoolPush(cp);
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hand the output collected so far to the spooler.
+**
+**  Parameters:     Name        Description.
+**                  sp          spool handle
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void spoolFlush(Spool *sp)
+{
+	SpoolChunk *cp = sp->fill;
+	if (cp != nullptr)
+	{
+		sp->fill = nullptr;
+		spoolPush(cp);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Complete the output file. Once all data queued so far
+**                  is written the spooler renames the file and starts a
+**                  new one under the original name.
+**
+**  Parameters:     Name        Description.
+**                  sp          spool handle
+**                  newName     name of the completed file
+**                  app         post-processor to run on the completed
+**                              file, or nullptr
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void spoolComplete(Spool *sp, char *newName, const char *app)
+{
+	spoolFlush(sp);
+
+	SpoolChunk *cp = spoolNewChunk(sp);
+	cp->kind = SpoolComplete;
+	cp->app = app;
+	strncpy(cp->data, newName, _MAX_PATH);
+	spoolPush(cp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write out all spooled output and close the files.
+**                  Queued post-processing is abandoned; the completed
+**                  files are left in place.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void spoolTerminate()
+{
+	if (!spoolInitialised)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&spoolMutex);
+	for (Spool *sp = firstSpool; sp != nullptr; sp = sp->next)
+	{
+		spoolFlush(sp);
+	}
+
+	spoolDrain();
+
+	Spool *sp = firstSpool;
+	firstSpool = nullptr;
+	LeaveCriticalSection(&spoolMutex);
+
+	while (sp != nullptr)
+	{
+		Spool *next = sp->next;
+		if (sp->fcb != nullptr)
+		{
+			fclose(sp->fcb);
+		}
+
+		free(sp);
+		sp = next;
+	}
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Initialise the spooler and start its thread, once.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void spoolStartup()
+{
+	if (spoolInitialised)
+	{
+		return;
+	}
+
+	InitializeCriticalSection(&spoolMutex);
+	InitializeConditionVariable(&spoolWork);
+	InitializeCriticalSection(&spoolJobMutex);
+	InitializeConditionVariable(&spoolJobWork);
+	spoolInitialised = true;
+
+	spoolCreateThread(false);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate an empty chunk.
+**
+**  Parameters:     Name        Description.
+**                  sp          spool handle
+**
+**  Returns:        Chunk.
+**
+**------------------------------------------------------------------------*/
+static SpoolChunk *spoolNewChunk(Spool *sp)
+{
+	SpoolChunk *cp = static_cast<SpoolChunk *>(malloc(sizeof(SpoolChunk)));
+	if (cp == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate spool chunk\n");
+		exit(1);
+	}
+
+	cp->sp = sp;
+	cp->kind = SpoolData;
+	cp->app = nullptr;
+	cp->bytes = 0;
+
+	return(cp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Push a chunk on the spooler's list without locking
+**                  and wake the spooler.
+**
+**  Parameters:     Name        Description.
+**                  cp          chunk
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void spoolPush(SpoolChunk *cp)
+{
+	SpoolChunk *head;
+
+	do
+	{
+		head = spoolQueue;
+		cp->next = head;
+#if defined(_WIN32)
+	} while (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile *>(&spoolQueue), cp, head) != head);
+#else
+	} while (__sync_val_compare_and_swap(&spoolQueue, head, cp) != head);
+#endif
+
+	WakeConditionVariable(&spoolWork);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take all pushed chunks and write them out in the order
+**                  they were pushed. Called with spoolMutex held.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void spoolDrain()
+{
+	SpoolChunk *list;
+	SpoolChunk *cp;
+
+	while (spoolQueue != nullptr)
+	{
+#if defined(_WIN32)
+		list = static_cast<SpoolChunk *>(InterlockedExchangePointer(reinterpret_cast<PVOID volatile *>(&spoolQueue), nullptr));
+#else
+		list = __sync_lock_test_and_set(&spoolQueue, static_cast<SpoolChunk *>(nullptr));
+#endif
+
+		/*
+		**  The list is newest first, turn it around.
+		*/
+		SpoolChunk *ordered = nullptr;
+		while (list != nullptr)
+		{
+			cp = list;
+			list = cp->next;
+			cp->next = ordered;
+			ordered = cp;
+		}
+
+		while (ordered != nullptr)
+		{
+			cp = ordered;
+			ordered = cp->next;
+
+			if (cp->kind == SpoolComplete)
+			{
+				spoolFinish(cp);
+			}
+			else if (cp->sp->fcb != nullptr)
+			{
+				fwrite(cp->data, 1, cp->bytes, cp->sp->fcb);
+			}
+
+			free(cp);
+		}
+	}
+
+	/*
+	**  Let the files catch up while the devices are idle.
+	*/
+	for (Spool *sp = firstSpool; sp != nullptr; sp = sp->next)
+	{
+		if (sp->fcb != nullptr)
+		{
+			fflush(sp->fcb);
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Complete an output file: close and rename it, reopen
+**                  the original name and queue any post-processing.
+**
+**  Parameters:     Name        Description.
+**                  cp          completion request
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void spoolFinish(SpoolChunk *cp)
+{
+	Spool *sp = cp->sp;
+
+	if (sp->fcb != nullptr)
+	{
+		fclose(sp->fcb);
+		sp->fcb = nullptr;
+	}
+
+	bool renamed = rename(sp->name, cp->data) == 0;
+	if (!renamed)
+	{
+		printf("Could not rename %s to %s - %s\n", sp->name, cp->data, strerror(errno));
+	}
+
+	sp->fcb = fopen(sp->name, renamed ? sp->mode : "a");
+	if (sp->fcb == nullptr)
+	{
+		printf("Failed to open %s\n", sp->name);
+		return;
+	}
+
+	setvbuf(sp->fcb, nullptr, _IOFBF, SpoolBufferSize);
+
+	if (renamed && cp->app != nullptr)
+	{
+		spoolSubmit(cp->app, cp->data);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue a completed file for the post-processor.
+**
+**  Parameters:     Name        Description.
+**                  app         post-processor
+**                  fileName    completed file
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void spoolSubmit(const char *app, char *fileName)
+{
+	SpoolJob *jp = static_cast<SpoolJob *>(calloc(1, sizeof(SpoolJob)));
+	if (jp == nullptr)
+	{
+		printf("Failed to allocate spool job - %s not post-processed\n", fileName);
+		return;
+	}
+
+	jp->app = app;
+	strncpy(jp->name, fileName, _MAX_PATH);
+
+	EnterCriticalSection(&spoolJobMutex);
+	if (!spoolWorkersRunning)
+	{
+		spoolWorkersRunning = true;
+		for (int i = 0; i < SpoolWorkers; i++)
+		{
+			spoolCreateThread(true);
+		}
+	}
+
+	if (lastJob == nullptr)
+	{
+		firstJob = jp;
+	}
+	else
+	{
+		lastJob->next = jp;
+	}
+
+	lastJob = jp;
+	LeaveCriticalSection(&spoolJobMutex);
+
+	WakeConditionVariable(&spoolJobWork);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Run the post-processor on a completed file and wait
+**                  for it.
+**
+**  Parameters:     Name        Description.
+**                  app         post-processor
+**                  fileName    completed file
+**
+**  Returns:        true if the post-processor ran and succeeded.
+**
+**------------------------------------------------------------------------*/
+static bool spoolRunApp(const char *app, char *fileName)
+{
+#if defined(_WIN32)
+	for (char *p = fileName; *p != 0; p++)
+	{
+		if (*p == '/')
+		{
+			*p = '\\';
+		}
+	}
+
+	intptr_t ret = _spawnl(_P_WAIT, app, app, fileName, app, nullptr);
+	return(ret == 0);
+#else
+	int status;
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		execl(app, app, fileName, app, static_cast<char *>(nullptr));
+		_exit(127);
+	}
+
+	if (pid < 0 || waitpid(pid, &status, 0) < 0)
+	{
+		return(false);
+	}
+
+	return(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the spooler thread or a post-processor worker.
+**
+**  Parameters:     Name        Description.
+**                  worker      true for a post-processor worker
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void spoolCreateThread(bool worker)
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(worker ? spoolWorker : spoolThread),
+		static_cast<LPVOID>(nullptr),                               // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create spooler thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, worker ? spoolWorker : spoolThread, NULL);
+	if (rc != 0)
+	{
+		fprintf(stderr, "Failed to create spooler thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Spooler thread. Writes the pushed chunks, waking
+**                  when one is pushed or every SpoolFlushMs milliseconds.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void spoolThread(void *param)
+#else
+static void *spoolThread(void *param)
+#endif
+{
+	(void)param;
+
+	EnterCriticalSection(&spoolMutex);
+	while (BigIron->emulationActive)
+	{
+		if (spoolQueue == nullptr)
+		{
+			SleepConditionVariableCS(&spoolWork, &spoolMutex, SpoolFlushMs);
+		}
+
+		spoolDrain();
+	}
+
+	LeaveCriticalSection(&spoolMutex);
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Post-processor worker thread. Runs the post-processor
+**                  of each queued file, repeating a failed run up to
+**                  SpoolAttempts times.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void spoolWorker(void *param)
+#else
+static void *spoolWorker(void *param)
+#endif
+{
+	(void)param;
+
+	EnterCriticalSection(&spoolJobMutex);
+	while (BigIron->emulationActive)
+	{
+		SpoolJob *jp = firstJob;
+		if (jp == nullptr)
+		{
+			SleepConditionVariableCS(&spoolJobWork, &spoolJobMutex, SpoolFlushMs * 10);
+			continue;
+		}
+
+		firstJob = jp->next;
+		if (firstJob == nullptr)
+		{
+			lastJob = nullptr;
+		}
+
+		LeaveCriticalSection(&spoolJobMutex);
+
+		int attempt;
+		for (attempt = 1; attempt <= SpoolAttempts; attempt++)
+		{
+			if (spoolRunApp(jp->app, jp->name))
+			{
+				break;
+			}
+
+			if (attempt < SpoolAttempts)
+			{
+#if defined(_WIN32)
+				Sleep(SpoolRetryMs);
+#else
+				usleep(SpoolRetryMs * 1000);
+#endif
+			}
+		}
+
+		if (attempt > SpoolAttempts)
+		{
+			printf("\n%s failed on %s after %d attempts\n", jp->app, jp->name, SpoolAttempts);
+			printf("\nOperator> ");
+		}
+
+		free(jp);
+		EnterCriticalSection(&spoolJobMutex);
+	}
+
+	LeaveCriticalSection(&spoolJobMutex);
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -33,6 +33,10 @@
 
 #include "targetver.h"
 
+// Winsock 2 must come first, Windows.h would pull in Winsock 1 instead
+#if defined(_WIN32)
+#include <winsock2.h>
+#endif
 #include <Windows.h>
 #include <stdio.h>
 #include <tchar.h>
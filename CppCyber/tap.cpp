@@ -0,0 +1,1755 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: tap.cpp
+**
+**  Description:
+**      TAP tape containers shared by the tape drivers. A TAP record is a
+**      4 byte little endian length, the data and the length again; a
+**      tape mark is a single length of zero.
+**
+**      Records are read through a read only mapping of the container,
+**      so the data handed to a driver points straight into the host's
+**      file cache. Where the container cannot be mapped it is read with
+**      file I/O instead. Written records are collected in a large buffer
+**      which a writer thread puts to disk when it is full, at a tape mark
+**      or at the latest after TapFlushMs, so a record costs one copy
+**      rather than three writes. Any read or positioning first waits
+**      for the written data to reach the container.
+**
+**      Each container keeps an index of the records passed forward from
+**      the load point, so moving back over them, or forward again, needs
+**      no TAP headers.
+**
+**      Containers compressed with gzip (.gz) or zstd (.zst) are read only.
+**      They are streamed through the host's gzip or zstd command by a
+**      read-ahead thread per container into a ring of decompressed data.
+**      Moving back beyond what the ring still holds restarts the
+**      decompressor and skips forward again.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  Size of each of the two write buffers of a container.
+*/
+#define TapBufferSize           (1024 * 1024)
+
+/*
+**  Longest the writer thread waits before looking for work.
+*/
+#define TapFlushMs              100
+
+/*
+**  Initial number of index entries.
+*/
+#define TapIndexSize            1024
+
+/*
+**  Ring of a compressed container's decompressed data, the part of it
+**  kept behind the reader for moving back, and the most read from the
+**  decompressor at a time.
+*/
+#define TapStreamSize           (16 * 1024 * 1024)
+#define TapStreamBack           (4 * 1024 * 1024)
+#define TapStreamChunk          (1024 * 1024)
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if defined(_WIN32)
+#define TapOpenPipe(cmd)        _popen((cmd), "rb")
+#define TapClosePipe(pipe)      _pclose(pipe)
+#else
+#define TapOpenPipe(cmd)        popen((cmd), "r")
+#define TapClosePipe(pipe)      pclose(pipe)
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  Index entry of a record passed forward.
+*/
+typedef struct tapRecord
+{
+	i64         offset;             /* file offset of the TAP header */
+	u32         length;             /* record length, 0 for a tape mark */
+} TapRecord;
+
+/*
+**  Decompressed data of a compressed container. The read-ahead thread
+**  fills the ring at head while the reader takes data at or above low.
+**  Data below floor is no longer needed and may be overwritten.
+*/
+typedef struct tapStream
+{
+	char        *command;           /* decompressor command line */
+	u8          *ring;
+	i64         head;               /* bytes decompressed so far */
+	i64         low;                /* lowest offset still in the ring */
+	i64         floor;              /* lowest offset the reader still needs */
+	bool        eof;                /* decompressor finished */
+	bool        restart;            /* reader asks to start again */
+	bool        stop;               /* container closed, thread frees the stream */
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE produced;
+	CONDITION_VARIABLE consumed;
+} TapStream;
+
+/*
+**  Open TAP container.
+*/
+struct tapFile
+{
+	struct tapFile *next;
+	FILE        *fcb;
+	char        name[_MAX_PATH + 1];
+	u32         maxRecord;          /* longest record accepted */
+	i64         position;           /* file offset of the next TAP header */
+
+	/*
+	**  Reading.
+	*/
+	u8          *map;               /* mapping of the container or nullptr */
+	u64         mapBytes;           /* bytes mapped */
+	bool        mapValid;           /* mapping matches the container size */
+	u8          *buffer;            /* record read with file I/O */
+	TapStream   *stream;            /* decompressed data or nullptr */
+#if defined(_WIN32)
+	HANDLE      mapHandle;
+#endif
+
+	/*
+	**  Record index, from the load point up to end.
+	*/
+	TapRecord   *records;
+	u32         count;
+	u32         max;
+	i64         end;                /* file offset following the last record */
+
+	/*
+	**  Writing. The emulation fills one buffer while the writer thread
+	**  writes the other. lock covers the pending buffer and the FILE,
+	**  fillLock the fill buffer; lock is taken first.
+	*/
+	u8          *fill;
+	u32         fillBytes;
+	i64         fillStart;
+	u8          *pending;
+	u32         pendingBytes;
+	i64         pendingStart;
+	u32         bufferSize;
+	CRITICAL_SECTION lock;
+	CRITICAL_SECTION fillLock;
+
+	/*
+	**  Writer thread's use of the container, under tapListMutex.
+	*/
+	u32         writerPass;         /* last pass of the writer thread */
+	bool        writerBusy;         /* writer thread is flushing it */
+};
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static bool tapFetch(TapFile *tf, i64 offset, u32 bytes, u8 **data);
+static const char *tapDecompressor(const char *name);
+static char *tapCommand(const char *decompress, const char *name);
+static bool tapStreamFetch(TapFile *tf, i64 offset, u32 bytes);
+static void tapStreamCreateThread(TapStream *sp);
+#if defined(_WIN32)
+static void tapStreamThread(void *param);
+#else
+static void *tapStreamThread(void *param);
+#endif
+static void tapMap(TapFile *tf);
+static void tapUnmap(TapFile *tf);
+static void tapSync(TapFile *tf);
+static void tapHandOff(TapFile *tf);
+static void tapFlush(TapFile *tf);
+static void tapWaitWriter(TapFile *tf);
+static void tapWriteBuffer(TapFile *tf, i64 offset, u8 *buffer, u32 bytes);
+static void tapRelease(TapFile *tf);
+static u32 tapGet32(u8 *p);
+static void tapPut32(u8 *p, u32 value);
+static void tapIndexReset(TapFile *tf);
+static void tapIndexAdd(TapFile *tf, i64 position, u32 length, i64 end);
+static i32 tapIndexFind(TapFile *tf, i64 position);
+static void tapIndexTruncate(TapFile *tf, i64 position);
+static i64 tapIndexOffset(TapFile *tf, i32 record);
+static void tapCreateThread();
+#if defined(_WIN32)
+static void tapThread(void *param);
+#else
+static void *tapThread(void *param);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static TapFile *firstTap = nullptr;
+static bool tapInitialised = false;
+static bool tapWriterRunning = false;
+static CRITICAL_SECTION tapListMutex;
+static CONDITION_VARIABLE tapWork;
+static CONDITION_VARIABLE tapIdle;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Start using a TAP container just opened by a driver.
+**                  The driver keeps ownership of the FILE and closes it
+**                  after tapClose.
+**
+**  Parameters:     Name        Description.
+**                  fcb         container opened by the driver
+**                  name        file name for messages
+**                  maxRecord   longest record the driver accepts
+**
+**  Returns:        Container.
+**
+**------------------------------------------------------------------------*/
+TapFile *tapOpen(FILE *fcb, char *name, u32 maxRecord)
+{
+	if (!tapInitialised)
+	{
+		InitializeCriticalSection(&tapListMutex);
+		InitializeConditionVariable(&tapWork);
+		InitializeConditionVariable(&tapIdle);
+		tapInitialised = true;
+	}
+
+	TapFile *tf = static_cast<TapFile *>(calloc(1, sizeof(TapFile)));
+	if (tf != nullptr)
+	{
+		tf->buffer = static_cast<u8 *>(malloc(maxRecord + 8));
+	}
+
+	if (tf == nullptr || tf->buffer == nullptr)
+	{
+		fprintf(stderr, "Failed to allocate TAP container\n");
+		exit(1);
+	}
+
+	tf->fcb = fcb;
+	strncpy(tf->name, name, _MAX_PATH);
+	tf->maxRecord = maxRecord;
+	tf->position = TapTell(fcb);
+	tf->bufferSize = TapBufferSize > maxRecord + 8 ? TapBufferSize : maxRecord + 8;
+	InitializeCriticalSection(&tf->lock);
+	InitializeCriticalSection(&tf->fillLock);
+
+	/*
+	**  A compressed container is read through its decompressor.
+	*/
+	const char *decompress = tapDecompressor(name);
+	if (decompress != nullptr)
+	{
+		TapStream *sp = static_cast<TapStream *>(calloc(1, sizeof(TapStream)));
+		if (sp == nullptr || (sp->ring = static_cast<u8 *>(malloc(TapStreamSize))) == nullptr)
+		{
+			fprintf(stderr, "Failed to allocate TAP stream\n");
+			exit(1);
+		}
+
+		sp->command = tapCommand(decompress, name);
+		if (sp->command == nullptr)
+		{
+			logError(LogErrorLocation, "%s - file name can not be passed to %s", name, decompress);
+		}
+
+		InitializeCriticalSection(&sp->lock);
+		InitializeConditionVariable(&sp->produced);
+		InitializeConditionVariable(&sp->consumed);
+		tf->stream = sp;
+		tf->position = 0;
+		tapStreamCreateThread(sp);
+	}
+
+	EnterCriticalSection(&tapListMutex);
+	tf->next = firstTap;
+	firstTap = tf;
+	LeaveCriticalSection(&tapListMutex);
+
+	return(tf);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Tell whether a TAP container is compressed, and so
+**                  can only be read.
+**
+**  Parameters:     Name        Description.
+**                  name        file name
+**
+**  Returns:        TRUE if compressed.
+**
+**------------------------------------------------------------------------*/
+bool tapCompressed(const char *name)
+{
+	return(tapDecompressor(name) != nullptr);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Stop using a TAP container, writing out buffered
+**                  records. The FILE is left open and positioned.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void tapClose(TapFile *tf)
+{
+	if (tf == nullptr)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&tapListMutex);
+	TapFile **link = &firstTap;
+	while (*link != nullptr && *link != tf)
+	{
+		link = &(*link)->next;
+	}
+
+	if (*link != nullptr)
+	{
+		*link = tf->next;
+	}
+
+	tapWaitWriter(tf);
+	LeaveCriticalSection(&tapListMutex);
+
+	tapRelease(tf);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read the next record.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  data        returns the record data, valid until the
+**                              next call for this container; nullptr to
+**                              skip the record
+**
+**  Returns:        Record length, TapMark for a tape mark, TapEof at
+**                  the end of the container or TapError.
+**
+**------------------------------------------------------------------------*/
+i32 tapRead(TapFile *tf, u8 **data)
+{
+	u8 *p;
+	u32 padding = 0;
+
+	tapSync(tf);
+
+	i64 position = tf->position;
+
+	/*
+	**  An indexed record is passed without reading its headers.
+	*/
+	i32 record = tapIndexFind(tf, position);
+	if (record >= 0 && record < static_cast<i32>(tf->count))
+	{
+		u32 length = tf->records[record].length;
+		if (data != nullptr && length != 0 && !tapFetch(tf, position + 4, length, data))
+		{
+			logError(LogErrorLocation, "%s - short tape record read", tf->name);
+			return(TapError);
+		}
+
+		tf->position = tapIndexOffset(tf, record + 1);
+		return(static_cast<i32>(length));
+	}
+
+	/*
+	**  Read and verify TAP record length header.
+	*/
+	if (!tapFetch(tf, position, 4, &p))
+	{
+		return(TapEof);
+	}
+
+	u32 length = tapGet32(p);
+	if (length == 0)
+	{
+		tapIndexAdd(tf, position, 0, position + 4);
+		tf->position = position + 4;
+		return(TapMark);
+	}
+
+	if (length > tf->maxRecord)
+	{
+		logError(LogErrorLocation, "%s - tape record too long: %u", tf->name, length);
+		return(TapError);
+	}
+
+	/*
+	**  Verify the TAP record length trailer. A "padded" record has one
+	**  byte between the data and the trailer.
+	*/
+	if (!tapFetch(tf, position + 4 + length, 4, &p))
+	{
+		logError(LogErrorLocation, "%s - missing tape record trailer", tf->name);
+		return(TapError);
+	}
+
+	if (tapGet32(p) != length)
+	{
+		if (!tapFetch(tf, position + 5 + length, 4, &p) || tapGet32(p) != length)
+		{
+			logError(LogErrorLocation, "%s - invalid tape record trailer", tf->name);
+			return(TapError);
+		}
+
+		padding = 1;
+	}
+
+	if (data != nullptr && !tapFetch(tf, position + 4, length, data))
+	{
+		logError(LogErrorLocation, "%s - short tape record read", tf->name);
+		return(TapError);
+	}
+
+	tapIndexAdd(tf, position, length, position + 8 + length + padding);
+	tf->position = position + 8 + length + padding;
+
+	return(static_cast<i32>(length));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read the previous record, leaving the container
+**                  positioned at it.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  data        returns the record data as for tapRead,
+**                              nullptr to skip the record
+**
+**  Returns:        Record length, TapMark for a tape mark, TapBot at the
+**                  load point or TapError.
+**
+**------------------------------------------------------------------------*/
+i32 tapReadBackward(TapFile *tf, u8 **data)
+{
+	u8 *p;
+
+	tapSync(tf);
+
+	i64 position = tf->position;
+	if (position == 0)
+	{
+		return(TapBot);
+	}
+
+	/*
+	**  The previous record is taken from the index if it has been
+	**  passed before.
+	*/
+	i32 record = tapIndexFind(tf, position);
+	if (record > 0)
+	{
+		TapRecord *rp = tf->records + record - 1;
+		if (data != nullptr && rp->length != 0 && !tapFetch(tf, rp->offset + 4, rp->length, data))
+		{
+			logError(LogErrorLocation, "%s - short tape record read", tf->name);
+			return(TapError);
+		}
+
+		tf->position = rp->offset;
+		return(static_cast<i32>(rp->length));
+	}
+
+	/*
+	**  Read the length from the previous record's trailer.
+	*/
+	if (position < 4 || !tapFetch(tf, position - 4, 4, &p))
+	{
+		logError(LogErrorLocation, "%s - missing tape record trailer", tf->name);
+		return(TapError);
+	}
+
+	u32 length = tapGet32(p);
+	if (length == 0)
+	{
+		tf->position = position - 4;
+		return(TapMark);
+	}
+
+	if (length > tf->maxRecord)
+	{
+		logError(LogErrorLocation, "%s - tape record too long: %u", tf->name, length);
+		return(TapError);
+	}
+
+	/*
+	**  Verify the TAP record header, allowing for a padded record.
+	*/
+	i64 header = position - 8 - length;
+	if (header < 0 || !tapFetch(tf, header, 4, &p) || tapGet32(p) != length)
+	{
+		header -= 1;
+		if (header < 0 || !tapFetch(tf, header, 4, &p) || tapGet32(p) != length)
+		{
+			logError(LogErrorLocation, "%s - invalid tape record header", tf->name);
+			return(TapError);
+		}
+	}
+
+	if (data != nullptr && !tapFetch(tf, header + 4, length, data))
+	{
+		logError(LogErrorLocation, "%s - short tape record read", tf->name);
+		return(TapError);
+	}
+
+	tf->position = header;
+
+	return(static_cast<i32>(length));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Search for a tape mark through the index, forward or
+**                  backward, positioning past it (forward) or to it
+**                  (backward) without reading the container.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  forward     true to search forward
+**                  passed      returns the number of records passed
+**                  mark        returns true if a tape mark was passed
+**
+**  Returns:        false if the search must continue record by record
+**                  from the new position.
+**
+**------------------------------------------------------------------------*/
+bool tapSearchMark(TapFile *tf, bool forward, u32 *passed, bool *mark)
+{
+	*passed = 0;
+	*mark = false;
+
+	tapSync(tf);
+
+	i32 record = tapIndexFind(tf, tf->position);
+	if (record < 0)
+	{
+		return(false);
+	}
+
+	if (forward)
+	{
+		i32 count = static_cast<i32>(tf->count);
+		while (record < count && !*mark)
+		{
+			*mark = tf->records[record++].length == 0;
+			*passed += 1;
+		}
+
+		tf->position = tapIndexOffset(tf, record);
+
+		/*
+		**  Without a tape mark in the indexed part the search goes on
+		**  beyond it.
+		*/
+		return(*mark);
+	}
+
+	/*
+	**  Backward the search stops at the load point at the latest.
+	*/
+	while (record > 0 && !*mark)
+	{
+		*mark = tf->records[--record].length == 0;
+		*passed += 1;
+	}
+
+	tf->position = *passed == 0 ? 0 : tf->records[record].offset;
+
+	return(true);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write a record or a tape mark at the current position.
+**                  The record is buffered; a tape mark also hands the
+**                  buffer to the writer thread.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  data        record data
+**                  length      record length, 0 for a tape mark
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void tapWrite(TapFile *tf, u8 *data, u32 length)
+{
+	if (tf->stream != nullptr)
+	{
+		logError(LogErrorLocation, "%s - compressed tape can not be written", tf->name);
+		return;
+	}
+
+	i64 position = tf->position;
+	u32 bytes = length == 0 ? 4 : length + 8;
+
+	/*
+	**  Records beyond the write can no longer be reached.
+	*/
+	tapIndexTruncate(tf, position);
+	tapIndexAdd(tf, position, length, position + bytes);
+
+	if (tf->fill == nullptr)
+	{
+		EnterCriticalSection(&tf->lock);
+		EnterCriticalSection(&tf->fillLock);
+		tf->pending = static_cast<u8 *>(malloc(tf->bufferSize));
+		tf->fill = static_cast<u8 *>(malloc(tf->bufferSize));
+		LeaveCriticalSection(&tf->fillLock);
+		LeaveCriticalSection(&tf->lock);
+		if (tf->fill == nullptr || tf->pending == nullptr)
+		{
+			fprintf(stderr, "Failed to allocate TAP write buffer\n");
+			exit(1);
+		}
+
+		tapCreateThread();
+	}
+
+	/*
+	**  A write which does not follow the buffered ones, or does not fit,
+	**  starts a new buffer. The writer thread may take the buffer at any
+	**  time outside fillLock.
+	*/
+	EnterCriticalSection(&tf->fillLock);
+	bool handOff = tf->fillBytes != 0 && (tf->fillStart + tf->fillBytes != position || tf->fillBytes + bytes > tf->bufferSize);
+	LeaveCriticalSection(&tf->fillLock);
+
+	if (handOff)
+	{
+		tapHandOff(tf);
+	}
+
+	EnterCriticalSection(&tf->fillLock);
+	if (tf->fillBytes == 0)
+	{
+		tf->fillStart = position;
+	}
+
+	u8 *p = tf->fill + tf->fillBytes;
+	tapPut32(p, length);
+	if (length != 0)
+	{
+		memcpy(p + 4, data, length);
+		tapPut32(p + 4 + length, length);
+	}
+
+	tf->fillBytes += bytes;
+	LeaveCriticalSection(&tf->fillLock);
+
+	tf->position = position + bytes;
+	tf->mapValid = false;
+
+	if (length == 0)
+	{
+		tapHandOff(tf);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Position a container at the load point.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void tapRewind(TapFile *tf)
+{
+	tf->position = 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the position of a container.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        File offset of the next TAP header.
+**
+**------------------------------------------------------------------------*/
+i64 tapPosition(TapFile *tf)
+{
+	return(tf->position);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Keep a unit file which is a TAP container consistent
+**                  with a snapshot. Before the channel saves the file
+**                  position, the buffered records are written and the
+**                  FILE is positioned where the container is. After the
+**                  channel has restored the FILE position, the container
+**                  takes it over. Other files are left alone.
+**
+**  Parameters:     Name        Description.
+**                  fcb         unit file
+**                  restore     true after restoring, false before saving
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void tapSnapshot(FILE *fcb, bool restore)
+{
+	if (!tapInitialised)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&tapListMutex);
+	TapFile *tf = firstTap;
+	while (tf != nullptr && tf->fcb != fcb)
+	{
+		tf = tf->next;
+	}
+
+	LeaveCriticalSection(&tapListMutex);
+
+	if (tf == nullptr)
+	{
+		return;
+	}
+
+	tapSync(tf);
+	if (restore)
+	{
+		tf->position = TapTell(fcb);
+		tf->mapValid = false;
+		tapIndexReset(tf);
+	}
+	else
+	{
+		TapSeek(fcb, tf->position);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write out the buffered records of all containers and
+**                  release them. Called before the channels close their
+**                  unit files.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void tapTerminate()
+{
+	if (!tapInitialised)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&tapListMutex);
+	TapFile *tf = firstTap;
+	firstTap = nullptr;
+	for (TapFile *wp = tf; wp != nullptr; wp = wp->next)
+	{
+		tapWaitWriter(wp);
+	}
+
+	LeaveCriticalSection(&tapListMutex);
+
+	while (tf != nullptr)
+	{
+		TapFile *next = tf->next;
+		tapRelease(tf);
+		tf = next;
+	}
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Get bytes of a container, from the mapping if it
+**                  covers them, otherwise by reading them into the
+**                  container's record buffer.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  offset      file offset
+**                  bytes       number of bytes, at most maxRecord + 8
+**                  data        returns the bytes
+**
+**  Returns:        false if the container ends before the bytes.
+**
+**------------------------------------------------------------------------*/
+static bool tapFetch(TapFile *tf, i64 offset, u32 bytes, u8 **data)
+{
+	if (tf->stream != nullptr)
+	{
+		*data = tf->buffer;
+		return(tapStreamFetch(tf, offset, bytes));
+	}
+
+	if (!tf->mapValid)
+	{
+		tapMap(tf);
+	}
+
+	if (tf->map != nullptr && static_cast<u64>(offset) + bytes <= tf->mapBytes)
+	{
+		*data = tf->map + offset;
+		return(true);
+	}
+
+	EnterCriticalSection(&tf->lock);
+	size_t got = 0;
+	if (TapSeek(tf->fcb, offset) == 0)
+	{
+		got = fread(tf->buffer, 1, bytes, tf->fcb);
+	}
+
+	LeaveCriticalSection(&tf->lock);
+
+	*data = tf->buffer;
+
+	return(got == bytes);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the decompressor of a compressed container.
+**
+**  Parameters:     Name        Description.
+**                  name        file name
+**
+**  Returns:        Decompressor command or nullptr if not compressed.
+**
+**------------------------------------------------------------------------*/
+static const char *tapDecompressor(const char *name)
+{
+	size_t len = strlen(name);
+
+	if (len > 3 && strcmp(name + len - 3, ".gz") == 0)
+	{
+		return("gzip -dc");
+	}
+
+	if (len > 4 && strcmp(name + len - 4, ".zst") == 0)
+	{
+		return("zstd -dcq");
+	}
+
+	return(nullptr);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Build the command line which decompresses a container
+**                  to standard output. On POSIX hosts the name is single
+**                  quoted for the shell; on Windows, where a name can not
+**                  contain a double quote, it is double quoted and names
+**                  with characters cmd.exe expands even within quotes are
+**                  refused.
+**
+**  Parameters:     Name        Description.
+**                  decompress  decompressor command
+**                  name        file name
+**
+**  Returns:        Allocated command line or nullptr.
+**
+**------------------------------------------------------------------------*/
+static char *tapCommand(const char *decompress, const char *name)
+{
+	size_t len = strlen(decompress) + 4 * strlen(name) + 8;
+	char *command = static_cast<char *>(malloc(len));
+	if (command == nullptr)
+	{
+		return(nullptr);
+	}
+
+	char *cp = command + sprintf(command, "%s ", decompress);
+	for (const char *np = name; *np != 0; np++)
+	{
+		if (static_cast<u8>(*np) < ' ')
+		{
+			free(command);
+			return(nullptr);
+		}
+	}
+
+#if defined(_WIN32)
+	if (strpbrk(name, "\"%!") != nullptr)
+	{
+		free(command);
+		return(nullptr);
+	}
+
+	sprintf(cp, "\"%s\"", name);
+#else
+	*cp++ = '\'';
+	for (const char *np = name; *np != 0; np++)
+	{
+		if (*np == '\'')
+		{
+			/*
+			**  Close the quote, add an escaped quote and open it again.
+			*/
+			memcpy(cp, "'\\''", 4);
+			cp += 4;
+		}
+		else
+		{
+			*cp++ = *np;
+		}
+	}
+
+	*cp++ = '\'';
+	*cp = 0;
+#endif
+
+	return(command);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Get bytes of a compressed container into its record
+**                  buffer, waiting for the read-ahead thread to
+**                  decompress them. Bytes no longer in the ring are got
+**                  by restarting the decompressor.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  offset      offset in the decompressed data
+**                  bytes       number of bytes, at most maxRecord + 8
+**
+**  Returns:        false if the container ends before the bytes.
+**
+**------------------------------------------------------------------------*/
+static bool tapStreamFetch(TapFile *tf, i64 offset, u32 bytes)
+{
+	TapStream *sp = tf->stream;
+
+	EnterCriticalSection(&sp->lock);
+
+	if (offset < sp->low)
+	{
+		sp->restart = true;
+		WakeConditionVariable(&sp->consumed);
+		while (sp->restart)
+		{
+			SleepConditionVariableCS(&sp->produced, &sp->lock, INFINITE);
+		}
+	}
+
+	/*
+	**  Let the thread go on reading ahead, keeping some data for moving
+	**  back.
+	*/
+	sp->floor = offset > TapStreamBack ? offset - TapStreamBack : 0;
+	WakeConditionVariable(&sp->consumed);
+
+	while (sp->head < offset + bytes && !sp->eof)
+	{
+		SleepConditionVariableCS(&sp->produced, &sp->lock, INFINITE);
+	}
+
+	bool ok = sp->head >= offset + bytes;
+	if (ok)
+	{
+		u32 start = static_cast<u32>(offset % TapStreamSize);
+		u32 first = TapStreamSize - start < bytes ? TapStreamSize - start : bytes;
+		memcpy(tf->buffer, sp->ring + start, first);
+		memcpy(tf->buffer + first, sp->ring, bytes - first);
+	}
+
+	LeaveCriticalSection(&sp->lock);
+
+	return(ok);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the read-ahead thread of a compressed container.
+**
+**  Parameters:     Name        Description.
+**                  sp          stream
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapStreamCreateThread(TapStream *sp)
+{
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(tapStreamThread),
+		static_cast<LPVOID>(sp),                                    // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create TAP read-ahead thread\n");
+		exit(1);
+	}
+
+	CloseHandle(hThread);
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, tapStreamThread, sp);
+	if (rc != 0)
+	{
+		fprintf(stderr, "Failed to create TAP read-ahead thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read-ahead thread of a compressed container. Reads
+**                  the decompressor's output into the ring as far ahead
+**                  of the reader as the ring allows, starting the
+**                  decompressor again when the reader asks for it.
+**
+**  Parameters:     Name        Description.
+**                  param       stream
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void tapStreamThread(void *param)
+#else
+static void *tapStreamThread(void *param)
+#endif
+{
+	TapStream *sp = static_cast<TapStream *>(param);
+
+	EnterCriticalSection(&sp->lock);
+	while (!sp->stop)
+	{
+		sp->head = 0;
+		sp->low = 0;
+		sp->floor = 0;
+		sp->eof = false;
+		sp->restart = false;
+		WakeConditionVariable(&sp->produced);
+		LeaveCriticalSection(&sp->lock);
+
+		FILE *pipe = sp->command != nullptr ? TapOpenPipe(sp->command) : nullptr;
+
+		EnterCriticalSection(&sp->lock);
+		while (pipe != nullptr && !sp->stop && !sp->restart)
+		{
+			if (sp->head >= sp->floor + TapStreamSize)
+			{
+				SleepConditionVariableCS(&sp->consumed, &sp->lock, INFINITE);
+				continue;
+			}
+
+			/*
+			**  The part of the ring about to be read into is given up
+			**  first; the reader no longer needs it.
+			*/
+			u32 start = static_cast<u32>(sp->head % TapStreamSize);
+			i64 room = sp->floor + TapStreamSize - sp->head;
+			u32 chunk = TapStreamSize - start < TapStreamChunk ? TapStreamSize - start : TapStreamChunk;
+			if (chunk > room)
+			{
+				chunk = static_cast<u32>(room);
+			}
+
+			if (sp->head + chunk - TapStreamSize > sp->low)
+			{
+				sp->low = sp->head + chunk - TapStreamSize;
+			}
+
+			LeaveCriticalSection(&sp->lock);
+			size_t got = fread(sp->ring + start, 1, chunk, pipe);
+			EnterCriticalSection(&sp->lock);
+
+			if (got == 0)
+			{
+				break;
+			}
+
+			sp->head += got;
+			WakeConditionVariable(&sp->produced);
+		}
+
+		LeaveCriticalSection(&sp->lock);
+		int status = pipe != nullptr ? TapClosePipe(pipe) : -1;
+		EnterCriticalSection(&sp->lock);
+
+		if (sp->stop || sp->restart)
+		{
+			continue;
+		}
+
+		if (status != 0)
+		{
+			logError(LogErrorLocation, "decompressing tape failed: %s", sp->command != nullptr ? sp->command : "invalid file name");
+		}
+
+		/*
+		**  Everything has been read; wait until the reader wants to
+		**  start again or closes the container.
+		*/
+		sp->eof = true;
+		WakeConditionVariable(&sp->produced);
+		while (!sp->stop && !sp->restart)
+		{
+			SleepConditionVariableCS(&sp->consumed, &sp->lock, INFINITE);
+		}
+	}
+
+	LeaveCriticalSection(&sp->lock);
+
+	DeleteCriticalSection(&sp->lock);
+	free(sp->command);
+	free(sp->ring);
+	free(sp);
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Map a container read only at its current size. An
+**                  empty container, or one which cannot be mapped, is
+**                  left unmapped and read with file I/O.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapMap(TapFile *tf)
+{
+	tapUnmap(tf);
+	tf->mapValid = true;
+
+#if defined(_WIN32)
+	LARGE_INTEGER size;
+	HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(tf->fcb)));
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	tf->mapHandle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (tf->mapHandle == nullptr)
+	{
+		return;
+	}
+
+	tf->map = static_cast<u8 *>(MapViewOfFile(tf->mapHandle, FILE_MAP_READ, 0, 0, 0));
+	if (tf->map == nullptr)
+	{
+		CloseHandle(tf->mapHandle);
+		tf->mapHandle = nullptr;
+		return;
+	}
+
+	tf->mapBytes = static_cast<u64>(size.QuadPart);
+#else
+	struct stat st;
+	int fd = fileno(tf->fcb);
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		return;
+	}
+
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		return;
+	}
+
+	tf->map = static_cast<u8 *>(p);
+	tf->mapBytes = static_cast<u64>(st.st_size);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Remove the mapping of a container.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapUnmap(TapFile *tf)
+{
+	if (tf->map == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(tf->map);
+	CloseHandle(tf->mapHandle);
+	tf->mapHandle = nullptr;
+#else
+	munmap(tf->map, static_cast<size_t>(tf->mapBytes));
+#endif
+	tf->map = nullptr;
+	tf->mapBytes = 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write out both buffers of a container, waiting for
+**                  the writer thread if it is busy with it.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapSync(TapFile *tf)
+{
+	if (tf->fill == nullptr)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&tf->lock);
+	if (tf->pendingBytes != 0)
+	{
+		tapWriteBuffer(tf, tf->pendingStart, tf->pending, tf->pendingBytes);
+		tf->pendingBytes = 0;
+	}
+
+	EnterCriticalSection(&tf->fillLock);
+	if (tf->fillBytes != 0)
+	{
+		tapWriteBuffer(tf, tf->fillStart, tf->fill, tf->fillBytes);
+		tf->fillBytes = 0;
+	}
+
+	LeaveCriticalSection(&tf->fillLock);
+	LeaveCriticalSection(&tf->lock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hand the fill buffer of a container to the writer
+**                  thread. If the thread has not yet written the previous
+**                  one, that is written here first.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapHandOff(TapFile *tf)
+{
+	EnterCriticalSection(&tf->lock);
+	if (tf->pendingBytes != 0)
+	{
+		tapWriteBuffer(tf, tf->pendingStart, tf->pending, tf->pendingBytes);
+	}
+
+	EnterCriticalSection(&tf->fillLock);
+	u8 *buffer = tf->pending;
+	tf->pending = tf->fill;
+	tf->pendingBytes = tf->fillBytes;
+	tf->pendingStart = tf->fillStart;
+	tf->fill = buffer;
+	tf->fillBytes = 0;
+	LeaveCriticalSection(&tf->fillLock);
+	LeaveCriticalSection(&tf->lock);
+
+	WakeConditionVariable(&tapWork);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write out what a container has buffered (writer
+**                  thread). The pending buffer is written, and then the
+**                  records collected in the fill buffer meanwhile, so
+**                  no record stays in memory longer than one pass.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapFlush(TapFile *tf)
+{
+	EnterCriticalSection(&tf->lock);
+	if (tf->pendingBytes != 0)
+	{
+		tapWriteBuffer(tf, tf->pendingStart, tf->pending, tf->pendingBytes);
+		tf->pendingBytes = 0;
+	}
+
+	/*
+	**  Take the fill buffer over; the emulation goes on with the
+	**  empty pending one while it is written.
+	*/
+	EnterCriticalSection(&tf->fillLock);
+	if (tf->fill != nullptr && tf->fillBytes != 0)
+	{
+		u8 *buffer = tf->pending;
+		tf->pending = tf->fill;
+		tf->pendingBytes = tf->fillBytes;
+		tf->pendingStart = tf->fillStart;
+		tf->fill = buffer;
+		tf->fillBytes = 0;
+	}
+
+	LeaveCriticalSection(&tf->fillLock);
+
+	if (tf->pendingBytes != 0)
+	{
+		tapWriteBuffer(tf, tf->pendingStart, tf->pending, tf->pendingBytes);
+		tf->pendingBytes = 0;
+	}
+
+	LeaveCriticalSection(&tf->lock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Wait until the writer thread is done with a container
+**                  which has been taken out of the list. The caller holds
+**                  tapListMutex.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapWaitWriter(TapFile *tf)
+{
+	while (tf->writerBusy)
+	{
+		SleepConditionVariableCS(&tapIdle, &tapListMutex, INFINITE);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write a buffer to a container. The caller holds the
+**                  container's lock.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  offset      file offset of the buffer
+**                  buffer      data
+**                  bytes       number of bytes
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapWriteBuffer(TapFile *tf, i64 offset, u8 *buffer, u32 bytes)
+{
+	if (TapSeek(tf->fcb, offset) != 0
+		|| fwrite(buffer, 1, bytes, tf->fcb) != bytes
+		|| fflush(tf->fcb) != 0)
+	{
+		logError(LogErrorLocation, "%s - error writing tape", tf->name);
+	}
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write out and free a container no longer in the list.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapRelease(TapFile *tf)
+{
+	tapSync(tf);
+	tapUnmap(tf);
+	if (tf->stream == nullptr)
+	{
+		TapSeek(tf->fcb, tf->position);
+	}
+	else
+	{
+		/*
+		**  The read-ahead thread frees the stream once it has closed the
+		**  decompressor.
+		*/
+		TapStream *sp = tf->stream;
+		EnterCriticalSection(&sp->lock);
+		sp->stop = true;
+		WakeConditionVariable(&sp->consumed);
+		LeaveCriticalSection(&sp->lock);
+	}
+
+	DeleteCriticalSection(&tf->lock);
+	DeleteCriticalSection(&tf->fillLock);
+	free(tf->records);
+	free(tf->fill);
+	free(tf->pending);
+	free(tf->buffer);
+	free(tf);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Get a little endian TAP record length.
+**
+**  Parameters:     Name        Description.
+**                  p           first byte
+**
+**  Returns:        Length.
+**
+**------------------------------------------------------------------------*/
+static u32 tapGet32(u8 *p)
+{
+	return(static_cast<u32>(p[0]) | (static_cast<u32>(p[1]) << 8) | (static_cast<u32>(p[2]) << 16) | (static_cast<u32>(p[3]) << 24));
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Put a little endian TAP record length.
+**
+**  Parameters:     Name        Description.
+**                  p           first byte
+**                  value       length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapPut32(u8 *p, u32 value)
+{
+	p[0] = static_cast<u8>(value >> 0);
+	p[1] = static_cast<u8>(value >> 8);
+	p[2] = static_cast<u8>(value >> 16);
+	p[3] = static_cast<u8>(value >> 24);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Forget the record index of a container. The index
+**                  memory is kept.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapIndexReset(TapFile *tf)
+{
+	tf->count = 0;
+	tf->end = 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a record to the index if it starts where the
+**                  indexed part of the tape ends. Records met anywhere
+**                  else are already indexed or lie beyond a gap.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  position    file offset of the TAP record header
+**                  length      record length, 0 for a tape mark
+**                  end         file offset following the record
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapIndexAdd(TapFile *tf, i64 position, u32 length, i64 end)
+{
+	if (position != tf->end)
+	{
+		return;
+	}
+
+	if (tf->count == tf->max)
+	{
+		u32 max = tf->max == 0 ? TapIndexSize : tf->max * 2;
+		TapRecord *records = static_cast<TapRecord *>(realloc(tf->records, max * sizeof(TapRecord)));
+		if (records == nullptr)
+		{
+			/*
+			**  The rest of the tape is just not indexed.
+			*/
+			return;
+		}
+
+		tf->records = records;
+		tf->max = max;
+	}
+
+	tf->records[tf->count].offset = position;
+	tf->records[tf->count].length = length;
+	tf->count += 1;
+	tf->end = end;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the indexed record starting at a file offset.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  position    file offset
+**
+**  Returns:        Record number, the number of indexed records if the
+**                  offset is the end of the indexed part, or -1 if the
+**                  offset is not covered by the index.
+**
+**------------------------------------------------------------------------*/
+static i32 tapIndexFind(TapFile *tf, i64 position)
+{
+	if (position == tf->end)
+	{
+		return(tf->count);
+	}
+
+	u32 lo = 0;
+	u32 hi = tf->count;
+	while (lo < hi)
+	{
+		u32 mid = (lo + hi) / 2;
+		if (tf->records[mid].offset < position)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return(lo < tf->count && tf->records[lo].offset == position ? static_cast<i32>(lo) : -1);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Drop the records at and after a file offset from the
+**                  index, as writing there makes them unreachable.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  position    file offset about to be written
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapIndexTruncate(TapFile *tf, i64 position)
+{
+	if (position >= tf->end)
+	{
+		return;
+	}
+
+	i32 record = tapIndexFind(tf, position);
+	if (record < 0)
+	{
+		tapIndexReset(tf);
+		return;
+	}
+
+	tf->count = record;
+	tf->end = position;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the file offset of an indexed record.
+**
+**  Parameters:     Name        Description.
+**                  tf          container
+**                  record      record number, up to the number of
+**                              indexed records for the end
+**
+**  Returns:        File offset.
+**
+**------------------------------------------------------------------------*/
+static i64 tapIndexOffset(TapFile *tf, i32 record)
+{
+	return(record < static_cast<i32>(tf->count) ? tf->records[record].offset : tf->end);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the TAP writer thread, once.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void tapCreateThread()
+{
+	EnterCriticalSection(&tapListMutex);
+	if (tapWriterRunning)
+	{
+		LeaveCriticalSection(&tapListMutex);
+		return;
+	}
+
+	tapWriterRunning = true;
+	LeaveCriticalSection(&tapListMutex);
+
+#if defined(_WIN32)
+	DWORD dwThreadId;
+
+	HANDLE hThread = CreateThread(
+		nullptr,                                       // no security attribute
+		0,                                          // default stack size
+		reinterpret_cast<LPTHREAD_START_ROUTINE>(tapThread),
+		static_cast<LPVOID>(nullptr),                               // thread parameter
+		0,                                          // not suspended
+		&dwThreadId);                               // returns thread ID
+
+	if (hThread == nullptr)
+	{
+		fprintf(stderr, "Failed to create TAP writer thread\n");
+		exit(1);
+	}
+#else
+	int rc;
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	rc = pthread_create(&thread, &attr, tapThread, NULL);
+	if (rc < 0)
+	{
+		fprintf(stderr, "Failed to create TAP writer thread\n");
+		exit(1);
+	}
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        TAP writer thread. Writes out the buffered records of
+**                  all containers, waking when a buffer is handed off or
+**                  every TapFlushMs milliseconds. tapListMutex is only
+**                  held to pick the next container; the container is
+**                  marked busy so it is not released while it is written.
+**
+**  Parameters:     Name        Description.
+**                  param       Thread parameter (unused)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void tapThread(void *param)
+#else
+static void *tapThread(void *param)
+#endif
+{
+	(void)param;
+	u32 pass = 0;
+
+	EnterCriticalSection(&tapListMutex);
+	while (BigIron->emulationActive)
+	{
+		SleepConditionVariableCS(&tapWork, &tapListMutex, TapFlushMs);
+		pass += 1;
+
+		/*
+		**  The list may change while a container is written, so each
+		**  container is looked for from the start of the list.
+		*/
+		for (;;)
+		{
+			TapFile *tf = firstTap;
+			while (tf != nullptr && (tf->writerPass == pass || tf->fill == nullptr))
+			{
+				tf = tf->next;
+			}
+
+			if (tf == nullptr)
+			{
+				break;
+			}
+
+			tf->writerPass = pass;
+			tf->writerBusy = true;
+			LeaveCriticalSection(&tapListMutex);
+
+			tapFlush(tf);
+
+			EnterCriticalSection(&tapListMutex);
+			tf->writerBusy = false;
+			WakeAllConditionVariable(&tapIdle);
+		}
+	}
+
+	LeaveCriticalSection(&tapListMutex);
+
+#if !defined(_WIN32)
+	return NULL;
+#endif
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -235,11 +235,9 @@
 typedef struct portParam
 {
 	u8          id;
-	bool        active;
-	SOCKET         connFd;
+	MuxPort     *port;
 	PpWord      status;
 	char        input;
-	char        output[512];
 } PortParam;
 
 /*
@@ -252,7 +250,6 @@ static void tpMuxIo(u8 mfrId);
 static void tpMuxActivate(u8 mfrId);
 static void tpMuxDisconnect(u8 mfrId);
 static void tpMuxCreateThread(DevSlot *dp);
-static int tpMuxCheckInput(PortParam *mp);
 #if defined(_WIN32)
 static void tpMuxThread(void *param);
 #else
@@ -318,8 +315,7 @@ void tpMuxInit(u8 mfrID, u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
 	for (u8 i = 0; i < telnetConns; i++)
 	{
 		mp->status = 00026;
-		mp->active = false;
-		mp->connFd = 0;
+		mp->port = muxPortOpen("tpMux", i);
 		mp->id = i;
 		mp += 1;
 	}
@@ -426,8 +422,8 @@ static void tpMuxIo(u8 mfrId)
 	case FcTpmStatusSumary:
 		if (!mfr->activeChannel->full)
 		{
-			if (mp->active
-				&& (mp->input = tpMuxCheckInput(mp)) > 0)
+			if (muxPortActive(mp->port)
+				&& (mp->input = static_cast<char>(muxPortGet(mp->port))) > 0)
 			{
 				mp->status |= 00010;
 			}
@@ -461,18 +457,12 @@ static void tpMuxIo(u8 mfrId)
 			*/
 			mfr->activeChannel->full = false;
 
-			if (mp->active)
+			if (muxPortActive(mp->port))
 			{
 				/*
 				**  Port with active TCP connection.
 				*/
-				mp->output[mfr->activeDevice->recordLength] = static_cast<char>(mfr->activeChannel->data) & 0177;
-				mfr->activeDevice->recordLength++;
-				if (mfr->activeDevice->recordLength == sizeof(mp->output))
-				{
-					send(mp->connFd, mp->output, mfr->activeDevice->recordLength, 0);
-					mfr->activeDevice->recordLength = 0;
-				}
+				muxPortPut(mp->port, mfr->activeChannel->data & 0177);
 #if DEBUG
 				printf("write port %d - %04o\n", mp->id, activeChannel->data);
 #endif
@@ -515,11 +505,7 @@ static void tpMuxDisconnect(u8 mfrId)
 
 	if (mfr->activeDevice->fcode == FcTpmWriteChar)
 	{
-		if (mp->active)
-		{
-			send(mp->connFd, mp->output, mfr->activeDevice->recordLength, 0);
-			mfr->activeDevice->recordLength = 0;
-		}
+		muxPortFlush(mp->port);
 	}
 }
 
@@ -653,7 +639,7 @@ static void *tpMuxThread(void *param)
 		PortParam *mp = static_cast<PortParam *>(dp->context[0]);
 		for (i = 0; i < telnetConns; i++)
 		{
-			if (!mp->active)
+			if (!muxPortActive(mp->port))
 			{
 				break;
 			}
@@ -678,12 +664,12 @@ static void *tpMuxThread(void *param)
 		**  Wait for a connection.
 		*/
 		int fromLen = sizeof(from);
-		mp->connFd = accept(listenFd, reinterpret_cast<struct sockaddr *>(&from), &fromLen);
+		SOCKET connFd = accept(listenFd, reinterpret_cast<struct sockaddr *>(&from), &fromLen);
 
 		/*
 		**  Mark connection as active.
 		*/
-		mp->active = true;
+		muxPortAttach(mp->port, connFd);
 		printf("tpMux: Received connection on port %d\n", mp->id);
 	}
 
@@ -692,65 +678,4 @@ static void *tpMuxThread(void *param)
 #endif
 }
 
-/*--------------------------------------------------------------------------
-**  Purpose:        Check for input.
-**
-**  Parameters:     Name        Description.
-**                  mp          pointer to mux parameters.
-**
-**  Returns:        Nothing.
-**
-**------------------------------------------------------------------------*/
-static int tpMuxCheckInput(PortParam *mp)
-{
-	fd_set readFds;
-	fd_set exceptFds;
-	struct timeval timeout;
-	char data;
-
-	FD_ZERO(&readFds);
-	FD_ZERO(&exceptFds);
-	FD_SET(mp->connFd, &readFds);
-	FD_SET(mp->connFd, &exceptFds);
-
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 0;
-
-	select((static_cast<int>(mp->connFd) + 1), &readFds, nullptr, &exceptFds, &timeout);
-	if (FD_ISSET(mp->connFd, &readFds))
-	{
-		int i = recv(mp->connFd, &data, 1, 0);
-		if (i == 1)
-		{
-			return(data);
-		}
-		else
-		{
-#if defined(_WIN32)
-			closesocket(mp->connFd);
-#else
-			close(mp->connFd);
-#endif
-			mp->active = false;
-			printf("tpMux: Connection dropped on port %d\n", mp->id);
-			return(-1);
-		}
-	}
-	else if (FD_ISSET(mp->connFd, &exceptFds))
-	{
-#if defined(_WIN32)
-		closesocket(mp->connFd);
-#else
-		close(mp->connFd);
-#endif
-		mp->active = false;
-		printf("tpMux: Connection dropped on port %d\n", mp->id);
-		return(-1);
-	}
-	else
-	{
-		return(0);
-	}
-}
-
 /*---------------------------  End Of File  ------------------------------*/
@@ -132,6 +132,7 @@ typedef struct devSlot
     void            (*full)();      /* PCI channel full request */
     void            (*empty)();     /* PCI channel empty request */
     u16             (*flags)();     /* PCI channel flags request */
+    void            (*snapshot)(struct devSlot *dp, FILE *fcb, bool restore); /* optional device state save/restore */
     void            *context[MaxUnits2];/* device specific context data */
     void            *controllerContext; /* controller specific context data */
     PpWord          status;             /* device status */
@@ -215,6 +216,97 @@ typedef struct
 
     } CpuContext;
 
+/*
+**  Host thread accounting.
+*/
+typedef struct
+    {
+    u64             startUs;            /* host time the thread started */
+    u64             parkedUs;           /* host time spent blocked with nothing to do */
+    u32             parks;              /* number of times the thread blocked */
+    } ThreadStats;
+
+/*
+**  ECS flag register shared between emulator processes.
+*/
+typedef struct
+    {
+    volatile i32    flagRegister;       /* ECS flag register */
+    volatile i32    ready;              /* creator has initialised the segment */
+    volatile i32    words;              /* ECS size agreed by all processes */
+    volatile i32    creator;            /* process ID of the creator */
+    volatile i32    pid[MaxEcsSharers]; /* processes using the segment, 0 if free */
+    } EcsShare;
+
+/*
+**  Host memory holding CM or ECS, optionally backed by a file.
+*/
+typedef struct
+    {
+    CpWord          *mem;               /* emulated memory */
+    u32             words;              /* size in 60 bit words */
+    char            name[16];           /* backing file name in persistDir */
+    bool            mapped;             /* backing file is mapped, not copied */
+    FILE            *fcb;               /* backing file when copied */
+    u32             pages;              /* size in MemPageWords pages */
+    u8              *dirty;             /* pages written since last cut, null if not checkpointing */
+    u8              mfrID;              /* mainframe which takes the checkpoint cut */
+    bool            local;              /* only mfrID uses it, else cut with all mainframes held */
+    FILE            *ckpFcb[2];         /* checkpoint files, written in turn */
+    u32             ckpSlot;            /* checkpoint file written next */
+    u8              *ckpBehind;         /* pages the file written next lacks */
+    CpWord          *stage;             /* pages copied at the last cut */
+    u32             *stagePage;         /* page number of each staged page */
+    u32             stageCount;         /* number of staged pages */
+    u32             stageSize;          /* capacity of staging area in pages */
+    u32             pageKB;             /* host page size backing mem */
+    i32             node;               /* NUMA node holding mem, -1 if any */
+    u64             allocBytes;         /* size when page allocated, 0 if from calloc */
+    EcsShare        *share;             /* flag register when shared between processes */
+    bool            shareCreator;       /* this process created the shared segment */
+    int             shareSlot;          /* this process's entry in share->pid */
+#if defined(_WIN32)
+    HANDLE          fileHandle;         /* backing file when mapped */
+    HANDLE          mapHandle;          /* file mapping object */
+    HANDLE          shareHandle;        /* flag register mapping object */
+    HANDLE          shareLock;          /* serialises attach and detach */
+#else
+    int             fd;                 /* backing file when mapped */
+    int             shareFd;            /* flag register, locked during attach and detach */
+#endif
+    } MemStore;
+
+/*
+**  TAP tape container, private to tap.cpp.
+*/
+typedef struct tapFile TapFile;
+
+/*
+**  Print spool file, private to spool.cpp.
+*/
+typedef struct spool Spool;
+
+/*
+**  Card of a card deck, read and converted ahead of the card reader.
+*/
+typedef struct
+    {
+    u8              flags;              /* card reader specific flags */
+    PpWord          card[80];           /* card columns */
+    } DeckCard;
+
+/*
+**  Card reader input tray, private to deck.cpp. The tray's parse
+**  function converts one line of a deck file into a card.
+*/
+typedef struct deckTray DeckTray;
+typedef void (*DeckParse)(void *param, char *line, DeckCard *card);
+
+/*
+**  Terminal mux port, private to muxio.cpp.
+*/
+typedef struct muxPort MuxPort;
+
 /*
 **  Model specific feature set.
 */
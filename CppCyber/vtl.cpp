@@ -0,0 +1,793 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**  C++ adaptation by Dale Sinder 2017
+**
+**  Name: vtl.cpp
+**
+**  Description:
+**      Virtual tape library. When NOS asks for a tape by VSN on a
+**      mainframe's console, the library finds the image of the VSN and
+**      mounts it on the first free MT679 unit of that mainframe, so
+**      nobody has to find the image and pick a unit at the operator
+**      prompt. The operator can also request a VSN. A request which finds
+**      no free unit waits until one is unloaded.
+**
+**      VSN requests are recognised on the console by the text configured
+**      with tapeRequest (default "VSN="), followed by the VSN. Such a
+**      tape is mounted read only, unless the text configured with
+**      tapeRingRequest follows the VSN on the same line.
+**
+**      The library directory holds the images and an optional index,
+**      library.txt, with lines of the form
+**
+**          <vsn> <image file>
+**
+**      A VSN without an index line is looked for as <vsn>.tap,
+**      <vsn>.tap.gz and <vsn>.tap.zst in the library directory.
+**      Compressed images are mounted read only and decompressed while
+**      they are read (see tap.cpp).
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "stdafx.h"
+#include <sys/stat.h>
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define VtlIndexName            "library.txt"
+#define VtlMaxVsn               6
+#define VtlMaxRequest           20
+
+/*
+**  A VSN seen on the console is not requested again for this many
+**  seconds after it was unloaded or not found, as the request may still
+**  be displayed for a while.
+*/
+#define VtlHoldOff              30
+#define VtlRecentSize           32
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef enum
+{
+	VtlWaiting,                         /* waiting for a free unit */
+	VtlMounted,
+} VtlState;
+
+typedef struct vtlRequest
+{
+	struct vtlRequest *next;
+	char        vsn[VtlMaxVsn + 1];
+	char        image[_MAX_PATH + 1];   /* image in the library */
+	u8          mfrId;                  /* mainframe to mount on */
+	bool        ringIn;
+	VtlState    state;
+} VtlRequest;
+
+/*
+**  VSN recently unloaded or not found.
+*/
+typedef struct vtlRecent
+{
+	char        vsn[VtlMaxVsn + 1];
+	u8          mfrId;
+	time_t      until;
+} VtlRecent;
+
+/*
+**  Console text matched so far, per mainframe.
+*/
+typedef struct vtlWatcher
+{
+	u32         matched;                /* characters of the request text */
+	u32         length;                 /* characters of the VSN */
+	char        vsn[VtlMaxVsn + 1];
+	bool        pending;                /* VSN seen, looking for the ring text */
+	u32         ringMatched;            /* characters of the ring text */
+	char        previous;               /* character before the ring text */
+} VtlWatcher;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void vtlRequestSeen(u8 mfrId, char *vsn, bool ringIn);
+static void vtlQueue(char *vsn, char *image, u8 mfrId, bool ringIn);
+static bool vtlRequested(char *vsn);
+static void vtlHoldOff(char *vsn, u8 mfrId);
+static bool vtlLookup(char *vsn, char *image);
+static bool vtlExists(char *path);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static char vtlDir[_MAX_PATH + 1];
+static bool vtlConfigured = false;
+static VtlRequest *firstRequest = nullptr;
+static volatile u32 vtlWaiting = 0;
+static CRITICAL_SECTION vtlMutex;
+static char vtlRequestText[VtlMaxRequest + 1];
+static u32 vtlRequestLength = 0;
+static char vtlRingText[VtlMaxRequest + 1];
+static u32 vtlRingLength = 0;
+static VtlWatcher vtlWatchers[MaxMainFrames];
+static VtlRecent vtlRecent[VtlRecentSize];
+static u32 vtlRecentNext = 0;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Initialise the virtual tape library.
+**
+**  Parameters:     Name        Description.
+**                  dir         library directory
+**                  request     console text preceding a requested VSN,
+**                                  empty to mount on operator request only
+**                  ring        console text following the VSN when the
+**                                  tape needs a write ring, empty to
+**                                  mount console requests read only
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlInit(char *dir, char *request, char *ring)
+{
+	strncpy(vtlDir, dir, _MAX_PATH);
+	strncpy(vtlRequestText, request, VtlMaxRequest);
+	for (char *cp = vtlRequestText; *cp != 0; cp++)
+	{
+		*cp = static_cast<char>(toupper(*cp));
+	}
+
+	strncpy(vtlRingText, ring, VtlMaxRequest);
+	for (char *cp = vtlRingText; *cp != 0; cp++)
+	{
+		*cp = static_cast<char>(toupper(*cp));
+	}
+
+	vtlRequestLength = static_cast<u32>(strlen(vtlRequestText));
+	vtlRingLength = static_cast<u32>(strlen(vtlRingText));
+	InitializeCriticalSection(&vtlMutex);
+	vtlConfigured = true;
+
+	printf("Virtual tape library in %s\n", vtlDir);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Request a tape by VSN (operator interface).
+**
+**  Parameters:     Name        Description.
+**                  params      parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlMount(char *params)
+{
+	char vsn[80];
+	char image[_MAX_PATH + 1];
+	char unitMode = 'r';
+	int mfrId = 0;
+
+	if (!vtlConfigured)
+	{
+		printf("No tapeLibrary configured\n");
+		return;
+	}
+
+	int numParam = sscanf(params, "%79[^,],%c,%d", vsn, &unitMode, &mfrId);
+	if (numParam < 1)
+	{
+		printf("Not enough or invalid parameters\n");
+		return;
+	}
+
+	if (strlen(vsn) > VtlMaxVsn)
+	{
+		printf("Invalid VSN %s\n", vsn);
+		return;
+	}
+
+	if (unitMode != 'w' && unitMode != 'r')
+	{
+		printf("Invalid ring mode (r/w)\n");
+		return;
+	}
+
+	if (mfrId < 0 || mfrId >= BigIron->initMainFrames)
+	{
+		printf("Invalid mainframe no %o\n", mfrId);
+		return;
+	}
+
+	for (char *cp = vsn; *cp != 0; cp++)
+	{
+		*cp = static_cast<char>(toupper(*cp));
+	}
+
+	/*
+	**  A tape can only be on one unit at a time.
+	*/
+	if (vtlRequested(vsn))
+	{
+		printf("VSN %s already requested\n", vsn);
+		return;
+	}
+
+	if (!vtlLookup(vsn, image))
+	{
+		printf("VSN %s not in library\n", vsn);
+		return;
+	}
+
+	/*
+	**  The tape is mounted by the mainframe's own PP thread, the next
+	**  time its system talks to an MT679.
+	*/
+	vtlQueue(vsn, image, static_cast<u8>(mfrId), unitMode == 'w');
+	printf("VSN %s queued for mainframe %o\n", vsn, mfrId);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Look for VSN requests in the text a mainframe shows
+**                  on its console. Called on the mainframe's PP thread
+**                  for each character displayed, and with a newline
+**                  when the console is positioned.
+**
+**  Parameters:     Name        Description.
+**                  mfrId       mainframe
+**                  ch          ASCII character
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlWatch(u8 mfrId, char ch)
+{
+	if (vtlRequestLength == 0)
+	{
+		return;
+	}
+
+	VtlWatcher *wp = vtlWatchers + mfrId;
+
+	/*
+	**  After a VSN look for the ring text, as a word of its own, up to
+	**  the end of the line.
+	*/
+	if (wp->pending)
+	{
+		if (ch == '\n')
+		{
+			wp->pending = false;
+			vtlRequestSeen(mfrId, wp->vsn, false);
+		}
+		else if (wp->ringMatched > 0 || !isalnum(static_cast<u8>(wp->previous)))
+		{
+			if (ch == vtlRingText[wp->ringMatched])
+			{
+				wp->ringMatched += 1;
+				if (wp->ringMatched == vtlRingLength)
+				{
+					wp->pending = false;
+					vtlRequestSeen(mfrId, wp->vsn, true);
+				}
+			}
+			else
+			{
+				wp->ringMatched = 0;
+			}
+		}
+
+		wp->previous = ch;
+		if (wp->pending)
+		{
+			return;
+		}
+
+		wp->matched = 0;
+		wp->length = 0;
+		return;
+	}
+
+	/*
+	**  Match the request text.
+	*/
+	if (wp->matched < vtlRequestLength)
+	{
+		if (ch == vtlRequestText[wp->matched])
+		{
+			wp->matched += 1;
+		}
+		else
+		{
+			wp->matched = ch == vtlRequestText[0] ? 1 : 0;
+		}
+
+		wp->length = 0;
+		return;
+	}
+
+	/*
+	**  Collect the VSN following it, allowing for leading blanks.
+	*/
+	if (isalnum(static_cast<u8>(ch)))
+	{
+		/*
+		**  A longer name is no VSN.
+		*/
+		if (wp->length < VtlMaxVsn)
+		{
+			wp->vsn[wp->length] = ch;
+		}
+
+		if (wp->length <= VtlMaxVsn)
+		{
+			wp->length += 1;
+		}
+
+		return;
+	}
+
+	if (ch == ' ' && wp->length == 0)
+	{
+		return;
+	}
+
+	if (wp->length > 0 && wp->length <= VtlMaxVsn)
+	{
+		wp->vsn[wp->length] = 0;
+		if (vtlRingLength == 0 || ch == '\n')
+		{
+			vtlRequestSeen(mfrId, wp->vsn, false);
+		}
+		else
+		{
+			wp->pending = true;
+			wp->ringMatched = 0;
+			wp->previous = ch;
+			wp->matched = 0;
+			wp->length = 0;
+			return;
+		}
+	}
+
+	wp->matched = ch == vtlRequestText[0] ? 1 : 0;
+	wp->length = 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Mount requested tapes on free units of a mainframe.
+**                  Called by the tape driver, so tapes are only mounted
+**                  on the mainframe's own PP thread.
+**
+**  Parameters:     Name        Description.
+**                  mfrId       mainframe
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlPoll(u8 mfrId)
+{
+	if (vtlWaiting == 0)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&vtlMutex);
+
+	VtlRequest **link = &firstRequest;
+	while (*link != nullptr)
+	{
+		VtlRequest *rp = *link;
+
+		if (rp->state == VtlWaiting && rp->mfrId == mfrId)
+		{
+			i8 rc = mt679MountFree(mfrId, rp->image, rp->ringIn);
+			if (rc == 0)
+			{
+				/*
+				**  No free unit.
+				*/
+				break;
+			}
+
+			vtlWaiting -= 1;
+			if (rc < 0)
+			{
+				vtlHoldOff(rp->vsn, rp->mfrId);
+				*link = rp->next;
+				free(rp);
+				continue;
+			}
+
+			rp->state = VtlMounted;
+		}
+
+		link = &rp->next;
+	}
+
+	LeaveCriticalSection(&vtlMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release a library tape after it has been unloaded.
+**
+**  Parameters:     Name        Description.
+**                  fileName    file which was mounted
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlRelease(char *fileName)
+{
+	if (!vtlConfigured)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&vtlMutex);
+
+	for (VtlRequest **link = &firstRequest; *link != nullptr; link = &(*link)->next)
+	{
+		VtlRequest *rp = *link;
+		if (rp->state == VtlMounted && strcmp(rp->image, fileName) == 0)
+		{
+			vtlHoldOff(rp->vsn, rp->mfrId);
+			*link = rp->next;
+			free(rp);
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&vtlMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show outstanding tape requests (operator interface).
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlShowStatus()
+{
+	if (!vtlConfigured)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&vtlMutex);
+
+	for (VtlRequest *rp = firstRequest; rp != nullptr; rp = rp->next)
+	{
+		if (rp->state == VtlWaiting)
+		{
+			printf("VSN %-6s  waiting for a free unit on mainframe %o\n", rp->vsn, rp->mfrId);
+		}
+	}
+
+	LeaveCriticalSection(&vtlMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Free the outstanding requests.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void vtlTerminate()
+{
+	if (!vtlConfigured)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&vtlMutex);
+
+	while (firstRequest != nullptr)
+	{
+		VtlRequest *rp = firstRequest;
+		firstRequest = rp->next;
+		free(rp);
+	}
+
+	vtlWaiting = 0;
+
+	LeaveCriticalSection(&vtlMutex);
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Handle a VSN requested on a mainframe's console.
+**                  The console is refreshed continuously, so a VSN which
+**                  is already requested, or was just unloaded or not
+**                  found, is ignored.
+**
+**  Parameters:     Name        Description.
+**                  mfrId       mainframe
+**                  vsn         upper case VSN
+**                  ringIn      true if the request asks for a write ring
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void vtlRequestSeen(u8 mfrId, char *vsn, bool ringIn)
+{
+	char image[_MAX_PATH + 1];
+
+	if (vtlRequested(vsn))
+	{
+		return;
+	}
+
+	EnterCriticalSection(&vtlMutex);
+	time_t now = time(nullptr);
+	for (int i = 0; i < VtlRecentSize; i++)
+	{
+		VtlRecent *rp = vtlRecent + i;
+		if (rp->mfrId == mfrId && now < rp->until && strcmp(rp->vsn, vsn) == 0)
+		{
+			LeaveCriticalSection(&vtlMutex);
+			return;
+		}
+	}
+
+	LeaveCriticalSection(&vtlMutex);
+
+	if (!vtlLookup(vsn, image))
+	{
+		printf("\nVSN %s requested on mainframe %o is not in the library\n", vsn, mfrId);
+		EnterCriticalSection(&vtlMutex);
+		vtlHoldOff(vsn, mfrId);
+		LeaveCriticalSection(&vtlMutex);
+		return;
+	}
+
+	printf("\nVSN %s requested on mainframe %o\n", vsn, mfrId);
+	vtlQueue(vsn, image, mfrId, ringIn);
+	vtlPoll(mfrId);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Queue a request for a tape. Requests are served in
+**                  the order they were made.
+**
+**  Parameters:     Name        Description.
+**                  vsn         upper case VSN
+**                  image       image of the VSN
+**                  mfrId       mainframe to mount on
+**                  ringIn      true to mount with write ring
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void vtlQueue(char *vsn, char *image, u8 mfrId, bool ringIn)
+{
+	VtlRequest *rp = static_cast<VtlRequest *>(calloc(1, sizeof(VtlRequest)));
+	if (rp == nullptr)
+	{
+		printf("Failed to allocate tape request\n");
+		return;
+	}
+
+	strcpy(rp->vsn, vsn);
+	strcpy(rp->image, image);
+	rp->mfrId = mfrId;
+	rp->ringIn = ringIn && !tapCompressed(image);
+	rp->state = VtlWaiting;
+
+	EnterCriticalSection(&vtlMutex);
+	VtlRequest **link = &firstRequest;
+	while (*link != nullptr)
+	{
+		link = &(*link)->next;
+	}
+
+	*link = rp;
+	vtlWaiting += 1;
+	LeaveCriticalSection(&vtlMutex);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check if a VSN is waiting or mounted.
+**
+**  Parameters:     Name        Description.
+**                  vsn         upper case VSN
+**
+**  Returns:        TRUE if it is.
+**
+**------------------------------------------------------------------------*/
+static bool vtlRequested(char *vsn)
+{
+	bool found = false;
+
+	EnterCriticalSection(&vtlMutex);
+	for (VtlRequest *rp = firstRequest; rp != nullptr && !found; rp = rp->next)
+	{
+		found = strcmp(rp->vsn, vsn) == 0;
+	}
+
+	LeaveCriticalSection(&vtlMutex);
+
+	return(found);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Ignore a VSN on a mainframe's console for a while.
+**                  The caller holds vtlMutex.
+**
+**  Parameters:     Name        Description.
+**                  vsn         upper case VSN
+**                  mfrId       mainframe
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void vtlHoldOff(char *vsn, u8 mfrId)
+{
+	VtlRecent *rp = vtlRecent + vtlRecentNext;
+	vtlRecentNext = (vtlRecentNext + 1) % VtlRecentSize;
+
+	strcpy(rp->vsn, vsn);
+	rp->mfrId = mfrId;
+	rp->until = time(nullptr) + VtlHoldOff;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the image of a VSN.
+**
+**  Parameters:     Name        Description.
+**                  vsn         upper case VSN
+**                  image       returns path of the image, _MAX_PATH + 1
+**                              characters
+**
+**  Returns:        TRUE if found.
+**
+**------------------------------------------------------------------------*/
+static bool vtlLookup(char *vsn, char *image)
+{
+	char path[_MAX_PATH + 1];
+	char line[_MAX_PATH + 40];
+	char entry[40];
+	char file[261];
+	static const char *suffix[] = { ".tap", ".tap.gz", ".tap.zst" };
+	int len;
+
+	/*
+	**  The index is read on each request, so tapes may be added while
+	**  the emulator runs.
+	*/
+	len = snprintf(path, sizeof(path), "%s/%s", vtlDir, VtlIndexName);
+	FILE *fcb = len > 0 && len < static_cast<int>(sizeof(path)) ? fopen(path, "r") : nullptr;
+	if (fcb != nullptr)
+	{
+		while (fgets(line, sizeof(line), fcb) != nullptr)
+		{
+			if (line[0] == ';' || line[0] == '#' || sscanf(line, "%39s %260s", entry, file) != 2)
+			{
+				continue;
+			}
+
+			for (char *cp = entry; *cp != 0; cp++)
+			{
+				*cp = static_cast<char>(toupper(*cp));
+			}
+
+			if (strcmp(entry, vsn) != 0)
+			{
+				continue;
+			}
+
+			fclose(fcb);
+
+			/*
+			**  Relative names are in the library directory. A name
+			**  which does not fit is refused rather than truncated.
+			*/
+			if (file[0] == '/' || file[0] == '\\' || (file[0] != 0 && file[1] == ':'))
+			{
+				len = snprintf(image, _MAX_PATH + 1, "%s", file);
+			}
+			else
+			{
+				len = snprintf(image, _MAX_PATH + 1, "%s/%s", vtlDir, file);
+			}
+
+			if (len < 0 || len > _MAX_PATH)
+			{
+				printf("Image name of VSN %s is too long\n", vsn);
+				return(false);
+			}
+
+			return(vtlExists(image));
+		}
+
+		fclose(fcb);
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		len = snprintf(image, _MAX_PATH + 1, "%s/%s%s", vtlDir, vsn, suffix[i]);
+		if (len > 0 && len <= _MAX_PATH && vtlExists(image))
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check if a file exists.
+**
+**  Parameters:     Name        Description.
+**                  path        file name
+**
+**  Returns:        TRUE if it exists.
+**
+**------------------------------------------------------------------------*/
+static bool vtlExists(char *path)
+{
+	struct stat s;
+
+	return(stat(path, &s) == 0 && (s.st_mode & S_IFDIR) == 0);
+}
+
+/*---------------------------  End Of File  ------------------------------*/